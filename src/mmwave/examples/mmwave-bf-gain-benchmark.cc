@@ -0,0 +1,103 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * Micro-benchmark of the per-subband beamforming gain kernel of MmWave3gppChannel.
+ * The kernel, which rotates precomputed per-cluster delay phase ramps across the subbands,
+ * is compared with the direct evaluation of exp() for every subband and cluster pair.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mmwave-3gpp-channel.h"
+#include "ns3/mmwave-phy-mac-common.h"
+#include <ns3/system-wall-clock-ms.h>
+#include <iostream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+	uint32_t numCluster = 24;
+	uint32_t iterations = 20000;
+
+	CommandLine cmd;
+	cmd.AddValue ("numCluster", "number of clusters (including the sub-clusters)", numCluster);
+	cmd.AddValue ("iterations", "number of evaluations of each method", iterations);
+	cmd.Parse (argc, argv);
+
+	Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+	double fc = config->GetCentreFrequency ();
+	double chunkWidth = config->GetChunkWidth ();
+	double bw = chunkWidth * config->GetNumChunkPerRb () * config->GetNumRb ();
+	uint32_t numBands = config->GetTotalNumChunk ();
+
+	Ptr<UniformRandomVariable> rv = CreateObject<UniformRandomVariable> ();
+	complexVector_t longTerm, phase, phaseStep;
+	doubleVector_t delay;
+	for (uint32_t cIndex = 0; cIndex < numCluster; cIndex++)
+	{
+		longTerm.push_back (std::complex<double> (rv->GetValue (-1, 1), rv->GetValue (-1, 1)));
+		delay.push_back (rv->GetValue (0, 1e-6));
+		phase.push_back (exp (std::complex<double> (0, -2*M_PI*(fc - bw/2)*delay.back ())));
+		phaseStep.push_back (exp (std::complex<double> (0, -2*M_PI*chunkWidth*delay.back ())));
+	}
+	std::vector<double> txPsd (numBands, 1e-9);
+	std::vector<double> rxRef (numBands);
+	std::vector<double> rxKernel (numBands);
+
+	// reference: evaluate exp() for every subband and cluster pair
+	SystemWallClockMs clock;
+	clock.Start ();
+	for (uint32_t iter = 0; iter < iterations; iter++)
+	{
+		for (uint32_t iSubband = 0; iSubband < numBands; iSubband++)
+		{
+			std::complex<double> subsbandGain (0.0,0.0);
+			double fsb = fc - bw/2 + chunkWidth*iSubband;
+			for (uint32_t cIndex = 0; cIndex < numCluster; cIndex++)
+			{
+				double d = -2*M_PI*fsb*delay[cIndex];
+				subsbandGain = subsbandGain + longTerm[cIndex]*exp (std::complex<double> (0, d));
+			}
+			rxRef[iSubband] = txPsd[iSubband]*norm (subsbandGain);
+		}
+	}
+	int64_t refMs = clock.End ();
+
+	clock.Start ();
+	for (uint32_t iter = 0; iter < iterations; iter++)
+	{
+		MmWave3gppChannel::CalSubbandGain (&longTerm[0], &phase[0], &phaseStep[0], numCluster,
+				&txPsd[0], &rxKernel[0], numBands, 0, numBands);
+	}
+	int64_t kernelMs = clock.End ();
+
+	double maxRelErr = 0;
+	for (uint32_t iSubband = 0; iSubband < numBands; iSubband++)
+	{
+		maxRelErr = std::max (maxRelErr, std::abs (rxKernel[iSubband] - rxRef[iSubband])/rxRef[iSubband]);
+	}
+
+	std::cout << "subbands " << numBands << " clusters " << numCluster << " iterations " << iterations << std::endl;
+	std::cout << "exp per subband:    " << refMs << " ms" << std::endl;
+	std::cout << "phase ramp kernel:  " << kernelMs << " ms" << std::endl;
+	std::cout << "speedup:            " << (kernelMs > 0 ? (double)refMs/kernelMs : 0) << std::endl;
+	std::cout << "max relative error: " << maxRelErr << std::endl;
+	return 0;
+}
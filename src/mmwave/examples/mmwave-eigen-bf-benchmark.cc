@@ -0,0 +1,208 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * Benchmark of the long term covariance beamforming of MmWave3gppChannel.
+ * MmWave3gppChannel::CalDominantBeams (correlation matrices built from the channel tensor
+ * and Lanczos iteration) is compared with the 10 rounds of power iteration on the
+ * correlation matrices used before, in terms of runtime and of beamforming gain,
+ * on clustered channels for several array sizes.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mmwave-3gpp-channel.h"
+#include <ns3/system-wall-clock-ms.h>
+#include <iostream>
+
+using namespace ns3;
+
+/*
+ * Power iteration on the tx and rx correlation matrices, as computed by
+ * LongTermCovMatrixBeamforming before CalDominantBeams
+ */
+static complexVector_t
+PowerIteration (const complex2DVector_t &Q)
+{
+	uint8_t size = Q.size ();
+	complexVector_t antennaWeights = Q.at (0);
+	int iter = 10;
+	double diff = 1;
+	while(iter != 0 && diff>1e-10)
+	{
+		complexVector_t antennaWeights_New;
+		for(uint8_t row = 0; row<size; row++)
+		{
+			std::complex<double> sum(0,0);
+			for (uint8_t col = 0; col< size; col++)
+			{
+				sum += Q.at (row).at (col)*antennaWeights.at (col);
+			}
+			antennaWeights_New.push_back(sum);
+		}
+		double weightSum = 0;
+		for (uint8_t i = 0; i< size; i++)
+		{
+			weightSum += norm(antennaWeights_New.at(i));
+		}
+		diff = 0;
+		for (uint8_t i = 0; i< size; i++)
+		{
+			antennaWeights_New.at(i) = antennaWeights_New.at(i)/sqrt(weightSum);
+			diff += std::norm(antennaWeights_New.at(i)-antennaWeights.at(i));
+		}
+		iter--;
+		antennaWeights = antennaWeights_New;
+	}
+	return antennaWeights;
+}
+
+static void
+ReferenceBeams (const ChannelTensor3gpp &channel, complexVector_t &txW, complexVector_t &rxW)
+{
+	uint8_t txSize = channel.GetTxSize ();
+	uint8_t rxSize = channel.GetRxSize ();
+	uint8_t numCluster = channel.GetNumCluster ();
+	complex2DVector_t txQ (txSize, complexVector_t (txSize));
+	for (uint8_t t1Index = 0; t1Index < txSize; t1Index++)
+	{
+		for (uint8_t t2Index = 0; t2Index < txSize; t2Index++)
+		{
+			for(uint8_t rxIndex = 0; rxIndex < rxSize; rxIndex++)
+			{
+				for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+				{
+					txQ[t1Index][t2Index] += std::conj (channel (rxIndex, t1Index, cIndex))*channel (rxIndex, t2Index, cIndex);
+				}
+			}
+		}
+	}
+	txW = PowerIteration (txQ);
+
+	complex2DVector_t rxQ (rxSize, complexVector_t (rxSize));
+	for (uint8_t r1Index = 0; r1Index < rxSize; r1Index++)
+	{
+		for (uint8_t r2Index = 0; r2Index < rxSize; r2Index++)
+		{
+			for(uint8_t txIndex = 0; txIndex < txSize; txIndex++)
+			{
+				for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+				{
+					rxQ[r1Index][r2Index] += channel (r1Index, txIndex, cIndex)*std::conj (channel (r2Index, txIndex, cIndex));
+				}
+			}
+		}
+	}
+	rxW = PowerIteration (rxQ);
+}
+
+/*
+ * Sum over the clusters of the power of the long term component, as in CalLongTerm
+ */
+static double
+BeamformingGain (const ChannelTensor3gpp &channel, const complexVector_t &txW, const complexVector_t &rxW)
+{
+	double gain = 0;
+	for (uint8_t cIndex = 0; cIndex < channel.GetNumCluster (); cIndex++)
+	{
+		std::complex<double> longTerm (0,0);
+		for (uint16_t rxIndex = 0; rxIndex < channel.GetRxSize (); rxIndex++)
+		{
+			for (uint16_t txIndex = 0; txIndex < channel.GetTxSize (); txIndex++)
+			{
+				longTerm += std::conj (rxW[rxIndex])*channel (rxIndex, txIndex, cIndex)*txW[txIndex];
+			}
+		}
+		gain += std::norm (longTerm);
+	}
+	return gain;
+}
+
+/*
+ * Clustered channel: each cluster is a plane wave between two square arrays with half
+ * wavelength spacing, with exponentially decaying power.
+ */
+static void
+GenerateChannel (ChannelTensor3gpp &channel, uint16_t rxSize, uint16_t txSize, uint8_t numCluster,
+		Ptr<UniformRandomVariable> uniformRv, Ptr<NormalRandomVariable> normalRv)
+{
+	channel.Resize (rxSize, txSize, numCluster);
+	uint16_t rxSide = sqrt (rxSize);
+	uint16_t txSide = sqrt (txSize);
+	for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+	{
+		std::complex<double> gain = std::complex<double> (normalRv->GetValue (), normalRv->GetValue ())*exp (-0.3*cIndex);
+		double rxH = uniformRv->GetValue (-M_PI, M_PI), rxV = uniformRv->GetValue (0, M_PI);
+		double txH = uniformRv->GetValue (-M_PI, M_PI), txV = uniformRv->GetValue (0, M_PI);
+		for (uint16_t u = 0; u < rxSize; u++)
+		{
+			double rxPhase = M_PI*(sin (rxV)*sin (rxH)*(u % rxSide) + cos (rxV)*(u / rxSide));
+			for (uint16_t s = 0; s < txSize; s++)
+			{
+				double txPhase = M_PI*(sin (txV)*sin (txH)*(s % txSide) + cos (txV)*(s / txSide));
+				channel (u, s, cIndex) = gain*exp (std::complex<double> (0, rxPhase + txPhase));
+			}
+		}
+	}
+}
+
+int
+main (int argc, char *argv[])
+{
+	uint32_t numCluster = 20;
+	uint32_t numChannels = 20;
+
+	CommandLine cmd;
+	cmd.AddValue ("numCluster", "number of clusters (including the sub-clusters)", numCluster);
+	cmd.AddValue ("numChannels", "number of channels generated for each array size", numChannels);
+	cmd.Parse (argc, argv);
+
+	Ptr<UniformRandomVariable> uniformRv = CreateObject<UniformRandomVariable> ();
+	Ptr<NormalRandomVariable> normalRv = CreateObject<NormalRandomVariable> ();
+
+	uint16_t arraySizes[][2] = {{4, 4}, {16, 4}, {16, 16}, {64, 16}, {64, 64}};
+	std::cout << "txSize\trxSize\tpower iteration (ms)\tlanczos (ms)\tspeedup\tgain ratio (min/avg)" << std::endl;
+	for (uint8_t i = 0; i < sizeof (arraySizes)/sizeof (arraySizes[0]); i++)
+	{
+		uint16_t txSize = arraySizes[i][0];
+		uint16_t rxSize = arraySizes[i][1];
+		int64_t refMs = 0, newMs = 0;
+		double minRatio = 1e9, ratioSum = 0;
+		SystemWallClockMs clock;
+		for (uint32_t n = 0; n < numChannels; n++)
+		{
+			ChannelTensor3gpp channel;
+			GenerateChannel (channel, rxSize, txSize, numCluster, uniformRv, normalRv);
+			complexVector_t refTxW, refRxW, txW, rxW;
+
+			clock.Start ();
+			ReferenceBeams (channel, refTxW, refRxW);
+			refMs += clock.End ();
+
+			clock.Start ();
+			MmWave3gppChannel::CalDominantBeams (channel, txW, rxW);
+			newMs += clock.End ();
+
+			double ratio = BeamformingGain (channel, txW, rxW)/BeamformingGain (channel, refTxW, refRxW);
+			minRatio = std::min (minRatio, ratio);
+			ratioSum += ratio;
+		}
+		std::cout << txSize << "\t" << rxSize << "\t" << refMs << "\t" << newMs << "\t"
+				<< (newMs > 0 ? (double)refMs/newMs : 0) << "\t" << minRatio << "/" << ratioSum/numChannels << std::endl;
+	}
+	return 0;
+}
@@ -0,0 +1,89 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * Converter of a raytracing trace from the text format to the binary format of
+ * MmWaveRaytracingTrace. The binary file can be given to the TraceFile attribute of
+ * MmWaveChannelRaytracing, it is then mapped in memory instead of being parsed.
+ * The converted trace is read back and compared with the text trace, entirely and
+ * streamed with windows of windowSize snapshots.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mmwave-raytracing-trace.h"
+#include <ns3/system-wall-clock-ms.h>
+#include <iostream>
+
+using namespace ns3;
+
+int
+main (int argc, char *argv[])
+{
+	std::string input = "src/mmwave/model/Raytracing/Quadriga.txt";
+	std::string output = "Quadriga.bin";
+	uint32_t windowSize = 16;
+
+	CommandLine cmd;
+	cmd.AddValue ("input", "raytracing trace in the text format", input);
+	cmd.AddValue ("output", "raytracing trace in the binary format", output);
+	cmd.AddValue ("windowSize", "number of snapshots of a window of the streamed traces", windowSize);
+	cmd.Parse (argc, argv);
+
+	MmWaveRaytracingTrace::ConvertTextToBinary (input, output);
+
+	SystemWallClockMs clock;
+	clock.Start ();
+	Ptr<MmWaveRaytracingTrace> text = Create<MmWaveRaytracingTrace> ();
+	text->Open (input);
+	int64_t textMs = clock.End ();
+
+	clock.Start ();
+	Ptr<MmWaveRaytracingTrace> binary = Create<MmWaveRaytracingTrace> ();
+	binary->Open (output);
+	int64_t binaryMs = clock.End ();
+
+	NS_ABORT_MSG_IF (!binary->IsMapped (), "The converted trace is not in the binary format");
+	Ptr<MmWaveRaytracingTrace> streams[2] = {Create<MmWaveRaytracingTrace> (), Create<MmWaveRaytracingTrace> ()};
+	streams[0]->Open (input, windowSize);
+	streams[1]->Open (output, windowSize);
+
+	Ptr<MmWaveRaytracingTrace> traces[3] = {binary, streams[0], streams[1]};
+	for (uint8_t t = 0; t < 3; t++)
+	{
+		NS_ABORT_MSG_IF (text->GetNumSnapshots () != traces[t]->GetNumSnapshots (), "Different number of snapshots");
+	}
+	for (uint32_t index = 0; index < text->GetNumSnapshots (); index++)
+	{
+		RaytracingSnapshot a = text->GetSnapshot (index);
+		for (uint8_t t = 0; t < 3; t++)
+		{
+			RaytracingSnapshot b = traces[t]->GetSnapshot (index);
+			NS_ABORT_MSG_IF (a.m_numPath != b.m_numPath, "Different number of paths in snapshot " << index);
+			for (uint8_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+			{
+				NS_ABORT_MSG_IF (a.GetField ((RaytracingField)f) != b.GetField ((RaytracingField)f),
+						"Different values in snapshot " << index);
+			}
+		}
+	}
+
+	std::cout << "snapshots:         " << binary->GetNumSnapshots () << std::endl;
+	std::cout << "text parsing:      " << textMs << " ms" << std::endl;
+	std::cout << "binary mapping:    " << binaryMs << " ms" << std::endl;
+	return 0;
+}
@@ -0,0 +1,309 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/**
+ * Benchmark of the flex-TTI MAC schedulers. Each scheduler is driven through its SAPs, without
+ * MAC or PHY, for a number of subframes: the UEs report their DL-CQI, DL RLC buffer and UL BSR,
+ * the scheduler is triggered and the TB sizes of its allocations are drained from the queues.
+ * The traffic and the CQIs are the same for all the schedulers. The DL and UL throughput, the
+ * Jain fairness index of the DL throughput of the UEs, the CPU time and the part of it spent in
+ * SchedTriggerReq are reported.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/mmwave-mac-scheduler.h"
+#include "ns3/mmwave-phy-mac-common.h"
+#include <ns3/eps-bearer.h>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+/**
+ * Packet queues of the UEs, drained by the allocations of the scheduler
+ */
+class BenchmarkMacSchedSapUser : public MmWaveMacSchedSapUser
+{
+public:
+	struct Packet
+	{
+		uint32_t m_size;
+		double m_arrivalUs;
+	};
+
+	struct UeQueues
+	{
+		UeQueues () : m_dlSize (0), m_ulSize (0), m_dlBytes (0), m_ulBytes (0)
+		{
+		}
+		std::deque<Packet> m_dl;
+		uint64_t m_dlSize;
+		uint64_t m_ulSize;
+		uint64_t m_dlBytes;
+		uint64_t m_ulBytes;
+	};
+
+	BenchmarkMacSchedSapUser (uint32_t numUe)
+		: m_ues (numUe + 1)
+	{
+	}
+
+	virtual void SchedConfigInd (const struct SchedConfigIndParameters& params)
+	{
+		for (unsigned islot = 0; islot < params.m_sfAllocInfo.m_slotAllocInfo.size (); islot++)
+		{
+			const SlotAllocInfo &slot = params.m_sfAllocInfo.m_slotAllocInfo[islot];
+			if (slot.m_slotType == SlotAllocInfo::CTRL || slot.m_dci.m_rnti == 0 || slot.m_dci.m_rnti >= m_ues.size ())
+			{
+				continue;
+			}
+			UeQueues &ue = m_ues[slot.m_dci.m_rnti];
+			if (slot.m_tddMode == SlotAllocInfo::UL)
+			{
+				uint64_t served = std::min<uint64_t> (ue.m_ulSize, slot.m_dci.m_tbSize);
+				ue.m_ulSize -= served;
+				ue.m_ulBytes += served;
+				continue;
+			}
+			// the head packet is segmented if the TB is too small
+			uint32_t tbSize = slot.m_dci.m_tbSize;
+			while (tbSize > 0 && !ue.m_dl.empty ())
+			{
+				uint32_t served = std::min (tbSize, ue.m_dl.front ().m_size);
+				tbSize -= served;
+				ue.m_dlSize -= served;
+				ue.m_dlBytes += served;
+				ue.m_dl.front ().m_size -= served;
+				if (ue.m_dl.front ().m_size == 0)
+				{
+					ue.m_dl.pop_front ();
+				}
+			}
+		}
+	}
+
+	std::vector<UeQueues> m_ues;
+};
+
+class BenchmarkMacCschedSapUser : public MmWaveMacCschedSapUser
+{
+public:
+	virtual void CschedCellConfigCnf (const struct CschedCellConfigCnfParameters& params) {}
+	virtual void CschedUeConfigCnf (const struct CschedUeConfigCnfParameters& params) {}
+	virtual void CschedLcConfigCnf (const struct CschedLcConfigCnfParameters& params) {}
+	virtual void CschedLcReleaseCnf (const struct CschedLcReleaseCnfParameters& params) {}
+	virtual void CschedUeReleaseCnf (const struct CschedUeReleaseCnfParameters& params) {}
+	virtual void CschedUeConfigUpdateInd (const struct CschedUeConfigUpdateIndParameters& params) {}
+	virtual void CschedCellConfigUpdateInd (const struct CschedCellConfigUpdateIndParameters& params) {}
+};
+
+static uint8_t
+BufferSize2BsrId (uint64_t size)
+{
+	uint8_t index = 0;
+	while (index < 62 && BufferSizeLevelBsrTable[index] < size)
+	{
+		index++;
+	}
+	return index;
+}
+
+static void
+RunScheduler (std::string type, uint32_t numUe, uint32_t numSubframes,
+              uint32_t packetSize, double dlLoad, double ulLoad)
+{
+	Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+	ObjectFactory factory;
+	factory.SetTypeId (type);
+	Ptr<MmWaveMacScheduler> sched = factory.Create<MmWaveMacScheduler> ();
+	BenchmarkMacSchedSapUser schedUser (numUe);
+	BenchmarkMacCschedSapUser cschedUser;
+	sched->ConfigureCommonParameters (config);
+	sched->SetMacSchedSapUser (&schedUser);
+	sched->SetMacCschedSapUser (&cschedUser);
+	MmWaveMacSchedSapProvider *schedSap = sched->GetMacSchedSapProvider ();
+	MmWaveMacCschedSapProvider *cschedSap = sched->GetMacCschedSapProvider ();
+
+	// the same channel and traffic for every scheduler
+	Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable> ();
+	uniform->SetStream (1);
+
+	std::vector<uint8_t> meanCqi (numUe + 1);
+	for (uint16_t rnti = 1; rnti <= numUe; rnti++)
+	{
+		meanCqi[rnti] = 2 + uniform->GetInteger (0, 12);
+		MmWaveMacCschedSapProvider::CschedUeConfigReqParameters ueParams;
+		ueParams.m_rnti = rnti;
+		ueParams.m_transmissionMode = 0;
+		ueParams.m_reconfigureFlag = false;
+		cschedSap->CschedUeConfigReq (ueParams);
+
+		MmWaveMacCschedSapProvider::CschedLcConfigReqParameters lcParams;
+		lcParams.m_rnti = rnti;
+		lcParams.m_reconfigureFlag = false;
+		LogicalChannelConfigListElement_s lc;
+		lc.m_logicalChannelIdentity = 3;
+		lc.m_logicalChannelGroup = 1;
+		lc.m_direction = LogicalChannelConfigListElement_s::DIR_DL;
+		lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+		lc.m_qci = EpsBearer::NGBR_VIDEO_TCP_DEFAULT;
+		lc.m_eRabMaximulBitrateUl = lc.m_eRabMaximulBitrateDl = 0;
+		lc.m_eRabGuaranteedBitrateUl = lc.m_eRabGuaranteedBitrateDl = 0;
+		lcParams.m_logicalChannelConfigList.push_back (lc);
+		lc.m_direction = LogicalChannelConfigListElement_s::DIR_UL;
+		lcParams.m_logicalChannelConfigList.push_back (lc);
+		cschedSap->CschedLcConfigReq (lcParams);
+	}
+
+	SfnSf sfn (0, 0, 0);
+	std::clock_t start = std::clock ();
+	std::clock_t triggerCpu = 0;
+	for (uint32_t isf = 0; isf < numSubframes; isf++)
+	{
+		if (isf % 10 == 0)
+		{
+			MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters cqiParams;
+			cqiParams.m_sfnsf = sfn;
+			for (uint16_t rnti = 1; rnti <= numUe; rnti++)
+			{
+				DlCqiInfo cqi;
+				cqi.m_rnti = rnti;
+				cqi.m_ri = 1;
+				cqi.m_cqiType = DlCqiInfo::WB;
+				cqi.m_wbCqi = meanCqi[rnti] + uniform->GetInteger (0, 2) - 1;
+				cqi.m_wbPmi = 0;
+				cqiParams.m_cqiList.push_back (cqi);
+			}
+			schedSap->SchedDlCqiInfoReq (cqiParams);
+		}
+
+		MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters bsrParams;
+		bsrParams.m_sfnSf = sfn;
+		double nowUs = isf * config->GetSubframePeriod ();
+		for (uint16_t rnti = 1; rnti <= numUe; rnti++)
+		{
+			BenchmarkMacSchedSapUser::UeQueues &ue = schedUser.m_ues[rnti];
+			if (uniform->GetValue () < dlLoad)
+			{
+				BenchmarkMacSchedSapUser::Packet packet;
+				packet.m_size = packetSize;
+				packet.m_arrivalUs = nowUs;
+				ue.m_dl.push_back (packet);
+				ue.m_dlSize += packetSize;
+			}
+			if (uniform->GetValue () < ulLoad)
+			{
+				ue.m_ulSize += packetSize;
+			}
+			if (ue.m_dlSize > 0)
+			{
+				// reported like LteRlcUmLowLat, with the sizes and delays of the first 20 packets
+				MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters rlcParams;
+				rlcParams.m_rnti = rnti;
+				rlcParams.m_logicalChannelIdentity = 3;
+				rlcParams.m_rlcTransmissionQueueSize = ue.m_dlSize;
+				rlcParams.m_rlcTransmissionQueueHolDelay = nowUs - ue.m_dl.front ().m_arrivalUs;
+				rlcParams.m_rlcRetransmissionQueueSize = 0;
+				rlcParams.m_rlcRetransmissionHolDelay = 0;
+				rlcParams.m_rlcStatusPduSize = 0;
+				rlcParams.m_arrivalRate = 0;
+				for (unsigned i = 0; i < ue.m_dl.size () && i < 20; i++)
+				{
+					rlcParams.m_txPacketSizes.push_back (ue.m_dl[i].m_size);
+					rlcParams.m_txPacketDelays.push_back (nowUs - ue.m_dl[i].m_arrivalUs);
+				}
+				schedSap->SchedDlRlcBufferReq (rlcParams);
+			}
+			if (ue.m_ulSize > 0)
+			{
+				MacCeElement bsr;
+				bsr.m_rnti = rnti;
+				bsr.m_macCeType = MacCeElement::BSR;
+				bsr.m_macCeValue.m_bufferStatus.resize (4, 0);
+				bsr.m_macCeValue.m_bufferStatus[0] = BufferSize2BsrId (ue.m_ulSize);
+				bsrParams.m_macCeList.push_back (bsr);
+			}
+		}
+		schedSap->SchedUlMacCtrlInfoReq (bsrParams);
+
+		MmWaveMacSchedSapProvider::SchedTriggerReqParameters trigger;
+		trigger.m_snfSf = sfn;
+		std::clock_t triggerStart = std::clock ();
+		schedSap->SchedTriggerReq (trigger);
+		triggerCpu += std::clock () - triggerStart;
+
+		if (++sfn.m_sfNum == config->GetSubframesPerFrame ())
+		{
+			sfn.m_sfNum = 0;
+			sfn.m_frameNum++;
+		}
+	}
+	double cpuMs = 1000.0 * (std::clock () - start) / CLOCKS_PER_SEC;
+	double triggerMs = 1000.0 * triggerCpu / CLOCKS_PER_SEC;
+
+	double dlBytes = 0, ulBytes = 0, sumSq = 0;
+	for (uint16_t rnti = 1; rnti <= numUe; rnti++)
+	{
+		const BenchmarkMacSchedSapUser::UeQueues &ue = schedUser.m_ues[rnti];
+		dlBytes += ue.m_dlBytes;
+		ulBytes += ue.m_ulBytes;
+		sumSq += (double)ue.m_dlBytes * ue.m_dlBytes;
+	}
+	double duration = numSubframes * config->GetSubframePeriod () * 1e-6;
+	double fairness = (sumSq > 0) ? dlBytes * dlBytes / (numUe * sumSq) : 0;
+	std::cout << type << std::endl;
+	std::cout << "  DL throughput " << dlBytes * 8 / duration / 1e6 << " Mbps"
+	          << ", UL throughput " << ulBytes * 8 / duration / 1e6 << " Mbps"
+	          << ", DL fairness " << fairness
+	          << ", CPU " << cpuMs << " ms (" << 1000 * cpuMs / numSubframes << " us per subframe)" << std::endl;
+	std::cout << "  SchedTriggerReq CPU " << triggerMs << " ms (" << 1000 * triggerMs / numSubframes << " us per subframe)" << std::endl;
+
+	sched->Dispose ();
+}
+
+int
+main (int argc, char *argv[])
+{
+	uint32_t numUe = 200;
+	uint32_t numSubframes = 10000;
+	uint32_t packetSize = 1000;
+	double dlLoad = 0.2;
+	double ulLoad = 0;
+	std::string schedulers = "ns3::MmWaveFlexTtiMacScheduler,ns3::MmWaveFlexTtiPfMacScheduler,"
+			"ns3::MmWaveFlexTtiMaxRateMacScheduler,ns3::MmWaveFlexTtiMaxWeightMacScheduler";
+
+	CommandLine cmd;
+	cmd.AddValue ("numUe", "number of UEs", numUe);
+	cmd.AddValue ("numSubframes", "number of scheduled subframes", numSubframes);
+	cmd.AddValue ("packetSize", "size of the packets in bytes", packetSize);
+	cmd.AddValue ("dlLoad", "probability of a DL packet arrival for each UE in each subframe", dlLoad);
+	cmd.AddValue ("ulLoad", "probability of a UL packet arrival for each UE in each subframe", ulLoad);
+	cmd.AddValue ("schedulers", "comma separated TypeIds of the schedulers", schedulers);
+	cmd.Parse (argc, argv);
+
+	std::cout << numUe << " UEs, " << numSubframes << " subframes" << std::endl;
+	std::istringstream types (schedulers);
+	std::string type;
+	while (std::getline (types, type, ','))
+	{
+		RunScheduler (type, numUe, numSubframes, packetSize, dlLoad, ulLoad);
+	}
+	return 0;
+}
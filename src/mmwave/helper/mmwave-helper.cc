@@ -130,6 +130,7 @@ MmWaveHelper::DoDispose (void)
 {
 	NS_LOG_FUNCTION (this);
 	m_channel = 0;
+	m_schedTriggerBatch = 0;
 	Object::DoDispose ();
 }
 
@@ -140,6 +141,7 @@ MmWaveHelper::DoInitialize()
 
 	m_channel = m_channelFactory.Create<SpectrumChannel> ();
 	m_phyMacCommon = CreateObject <MmWavePhyMacCommon> () ;
+	m_schedTriggerBatch = CreateObject<MmWaveSchedTriggerBatch> ();
 
 	if (!m_pathlossModelType.empty ())
 	{
@@ -459,6 +461,8 @@ MmWaveHelper::InstallSingleEnbDevice (Ptr<Node> n)
 
 	Ptr<MmWaveEnbMac> mac = CreateObject<MmWaveEnbMac> ();
 	mac->SetConfigurationParameters (m_phyMacCommon);
+	mac->SetCellId (cellId);
+	mac->SetSchedTriggerBatch (m_schedTriggerBatch);
 	Ptr<MmWaveMacScheduler> sched = m_schedulerFactory.Create<MmWaveMacScheduler> ();
 
 	/*to use the dummy ffrAlgorithm, I changed the bandwidth to 25 in EnbNetDevice
@@ -152,6 +152,8 @@ private:
 
 	Ptr<MmWavePhyMacCommon> m_phyMacCommon;
 
+	Ptr<MmWaveSchedTriggerBatch> m_schedTriggerBatch; // shared by the MACs of the installed eNBs
+
 	ObjectFactory m_ffrAlgorithmFactory;
 	ObjectFactory m_enbAntennaModelFactory;
 	ObjectFactory m_ueAntennaModelFactory;
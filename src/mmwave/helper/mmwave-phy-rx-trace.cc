@@ -65,7 +65,7 @@ MmWavePhyRxTrace::GetTypeId (void)
 
 void
 MmWavePhyRxTrace::ReportCurrentCellRsrpSinrCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
-																uint64_t imsi, SpectrumValue& sinr, SpectrumValue& power)
+																uint64_t imsi, const SpectrumValue& sinr, const SpectrumValue& power)
 {
 	NS_LOG_INFO ("UE"<<imsi<<"->Generate RsrpSinrTrace");
 	phyStats->ReportInterferenceTrace (imsi, sinr);
@@ -74,7 +74,7 @@ MmWavePhyRxTrace::ReportCurrentCellRsrpSinrCallback (Ptr<MmWavePhyRxTrace> phySt
 
 void
 MmWavePhyRxTrace::UlSinrTraceCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
-																uint64_t imsi, SpectrumValue& sinr, SpectrumValue& power)
+																uint64_t imsi, const SpectrumValue& sinr, const SpectrumValue& power)
 {
 	NS_LOG_INFO ("UE"<<imsi<<"->Generate UlSinrTrace");
 	uint64_t slot_count = Now().GetMicroSeconds ()/125;
@@ -83,8 +83,8 @@ MmWavePhyRxTrace::UlSinrTraceCallback (Ptr<MmWavePhyRxTrace> phyStats, std::stri
 	char fname[255];
 	sprintf(fname, "UE_%llu_UL_SINR_dB.txt", (long long unsigned ) imsi);
 	log_file = fopen(fname, "a");
-	Values::iterator it = sinr.ValuesBegin();
-	while(it!=sinr.ValuesEnd())
+	Values::const_iterator it = sinr.ConstValuesBegin();
+	while(it!=sinr.ConstValuesEnd())
 	{
 		//fprintf(log_file, "%d\t%d\t%f\t \n", slot_count/2, rb_count, 10*log10(*it));
 		fprintf(log_file, "%llu\t%llu\t%d\t%f\t \n",(long long unsigned )slot_count/8+1, (long long unsigned )slot_count%8+1, rb_count, 10*log10(*it));
@@ -98,7 +98,7 @@ MmWavePhyRxTrace::UlSinrTraceCallback (Ptr<MmWavePhyRxTrace> phyStats, std::stri
 }
 
 void
-MmWavePhyRxTrace::ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr)
+MmWavePhyRxTrace::ReportInterferenceTrace (uint64_t imsi, const SpectrumValue& sinr)
 {
 	uint64_t slot_count = Now().GetMicroSeconds ()/125;
 	uint32_t rb_count = 1;
@@ -106,8 +106,8 @@ MmWavePhyRxTrace::ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr)
 	char fname[255];
 	sprintf(fname, "UE_%llu_SINR_dB.txt", (long long unsigned ) imsi);
 	log_file = fopen(fname, "a");
-	Values::iterator it = sinr.ValuesBegin();
-	while(it!=sinr.ValuesEnd())
+	Values::const_iterator it = sinr.ConstValuesBegin();
+	while(it!=sinr.ConstValuesEnd())
 	{
 		//fprintf(log_file, "%d\t%d\t%f\t \n", slot_count/2, rb_count, 10*log10(*it));
 		fprintf(log_file, "%llu\t%llu\t%d\t%f\t \n",(long long unsigned) slot_count/8+1, (long long unsigned) slot_count%8+1, rb_count, 10*log10(*it));
@@ -119,7 +119,7 @@ MmWavePhyRxTrace::ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr)
 }
 
 void
-MmWavePhyRxTrace::ReportPowerTrace (uint64_t imsi, SpectrumValue& power)
+MmWavePhyRxTrace::ReportPowerTrace (uint64_t imsi, const SpectrumValue& power)
 {
 
 	uint32_t slot_count = Now().GetMicroSeconds ()/125;
@@ -128,8 +128,8 @@ MmWavePhyRxTrace::ReportPowerTrace (uint64_t imsi, SpectrumValue& power)
 	char fname[255];
 	printf (fname, "UE_%llu_ReceivedPower_dB.txt", (long long unsigned) imsi);
 	log_file = fopen(fname, "a");
-	Values::iterator it = power.ValuesBegin();
-	while(it!=power.ValuesEnd())
+	Values::const_iterator it = power.ConstValuesBegin();
+	while(it!=power.ConstValuesEnd())
 	{
 		fprintf(log_file, "%llu\t%llu\t%d\t%f\t \n",(long long unsigned) slot_count/8+1,(long long unsigned) slot_count%8+1, rb_count, 10*log10(*it));
 		rb_count++;
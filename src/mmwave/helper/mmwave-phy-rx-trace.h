@@ -43,9 +43,9 @@ public:
 	virtual ~MmWavePhyRxTrace();
 	static TypeId GetTypeId (void);
 	static void ReportCurrentCellRsrpSinrCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
-						uint64_t imsi, SpectrumValue& sinr, SpectrumValue& power);
+						uint64_t imsi, const SpectrumValue& sinr, const SpectrumValue& power);
 	static void UlSinrTraceCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
-							uint64_t imsi, SpectrumValue& sinr, SpectrumValue& power);
+							uint64_t imsi, const SpectrumValue& sinr, const SpectrumValue& power);
 	static void ReportPacketCountUeCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
 			UePhyPacketCountParameter param);
 	static void ReportPacketCountEnbCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path,
@@ -56,8 +56,8 @@ public:
 	static void RxPacketTraceEnbCallback (Ptr<MmWavePhyRxTrace> phyStats, std::string path, RxPacketTraceParams param);
 
 private:
-	void ReportInterferenceTrace (uint64_t imsi, SpectrumValue& sinr);
-	void ReportPowerTrace (uint64_t imsi, SpectrumValue& power);
+	void ReportInterferenceTrace (uint64_t imsi, const SpectrumValue& sinr);
+	void ReportPowerTrace (uint64_t imsi, const SpectrumValue& power);
 	void ReportPacketCountUe (UePhyPacketCountParameter param);
 	void ReportPacketCountEnb (EnbPhyPacketCountParameter param);
 	void ReportDLTbSize (uint64_t imsi, uint64_t tbSize);
@@ -29,6 +29,8 @@
 #include <ns3/math.h>
 #include <ns3/simulator.h>
 #include "ns3/double.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
 
 
 NS_LOG_COMPONENT_DEFINE ("AntennaArrayModel");
@@ -36,6 +38,7 @@ NS_LOG_COMPONENT_DEFINE ("AntennaArrayModel");
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (AntennaArrayModel);
+NS_OBJECT_ENSURE_REGISTERED (AntennaSteeringCache);
 
 static const double Enb22DegreeBFVectorReal[8][64] = {
 		{1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,1.000000,-0.998179,0.992721,-0.983647,0.970990,-0.954796,0.935123,-0.912045,},
@@ -81,10 +84,269 @@ static const double All90DegreeBFVectorImag[2][4] = {
 };
 
 
+AntennaSteeringCache::AntennaSteeringCache ()
+	: m_resolution (0),
+	  m_interpolation (false),
+	  m_maxBytes (0),
+	  m_numZenith (0),
+	  m_numAzimuth (0),
+	  m_bytes (0),
+	  m_hits (0),
+	  m_misses (0)
+{
+}
+
+AntennaSteeringCache::~AntennaSteeringCache ()
+{
+}
+
+TypeId
+AntennaSteeringCache::GetTypeId ()
+{
+	static TypeId tid = TypeId ("ns3::AntennaSteeringCache")
+	.SetParent<Object> ()
+	.AddConstructor<AntennaSteeringCache> ()
+	.AddAttribute ("AngleResolution",
+			"Resolution in degrees of the zenith and azimuth grid of the cached steering vectors, "
+			"0 disables the cache and the steering vectors are computed exactly",
+			DoubleValue (0),
+			MakeDoubleAccessor (&AntennaSteeringCache::m_resolution),
+			MakeDoubleChecker<double> (0, 90))
+	.AddAttribute ("Interpolation",
+			"Interpolate the steering vectors of the four grid points around a direction, "
+			"instead of taking the nearest grid point",
+			BooleanValue (false),
+			MakeBooleanAccessor (&AntennaSteeringCache::m_interpolation),
+			MakeBooleanChecker ())
+	.AddAttribute ("MaxBytes",
+			"Maximum memory used by the cached steering vectors, the vectors that do not fit "
+			"are computed every time",
+			UintegerValue (64 << 20),
+			MakeUintegerAccessor (&AntennaSteeringCache::m_maxBytes),
+			MakeUintegerChecker<uint64_t> ())
+	;
+	return tid;
+}
+
+void
+AntennaSteeringCache::NotifyConstructionCompleted ()
+{
+	Object::NotifyConstructionCompleted ();
+	if (m_resolution > 0)
+	{
+		m_numZenith = std::max (1.0, round (180/m_resolution));
+		m_numAzimuth = std::max (1.0, round (360/m_resolution));
+	}
+}
+
+AntennaSteeringCache *
+AntennaSteeringCache::Get ()
+{
+	static Ptr<AntennaSteeringCache> cache = CreateObject<AntennaSteeringCache> ();
+	return PeekPointer (cache);
+}
+
+bool
+AntennaSteeringCache::IsEnabled () const
+{
+	return m_numZenith > 0;
+}
+
+void
+AntennaSteeringCache::CalSteeringVector (double disH, double disV, uint8_t *antennaNum,
+		double zenith, double azimuth, std::complex<double> *steering)
+{
+	double sinZenithCosAzimuth = sin(zenith)*cos(azimuth);
+	double sinZenithSinAzimuth = sin(zenith)*sin(azimuth);
+	double cosZenith = cos(zenith);
+	uint16_t size = antennaNum[0]*antennaNum[1];
+	for (uint16_t index = 0; index < size; index++)
+	{
+		// same location as AntennaArrayModel::GetAntennaLocation
+		Vector loc;
+		loc.x = 0;
+		loc.y = disH* (index % antennaNum[0]);
+		loc.z = disV* (index / antennaNum[1]);
+		double phase = 2*M_PI*(sinZenithCosAzimuth*loc.x + sinZenithSinAzimuth*loc.y + cosZenith*loc.z);
+		steering[index] = exp(std::complex<double>(0, phase));
+	}
+}
+
+void
+AntennaSteeringCache::GetSteeringVector (double disH, double disV, uint8_t *antennaNum,
+		double zenith, double azimuth, std::complex<double> *steering)
+{
+	if (!IsEnabled ())
+	{
+		CalSteeringVector (disH, disV, antennaNum, zenith, azimuth, steering);
+		return;
+	}
+
+	// fold the direction to zenith in [0, pi] and azimuth in [0, 2*pi)
+	zenith = fmod (zenith, 2*M_PI);
+	if (zenith < 0)
+	{
+		zenith += 2*M_PI;
+	}
+	if (zenith > M_PI)
+	{
+		zenith = 2*M_PI - zenith;
+		azimuth += M_PI;
+	}
+	azimuth = fmod (azimuth, 2*M_PI);
+	if (azimuth < 0)
+	{
+		azimuth += 2*M_PI;
+	}
+	double zenithPos = zenith/M_PI*m_numZenith;
+	double azimuthPos = azimuth/(2*M_PI)*m_numAzimuth;
+
+	Geometry *geometry = FindGeometry (disH, disV, antennaNum);
+	if (!m_interpolation)
+	{
+		uint32_t zenithIndex = std::min ((uint32_t)round (zenithPos), m_numZenith);
+		uint32_t azimuthIndex = (uint32_t)round (azimuthPos) % m_numAzimuth;
+		GetGridVector (*geometry, zenithIndex, azimuthIndex, steering);
+		return;
+	}
+
+	// bilinear interpolation of the four grid points around the direction, the elements are
+	// then projected back to unit modulus
+	uint16_t size = antennaNum[0]*antennaNum[1];
+	uint32_t zenithIndex = std::min ((uint32_t)zenithPos, m_numZenith - 1);
+	uint32_t azimuthIndex = (uint32_t)azimuthPos % m_numAzimuth;
+	double zenithWeight = std::min (zenithPos - zenithIndex, 1.0);
+	double azimuthWeight = azimuthPos - floor (azimuthPos);
+	std::complex<double> corners[4][256];
+	GetGridVector (*geometry, zenithIndex, azimuthIndex, corners[0]);
+	GetGridVector (*geometry, zenithIndex, (azimuthIndex + 1) % m_numAzimuth, corners[1]);
+	GetGridVector (*geometry, zenithIndex + 1, azimuthIndex, corners[2]);
+	GetGridVector (*geometry, zenithIndex + 1, (azimuthIndex + 1) % m_numAzimuth, corners[3]);
+	double w[4] = {(1 - zenithWeight)*(1 - azimuthWeight), (1 - zenithWeight)*azimuthWeight,
+			zenithWeight*(1 - azimuthWeight), zenithWeight*azimuthWeight};
+	for (uint16_t i = 0; i < size; i++)
+	{
+		std::complex<double> value = w[0]*corners[0][i] + w[1]*corners[1][i] + w[2]*corners[2][i] + w[3]*corners[3][i];
+		double magnitude = std::abs (value);
+		steering[i] = magnitude > 0 ? value/magnitude : corners[0][i];
+	}
+}
+
+AntennaSteeringCache::Geometry *
+AntennaSteeringCache::FindGeometry (double disH, double disV, uint8_t *antennaNum)
+{
+#ifdef HAVE_PTHREAD_H
+	CriticalSection lock (m_mutex);
+#endif
+	for (uint32_t i = 0; i < m_geometries.size (); i++)
+	{
+		Geometry &g = m_geometries[i];
+		if (g.m_antennaNum[0] == antennaNum[0] && g.m_antennaNum[1] == antennaNum[1]
+				&& g.m_spacing[0] == disH && g.m_spacing[1] == disV)
+		{
+			return &g;
+		}
+	}
+	Geometry g;
+	g.m_antennaNum[0] = antennaNum[0];
+	g.m_antennaNum[1] = antennaNum[1];
+	g.m_spacing[0] = disH;
+	g.m_spacing[1] = disV;
+	m_geometries.push_back (g);
+	NS_LOG_INFO ("New steering vector geometry " << (uint16_t)antennaNum[0] << "x" << (uint16_t)antennaNum[1]);
+	return &m_geometries.back ();
+}
+
+void
+AntennaSteeringCache::GetGridVector (Geometry &geometry, uint32_t zenithIndex, uint32_t azimuthIndex,
+		std::complex<double> *steering)
+{
+	uint16_t size = geometry.m_antennaNum[0]*geometry.m_antennaNum[1];
+	uint32_t key = zenithIndex*m_numAzimuth + azimuthIndex;
+	const complexVector_t *cached = 0;
+	{
+#ifdef HAVE_PTHREAD_H
+		CriticalSection lock (m_mutex);
+#endif
+		std::map<uint32_t, complexVector_t>::const_iterator it = geometry.m_vectors.find (key);
+		if (it != geometry.m_vectors.end ())
+		{
+			m_hits++;
+			cached = &it->second;
+		}
+		else
+		{
+			m_misses++;
+		}
+	}
+	if (cached != 0)
+	{
+		// the vector is not modified once inserted, the map nodes do not move
+		std::copy (cached->begin (), cached->end (), steering);
+		return;
+	}
+
+	CalSteeringVector (geometry.m_spacing[0], geometry.m_spacing[1], geometry.m_antennaNum,
+			M_PI*zenithIndex/m_numZenith, 2*M_PI*azimuthIndex/m_numAzimuth, steering);
+	uint64_t bytes = size*sizeof (std::complex<double>);
+#ifdef HAVE_PTHREAD_H
+	CriticalSection lock (m_mutex);
+#endif
+	// another thread may have inserted the same vector in the meantime
+	if (m_bytes + bytes <= m_maxBytes
+			&& geometry.m_vectors.insert (std::make_pair (key, complexVector_t (steering, steering + size))).second)
+	{
+		m_bytes += bytes;
+	}
+}
+
+uint64_t
+AntennaSteeringCache::GetHits () const
+{
+	return m_hits;
+}
+
+uint64_t
+AntennaSteeringCache::GetMisses () const
+{
+	return m_misses;
+}
+
+void
+AntennaSteeringCache::PrintStatistics (std::ostream &os) const
+{
+#ifdef HAVE_PTHREAD_H
+	CriticalSection lock (m_mutex);
+#endif
+	uint64_t vectors = 0;
+	for (uint32_t i = 0; i < m_geometries.size (); i++)
+	{
+		vectors += m_geometries[i].m_vectors.size ();
+	}
+	uint64_t lookups = m_hits + m_misses;
+	os << "steering vector cache: " << m_geometries.size () << " geometries, " << vectors << " vectors, "
+			<< m_bytes << " bytes, " << m_hits << " hits, " << m_misses << " misses, hit rate "
+			<< (lookups > 0 ? (double)m_hits/lookups : 0);
+}
+
+void
+AntennaSteeringCache::Clear ()
+{
+#ifdef HAVE_PTHREAD_H
+	CriticalSection lock (m_mutex);
+#endif
+	m_geometries.clear ();
+	m_bytes = 0;
+	m_hits = 0;
+	m_misses = 0;
+}
+
 AntennaArrayModel::AntennaArrayModel()
 	:m_minAngle (0),m_maxAngle(2*M_PI)
 {
 	m_omniTx = false;
+	// create the shared cache on the main thread
+	AntennaSteeringCache::Get ();
 }
 
 AntennaArrayModel::~AntennaArrayModel()
@@ -394,22 +656,25 @@ AntennaArrayModel::GetAntennaLocation(uint8_t index, uint8_t* antennaNum)
 void
 AntennaArrayModel::SetSector (uint8_t sector, uint8_t *antennaNum, double elevation)
 {
-	complexVector_t tempVector;
 	double hAngle_radian = M_PI*(double)sector/(double)antennaNum[1]-0.5*M_PI;
 	double vAngle_radian = elevation*M_PI/180;
 	uint16_t size = antennaNum[0]*antennaNum[1];
 	double power = 1/sqrt(size);
+	complexVector_t tempVector (size);
+	GetSteeringVector (vAngle_radian, hAngle_radian, antennaNum, &tempVector[0]);
 	for(int ind=0; ind<size; ind++)
 	{
-		Vector loc = GetAntennaLocation(ind, antennaNum);
-		double phase = -2*M_PI*(sin(vAngle_radian)*cos(hAngle_radian)*loc.x
-							+ sin(vAngle_radian)*sin(hAngle_radian)*loc.y
-							+ cos(vAngle_radian)*loc.z);
-		tempVector.push_back(exp(std::complex<double>(0, phase))*power);
+		tempVector[ind] = std::conj (tempVector[ind])*power;
 	}
 	m_beamformingVector = tempVector;
 }
 
+void
+AntennaArrayModel::GetSteeringVector (double zenith, double azimuth, uint8_t *antennaNum, std::complex<double> *steering)
+{
+	AntennaSteeringCache::Get ()->GetSteeringVector (m_disH, m_disV, antennaNum, zenith, azimuth, steering);
+}
+
 
 
 } /* namespace ns3 */
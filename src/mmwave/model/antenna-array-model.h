@@ -27,12 +27,118 @@
 #include <ns3/antenna-model.h>
 #include <complex>
 #include <ns3/net-device.h>
+#include <ns3/core-config.h>
 #include <map>
+#include <deque>
+#include <ostream>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-mutex.h>
+#endif
 
 namespace ns3 {
 
 typedef std::vector< std::complex<double> > complexVector_t;
 
+/**
+ * Process-wide cache of the steering vectors of the antenna array geometries, shared by all the
+ * AntennaArrayModel instances and hence by all the channel models using them. The directions are
+ * quantized on a grid of AngleResolution degrees in zenith and azimuth, a direction gets the vector
+ * of the nearest grid point or, with Interpolation, the interpolation of the four surrounding ones.
+ * The cache is disabled by default, i.e., the steering vectors are computed exactly.
+ * The attributes must be set with Config::SetDefault before the first antenna array is created.
+ * The cache can be used by the worker threads of the channel models: the lock is only held to look
+ * up and insert the geometries and the vectors, which are never modified once inserted, so that the
+ * steering vectors are computed and interpolated in parallel.
+ */
+class AntennaSteeringCache : public Object
+{
+public:
+	AntennaSteeringCache ();
+	virtual ~AntennaSteeringCache ();
+	static TypeId GetTypeId ();
+
+	/**
+	 * Returns the process-wide cache, created the first time. A raw pointer is returned
+	 * so that the reference count is not touched by the worker threads
+	 */
+	static AntennaSteeringCache *Get ();
+
+	bool IsEnabled () const;
+
+	/**
+	 * Compute the steering vector of an array geometry towards a direction
+	 * @params the horizontal spacing between the elements, in wavelengths
+	 * @params the vertical spacing between the elements, in wavelengths
+	 * @params the number of vertical and horizontal antenna elements
+	 * @params the zenith angle (rad)
+	 * @params the azimuth angle (rad)
+	 * @params the output, one entry per antenna element
+	 */
+	void GetSteeringVector (double disH, double disV, uint8_t *antennaNum,
+			double zenith, double azimuth, std::complex<double> *steering);
+
+	/**
+	 * Compute the exact steering vector, exp(j*2*pi*<direction, element location>) for each element
+	 * @params see GetSteeringVector
+	 */
+	static void CalSteeringVector (double disH, double disV, uint8_t *antennaNum,
+			double zenith, double azimuth, std::complex<double> *steering);
+
+	uint64_t GetHits () const;
+	uint64_t GetMisses () const;
+
+	/**
+	 * Print the number of geometries, vectors and bytes in the cache and the hit rate
+	 * @params the output stream
+	 */
+	void PrintStatistics (std::ostream &os) const;
+
+	/**
+	 * Remove all the vectors and reset the statistics, must not be called while other
+	 * threads use the cache
+	 */
+	void Clear ();
+
+protected:
+	virtual void NotifyConstructionCompleted ();
+
+private:
+	struct Geometry
+	{
+		uint8_t m_antennaNum[2];
+		double m_spacing[2];
+		std::map<uint32_t, complexVector_t> m_vectors; // grid point -> steering vector
+	};
+
+	/**
+	 * Returns the geometry, added to the cache the first time it is seen
+	 * @params see GetSteeringVector
+	 */
+	Geometry *FindGeometry (double disH, double disV, uint8_t *antennaNum);
+
+	/**
+	 * Copy the steering vector of a grid point to steering, computing it on a miss.
+	 * m_mutex is only held to look up and insert the vector
+	 */
+	void GetGridVector (Geometry &geometry, uint32_t zenithIndex, uint32_t azimuthIndex,
+			std::complex<double> *steering);
+
+	double m_resolution; // degrees, 0 if disabled
+	bool m_interpolation;
+	uint64_t m_maxBytes;
+
+	uint32_t m_numZenith; // number of grid intervals over [0, pi]
+	uint32_t m_numAzimuth; // number of grid points over [0, 2*pi)
+	std::deque<Geometry> m_geometries; // a deque so that adding a geometry does not move the others
+	uint64_t m_bytes;
+	uint64_t m_hits;
+	uint64_t m_misses;
+#ifdef HAVE_PTHREAD_H
+	mutable SystemMutex m_mutex;
+#endif
+};
+
 class AntennaArrayModel: public AntennaModel {
 public:
 	AntennaArrayModel();
@@ -51,6 +157,14 @@ public:
 	double GetRadiationPattern (double vangle, double hangle = 0);
 	Vector GetAntennaLocation (uint8_t index, uint8_t* antennaNum) ;
 	void SetSector (uint8_t sector, uint8_t *antennaNum, double elevation = 90);
+	/**
+	 * Compute the steering vector of the array towards a direction with the AntennaSteeringCache
+	 * @params the zenith angle (rad)
+	 * @params the azimuth angle (rad)
+	 * @params the number of vertical and horizontal antenna elements
+	 * @params the output, one entry per antenna element
+	 */
+	void GetSteeringVector (double zenith, double azimuth, uint8_t *antennaNum, std::complex<double> *steering);
 
 private:
 	bool m_omniTx;
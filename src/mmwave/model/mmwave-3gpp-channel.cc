@@ -37,10 +37,21 @@
 #include <ns3/double.h>
 #include <algorithm>
 #include <random>       // std::default_random_engine
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
 #include <ns3/boolean.h>
 #include <ns3/integer.h>
+#include <ns3/uinteger.h>
+#include <ns3/spectrum-value-pool.h>
+#include <ns3/core-config.h>
 #include "mmwave-spectrum-value-helper.h"
 
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-thread.h>
+#include <unistd.h>
+#endif
+
 
 namespace ns3{
 
@@ -159,7 +170,91 @@ static const double sqrtC_office_NLOS[6][6] = {
 
 
 
+// alignment in bytes of the channel coefficient buffer (one cache line)
+static const size_t CHANNEL_TENSOR_ALIGNMENT = 64;
+
+// thermal noise PSD (W/Hz) at 290 K, used by the relevance threshold
+static const double THERMAL_NOISE_PSD = 1.38e-23*290;
+
+// elevations (degrees) scanned by the beam search
+static const uint16_t BEAM_SEARCH_MIN_ELEVATION = 60;
+static const uint16_t BEAM_SEARCH_ELEVATION_STEP = 10;
+static const uint16_t BEAM_SEARCH_NUM_ELEVATIONS = 7;
+
+ChannelTensor3gpp::ChannelTensor3gpp ()
+	: m_data (0),
+	  m_capacity (0),
+	  m_rxSize (0),
+	  m_txSize (0),
+	  m_numCluster (0)
+{
+}
+
+ChannelTensor3gpp::ChannelTensor3gpp (const ChannelTensor3gpp &tensor)
+	: m_data (0),
+	  m_capacity (0),
+	  m_rxSize (0),
+	  m_txSize (0),
+	  m_numCluster (0)
+{
+	*this = tensor;
+}
+
+ChannelTensor3gpp&
+ChannelTensor3gpp::operator= (const ChannelTensor3gpp &tensor)
+{
+	if (this != &tensor)
+	{
+		Resize (tensor.m_rxSize, tensor.m_txSize, tensor.m_numCluster);
+		size_t size = (size_t)m_rxSize*m_txSize*m_numCluster;
+		if (size > 0)
+		{
+			std::memcpy (m_data, tensor.m_data, size*sizeof (std::complex<double>));
+		}
+	}
+	return *this;
+}
+
+ChannelTensor3gpp::~ChannelTensor3gpp ()
+{
+	std::free (m_data);
+}
+
+void
+ChannelTensor3gpp::Resize (uint16_t rxSize, uint16_t txSize, uint8_t numCluster)
+{
+	size_t size = (size_t)rxSize*txSize*numCluster;
+	if (size > m_capacity)
+	{
+		std::free (m_data);
+		void *buffer = 0;
+		if (posix_memalign (&buffer, CHANNEL_TENSOR_ALIGNMENT, size*sizeof (std::complex<double>)) != 0)
+		{
+			NS_FATAL_ERROR ("unable to allocate the channel tensor");
+		}
+		m_data = static_cast<std::complex<double>*> (buffer);
+		m_capacity = size;
+	}
+	m_rxSize = rxSize;
+	m_txSize = txSize;
+	m_numCluster = numCluster;
+	std::fill (m_data, m_data + size, std::complex<double> (0,0));
+}
+
+void
+ChannelTensor3gpp::Clear ()
+{
+	m_rxSize = 0;
+	m_txSize = 0;
+	m_numCluster = 0;
+}
+
 MmWave3gppChannel::MmWave3gppChannel ()
+	: m_numEnb (0),
+	  m_numUe (0),
+	  m_batchUpdate (false),
+	  m_updateThreads (0),
+	  m_hierarchicalBeamSearch (false)
 {
 	m_uniformRv = CreateObject<UniformRandomVariable> ();
 	m_uniformRvBlockage = CreateObject<UniformRandomVariable> ();
@@ -187,6 +282,12 @@ MmWave3gppChannel::GetTypeId (void)
 				BooleanValue (false),
 				MakeBooleanAccessor (&MmWave3gppChannel::m_cellScan),
 				MakeBooleanChecker ())
+	.AddAttribute ("HierarchicalBeamSearch",
+				"With CellScan, search the beam pairs on a grid of every other sector and elevation "
+				"and then around the best pair, instead of searching all the pairs",
+				BooleanValue (false),
+				MakeBooleanAccessor (&MmWave3gppChannel::m_hierarchicalBeamSearch),
+				MakeBooleanChecker ())
 	.AddAttribute ("Blockage",
 				"Enable blockage model A (sec 7.6.4.1)",
 				BooleanValue (false),
@@ -207,6 +308,25 @@ MmWave3gppChannel::GetTypeId (void)
 				BooleanValue (true),
 				MakeBooleanAccessor (&MmWave3gppChannel::m_portraitMode),
 				MakeBooleanChecker ())
+	.AddAttribute ("RelevanceThreshold",
+				"The fast fading channel of a pair that is not connected is generated only when its received power, "
+				"with the maximum beamforming gain, exceeds the thermal noise by this threshold (dB). "
+				"Below the threshold only the pathloss is applied. The default value generates all the channels",
+				DoubleValue (-1000),
+				MakeDoubleAccessor (&MmWave3gppChannel::m_relevanceThreshold),
+				MakeDoubleChecker<double> ())
+	.AddAttribute ("BatchUpdate",
+				"Update all the channels that are due at the same time in one event, on UpdateThreads threads, "
+				"instead of updating each channel at its next signal. Each link uses its own random streams, "
+				"so the result does not depend on the number of threads",
+				BooleanValue (false),
+				MakeBooleanAccessor (&MmWave3gppChannel::m_batchUpdate),
+				MakeBooleanChecker ())
+	.AddAttribute ("UpdateThreads",
+				"Number of threads of the batch update, 0 for one thread per available core",
+				UintegerValue (0),
+				MakeUintegerAccessor (&MmWave3gppChannel::m_updateThreads),
+				MakeUintegerChecker<uint32_t> ())
 	;
 	return tid;
 }
@@ -220,6 +340,20 @@ void
 MmWave3gppChannel::DoDispose ()
 {
 	NS_LOG_FUNCTION (this);
+	if (AntennaSteeringCache::Get ()->IsEnabled ())
+	{
+		std::ostringstream stats;
+		AntennaSteeringCache::Get ()->PrintStatistics (stats);
+		NS_LOG_INFO (stats.str ());
+	}
+	m_batchUpdates.clear ();
+	m_updateJobs.clear ();
+	m_codebooks.clear ();
+	m_linkTable.clear ();
+	m_devices.clear ();
+	m_nodeToDevice.clear ();
+	m_numEnb = 0;
+	m_numUe = 0;
 }
 
 void
@@ -238,14 +372,168 @@ MmWave3gppChannel::GetConfigurationParameters (void) const
 void
 MmWave3gppChannel::ConnectDevices (Ptr<NetDevice> dev1, Ptr<NetDevice> dev2)
 {
-	key_t key = std::make_pair(dev1,dev2);
+	uint32_t id1 = GetDeviceId (dev1->GetNode ());
+	uint32_t id2 = GetDeviceId (dev2->GetNode ());
+	const DeviceInfo3gpp &info1 = m_devices[id1];
+	const DeviceInfo3gpp &info2 = m_devices[id2];
+
+	// only the eNB-UE pairs have a channel realization
+	if (info1.m_isEnb && info2.m_isUe)
+	{
+		GetLinkState (info1, info2).m_connected[0] = true;
+	}
+	else if (info1.m_isUe && info2.m_isEnb)
+	{
+		GetLinkState (info2, info1).m_connected[1] = true;
+	}
+}
+
+uint32_t
+MmWave3gppChannel::GetDeviceId (Ptr<Node> node) const
+{
+	uint32_t nodeId = node->GetId ();
+	if (nodeId < m_nodeToDevice.size () && m_nodeToDevice[nodeId] >= 0)
+	{
+		return m_nodeToDevice[nodeId];
+	}
+
+	DeviceInfo3gpp info;
+	info.m_device = node->GetDevice (0);
+	info.m_antennaNum[0] = 0;
+	info.m_antennaNum[1] = 0;
+	info.m_isEnb = false;
+	info.m_isUe = false;
+	info.m_index = 0;
+
+	Ptr<MmWaveEnbNetDevice> enbDev = DynamicCast<MmWaveEnbNetDevice> (info.m_device);
+	Ptr<MmWaveUeNetDevice> ueDev = DynamicCast<MmWaveUeNetDevice> (info.m_device);
+	if (enbDev != 0)
+	{
+		info.m_isEnb = true;
+		info.m_index = m_numEnb++;
+		info.m_antennaNum[0] = sqrt (enbDev->GetAntennaNum ());
+		info.m_antennaNum[1] = sqrt (enbDev->GetAntennaNum ());
+		info.m_antenna = DynamicCast<AntennaArrayModel> (
+					enbDev->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
+	}
+	else if (ueDev != 0)
+	{
+		info.m_isUe = true;
+		info.m_index = m_numUe++;
+		info.m_antennaNum[0] = sqrt (ueDev->GetAntennaNum ());
+		info.m_antennaNum[1] = sqrt (ueDev->GetAntennaNum ());
+		info.m_antenna = DynamicCast<AntennaArrayModel> (
+					ueDev->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
+	}
+
+	if (nodeId >= m_nodeToDevice.size ())
+	{
+		m_nodeToDevice.resize (nodeId + 1, -1);
+	}
+	m_nodeToDevice[nodeId] = m_devices.size ();
+	m_devices.push_back (info);
+	NS_LOG_INFO ("Node " << nodeId << " registered as device " << m_devices.size () - 1
+			<< " enb " << info.m_isEnb << " ue " << info.m_isUe);
+	return m_devices.size () - 1;
+}
+
+const BeamCodebook3gpp &
+MmWave3gppChannel::GetCodebook (Ptr<AntennaArrayModel> antenna, uint8_t *antennaNum) const
+{
+	// the geometry is given by the size of the array and the spacing of the elements
+	double spacingH = antenna->GetAntennaLocation (1, antennaNum).y;
+	double spacingV = antenna->GetAntennaLocation (antennaNum[1], antennaNum).z;
+	for (uint32_t i = 0; i < m_codebooks.size (); i++)
+	{
+		const BeamCodebook3gpp &codebook = m_codebooks[i];
+		if (codebook.m_antennaNum[0] == antennaNum[0] && codebook.m_antennaNum[1] == antennaNum[1]
+				&& codebook.m_spacing[0] == spacingH && codebook.m_spacing[1] == spacingV)
+		{
+			return codebook;
+		}
+	}
 
-	std::map< key_t, int >::iterator iter = m_connectedPair.find(key);
-	if (iter != m_connectedPair.end ())
+	BeamCodebook3gpp codebook;
+	codebook.m_antennaNum[0] = antennaNum[0];
+	codebook.m_antennaNum[1] = antennaNum[1];
+	codebook.m_spacing[0] = spacingH;
+	codebook.m_spacing[1] = spacingV;
+	codebook.m_size = antennaNum[0]*antennaNum[1];
+	codebook.m_numSectors = antennaNum[1] + 1;
+	codebook.m_beams.reserve ((size_t)BEAM_SEARCH_NUM_ELEVATIONS*codebook.m_numSectors*codebook.m_size);
+	// same BF vectors as AntennaArrayModel::SetSector
+	double power = 1/sqrt (codebook.m_size);
+	complexVector_t steering (codebook.m_size);
+	for (uint16_t eIndex = 0; eIndex < BEAM_SEARCH_NUM_ELEVATIONS; eIndex++)
+	{
+		double elevation = BEAM_SEARCH_MIN_ELEVATION + eIndex*BEAM_SEARCH_ELEVATION_STEP;
+		double vAngle_radian = elevation*M_PI/180;
+		for (uint16_t sector = 0; sector < codebook.m_numSectors; sector++)
+		{
+			double hAngle_radian = M_PI*(double)sector/(double)antennaNum[1]-0.5*M_PI;
+			antenna->GetSteeringVector (vAngle_radian, hAngle_radian, antennaNum, &steering[0]);
+			for (uint16_t ind = 0; ind < codebook.m_size; ind++)
+			{
+				codebook.m_beams.push_back (std::conj (steering[ind])*power);
+			}
+		}
+	}
+	NS_LOG_INFO ("Codebook of " << codebook.m_beams.size ()/codebook.m_size << " beams for a "
+			<< (uint16_t)antennaNum[0] << "x" << (uint16_t)antennaNum[1] << " array");
+	m_codebooks.push_back (codebook);
+	return m_codebooks.back ();
+}
+
+LinkState3gpp &
+MmWave3gppChannel::GetLinkState (const DeviceInfo3gpp &enbInfo, const DeviceInfo3gpp &ueInfo) const
+{
+	NS_ASSERT (enbInfo.m_isEnb && ueInfo.m_isUe);
+	if (enbInfo.m_index >= m_linkTable.size ())
+	{
+		m_linkTable.resize (m_numEnb);
+	}
+	std::vector<LinkState3gpp> &row = m_linkTable[enbInfo.m_index];
+	if (ueInfo.m_index >= row.size ())
 	{
-		m_connectedPair.erase (iter);
+		row.resize (m_numUe);
+	}
+	return row[ueInfo.m_index];
+}
+
+void
+MmWave3gppChannel::GetChannelCondition (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b,
+		bool &los, bool &o2i) const
+{
+	char condition;
+	// the GetObject trick is a trick against the const keyword
+	if (m_3gppPropagationLoss != 0)
+	{
+		condition = m_3gppPropagationLoss->GetChannelCondition(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
+	}
+	else if (m_3gppBuildingsLoss != 0)
+	{
+		condition = m_3gppBuildingsLoss->GetChannelCondition(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
+	}
+	else
+	{
+		NS_FATAL_ERROR("unkonw pathloss model");
+	}
+	los = false;
+	o2i = false;
+	if(condition == 'l')
+	{
+		los = true;
+	}
+	else if(condition == 'i')
+	{
+		o2i = true;
+	}
+	else if(condition == 's')
+	{
+		// in this special case, we condiser los + outdoor to indoor.
+		los = true;
+		o2i = true;
 	}
-	m_connectedPair.insert(std::make_pair(key,1));
 }
 
 void
@@ -290,15 +578,13 @@ MmWave3gppChannel::Initial(NetDeviceContainer ueDevices, NetDeviceContainer enbD
 			NS_LOG_INFO("a " << a << " b " << b);
 
 			// initialize the pathloss and channel condition
-			if (DynamicCast<MmWave3gppPropagationLossModel> (m_3gppPathloss)!=0)
+			if (m_3gppPropagationLoss != 0)
 			{
-				m_3gppPathloss->GetObject<MmWave3gppPropagationLossModel> ()
-						->GetLoss(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
+				m_3gppPropagationLoss->GetLoss(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
 			}			// the GetObject trick is a trick against the const keyword
-			else if (DynamicCast<MmWave3gppBuildingsPropagationLossModel> (m_3gppPathloss)!=0)
+			else if (m_3gppBuildingsLoss != 0)
 			{
-				m_3gppPathloss->GetObject<MmWave3gppBuildingsPropagationLossModel> ()
-						->GetLoss(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
+				m_3gppBuildingsLoss->GetLoss(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
 			}
 			else
 			{
@@ -321,74 +607,114 @@ MmWave3gppChannel::Initial(NetDeviceContainer ueDevices, NetDeviceContainer enbD
 
 
 
+Ptr<SpectrumValue>
+MmWave3gppChannel::ShareTxPsd (Ptr<const SpectrumValue> txPsd)
+{
+	SpectrumValuePool::NotifyShared ();
+	return ConstCast<SpectrumValue> (txPsd);
+}
+
+/**
+ * The deferred part of the computation of a received PSD: the long term component of a channel
+ * generated or updated for this signal, and the BF gain. The channel realization of the link is
+ * used only by this job among the jobs of a transmission
+ */
+class MmWave3gppChannel::BeamformingGainJob : public SpectrumPropagationLossJob
+{
+public:
+	BeamformingGainJob (const MmWave3gppChannel *channel, Ptr<Params3gpp> params, Ptr<const SpectrumValue> txPsd,
+			Ptr<SpectrumValue> rxPsd, Vector speed, double dopplerFactor)
+		: m_channel (channel),
+		  m_params (params),
+		  m_txPsd (txPsd),
+		  m_rxPsd (rxPsd),
+		  m_speed (speed),
+		  m_dopplerFactor (dopplerFactor)
+	{
+	}
+
+	virtual void Run ()
+	{
+		if (m_params->m_longTermPending)
+		{
+			m_channel->CalLongTerm (m_params);
+			m_params->m_longTermPending = false;
+		}
+		m_channel->CalBeamformingGain (*m_txPsd, m_params, m_speed, m_dopplerFactor, *m_rxPsd);
+	}
+
+private:
+	const MmWave3gppChannel *m_channel;
+	Ptr<Params3gpp> m_params;
+	Ptr<const SpectrumValue> m_txPsd;
+	Ptr<SpectrumValue> m_rxPsd;
+	Vector m_speed;
+	double m_dopplerFactor;
+};
+
 Ptr<SpectrumValue>
 MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
                                                    Ptr<const MobilityModel> a,
                                                    Ptr<const MobilityModel> b) const
+{
+	return CalcRxPsd (txPsd, a, b, 0);
+}
+
+Ptr<SpectrumValue>
+MmWave3gppChannel::DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+                                                   Ptr<const MobilityModel> a,
+                                                   Ptr<const MobilityModel> b,
+                                                   SpectrumPropagationLossJobList &jobs) const
+{
+	return CalcRxPsd (txPsd, a, b, &jobs);
+}
+
+Ptr<SpectrumValue>
+MmWave3gppChannel::CalcRxPsd (Ptr<const SpectrumValue> txPsd, Ptr<const MobilityModel> a,
+		Ptr<const MobilityModel> b, SpectrumPropagationLossJobList *jobs) const
 {
 	NS_LOG_FUNCTION (this);
-	Ptr<SpectrumValue> rxPsd = Copy (txPsd);
 
-	Ptr<NetDevice> txDevice = a->GetObject<Node> ()->GetDevice (0);
-	Ptr<NetDevice> rxDevice = b->GetObject<Node> ()->GetDevice (0);
-	Ptr<MmWaveEnbNetDevice> txEnb =
-					DynamicCast<MmWaveEnbNetDevice> (txDevice);
-	Ptr<MmWaveUeNetDevice> rxUe =
-					DynamicCast<MmWaveUeNetDevice> (rxDevice);
+	// the role and the antenna of the devices are resolved only the first time they are seen
+	uint32_t txId = GetDeviceId (a->GetObject<Node> ());
+	uint32_t rxId = GetDeviceId (b->GetObject<Node> ());
+	const DeviceInfo3gpp &txInfo = m_devices[txId];
+	const DeviceInfo3gpp &rxInfo = m_devices[rxId];
+	Ptr<NetDevice> txDevice = txInfo.m_device;
+	Ptr<NetDevice> rxDevice = rxInfo.m_device;
 
 	/* txAntennaNum[0]-number of vertical antenna elements
 	 * txAntennaNum[1]-number of horizontal antenna elements*/
-	uint8_t txAntennaNum[2];
-	uint8_t rxAntennaNum[2];
-	Ptr<AntennaArrayModel> txAntennaArray, rxAntennaArray;
+	uint8_t txAntennaNum[2] = {txInfo.m_antennaNum[0], txInfo.m_antennaNum[1]};
+	uint8_t rxAntennaNum[2] = {rxInfo.m_antennaNum[0], rxInfo.m_antennaNum[1]};
+	Ptr<AntennaArrayModel> txAntennaArray = txInfo.m_antenna;
+	Ptr<AntennaArrayModel> rxAntennaArray = rxInfo.m_antenna;
 
 	Vector locUT;
-	if(txEnb!=0 && rxUe!=0)
+	uint8_t direction; // index of the link direction in LinkState3gpp
+	bool downlink = txInfo.m_isEnb && rxInfo.m_isUe;
+	if(downlink)
 	{
 		NS_LOG_INFO ("this is downlink case, a tx " << a->GetPosition() << " b rx " << b->GetPosition());
-		txAntennaNum[0] = sqrt (txEnb->GetAntennaNum ());
-		txAntennaNum[1] = sqrt (txEnb->GetAntennaNum ());
-		rxAntennaNum[0] = sqrt (rxUe->GetAntennaNum ());
-		rxAntennaNum[1] = sqrt (rxUe->GetAntennaNum ());
-
-		txAntennaArray = DynamicCast<AntennaArrayModel> (
-					txEnb->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
-		rxAntennaArray = DynamicCast<AntennaArrayModel> (
-					rxUe->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
 		locUT = b->GetPosition();
-
+		direction = 0;
 	}
-	else if (txEnb==0 && rxUe==0 )
+	else if (txInfo.m_isUe && rxInfo.m_isEnb)
 	{
 		NS_LOG_INFO ("this is uplink case, a tx " << a->GetPosition() << " b rx " << b->GetPosition());
-
-		Ptr<MmWaveUeNetDevice> txUe =
-						DynamicCast<MmWaveUeNetDevice> (txDevice);
-		Ptr<MmWaveEnbNetDevice> rxEnb =
-						DynamicCast<MmWaveEnbNetDevice> (rxDevice);
-
-		txAntennaNum[0] = sqrt (txUe->GetAntennaNum ());
-		txAntennaNum[1] = sqrt (txUe->GetAntennaNum ());
-		rxAntennaNum[0] = sqrt (rxEnb->GetAntennaNum ());
-		rxAntennaNum[1] = sqrt (rxEnb->GetAntennaNum ());
-
-		txAntennaArray = DynamicCast<AntennaArrayModel> (
-					txUe->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
-		rxAntennaArray = DynamicCast<AntennaArrayModel> (
-					rxEnb->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
 		locUT = a->GetPosition();
-
+		direction = 1;
 	}
 	else
 	{
 		NS_LOG_INFO ("enb to enb or ue to ue transmission, skip beamforming a tx " << a->GetPosition() << " b rx " << b->GetPosition());
-		return rxPsd;
+		return ShareTxPsd (txPsd);
 	}
 
 	if(txAntennaArray->IsOmniTx() || rxAntennaArray->IsOmniTx() )
 	{
 		//omi transmission, do nothing.
-		return rxPsd;
+		return ShareTxPsd (txPsd);
 	}
 
 	/*txAntennaNum[0] = 1;
@@ -402,64 +728,48 @@ MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 	Vector txSpeed = a->GetVelocity();
 	Vector relativeSpeed (rxSpeed.x-txSpeed.x,rxSpeed.y-txSpeed.y,rxSpeed.z-txSpeed.z);
 
-	key_t key = std::make_pair(txDevice,rxDevice);
-	key_t keyReverse = std::make_pair(rxDevice,txDevice);
+	LinkState3gpp &link = downlink ? GetLinkState (txInfo, rxInfo) : GetLinkState (rxInfo, txInfo);
+	Ptr<Params3gpp> forwardParams = link.m_params[direction];
+	Ptr<Params3gpp> reverseParams = link.m_params[1 - direction];
 
-	std::map< key_t, Ptr<Params3gpp> >::iterator it = m_channelMap.find (key);
-	std::map< key_t, Ptr<Params3gpp> >::iterator itReverse = m_channelMap.find (keyReverse);
+	//The channel of an interfering pair is generated only once it can affect the SINR,
+	//i.e., when the received power with the array gain is above the noise plus the threshold.
+	//Otherwise the pathloss only is applied, the pair is checked again at the next signal.
+	if (forwardParams == 0 && reverseParams == 0 && !link.m_connected[direction])
+	{
+		double maxPsd = *std::max_element (txPsd->ConstValuesBegin (), txPsd->ConstValuesEnd ());
+		double arrayGain = txAntennaNum[0]*txAntennaNum[1]*rxAntennaNum[0]*rxAntennaNum[1];
+		double snrDb = 10*log10 (maxPsd*arrayGain/THERMAL_NOISE_PSD);
+		if (snrDb < m_relevanceThreshold)
+		{
+			NS_LOG_INFO ("max SNR " << snrDb << " dB below the relevance threshold, skip the channel generation");
+			return ShareTxPsd (txPsd);
+		}
+	}
 
 	Ptr<Params3gpp> channelParams;
 
 	bool reverseLink = false;
+	bool longTermDeferred = false;
 
 	//Step 2: Assign propagation condition (LOS/NLOS).
 
-	char condition;
-	if (DynamicCast<MmWave3gppPropagationLossModel> (m_3gppPathloss)!=0)
-	{
-		condition = m_3gppPathloss->GetObject<MmWave3gppPropagationLossModel> ()
-				->GetChannelCondition(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
-	}
-	else if (DynamicCast<MmWave3gppBuildingsPropagationLossModel> (m_3gppPathloss)!=0)
-	{
-		condition = m_3gppPathloss->GetObject<MmWave3gppBuildingsPropagationLossModel> ()
-				->GetChannelCondition(a->GetObject<MobilityModel>(),b->GetObject<MobilityModel>());
-	}
-	else
-	{
-		NS_FATAL_ERROR("unkonw pathloss model");
-	}
 	bool los = false;
 	bool o2i = false;
-	if(condition == 'l')
-	{
-		los = true;
-	}
-	else if(condition == 'i')
-	{
-		o2i = true;
-	}
-	else if(condition == 's')
-	{
-		// in this special case, we condiser los + outdoor to indoor.
-		los = true;
-		o2i = true;
-	}
+	GetChannelCondition (a, b, los, o2i);
 
 	//Every m_updatedPeriod, the channel matrix is deleted and a consistent channel update is triggered.
 	//When there is a LOS/NLOS switch, a new uncorrelated channel is created.
 	//Therefore, LOS/NLOS condition of updating is always consistent with the previous channel.
 
 	//I only update the fowrad channel.
-	if ((it == m_channelMap.end () && itReverse == m_channelMap.end ()) ||
-			(it != m_channelMap.end () && it->second->m_channel.size() == 0)||
-			(it != m_channelMap.end () && it->second->m_los != los))
+	if ((forwardParams == 0 && reverseParams == 0) ||
+			(forwardParams != 0 && forwardParams->m_channel.IsEmpty ())||
+			(forwardParams != 0 && forwardParams->m_los != los))
 	{
 		NS_LOG_INFO("Update or create the forward channel");
-		NS_LOG_LOGIC("it == m_channelMap.end () " << (it == m_channelMap.end ()));
-		NS_LOG_LOGIC("itReverse == m_channelMap.end () " << (itReverse == m_channelMap.end ()));
-		NS_LOG_LOGIC("it->second->m_channel.size() == 0 " << (it->second->m_channel.size() == 0));
-		NS_LOG_LOGIC("it->second->m_los != los" << (it->second->m_los != los));
+		NS_LOG_LOGIC("forwardParams == 0 " << (forwardParams == 0));
+		NS_LOG_LOGIC("reverseParams == 0 " << (reverseParams == 0));
 		
 		//Step 1: The parameters are configured in the example code.
 		/*make sure txAngle rxAngle exist, i.e., the position of tx and rx cannot be the same*/
@@ -476,7 +786,7 @@ MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 		double y = a->GetPosition().y-b->GetPosition().y;
 		double distance2D = sqrt (x*x +y*y);
 		double hUT, hBS;
-		if(rxUe != 0)
+		if(downlink)
 		{
 			hUT = b->GetPosition().z;
 			hBS = a->GetPosition().z;
@@ -490,34 +800,41 @@ MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 		Ptr<ParamsTable> table3gpp = Get3gppTable(los, o2i, hBS, hUT, distance2D);
 
 		// Step 4-11 are performed in function GetNewChannel()
-		if((it == m_channelMap.end () && itReverse == m_channelMap.end ()) ||
-				(it != m_channelMap.end () && it->second->m_channel.size() == 0))
+		if((forwardParams == 0 && reverseParams == 0) ||
+				(forwardParams != 0 && forwardParams->m_channel.IsEmpty ()))
 		{
 			//delete the channel parameter to cause the channel to be updated again.
 			//The m_updatePeriod can be configured to be relatively large in order to disable updates.
 			if(m_updatePeriod.GetMilliSeconds() > 0)
 			{
-				NS_LOG_INFO("Time " << Simulator::Now().GetSeconds() << " schedule delete for a " << a->GetPosition() << " b " << b->GetPosition());
-				Simulator::Schedule (m_updatePeriod, &MmWave3gppChannel::DeleteChannel,this,a,b);
+				if (m_batchUpdate)
+				{
+					ScheduleBatchUpdate (a, b);
+				}
+				else
+				{
+					NS_LOG_INFO("Time " << Simulator::Now().GetSeconds() << " schedule delete for a " << a->GetPosition() << " b " << b->GetPosition());
+					Simulator::Schedule (m_updatePeriod, &MmWave3gppChannel::DeleteChannel,this,a,b);
+				}
 			}
 		}
 
 		double distance3D = a->GetDistanceFrom(b);
 
-		if(it != m_channelMap.end () && it->second->m_channel.size() == 0)
+		if(forwardParams != 0 && forwardParams->m_channel.IsEmpty ())
 		{
 			//if the channel map is not empty, we only update the channel.
 			NS_LOG_DEBUG ("Update forward channel consistently");
-			it->second->m_locUT = locUT;
-			it->second->m_los = los;
-			it->second->m_o2i = o2i;
-			channelParams = UpdateChannel(it->second, table3gpp, txAntennaArray, rxAntennaArray,
+			forwardParams->m_locUT = locUT;
+			forwardParams->m_los = los;
+			forwardParams->m_o2i = o2i;
+			channelParams = UpdateChannel(forwardParams, table3gpp, txAntennaArray, rxAntennaArray,
 					txAntennaNum, rxAntennaNum, rxAngle, txAngle);
-			it->second->m_dis3D = distance3D;
-			it->second->m_dis2D = distance2D;
-			it->second->m_speed = relativeSpeed;
-			it->second->m_generatedTime = Now();
-			it->second->m_preLocUT = locUT;
+			forwardParams->m_dis3D = distance3D;
+			forwardParams->m_dis2D = distance2D;
+			forwardParams->m_speed = relativeSpeed;
+			forwardParams->m_generatedTime = Now();
+			forwardParams->m_preLocUT = locUT;
 
 		}
 		else
@@ -527,12 +844,11 @@ MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 			channelParams = GetNewChannel(table3gpp, locUT, los, o2i, txAntennaArray, rxAntennaArray,
 					txAntennaNum, rxAntennaNum, rxAngle, txAngle, relativeSpeed, distance2D, distance3D);
 		}
-		std::map< key_t, int >::iterator it1 = m_connectedPair.find (key);
-		if(it1 != m_connectedPair.end ())
+		if(link.m_connected[direction])
 		{
 			if(m_cellScan)
 			{
-				BeamSearchBeamforming (rxPsd, channelParams,txAntennaArray,rxAntennaArray, txAntennaNum, rxAntennaNum);
+				BeamSearchBeamforming (txPsd, channelParams,txAntennaArray,rxAntennaArray, txAntennaNum, rxAntennaNum);
 			}
 			else
 			{
@@ -550,242 +866,458 @@ MmWave3gppChannel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 			{
 				NS_LOG_INFO("channelParams->m_txW.size() == 0 " << (channelParams->m_txW.size() == 0));
 				NS_LOG_INFO("channelParams->m_rxW.size() == 0 " << (channelParams->m_rxW.size() == 0));
-				m_channelMap[key] = channelParams;
-				return rxPsd;
+				link.m_params[direction] = channelParams;
+				return ShareTxPsd (txPsd);
 			}
 		}
 
-		CalLongTerm (channelParams);
-		m_channelMap[key] = channelParams;
+		if (jobs != 0)
+		{
+			channelParams->m_longTermPending = true;
+			longTermDeferred = true;
+		}
+		else
+		{
+			CalLongTerm (channelParams);
+		}
+		link.m_params[direction] = channelParams;
 	}
-	else if (itReverse == m_channelMap.end ()) //Find channel matrix in the forward link
+	else if (reverseParams == 0) //Find channel matrix in the forward link
 	{
-		channelParams = (*it).second;
+		channelParams = forwardParams;
 	}
 	else //Find channel matrix in the Reverse link
 	{
 		reverseLink = true;
-		channelParams = (*itReverse).second;
+		channelParams = reverseParams;
 	}
 
-	Ptr<SpectrumValue> bfPsd = CalBeamformingGain(rxPsd, channelParams, relativeSpeed);
+	// the time of the signal is read here, the BF gain job may run on another thread
+	double dopplerFactor = 2*M_PI*Simulator::Now ().GetSeconds ()*m_phyMacConfig->GetCentreFrequency ()/3e8;
+	// all the values of the rx PSD are written by CalBeamformingGain, a pooled value is not initialized
+	Ptr<SpectrumValue> rxPsd = SpectrumValuePool::AllocateUninitialized (txPsd->GetSpectrumModel ());
+	if (channelParams->m_longTermPending && !longTermDeferred)
+	{
+		// the long term component was left to the job of another receiver of the same
+		// transmission, which would write it while this one reads it
+		CalLongTerm (channelParams);
+		channelParams->m_longTermPending = false;
+	}
+	if (jobs != 0)
+	{
+		jobs->push_back (Create<BeamformingGainJob> (this, channelParams, txPsd, rxPsd, relativeSpeed, dopplerFactor));
+		return rxPsd;
+	}
+	double bfGain = CalBeamformingGain(*txPsd, channelParams, relativeSpeed, dopplerFactor, *rxPsd);
 
-	SpectrumValue bfGain = (*bfPsd)/(*rxPsd);
-	uint8_t nbands = bfGain.GetSpectrumModel ()->GetNumBands ();
+	uint8_t nbands = rxPsd->GetSpectrumModel ()->GetNumBands ();
 	if (reverseLink == false)
 	{
-		NS_LOG_DEBUG ("****** DL BF gain == " << Sum (bfGain)/nbands << " RX PSD " << Sum(*rxPsd)/nbands); // print avg bf gain
+		NS_LOG_DEBUG ("****** DL BF gain == " << bfGain << " TX PSD " << Sum(*txPsd)/nbands); // print avg bf gain
 	}
 	else
 	{
-		NS_LOG_DEBUG ("****** UL BF gain == " << Sum (bfGain)/nbands << " RX PSD " << Sum(*rxPsd)/nbands);
+		NS_LOG_DEBUG ("****** UL BF gain == " << bfGain << " TX PSD " << Sum(*txPsd)/nbands);
 	}
-	return bfPsd;
+	return rxPsd;
 }
 
-void
-MmWave3gppChannel::LongTermCovMatrixBeamforming(Ptr<Params3gpp> params) const
+/*
+ * Eigen-decomposition of a real symmetric matrix with the cyclic Jacobi method.
+ * matrix is n x n row-major and is destroyed, its diagonal holds the eigenvalues on return.
+ * The eigenvectors are stored in the columns of vectors (n x n row-major).
+ */
+static void
+JacobiEigen (double *matrix, uint16_t n, double *vectors)
 {
-	//generate transmitter side spatial correlation matrix
-	uint8_t txSize = params->m_channel.at(0).size();
-	uint8_t rxSize = params->m_channel.size();
-	complex2DVector_t txQ;
-	txQ.resize(txSize);
-
-	for (uint8_t txIndex = 0; txIndex < txSize; txIndex++)
+	for (uint16_t i = 0; i < n; i++)
 	{
-		txQ.at(txIndex).resize(txSize);
+		for (uint16_t j = 0; j < n; j++)
+		{
+			vectors[i*n + j] = (i == j) ? 1 : 0;
+		}
 	}
-
-	//compute the transmitter side spatial correlation matrix txQ = H*H, where H is the sum of H_n over n clusters.
-	for (uint8_t t1Index = 0; t1Index < txSize; t1Index++)
+	for (uint8_t sweep = 0; sweep < 50; sweep++)
 	{
-		for (uint8_t t2Index = 0; t2Index < txSize; t2Index++)
+		double off = 0, diag = 0;
+		for (uint16_t p = 0; p < n; p++)
 		{
-			for(uint8_t rxIndex = 0; rxIndex < rxSize; rxIndex++)
+			diag += matrix[p*n + p]*matrix[p*n + p];
+			for (uint16_t q = p + 1; q < n; q++)
 			{
-				std::complex<double> cSum (0,0);
-				for (uint8_t cIndex = 0; cIndex < params->m_channel.at(rxIndex).at(t1Index).size(); cIndex++)
+				off += matrix[p*n + q]*matrix[p*n + q];
+			}
+		}
+		if (off <= 1e-30*diag)
+		{
+			break;
+		}
+		for (uint16_t p = 0; p < n; p++)
+		{
+			for (uint16_t q = p + 1; q < n; q++)
+			{
+				double apq = matrix[p*n + q];
+				if (apq == 0)
 				{
-					cSum = cSum + std::conj(params->m_channel.at(rxIndex).at(t1Index).at(cIndex))*
-							(params->m_channel.at(rxIndex).at(t2Index).at(cIndex));
+					continue;
+				}
+				double theta = (matrix[q*n + q] - matrix[p*n + p])/(2*apq);
+				double t = 1/(std::abs (theta) + sqrt (theta*theta + 1));
+				if (theta < 0)
+				{
+					t = -t;
+				}
+				double c = 1/sqrt (t*t + 1);
+				double s = t*c;
+				for (uint16_t k = 0; k < n; k++)
+				{
+					double akp = matrix[k*n + p];
+					double akq = matrix[k*n + q];
+					matrix[k*n + p] = c*akp - s*akq;
+					matrix[k*n + q] = s*akp + c*akq;
+				}
+				for (uint16_t k = 0; k < n; k++)
+				{
+					double apk = matrix[p*n + k];
+					double aqk = matrix[q*n + k];
+					matrix[p*n + k] = c*apk - s*aqk;
+					matrix[q*n + k] = s*apk + c*aqk;
+				}
+				for (uint16_t k = 0; k < n; k++)
+				{
+					double vkp = vectors[k*n + p];
+					double vkq = vectors[k*n + q];
+					vectors[k*n + p] = c*vkp - s*vkq;
+					vectors[k*n + q] = s*vkp + c*vkq;
 				}
-				txQ[t1Index][t2Index] += cSum;
 			}
-
 		}
 	}
+}
 
+/*
+ * Dominant eigenvector of the Hermitian matrix (size x size, row-major) with the Lanczos
+ * iteration with full reorthogonalization. The Ritz vector of the largest eigenvalue of the
+ * tridiagonal matrix is checked every few steps and accepted when its residual is small.
+ */
+static void
+DominantEigenvector (const std::vector< std::complex<double> > &matrix, uint16_t size, complexVector_t &vec)
+{
+	vec.assign (size, std::complex<double> (0,0));
+	const uint16_t maxSteps = std::min (size, (uint16_t)32);
+	std::vector< std::complex<double> > basis (maxSteps*size);
+	std::vector< std::complex<double> > w (size);
+	std::vector<double> alpha (maxSteps), beta (maxSteps);
+	std::vector<double> tridiag (maxSteps*maxSteps), ritz (maxSteps*maxSteps);
 
-	//calculate beamforming vector from spatial correlation matrix.
-	complexVector_t antennaWeights;
-	uint8_t txAntenna = txQ.size ();
-	for (uint8_t eIndex = 0; eIndex < txAntenna; eIndex++)
+	//start from the column with the largest diagonal element, which is not null unless the matrix is.
+	uint16_t start = 0;
+	for (uint16_t i = 1; i < size; i++)
+	{
+		if (matrix[i*size + i].real () > matrix[start*size + start].real ())
+		{
+			start = i;
+		}
+	}
+	double norm0 = 0;
+	for (uint16_t i = 0; i < size; i++)
 	{
-		antennaWeights.push_back(txQ.at (0).at (eIndex));
+		basis[i] = matrix[i*size + start];
+		norm0 += std::norm (basis[i]);
 	}
-
-
-	int iter = 10;
-	double diff = 1;
-	while(iter != 0 && diff>1e-10)
+	if (norm0 == 0)
 	{
-		complexVector_t antennaWeights_New;
+		vec[0] = 1;
+		return;
+	}
+	for (uint16_t i = 0; i < size; i++)
+	{
+		basis[i] /= sqrt (norm0);
+	}
 
-		for(uint8_t row = 0; row<txAntenna; row++)
+	uint16_t steps = 0;
+	uint16_t top = 0;
+	for (uint16_t j = 0; j < maxSteps; j++)
+	{
+		const std::complex<double> *q = &basis[j*size];
+		for (uint16_t row = 0; row < size; row++)
 		{
-			std::complex<double> sum(0,0);
-			for (uint8_t col = 0; col< txAntenna; col++)
+			const std::complex<double> *m = &matrix[row*size];
+			double sumRe = 0, sumIm = 0;
+			for (uint16_t col = 0; col < size; col++)
 			{
-				sum += txQ.at (row).at (col)*antennaWeights.at (col);
+				sumRe += m[col].real ()*q[col].real () - m[col].imag ()*q[col].imag ();
+				sumIm += m[col].real ()*q[col].imag () + m[col].imag ()*q[col].real ();
 			}
-
-		    antennaWeights_New.push_back(sum);
+			w[row] = std::complex<double> (sumRe, sumIm);
 		}
-		//normalize antennaWeights;
-		double weightSum = 0;
-		for (uint8_t i = 0; i< txAntenna; i++)
+		//full reorthogonalization against the basis, the first projection is alpha
+		for (uint16_t i = 0; i <= j; i++)
 		{
-			weightSum += norm(antennaWeights_New. at(i));
+			const std::complex<double> *qi = &basis[i*size];
+			std::complex<double> proj (0,0);
+			for (uint16_t k = 0; k < size; k++)
+			{
+				proj += std::conj (qi[k])*w[k];
+			}
+			if (i == j)
+			{
+				alpha[j] = proj.real ();
+			}
+			for (uint16_t k = 0; k < size; k++)
+			{
+				w[k] -= proj*qi[k];
+			}
 		}
-		for (uint8_t i = 0; i< txAntenna; i++)
+		double wNorm = 0;
+		for (uint16_t k = 0; k < size; k++)
 		{
-			antennaWeights_New. at(i) = antennaWeights_New. at(i)/sqrt(weightSum);
+			wNorm += std::norm (w[k]);
+		}
+		beta[j] = sqrt (wNorm);
+		steps = j + 1;
+
+		bool last = (steps == maxSteps) || (beta[j] <= 1e-12*std::abs (alpha[0]));
+		if (last || steps % 4 == 0)
+		{
+			for (uint16_t r = 0; r < steps; r++)
+			{
+				for (uint16_t c = 0; c < steps; c++)
+				{
+					tridiag[r*steps + c] = (r == c) ? alpha[r] : (r == c + 1) ? beta[c] : (c == r + 1) ? beta[r] : 0;
+				}
+			}
+			JacobiEigen (&tridiag[0], steps, &ritz[0]);
+			top = 0;
+			for (uint16_t r = 1; r < steps; r++)
+			{
+				if (tridiag[r*steps + r] > tridiag[top*steps + top])
+				{
+					top = r;
+				}
+			}
+			//residual of the Ritz pair
+			double residual = beta[j]*std::abs (ritz[(steps - 1)*steps + top]);
+			if (last || residual <= 1e-10*std::abs (tridiag[top*steps + top]))
+			{
+				break;
+			}
 		}
-		diff = 0;
-		for (uint8_t i = 0; i< txAntenna; i++)
+		std::complex<double> *next = &basis[(j + 1)*size];
+		for (uint16_t k = 0; k < size; k++)
 		{
-			diff += std::norm(antennaWeights_New. at(i)-antennaWeights. at(i));
+			next[k] = w[k]/beta[j];
 		}
-		iter--;
-		antennaWeights = antennaWeights_New;
 	}
 
-	params->m_txW = antennaWeights;
-
-	//compute the receiver side spatial correlation matrix rxQ = HH*, where H is the sum of H_n over n clusters.
-	complex2DVector_t rxQ;
-	rxQ.resize(rxSize);
-	for (uint8_t r1Index = 0; r1Index < rxSize; r1Index++)
+	double vecNorm = 0;
+	for (uint16_t k = 0; k < size; k++)
+	{
+		for (uint16_t i = 0; i < steps; i++)
+		{
+			vec[k] += ritz[i*steps + top]*basis[i*size + k];
+		}
+		vecNorm += std::norm (vec[k]);
+	}
+	for (uint16_t k = 0; k < size; k++)
 	{
-		rxQ.at(r1Index).resize(rxSize);
+		vec[k] /= sqrt (vecNorm);
 	}
+}
 
-	for (uint8_t r1Index = 0; r1Index < rxSize; r1Index++)
+void
+MmWave3gppChannel::CalDominantBeams (const ChannelTensor3gpp &channel, complexVector_t &txW, complexVector_t &rxW)
+{
+	uint16_t txSize = channel.GetTxSize ();
+	uint16_t rxSize = channel.GetRxSize ();
+	uint8_t numCluster = channel.GetNumCluster ();
+
+	//transmitter side spatial correlation matrix txQ = sum_n H_n^H*H_n, accumulated over one rx
+	//element at a time (the txSize x numCluster block of H for this element is contiguous),
+	//only the upper triangle is computed.
+	std::vector< std::complex<double> > txQ (txSize*txSize);
+	for (uint16_t rxIndex = 0; rxIndex < rxSize; rxIndex++)
 	{
-		for (uint8_t r2Index = 0; r2Index < rxSize; r2Index++)
+		for (uint16_t t1Index = 0; t1Index < txSize; t1Index++)
 		{
-			for(uint8_t txIndex = 0; txIndex < txSize; txIndex++)
-            {
-				std::complex<double> cSum (0,0);
-				for (uint8_t cIndex = 0; cIndex < params->m_channel.at(r1Index).at(txIndex).size(); cIndex++)
+			const double *h1 = reinterpret_cast<const double*> (channel.GetClusters (rxIndex, t1Index));
+			for (uint16_t t2Index = t1Index; t2Index < txSize; t2Index++)
+			{
+				const double *h2 = reinterpret_cast<const double*> (channel.GetClusters (rxIndex, t2Index));
+				double sumRe = 0, sumIm = 0;
+				for (uint16_t c = 0; c < 2*numCluster; c += 2)
 				{
-					cSum = cSum + params->m_channel.at(r1Index).at(txIndex).at(cIndex)*
-							std::conj(params->m_channel.at(r2Index).at(txIndex).at(cIndex));
+					sumRe += h1[c]*h2[c] + h1[c + 1]*h2[c + 1];
+					sumIm += h1[c]*h2[c + 1] - h1[c + 1]*h2[c];
 				}
-				rxQ[r1Index][r2Index] += cSum;
-            }
-
+				txQ[t1Index*txSize + t2Index] += std::complex<double> (sumRe, sumIm);
+			}
 		}
 	}
-
-	//calculate beamforming vector from spatial correlation matrix.
-	antennaWeights.clear();
-	uint8_t rxAntenna = rxQ.size ();
-	for (uint8_t eIndex = 0; eIndex < rxAntenna; eIndex++)
+	for (uint16_t t1Index = 0; t1Index < txSize; t1Index++)
 	{
-		antennaWeights.push_back(rxQ.at (0).at (eIndex));
+		for (uint16_t t2Index = 0; t2Index < t1Index; t2Index++)
+		{
+			txQ[t1Index*txSize + t2Index] = std::conj (txQ[t2Index*txSize + t1Index]);
+		}
 	}
+	DominantEigenvector (txQ, txSize, txW);
 
-	iter = 10;
-	diff = 1;
-	while(iter != 0 && diff>1e-10)
+	//receiver side spatial correlation matrix rxQ = sum_n H_n*H_n^H, each element is the dot
+	//product of two contiguous rows of txSize*numCluster coefficients.
+	std::vector< std::complex<double> > rxQ (rxSize*rxSize);
+	uint32_t rowLength = 2*(uint32_t)txSize*numCluster;
+	for (uint16_t r1Index = 0; r1Index < rxSize; r1Index++)
 	{
-		complexVector_t antennaWeights_New;
-
-		for(uint8_t row = 0; row<rxAntenna; row++)
+		const double *h1 = reinterpret_cast<const double*> (channel.GetClusters (r1Index, 0));
+		for (uint16_t r2Index = r1Index; r2Index < rxSize; r2Index++)
 		{
-			std::complex<double> sum(0,0);
-			for (uint8_t col = 0; col< rxAntenna; col++)
+			const double *h2 = reinterpret_cast<const double*> (channel.GetClusters (r2Index, 0));
+			double sumRe = 0, sumIm = 0;
+			for (uint32_t c = 0; c < rowLength; c += 2)
 			{
-				sum += rxQ.at (row).at (col)*antennaWeights.at (col);
+				sumRe += h1[c]*h2[c] + h1[c + 1]*h2[c + 1];
+				sumIm += h1[c + 1]*h2[c] - h1[c]*h2[c + 1];
 			}
-
-		    antennaWeights_New.push_back(sum);
-		}
-
-		//normalize antennaWeights;
-		double weightSum = 0;
-		for (uint8_t i = 0; i< rxAntenna; i++)
-		{
-			weightSum += norm(antennaWeights_New. at(i));
-		}
-		for (uint8_t i = 0; i< rxAntenna; i++)
-		{
-			antennaWeights_New. at(i) = antennaWeights_New. at(i)/sqrt(weightSum);
+			rxQ[r1Index*rxSize + r2Index] = std::complex<double> (sumRe, sumIm);
+			rxQ[r2Index*rxSize + r1Index] = std::complex<double> (sumRe, -sumIm);
 		}
-		diff = 0;
-		for (uint8_t i = 0; i< rxAntenna; i++)
-		{
-			diff += std::norm(antennaWeights_New. at(i)-antennaWeights. at(i));
-		}
-		iter--;
-		antennaWeights = antennaWeights_New;
 	}
+	DominantEigenvector (rxQ, rxSize, rxW);
+}
 
-	params->m_rxW = antennaWeights;
+void
+MmWave3gppChannel::LongTermCovMatrixBeamforming(Ptr<Params3gpp> params) const
+{
+	CalDominantBeams (params->m_channel, params->m_txW, params->m_rxW);
 }
 
-Ptr<SpectrumValue>
-MmWave3gppChannel::CalBeamformingGain (Ptr<const SpectrumValue> txPsd, Ptr<Params3gpp> params, Vector speed) const
+void
+MmWave3gppChannel::CalDelayPhaseRamp (Ptr<Params3gpp> params) const
 {
-	NS_LOG_FUNCTION (this);
+	uint8_t numCluster = params->m_delay.size();
+	// frequency of the first subband and spacing between subbands
+	double fStart = m_phyMacConfig->GetCentreFrequency () - GetSystemBandwidth ()/2;
+	double fStep = m_phyMacConfig->GetChunkWidth ();
 
-	Ptr<SpectrumValue> tempPsd = Copy<SpectrumValue> (txPsd);
+	params->m_delayPhase.resize (numCluster);
+	params->m_delayPhaseStep.resize (numCluster);
+	params->m_arrivalDirection.resize (numCluster);
+	for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+	{
+		double delay = params->m_delay.at (cIndex);
+		params->m_delayPhase[cIndex] = exp(std::complex<double>(0, -2*M_PI*fStart*delay));
+		params->m_delayPhaseStep[cIndex] = exp(std::complex<double>(0, -2*M_PI*fStep*delay));
 
-	//NS_ASSERT_MSG (params->m_delay.size()==params->m_channel.at(0).at(0).size(), "the cluster number of channel and delay spread should be the same");
-	//NS_ASSERT_MSG (params->m_txW.size()==params->m_channel.at(0).size(), "the tx antenna size of channel and antenna weights should be the same");
-	//NS_ASSERT_MSG (params->m_rxW.size()==params->m_channel.size(), "the rx antenna size of channel and antenna weights should be the same");
-	//NS_ASSERT_MSG (params->m_angle.at(0).size()==params->m_channel.at(0).at(0).size(), "the cluster number of channel and AOA should be the same");
-	//NS_ASSERT_MSG (params->m_angle.at(1).size()==params->m_channel.at(0).at(0).size(), "the cluster number of channel and ZOA should be the same");
+		//cluster angle angle[direction][n],where, direction = 0(aoa), 1(zoa).
+		double zoa = params->m_angle.at(ZOA_INDEX).at(cIndex)*M_PI/180;
+		double aoa = params->m_angle.at(AOA_INDEX).at(cIndex)*M_PI/180;
+		params->m_arrivalDirection[cIndex] = Vector (sin(zoa)*cos(aoa), sin(zoa)*sin(aoa), cos(zoa));
+	}
+}
 
+double
+MmWave3gppChannel::CalBeamformingGain (const SpectrumValue &txPsd, Ptr<Params3gpp> params,
+		Vector speed, double dopplerFactor, SpectrumValue &rxPsd) const
+{
+	// no logging and no access to the simulator here, this also runs on the fan-out threads
 	//channel[rx][tx][cluster]
 	uint8_t numCluster = params->m_delay.size();
-	//uint8_t txAntenna = params->m_txW.size();
-	//uint8_t rxAntenna = params->m_rxW.size();
+	NS_ASSERT_MSG (params->m_longTerm.size () == numCluster, "the cluster number of long term component and delay spread should be the same");
+	NS_ASSERT_MSG (params->m_delayPhase.size () == numCluster, "the delay phase ramps are not computed for this channel");
+	NS_ASSERT_MSG (txPsd.GetSpectrumModel ()->GetUid () == rxPsd.GetSpectrumModel ()->GetUid (), "tx and rx PSD should use the same spectrum model");
+
 	//the update of Doppler is simplified by only taking the center angle of each cluster in to consideration.
-	Values::iterator vit = tempPsd->ValuesBegin ();
-	uint16_t iSubband = 0;
-	double slotTime = Simulator::Now ().GetSeconds ();
-	complexVector_t doppler;
+	//The doppler and the long term component do not depend on the subband, they are merged in one gain per cluster.
+	std::complex<double> clusterGain[256];
+	bool moving = speed.x != 0 || speed.y != 0 || speed.z != 0;
 	for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
 	{
-		//cluster angle angle[direction][n],where, direction = 0(aoa), 1(zoa).
-		double temp_doppler = 2*M_PI*(sin(params->m_angle.at(ZOA_INDEX).at(cIndex)*M_PI/180)*cos(params->m_angle.at(AOA_INDEX).at(cIndex)*M_PI/180)*speed.x
-				+ sin(params->m_angle.at(ZOA_INDEX).at(cIndex)*M_PI/180)*sin(params->m_angle.at(AOA_INDEX).at(cIndex)*M_PI/180)*speed.y
-				+ cos(params->m_angle.at(ZOA_INDEX).at(cIndex)*M_PI/180)*speed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
-		doppler.push_back(exp(std::complex<double> (0, temp_doppler)));
+		clusterGain[cIndex] = params->m_longTerm[cIndex];
+		if (moving)
+		{
+			const Vector &dir = params->m_arrivalDirection[cIndex];
+			double temp_doppler = (dir.x*speed.x + dir.y*speed.y + dir.z*speed.z)*dopplerFactor;
+			clusterGain[cIndex] *= exp(std::complex<double> (0, temp_doppler));
+		}
+	}
 
+	uint32_t numBands = txPsd.GetSpectrumModel ()->GetNumBands ();
+	MmWaveBandRange bands = MmWaveSpectrumValueHelper::GetActiveBands (txPsd);
+	return CalSubbandGain (clusterGain, &params->m_delayPhase[0], &params->m_delayPhaseStep[0], numCluster,
+			&(*txPsd.ConstValuesBegin ()), &(*rxPsd.ValuesBegin ()), numBands, bands.m_first, bands.m_end);
+}
+
+double
+MmWave3gppChannel::CalSubbandGain (const std::complex<double> *clusterGain, const std::complex<double> *phase,
+		const std::complex<double> *phaseStep, uint8_t numCluster,
+		const double *txPsd, double *rxPsd, uint32_t numBands, uint32_t firstBand, uint32_t endBand)
+{
+	NS_ASSERT (firstBand <= endBand && endBand <= numBands);
+	// split real and imaginary parts so that the cluster loops below run over unit-stride
+	// arrays of doubles without branches, which the compiler can vectorize.
+	double gainRe[256], gainIm[256];
+	double phaseRe[256], phaseIm[256];
+	double stepRe[256], stepIm[256];
+	for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+	{
+		gainRe[cIndex] = clusterGain[cIndex].real ();
+		gainIm[cIndex] = clusterGain[cIndex].imag ();
+		phaseRe[cIndex] = phase[cIndex].real ();
+		phaseIm[cIndex] = phase[cIndex].imag ();
+		stepRe[cIndex] = phaseStep[cIndex].real ();
+		stepIm[cIndex] = phaseStep[cIndex].imag ();
+	}
+	if (firstBand > 0)
+	{
+		// the steps are unit rotations, move the phases to the first subband at once
+		for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+		{
+			std::complex<double> p = phase[cIndex]*std::polar (1.0, firstBand*std::arg (phaseStep[cIndex]));
+			phaseRe[cIndex] = p.real ();
+			phaseIm[cIndex] = p.imag ();
+		}
+	}
+	for (uint32_t iSubband = 0; iSubband < firstBand; iSubband++)
+	{
+		rxPsd[iSubband] = 0;
+	}
+	for (uint32_t iSubband = endBand; iSubband < numBands; iSubband++)
+	{
+		rxPsd[iSubband] = 0;
 	}
 
-	while (vit != tempPsd->ValuesEnd ())
+	double gainSum = 0;
+	uint32_t activeBands = 0;
+	for (uint32_t iSubband = firstBand; iSubband < endBand; iSubband++)
 	{
-		std::complex<double> subsbandGain (0.0,0.0);
-		if ((*vit) != 0.00)
+		double psd = txPsd[iSubband];
+		if (psd != 0.00)
 		{
-			double fsb = m_phyMacConfig->GetCentreFrequency () - GetSystemBandwidth ()/2 + m_phyMacConfig->GetChunkWidth ()*iSubband ;
+			double sumRe = 0, sumIm = 0;
 			for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
 			{
-				double delay = -2*M_PI*fsb*(params->m_delay.at (cIndex));
-				std::complex<double> txSum(0,0);
-				subsbandGain = subsbandGain + params->m_longTerm.at(cIndex)*doppler.at(cIndex)*exp(std::complex<double>(0, delay));
+				sumRe += gainRe[cIndex]*phaseRe[cIndex] - gainIm[cIndex]*phaseIm[cIndex];
+				sumIm += gainRe[cIndex]*phaseIm[cIndex] + gainIm[cIndex]*phaseRe[cIndex];
 			}
-			*vit = (*vit)*(norm (subsbandGain));
+			double gain = sumRe*sumRe + sumIm*sumIm;
+			rxPsd[iSubband] = psd*gain;
+			gainSum += gain;
+			activeBands++;
+		}
+		else
+		{
+			rxPsd[iSubband] = psd;
+		}
+		// rotate the phase of each cluster to the next subband
+		for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+		{
+			double re = phaseRe[cIndex]*stepRe[cIndex] - phaseIm[cIndex]*stepIm[cIndex];
+			phaseIm[cIndex] = phaseRe[cIndex]*stepIm[cIndex] + phaseIm[cIndex]*stepRe[cIndex];
+			phaseRe[cIndex] = re;
 		}
-		vit++;
-		iSubband++;
 	}
-	return tempPsd;
+	return activeBands > 0 ? gainSum/activeBands : 0;
 }
 
 double
@@ -800,13 +1332,15 @@ void
 MmWave3gppChannel::SetPathlossModel (Ptr<PropagationLossModel> pathloss)
 {
 	m_3gppPathloss = pathloss;
-	if (DynamicCast<MmWave3gppPropagationLossModel> (m_3gppPathloss)!=0)
+	m_3gppPropagationLoss = DynamicCast<MmWave3gppPropagationLossModel> (m_3gppPathloss);
+	m_3gppBuildingsLoss = DynamicCast<MmWave3gppBuildingsPropagationLossModel> (m_3gppPathloss);
+	if (m_3gppPropagationLoss != 0)
 	{
-		m_scenario = m_3gppPathloss->GetObject<MmWave3gppPropagationLossModel> ()->GetScenario();
+		m_scenario = m_3gppPropagationLoss->GetScenario();
 	}
-	else if (DynamicCast<MmWave3gppBuildingsPropagationLossModel> (m_3gppPathloss)!=0)
+	else if (m_3gppBuildingsLoss != 0)
 	{
-		m_scenario = m_3gppPathloss->GetObject<MmWave3gppBuildingsPropagationLossModel> ()->GetScenario();
+		m_scenario = m_3gppBuildingsLoss->GetScenario();
 	}
 	else
 	{
@@ -823,22 +1357,30 @@ MmWave3gppChannel::CalLongTerm (Ptr<Params3gpp> params) const
 
 	//store the long term part to reduce computation load
 	//only the small scale fading is need to be updated if the large scale parameters and antenna weights remain unchanged.
-	complexVector_t longTerm;
 	uint8_t numCluster = params->m_delay.size();
+	NS_ASSERT_MSG (numCluster == params->m_channel.GetNumCluster (), "the cluster number of channel and delay spread should be the same");
 
-	for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+	// all the clusters are accumulated together while walking the tensor in memory order,
+	// the summation order of each cluster is the same as computing them one by one.
+	complexVector_t longTerm (numCluster, std::complex<double> (0,0));
+	complexVector_t rxSum (numCluster);
+	for(uint8_t txIndex = 0; txIndex < txAntenna; txIndex++)
 	{
-		std::complex<double> txSum(0,0);
-		for(uint8_t txIndex = 0; txIndex < txAntenna; txIndex++)
+		std::fill (rxSum.begin (), rxSum.end (), std::complex<double> (0,0));
+		for (uint8_t rxIndex = 0; rxIndex < rxAntenna; rxIndex++)
 		{
-			std::complex<double> rxSum(0,0);
-			for (uint8_t rxIndex = 0; rxIndex < rxAntenna; rxIndex++)
+			const std::complex<double> rxW = std::conj(params->m_rxW[rxIndex]);
+			const std::complex<double> *h = params->m_channel.GetClusters (rxIndex, txIndex);
+			for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
 			{
-				rxSum = rxSum + std::conj(params->m_rxW.at(rxIndex))*params->m_channel.at(rxIndex).at(txIndex).at(cIndex);
+				rxSum[cIndex] = rxSum[cIndex] + rxW*h[cIndex];
 			}
-			txSum = txSum + params->m_txW.at(txIndex)*rxSum;
 		}
-		longTerm.push_back(txSum);
+		const std::complex<double> txW = params->m_txW[txIndex];
+		for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+		{
+			longTerm[cIndex] = longTerm[cIndex] + txW*rxSum[cIndex];
+		}
 	}
 	params->m_longTerm = longTerm;
 
@@ -1035,15 +1577,254 @@ MmWave3gppChannel::Get3gppTable (bool los, bool o2i, double hBS, double hUT, dou
 void
 MmWave3gppChannel::DeleteChannel(Ptr<const MobilityModel> a, Ptr<const MobilityModel> b) const
 {
-	Ptr<NetDevice> dev1 = a->GetObject<Node> ()->GetDevice (0);
-	Ptr<NetDevice> dev2 = b->GetObject<Node> ()->GetDevice (0);
+	uint32_t id1 = GetDeviceId (a->GetObject<Node> ());
+	uint32_t id2 = GetDeviceId (b->GetObject<Node> ());
+	const DeviceInfo3gpp &info1 = m_devices[id1];
+	const DeviceInfo3gpp &info2 = m_devices[id2];
 	NS_LOG_INFO("a position " << a->GetPosition() << " b " << b->GetPosition());
-	Ptr<Params3gpp> params = m_channelMap.find(std::make_pair(dev1,dev2))->second;
+	NS_ASSERT_MSG((info1.m_isEnb && info2.m_isUe) || (info1.m_isUe && info2.m_isEnb), "Channel not found");
+	Ptr<Params3gpp> params = info1.m_isEnb ? GetLinkState (info1, info2).m_params[0] : GetLinkState (info2, info1).m_params[1];
+	NS_ASSERT_MSG(params != 0, "Channel not found");
 	NS_LOG_INFO("params " << params);
-	NS_LOG_INFO("params m_channel size" << params->m_channel.size());
-	NS_ASSERT_MSG(m_channelMap.find(std::make_pair(dev1,dev2)) != m_channelMap.end(), "Channel not found");
-	params->m_channel.clear();
-	m_channelMap[std::make_pair(dev1,dev2)] = params;
+	NS_LOG_INFO("params m_channel empty " << params->m_channel.IsEmpty ());
+	params->m_channel.Clear ();
+}
+
+void
+MmWave3gppChannel::ScheduleBatchUpdate (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b) const
+{
+	Time updateTime = Simulator::Now () + m_updatePeriod;
+	NS_LOG_INFO("Time " << Simulator::Now().GetSeconds() << " schedule batch update at " << updateTime.GetSeconds ()
+			<< " for a " << a->GetPosition() << " b " << b->GetPosition());
+	std::vector<BatchUpdate3gpp> &links = m_batchUpdates[updateTime];
+	if (links.empty ())
+	{
+		// first link due at this time
+		Simulator::Schedule (m_updatePeriod, &MmWave3gppChannel::BatchUpdate, this);
+	}
+	BatchUpdate3gpp link;
+	link.m_txMobility = a;
+	link.m_rxMobility = b;
+	links.push_back (link);
+}
+
+void
+MmWave3gppChannel::BatchUpdate () const
+{
+	std::map< Time, std::vector<BatchUpdate3gpp> >::iterator it = m_batchUpdates.find (Simulator::Now ());
+	NS_ASSERT_MSG (it != m_batchUpdates.end (), "no link due for update");
+	std::vector<BatchUpdate3gpp> links;
+	links.swap (it->second);
+	m_batchUpdates.erase (it);
+
+	//Gather the inputs of all the updates on the main thread, in the order of the links,
+	//this is also where the random streams of a link are created the first time.
+	m_updateJobs.clear ();
+	m_updateJobs.resize (links.size ());
+	for (uint32_t jobIndex = 0; jobIndex < links.size (); jobIndex++)
+	{
+		ChannelUpdateJob3gpp &job = m_updateJobs[jobIndex];
+		Ptr<const MobilityModel> a = links[jobIndex].m_txMobility;
+		Ptr<const MobilityModel> b = links[jobIndex].m_rxMobility;
+		uint32_t txId = GetDeviceId (a->GetObject<Node> ());
+		uint32_t rxId = GetDeviceId (b->GetObject<Node> ());
+		const DeviceInfo3gpp &txInfo = m_devices[txId];
+		const DeviceInfo3gpp &rxInfo = m_devices[rxId];
+		bool downlink = txInfo.m_isEnb;
+		uint8_t direction = downlink ? 0 : 1;
+		LinkState3gpp &link = downlink ? GetLinkState (txInfo, rxInfo) : GetLinkState (rxInfo, txInfo);
+		Ptr<Params3gpp> params = link.m_params[direction];
+		NS_ASSERT_MSG (params != 0, "Channel not found");
+
+		job.m_link = links[jobIndex];
+		job.m_params = params;
+		job.m_txDevice = txInfo.m_device;
+		job.m_rxDevice = rxInfo.m_device;
+		job.m_txAntenna = txInfo.m_antenna;
+		job.m_rxAntenna = rxInfo.m_antenna;
+		for (uint8_t i = 0; i < 2; i++)
+		{
+			job.m_txAntennaNum[i] = txInfo.m_antennaNum[i];
+			job.m_rxAntennaNum[i] = rxInfo.m_antennaNum[i];
+		}
+		job.m_txAngle = Angles (b->GetPosition (), a->GetPosition ());
+		job.m_rxAngle = Angles (a->GetPosition (), b->GetPosition ());
+		job.m_locUT = downlink ? b->GetPosition () : a->GetPosition ();
+		Vector rxSpeed = b->GetVelocity();
+		Vector txSpeed = a->GetVelocity();
+		job.m_speed = Vector (rxSpeed.x-txSpeed.x,rxSpeed.y-txSpeed.y,rxSpeed.z-txSpeed.z);
+
+		double x = a->GetPosition().x-b->GetPosition().x;
+		double y = a->GetPosition().y-b->GetPosition().y;
+		job.m_dis2D = sqrt (x*x +y*y);
+		job.m_dis3D = a->GetDistanceFrom(b);
+		double hUT = downlink ? b->GetPosition().z : a->GetPosition().z;
+		double hBS = downlink ? a->GetPosition().z : b->GetPosition().z;
+
+		bool los, o2i;
+		GetChannelCondition (a, b, los, o2i);
+		job.m_table3gpp = Get3gppTable(los, o2i, hBS, hUT, job.m_dis2D);
+		params->m_locUT = job.m_locUT;
+		params->m_los = los;
+		params->m_o2i = o2i;
+
+		if (params->m_normalRv == 0)
+		{
+			params->m_normalRv = CreateObject<NormalRandomVariable> ();
+			params->m_normalRv->SetAttribute ("Mean", DoubleValue (0));
+			params->m_normalRv->SetAttribute ("Variance", DoubleValue (1));
+			params->m_normalRvBlockage = CreateObject<NormalRandomVariable> ();
+			params->m_normalRvBlockage->SetAttribute ("Mean", DoubleValue (0));
+			params->m_normalRvBlockage->SetAttribute ("Variance", DoubleValue (1));
+			params->m_uniformRvBlockage = CreateObject<UniformRandomVariable> ();
+		}
+
+		job.m_connected = link.m_connected[direction];
+		if (job.m_connected)
+		{
+			// the beam search changes the sectors of the antennas, it is performed on the main thread
+			job.m_longTerm = !m_cellScan;
+		}
+		else
+		{
+			// the weights follow the current beams, they are kept during an omni transmission
+			if (!job.m_txAntenna->IsOmniTx () && !job.m_rxAntenna->IsOmniTx ())
+			{
+				params->m_txW = job.m_txAntenna->GetBeamformingVector();
+				params->m_rxW = job.m_rxAntenna->GetBeamformingVector();
+			}
+			job.m_longTerm = params->m_txW.size() != 0 && params->m_rxW.size() != 0;
+		}
+	}
+
+	uint32_t numThreads = 1;
+#ifdef HAVE_PTHREAD_H
+	numThreads = m_updateThreads;
+	if (numThreads == 0)
+	{
+		numThreads = std::max (sysconf (_SC_NPROCESSORS_ONLN), 1L);
+	}
+#endif
+	numThreads = std::min (numThreads, (uint32_t)m_updateJobs.size ());
+	NS_LOG_INFO ("Time " << Simulator::Now().GetSeconds() << " batch update of " << m_updateJobs.size ()
+			<< " channels on " << numThreads << " threads");
+
+	if (numThreads > 1)
+	{
+#ifdef HAVE_PTHREAD_H
+		std::vector< Ptr<SystemThread> > threads;
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			Callback<void, uint32_t, uint32_t> run = MakeCallback (&MmWave3gppChannel::RunUpdateJobs, this);
+			threads.push_back (Create<SystemThread> (run.TwoBind (t, numThreads)));
+			threads.back ()->Start ();
+		}
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			threads[t]->Join ();
+		}
+#endif
+	}
+	else
+	{
+		RunUpdateJobs (0, 1);
+	}
+
+	//Complete the updates on the main thread, the antennas are shared by several links.
+	Ptr<const SpectrumValue> fakePsd;
+	for (uint32_t jobIndex = 0; jobIndex < m_updateJobs.size (); jobIndex++)
+	{
+		ChannelUpdateJob3gpp &job = m_updateJobs[jobIndex];
+		Ptr<Params3gpp> params = job.m_params;
+		params->m_dis3D = job.m_dis3D;
+		params->m_dis2D = job.m_dis2D;
+		params->m_speed = job.m_speed;
+		params->m_generatedTime = Now();
+		params->m_preLocUT = job.m_locUT;
+
+		if (job.m_connected)
+		{
+			// the update is not triggered by a signal, an omni transmission in progress is kept
+			bool txOmni = job.m_txAntenna->IsOmniTx ();
+			bool rxOmni = job.m_rxAntenna->IsOmniTx ();
+			if (m_cellScan)
+			{
+				if (fakePsd == 0)
+				{
+					std::vector<int> listOfSubchannels;
+					for (unsigned i = 0; i < m_phyMacConfig->GetTotalNumChunk(); i++)
+					{
+						listOfSubchannels.push_back(i);
+					}
+					fakePsd = MmWaveSpectrumValueHelper::CreateTxPowerSpectralDensity (m_phyMacConfig, 0, listOfSubchannels);
+				}
+				// the search reads the beams of the antennas, which must not be in omni mode
+				if (txOmni)
+				{
+					job.m_txAntenna->SetBeamformingVector (params->m_txW);
+				}
+				if (rxOmni)
+				{
+					job.m_rxAntenna->SetBeamformingVector (params->m_rxW);
+				}
+				BeamSearchBeamforming (fakePsd, params, job.m_txAntenna, job.m_rxAntenna, job.m_txAntennaNum, job.m_rxAntennaNum);
+				CalLongTerm (params);
+			}
+			job.m_txAntenna->SetBeamformingVector (params->m_txW, job.m_rxDevice);
+			job.m_rxAntenna->SetBeamformingVector (params->m_rxW, job.m_txDevice);
+			if (txOmni)
+			{
+				job.m_txAntenna->ChangeToOmniTx ();
+			}
+			if (rxOmni)
+			{
+				job.m_rxAntenna->ChangeToOmniTx ();
+			}
+		}
+		ScheduleBatchUpdate (job.m_link.m_txMobility, job.m_link.m_rxMobility);
+	}
+	m_updateJobs.clear ();
+}
+
+void
+MmWave3gppChannel::RunUpdateJobs (uint32_t first, uint32_t stride) const
+{
+	for (uint32_t jobIndex = first; jobIndex < m_updateJobs.size (); jobIndex += stride)
+	{
+		ChannelUpdateJob3gpp &job = m_updateJobs[jobIndex];
+		UpdateChannel (job.m_params, job.m_table3gpp, job.m_txAntenna, job.m_rxAntenna,
+				job.m_txAntennaNum, job.m_rxAntennaNum, job.m_rxAngle, job.m_txAngle);
+		if (job.m_connected && job.m_longTerm)
+		{
+			LongTermCovMatrixBeamforming (job.m_params);
+		}
+		if (job.m_longTerm)
+		{
+			CalLongTerm (job.m_params);
+		}
+	}
+}
+
+/*
+ * Compute the steering vectors of an antenna array towards numRays directions, given as
+ * zenith and azimuth angles in radians. The entry of the ray r for the element e is stored in
+ * steering[e*numRays + r], so that the rays of an element are contiguous.
+ */
+static void
+CalRaySteering (const Ptr<AntennaArrayModel> &antenna, uint8_t *antennaNum, const double *zenith,
+		const double *azimuth, uint32_t numRays, complexVector_t &steering)
+{
+	uint16_t size = antennaNum[0]*antennaNum[1];
+	steering.resize ((size_t)size*numRays);
+	complexVector_t ray (size);
+	for (uint32_t rayIndex = 0; rayIndex < numRays; rayIndex++)
+	{
+		antenna->GetSteeringVector (zenith[rayIndex], azimuth[rayIndex], antennaNum, &ray[0]);
+		for (uint16_t index = 0; index < size; index++)
+		{
+			steering[(size_t)index*numRays + rayIndex] = ray[index];
+		}
+	}
 }
 
 Ptr<Params3gpp>
@@ -1614,28 +2395,51 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 
 	NS_LOG_INFO ("1st strongest cluster:"<<(int)cluster1st<<", 2nd strongest cluster:"<<(int)cluster2nd);
 
-	complex3DVector_t H_usn; //channel coffecient H_usn[u][s][n];
 	//Since each of the strongest 2 clusters are divided into 3 sub-clusters, the total cluster will be numReducedCLuster + 4.
-
-	H_usn.resize(uSize);
-	for (uint16_t uIndex = 0; uIndex < uSize; uIndex++)
+	//The sub-clusters are stored after the first numReducedCluster clusters, in increasing order of their parent cluster.
+	uint8_t numSubCluster = (cluster1st == cluster2nd) ? 2 : 4;
+	ChannelTensor3gpp &H_usn = channelParams->m_channel; //channel coffecient H_usn[u][s][n];
+	H_usn.Resize (uSize, sSize, numReducedCluster + numSubCluster);
+	//double slotTime = Simulator::Now ().GetSeconds ();
+	// The following for loops computes the channel coefficients
+	// the phases of the rays and the steering vectors of the arrays towards the rays are computed
+	// once, and not for each pair of antenna elements
+	uint32_t numRays = numReducedCluster*raysPerCluster;
+	complexVector_t rayPhase (numRays);
+	for (uint8_t nIndex = 0; nIndex < numReducedCluster; nIndex++)
 	{
-		H_usn.at(uIndex).resize(sSize);
-		for (uint16_t sIndex = 0; sIndex < sSize; sIndex++)
+		for(uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
 		{
-			H_usn.at(uIndex).at(sIndex).resize(numReducedCluster);
+			double initialPhase = clusterPhase.at(nIndex).at(mIndex);
+			rayPhase[nIndex*raysPerCluster + mIndex] = exp(std::complex<double>(0, initialPhase))
+					*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]));
 		}
 	}
-	//double slotTime = Simulator::Now ().GetSeconds ();
-	// The following for loops computes the channel coefficients
+	complexVector_t rxSteering, txSteering;
+	CalRaySteering (rxAntenna, rxAntennaNum, &rayZoa_radian[0][0], &rayAoa_radian[0][0], numRays, rxSteering);
+	CalRaySteering (txAntenna, txAntennaNum, &rayZod_radian[0][0], &rayAod_radian[0][0], numRays, txSteering);
+	complexVector_t rxLosSteering, txLosSteering;
+	std::complex<double> losRayPhase;
+	if(los)
+	{
+		rxLosSteering.resize (uSize);
+		txLosSteering.resize (sSize);
+		rxAntenna->GetSteeringVector (rxAngle.theta, rxAngle.phi, rxAntennaNum, &rxLosSteering[0]);
+		txAntenna->GetSteeringVector (txAngle.theta, txAngle.phi, txAntennaNum, &txLosSteering[0]);
+		losRayPhase = exp(std::complex<double>(0, losPhase))
+				*(rxAntenna->GetRadiationPattern(rxAngle.theta)*txAntenna->GetRadiationPattern(txAngle.theta));
+	}
+
 	for (uint16_t uIndex = 0; uIndex < uSize; uIndex++)
 	{
-		Vector uLoc = rxAntenna->GetAntennaLocation(uIndex,rxAntennaNum);
+		const std::complex<double> *uSteering = &rxSteering[(size_t)uIndex*numRays];
 
 		for (uint16_t sIndex = 0; sIndex < sSize; sIndex++)
 		{
 
-			Vector sLoc = txAntenna->GetAntennaLocation(sIndex,txAntennaNum);
+			const std::complex<double> *sSteering = &txSteering[(size_t)sIndex*numRays];
+			std::complex<double> *h = H_usn.GetClusters (uIndex, sIndex);
+			uint8_t subIndex = H_usn.GetNumCluster () - numSubCluster;
 
 			for (uint8_t nIndex = 0; nIndex < numReducedCluster; nIndex++)
 			{
@@ -1645,29 +2449,18 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 					std::complex<double> rays(0,0);
 					for(uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
 					{
-						double initialPhase = clusterPhase.at(nIndex).at(mIndex);
-						//lambda_0 is accounted in the antenna spacing uLoc and sLoc.
-						double rxPhaseDiff = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*uLoc.x
-								+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*uLoc.y
-								+ cos(rayZoa_radian[nIndex][mIndex])*uLoc.z);
-
-						double txPhaseDiff = 2*M_PI*(sin(rayZod_radian[nIndex][mIndex])*cos(rayAod_radian[nIndex][mIndex])*sLoc.x
-								+ sin(rayZod_radian[nIndex][mIndex])*sin(rayAod_radian[nIndex][mIndex])*sLoc.y
-								+ cos(rayZod_radian[nIndex][mIndex])*sLoc.z);
+						uint32_t rayIndex = nIndex*raysPerCluster + mIndex;
 						//Doppler is computed in the CalBeamformingGain function and is simplified to only account for the center anngle of each cluster.
 						//double doppler = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*relativeSpeed.x
 						//		+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*relativeSpeed.y
 						//		+ cos(rayZoa_radian[nIndex][mIndex])*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
-						rays += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+						rays += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 						//rays += 1;
 					}
 					//rays *= sqrt(clusterPower.at(nIndex))/raysPerCluster;
 					rays *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
-					H_usn.at(uIndex).at(sIndex).at(nIndex) = rays;
+					h[nIndex] = rays;
 				}
 				else //(7.5-28)
 				{
@@ -1680,13 +2473,7 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 
 						//ZML:Just remind me that the angle offsets for the 3 subclusters were not generated correctly.
 
-						double initialPhase = clusterPhase.at(nIndex).at(mIndex);
-						double rxPhaseDiff = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*uLoc.x
-								+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*uLoc.y
-								+ cos(rayZoa_radian[nIndex][mIndex])*uLoc.z);
-						double txPhaseDiff = 2*M_PI*(sin(rayZod_radian[nIndex][mIndex])*cos(rayAod_radian[nIndex][mIndex])*sLoc.x
-								+ sin(rayZod_radian[nIndex][mIndex])*sin(rayAod_radian[nIndex][mIndex])*sLoc.y
-								+ cos(rayZod_radian[nIndex][mIndex])*sLoc.z);
+						uint32_t rayIndex = nIndex*raysPerCluster + mIndex;
 						//double doppler = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*relativeSpeed.x
 						//		+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*relativeSpeed.y
 						//		+ cos(rayZoa_radian[nIndex][mIndex])*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
@@ -1700,10 +2487,7 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 						case 17:
 						case 18:
 							//delaySpread= -2*M_PI*(clusterDelay.at(nIndex)+1.28*c_DS)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub2 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub2 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub2 +=1;
 							break;
@@ -1712,19 +2496,13 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 						case 15:
 						case 16:
 							//delaySpread = -2*M_PI*(clusterDelay.at(nIndex)+2.56*c_DS)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub3 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub3 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub3 +=1;
 							break;
 						default://case 1,2,3,4,5,6,7,8,19,20
 							//delaySpread = -2*M_PI*clusterDelay.at(nIndex)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub1 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub1 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub1 +=1;
 							break;
@@ -1736,38 +2514,29 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 					raysSub1 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
 					raysSub2 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
 					raysSub3 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
-					H_usn.at(uIndex).at(sIndex).at(nIndex) = raysSub1;
-					H_usn.at(uIndex).at(sIndex).push_back(raysSub2);
-					H_usn.at(uIndex).at(sIndex).push_back(raysSub3);
+					h[nIndex] = raysSub1;
+					h[subIndex++] = raysSub2;
+					h[subIndex++] = raysSub3;
 
 				}
 			}
 			if(los) //(7.5-29) && (7.5-30)
 			{
 				std::complex<double> ray(0,0);
-				double rxPhaseDiff = 2*M_PI*(sin(rxAngle.theta)*cos(rxAngle.phi)*uLoc.x
-						+ sin(rxAngle.theta)*sin(rxAngle.phi)*uLoc.y
-						+ cos(rxAngle.theta)*uLoc.z);
-				double txPhaseDiff = 2*M_PI*(sin(txAngle.theta)*cos(txAngle.phi)*sLoc.x
-						+ sin(txAngle.theta)*sin(txAngle.phi)*sLoc.y
-						+ cos(txAngle.theta)*sLoc.z);
 				//double doppler = 2*M_PI*(sin(rxAngle.theta)*cos(rxAngle.phi)*relativeSpeed.x
 				//		+ sin(rxAngle.theta)*sin(rxAngle.phi)*relativeSpeed.y
 				//		+ cos(rxAngle.theta)*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
 
-				ray = exp(std::complex<double>(0, losPhase))
-						*(rxAntenna->GetRadiationPattern(rxAngle.theta)*txAntenna->GetRadiationPattern(txAngle.theta))
-						*exp(std::complex<double>(0, rxPhaseDiff))
-						*exp(std::complex<double>(0, txPhaseDiff));
+				ray = losRayPhase*rxLosSteering[uIndex]*txLosSteering[sIndex];
 						//*exp(std::complex<double>(0, doppler));
 
 				double K_linear = pow(10,K_factor/10);
 				// the LOS path should be attenuated if blockage is enabled.
-				H_usn.at(uIndex).at(sIndex).at(0) = sqrt(1/(K_linear+1))*H_usn.at(uIndex).at(sIndex).at(0)+sqrt(K_linear/(1+K_linear))*ray/pow(10,attenuation_dB.at (0)/10);  //(7.5-30) for tau = tau1
-				double tempSize = H_usn.at(uIndex).at(sIndex).size();
+				h[0] = sqrt(1/(K_linear+1))*h[0]+sqrt(K_linear/(1+K_linear))*ray/pow(10,attenuation_dB.at (0)/10);  //(7.5-30) for tau = tau1
+				double tempSize = H_usn.GetNumCluster ();
 				for(uint8_t nIndex = 1; nIndex < tempSize; nIndex++)
 				{
-					H_usn.at(uIndex).at(sIndex).at(nIndex) *= sqrt(1/(K_linear+1)); //(7.5-30) for tau = tau2...taunN
+					h[nIndex] *= sqrt(1/(K_linear+1)); //(7.5-30) for tau = tau2...taunN
 				}
 
 			}
@@ -1832,7 +2601,7 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 
 	}
 
-	NS_LOG_INFO ("size of coefficient matrix =["<<H_usn.size() << "][" << H_usn.at(0).size() << "][" << H_usn.at (0).at(0).size()<<"]");
+	NS_LOG_INFO ("size of coefficient matrix =["<<H_usn.GetRxSize () << "][" << H_usn.GetTxSize () << "][" << (uint16_t)H_usn.GetNumCluster ()<<"]");
 
 
 	/*std::cout << "Delay:";
@@ -1842,7 +2611,6 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 	}
 	std::cout << "\n";*/
 
-	channelParams->m_channel = H_usn;
 	channelParams->m_delay = clusterDelay;
 
 	channelParams->m_angle.clear();
@@ -1851,17 +2619,20 @@ MmWave3gppChannel::GetNewChannel(Ptr<ParamsTable>  table3gpp, Vector locUT, bool
 	channelParams->m_angle.push_back(clusterAod);
 	channelParams->m_angle.push_back(clusterZod);
 
+	CalDelayPhaseRamp (channelParams);
+
 	return channelParams;
 
 }
 
 Ptr<Params3gpp>
 MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  table3gpp,
-		Ptr<AntennaArrayModel> txAntenna, Ptr<AntennaArrayModel> rxAntenna,
+		const Ptr<AntennaArrayModel> &txAntenna, const Ptr<AntennaArrayModel> &rxAntenna,
 		uint8_t *txAntennaNum, uint8_t *rxAntennaNum, Angles &rxAngle, Angles &txAngle) const
 {
 	Ptr<Params3gpp> params = params3gpp;
 	uint8_t raysPerCluster = table3gpp->m_raysPerCluster;
+	NormalRandomVariable *normalRv = params->m_normalRv != 0 ? PeekPointer (params->m_normalRv) : PeekPointer (m_normalRv);
 	//We first update the current location, the previous location will be updated in the end.
 
 
@@ -1901,7 +2672,7 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 	for (uint8_t cIndex = 0; cIndex < params->m_numCluster; cIndex++)
 	{
 		double power = exp(-1*clusterDelay.at(cIndex)*(table3gpp->m_rTau-1)/table3gpp->m_rTau/DS)*
-				pow(10,-1*m_normalRv->GetValue()*table3gpp->m_shadowingStd/10); //(7.5-5)
+				pow(10,-1*normalRv->GetValue()*table3gpp->m_shadowingStd/10); //(7.5-5)
 		powerSum +=power;
 		clusterPower.push_back(power);
 	}
@@ -1999,10 +2770,10 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 				}
 
 				//We can generate a new correlated normal RV with the following formula
-				params->m_norRvAngles.at(cInd).at(AOD_INDEX) = R_phi*params->m_norRvAngles.at(cInd).at(AOD_INDEX)+sqrt(1-R_phi*R_phi)*m_normalRv->GetValue();
-				params->m_norRvAngles.at(cInd).at(ZOD_INDEX) = R_theta*params->m_norRvAngles.at(cInd).at(ZOD_INDEX)+sqrt(1-R_theta*R_theta)*m_normalRv->GetValue();
-				params->m_norRvAngles.at(cInd).at(AOA_INDEX) = R_phi*params->m_norRvAngles.at(cInd).at(AOA_INDEX)+sqrt(1-R_phi*R_phi)*m_normalRv->GetValue();
-				params->m_norRvAngles.at(cInd).at(ZOA_INDEX) = R_theta*params->m_norRvAngles.at(cInd).at(ZOA_INDEX)+sqrt(1-R_theta*R_theta)*m_normalRv->GetValue();
+				params->m_norRvAngles.at(cInd).at(AOD_INDEX) = R_phi*params->m_norRvAngles.at(cInd).at(AOD_INDEX)+sqrt(1-R_phi*R_phi)*normalRv->GetValue();
+				params->m_norRvAngles.at(cInd).at(ZOD_INDEX) = R_theta*params->m_norRvAngles.at(cInd).at(ZOD_INDEX)+sqrt(1-R_theta*R_theta)*normalRv->GetValue();
+				params->m_norRvAngles.at(cInd).at(AOA_INDEX) = R_phi*params->m_norRvAngles.at(cInd).at(AOA_INDEX)+sqrt(1-R_phi*R_phi)*normalRv->GetValue();
+				params->m_norRvAngles.at(cInd).at(ZOA_INDEX) = R_theta*params->m_norRvAngles.at(cInd).at(ZOA_INDEX)+sqrt(1-R_theta*R_theta)*normalRv->GetValue();
 
 				//The normal RV is transformed to uniform RV with the desired correlation.
 				ranPhiAOD = (0.5*erfc(-1*params->m_norRvAngles.at(cInd).at(AOD_INDEX)/sqrt(2)))*2*M_PI-M_PI;
@@ -2258,28 +3029,51 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 
 	NS_LOG_INFO ("1st strongest cluster:"<<(int)cluster1st<<", 2nd strongest cluster:"<<(int)cluster2nd);
 
-	complex3DVector_t H_usn; //channel coffecient H_usn[u][s][n];
 	//Since each of the strongest 2 clusters are divided into 3 sub-clusters, the total cluster will be numReducedCLuster + 4.
-
-	H_usn.resize(uSize);
-	for (uint16_t uIndex = 0; uIndex < uSize; uIndex++)
+	//The sub-clusters are stored after the first m_numCluster clusters, in increasing order of their parent cluster.
+	uint8_t numSubCluster = (cluster1st == cluster2nd) ? 2 : 4;
+	ChannelTensor3gpp &H_usn = params->m_channel; //channel coffecient H_usn[u][s][n];
+	H_usn.Resize (uSize, sSize, params->m_numCluster + numSubCluster);
+	//double slotTime = Simulator::Now ().GetSeconds ();
+	// The following for loops computes the channel coefficients
+	// the phases of the rays and the steering vectors of the arrays towards the rays are computed
+	// once, and not for each pair of antenna elements
+	uint32_t numRays = params->m_numCluster*raysPerCluster;
+	complexVector_t rayPhase (numRays);
+	for (uint8_t nIndex = 0; nIndex < params->m_numCluster; nIndex++)
 	{
-		H_usn.at(uIndex).resize(sSize);
-		for (uint16_t sIndex = 0; sIndex < sSize; sIndex++)
+		for(uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
 		{
-			H_usn.at(uIndex).at(sIndex).resize(params->m_numCluster);
+			double initialPhase = clusterPhase.at(nIndex).at(mIndex);
+			rayPhase[nIndex*raysPerCluster + mIndex] = exp(std::complex<double>(0, initialPhase))
+					*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]));
 		}
 	}
-	//double slotTime = Simulator::Now ().GetSeconds ();
-	// The following for loops computes the channel coefficients
+	complexVector_t rxSteering, txSteering;
+	CalRaySteering (rxAntenna, rxAntennaNum, &rayZoa_radian[0][0], &rayAoa_radian[0][0], numRays, rxSteering);
+	CalRaySteering (txAntenna, txAntennaNum, &rayZod_radian[0][0], &rayAod_radian[0][0], numRays, txSteering);
+	complexVector_t rxLosSteering, txLosSteering;
+	std::complex<double> losRayPhase;
+	if(params->m_los)
+	{
+		rxLosSteering.resize (uSize);
+		txLosSteering.resize (sSize);
+		rxAntenna->GetSteeringVector (rxAngle.theta, rxAngle.phi, rxAntennaNum, &rxLosSteering[0]);
+		txAntenna->GetSteeringVector (txAngle.theta, txAngle.phi, txAntennaNum, &txLosSteering[0]);
+		losRayPhase = exp(std::complex<double>(0, losPhase))
+				*(rxAntenna->GetRadiationPattern(rxAngle.theta)*txAntenna->GetRadiationPattern(txAngle.theta));
+	}
+
 	for (uint16_t uIndex = 0; uIndex < uSize; uIndex++)
 	{
-		Vector uLoc = rxAntenna->GetAntennaLocation(uIndex,rxAntennaNum);
+		const std::complex<double> *uSteering = &rxSteering[(size_t)uIndex*numRays];
 
 		for (uint16_t sIndex = 0; sIndex < sSize; sIndex++)
 		{
 
-			Vector sLoc = txAntenna->GetAntennaLocation(sIndex,txAntennaNum);
+			const std::complex<double> *sSteering = &txSteering[(size_t)sIndex*numRays];
+			std::complex<double> *h = H_usn.GetClusters (uIndex, sIndex);
+			uint8_t subIndex = H_usn.GetNumCluster () - numSubCluster;
 
 			for (uint8_t nIndex = 0; nIndex < params->m_numCluster; nIndex++)
 			{
@@ -2289,29 +3083,18 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 					std::complex<double> rays(0,0);
 					for(uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
 					{
-						double initialPhase = clusterPhase.at(nIndex).at(mIndex);
-						//lambda_0 is accounted in the antenna spacing uLoc and sLoc.
-						double rxPhaseDiff = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*uLoc.x
-								+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*uLoc.y
-								+ cos(rayZoa_radian[nIndex][mIndex])*uLoc.z);
-
-						double txPhaseDiff = 2*M_PI*(sin(rayZod_radian[nIndex][mIndex])*cos(rayAod_radian[nIndex][mIndex])*sLoc.x
-								+ sin(rayZod_radian[nIndex][mIndex])*sin(rayAod_radian[nIndex][mIndex])*sLoc.y
-								+ cos(rayZod_radian[nIndex][mIndex])*sLoc.z);
+						uint32_t rayIndex = nIndex*raysPerCluster + mIndex;
 						//Doppler is computed in the CalBeamformingGain function and is simplified to only account for the center anngle of each cluster.
 						//double doppler = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*relativeSpeed.x
 						//		+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*relativeSpeed.y
 						//		+ cos(rayZoa_radian[nIndex][mIndex])*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
-						rays += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+						rays += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 						//rays += 1;
 					}
 					//rays *= sqrt(clusterPower.at(nIndex))/raysPerCluster;
 					rays *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
-					H_usn.at(uIndex).at(sIndex).at(nIndex) = rays;
+					h[nIndex] = rays;
 				}
 				else //(7.5-28)
 				{
@@ -2321,13 +3104,7 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 
 					for(uint8_t mIndex = 0; mIndex < raysPerCluster; mIndex++)
 					{
-						double initialPhase = clusterPhase.at(nIndex).at(mIndex);
-						double rxPhaseDiff = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*uLoc.x
-								+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*uLoc.y
-								+ cos(rayZoa_radian[nIndex][mIndex])*uLoc.z);
-						double txPhaseDiff = 2*M_PI*(sin(rayZod_radian[nIndex][mIndex])*cos(rayAod_radian[nIndex][mIndex])*sLoc.x
-								+ sin(rayZod_radian[nIndex][mIndex])*sin(rayAod_radian[nIndex][mIndex])*sLoc.y
-								+ cos(rayZod_radian[nIndex][mIndex])*sLoc.z);
+						uint32_t rayIndex = nIndex*raysPerCluster + mIndex;
 						//double doppler = 2*M_PI*(sin(rayZoa_radian[nIndex][mIndex])*cos(rayAoa_radian[nIndex][mIndex])*relativeSpeed.x
 						//		+ sin(rayZoa_radian[nIndex][mIndex])*sin(rayAoa_radian[nIndex][mIndex])*relativeSpeed.y
 						//		+ cos(rayZoa_radian[nIndex][mIndex])*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
@@ -2341,10 +3118,7 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 						case 17:
 						case 18:
 							//delaySpread= -2*M_PI*(clusterDelay.at(nIndex)+1.28*c_DS)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub2 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub2 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub2 +=1;
 							break;
@@ -2353,19 +3127,13 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 						case 15:
 						case 16:
 							//delaySpread = -2*M_PI*(clusterDelay.at(nIndex)+2.56*c_DS)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub3 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub3 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub3 +=1;
 							break;
 						default://case 1,2,3,4,5,6,7,8,19,20
 							//delaySpread = -2*M_PI*clusterDelay.at(nIndex)*m_phyMacConfig->GetCentreFrequency ();
-							raysSub1 += exp(std::complex<double>(0, initialPhase))
-								*(rxAntenna->GetRadiationPattern(rayZoa_radian[nIndex][mIndex])*txAntenna->GetRadiationPattern(rayZod_radian[nIndex][mIndex]))
-								*exp(std::complex<double>(0, rxPhaseDiff))
-								*exp(std::complex<double>(0, txPhaseDiff));
+							raysSub1 += rayPhase[rayIndex]*uSteering[rayIndex]*sSteering[rayIndex];
 								//*exp(std::complex<double>(0, doppler));
 							//raysSub1 +=1;
 							break;
@@ -2377,38 +3145,29 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 					raysSub1 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
 					raysSub2 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
 					raysSub3 *= sqrt(clusterPower.at(nIndex)/raysPerCluster);
-					H_usn.at(uIndex).at(sIndex).at(nIndex) = raysSub1;
-					H_usn.at(uIndex).at(sIndex).push_back(raysSub2);
-					H_usn.at(uIndex).at(sIndex).push_back(raysSub3);
+					h[nIndex] = raysSub1;
+					h[subIndex++] = raysSub2;
+					h[subIndex++] = raysSub3;
 
 				}
 			}
 			if(params->m_los) //(7.5-29) && (7.5-30)
 			{
 				std::complex<double> ray(0,0);
-				double rxPhaseDiff = 2*M_PI*(sin(rxAngle.theta)*cos(rxAngle.phi)*uLoc.x
-						+ sin(rxAngle.theta)*sin(rxAngle.phi)*uLoc.y
-						+ cos(rxAngle.theta)*uLoc.z);
-				double txPhaseDiff = 2*M_PI*(sin(txAngle.theta)*cos(txAngle.phi)*sLoc.x
-						+ sin(txAngle.theta)*sin(txAngle.phi)*sLoc.y
-						+ cos(txAngle.theta)*sLoc.z);
 				//double doppler = 2*M_PI*(sin(rxAngle.theta)*cos(rxAngle.phi)*relativeSpeed.x
 				//		+ sin(rxAngle.theta)*sin(rxAngle.phi)*relativeSpeed.y
 				//		+ cos(rxAngle.theta)*relativeSpeed.z)*slotTime*m_phyMacConfig->GetCentreFrequency ()/3e8;
 
-				ray = exp(std::complex<double>(0, losPhase))
-						*(rxAntenna->GetRadiationPattern(rxAngle.theta)*txAntenna->GetRadiationPattern(txAngle.theta))
-						*exp(std::complex<double>(0, rxPhaseDiff))
-						*exp(std::complex<double>(0, txPhaseDiff));
+				ray = losRayPhase*rxLosSteering[uIndex]*txLosSteering[sIndex];
 						//*exp(std::complex<double>(0, doppler));
 
 				double K_linear = pow(10,K_factor/10);
 
-				H_usn.at(uIndex).at(sIndex).at(0) = sqrt(1/(K_linear+1))*H_usn.at(uIndex).at(sIndex).at(0)+sqrt(K_linear/(1+K_linear))*ray/pow(10,attenuation_dB.at (0)/10);  //(7.5-30) for tau = tau1
-				double tempSize = H_usn.at(uIndex).at(sIndex).size();
+				h[0] = sqrt(1/(K_linear+1))*h[0]+sqrt(K_linear/(1+K_linear))*ray/pow(10,attenuation_dB.at (0)/10);  //(7.5-30) for tau = tau1
+				double tempSize = H_usn.GetNumCluster ();
 				for(uint8_t nIndex = 1; nIndex < tempSize; nIndex++)
 				{
-					H_usn.at(uIndex).at(sIndex).at(nIndex) *= sqrt(1/(K_linear+1)); //(7.5-30) for tau = tau2...taunN
+					h[nIndex] *= sqrt(1/(K_linear+1)); //(7.5-30) for tau = tau2...taunN
 				}
 
 			}
@@ -2456,7 +3215,7 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 
 	}
 
-	NS_LOG_INFO ("size of coefficient matrix =["<<H_usn.size() << "][" << H_usn.at(0).size() << "][" << H_usn.at (0).at(0).size()<<"]");
+	NS_LOG_INFO ("size of coefficient matrix =["<<H_usn.GetRxSize () << "][" << H_usn.GetTxSize () << "][" << (uint16_t)H_usn.GetNumCluster ()<<"]");
 
 
 	/*std::cout << "Delay:";
@@ -2467,60 +3226,222 @@ MmWave3gppChannel::UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable>  t
 	std::cout << "\n";*/
 
 	params->m_delay = clusterDelay;
-	params->m_channel = H_usn;
 	params->m_angle.clear();
 	params->m_angle.push_back(clusterAoa);
 	params->m_angle.push_back(clusterZoa);
 	params->m_angle.push_back(clusterAod);
 	params->m_angle.push_back(clusterZod);
+	CalDelayPhaseRamp (params);
 	//update the previous location.
 
 	return params;
 
 }
 
+/*
+ * Append to beams the beams of the codebook on a grid of every step-th elevation and sector.
+ */
+static void
+CodebookGrid (const BeamCodebook3gpp &codebook, uint16_t step, std::vector<uint16_t> &beams)
+{
+	for (uint16_t eIndex = 0; eIndex < BEAM_SEARCH_NUM_ELEVATIONS; eIndex += step)
+	{
+		for (uint16_t sector = 0; sector < codebook.m_numSectors; sector += step)
+		{
+			beams.push_back (eIndex*codebook.m_numSectors + sector);
+		}
+	}
+}
+
+/*
+ * Append to beams the beam of the codebook and its neighbors in elevation and sector.
+ */
+static void
+CodebookNeighbors (const BeamCodebook3gpp &codebook, uint16_t beam, std::vector<uint16_t> &beams)
+{
+	int32_t eIndex = beam/codebook.m_numSectors;
+	int32_t sector = beam%codebook.m_numSectors;
+	for (int32_t e = std::max (eIndex - 1, 0); e <= std::min (eIndex + 1, BEAM_SEARCH_NUM_ELEVATIONS - 1); e++)
+	{
+		for (int32_t s = std::max (sector - 1, 0); s <= std::min (sector + 1, codebook.m_numSectors - 1); s++)
+		{
+			beams.push_back (e*codebook.m_numSectors + s);
+		}
+	}
+}
+
+/*
+ * Evaluate the gain of the beam pairs txBeams x rxBeams on the channel. The gain of a pair,
+ * averaged over the subbands, is L^H P L, where L is the long term component of the pair
+ * and P is the correlation of the cluster delay phases over the subbands (numCluster x numCluster,
+ * upper triangle). The transmit beams are applied to the tensor first, then each receive beam
+ * to the result. bestGain and the pair are updated when a pair has a strictly larger gain,
+ * the pairs are visited in the order of txBeams and then of rxBeams.
+ */
+static void
+SearchBeamPairs (const ChannelTensor3gpp &channel, const std::vector< std::complex<double> > &clusterCorr,
+		const BeamCodebook3gpp &txCodebook, const std::vector<uint16_t> &txBeams,
+		const BeamCodebook3gpp &rxCodebook, const std::vector<uint16_t> &rxBeams,
+		double &bestGain, uint16_t &bestTx, uint16_t &bestRx)
+{
+	uint16_t rxSize = channel.GetRxSize ();
+	uint16_t txSize = channel.GetTxSize ();
+	uint8_t numCluster = channel.GetNumCluster ();
+	NS_ASSERT_MSG (txCodebook.m_size == txSize && rxCodebook.m_size == rxSize, "the codebooks do not match the channel");
+
+	std::vector<double> txRe (txSize), txIm (txSize);
+	std::vector<double> gRe ((size_t)rxSize*numCluster), gIm ((size_t)rxSize*numCluster);
+	double lRe[256], lIm[256];
+	for (uint32_t i = 0; i < txBeams.size (); i++)
+	{
+		const std::complex<double> *txW = &txCodebook.m_beams[(size_t)txBeams[i]*txSize];
+		for (uint16_t txIndex = 0; txIndex < txSize; txIndex++)
+		{
+			txRe[txIndex] = txW[txIndex].real ();
+			txIm[txIndex] = txW[txIndex].imag ();
+		}
+		// g[u][c] = sum_s H[u][s][c]*txW[s]
+		for (uint16_t rxIndex = 0; rxIndex < rxSize; rxIndex++)
+		{
+			double *rowRe = &gRe[(size_t)rxIndex*numCluster];
+			double *rowIm = &gIm[(size_t)rxIndex*numCluster];
+			std::fill (rowRe, rowRe + numCluster, 0.0);
+			std::fill (rowIm, rowIm + numCluster, 0.0);
+			for (uint16_t txIndex = 0; txIndex < txSize; txIndex++)
+			{
+				const std::complex<double> *h = channel.GetClusters (rxIndex, txIndex);
+				double wRe = txRe[txIndex], wIm = txIm[txIndex];
+				for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+				{
+					rowRe[cIndex] += h[cIndex].real ()*wRe - h[cIndex].imag ()*wIm;
+					rowIm[cIndex] += h[cIndex].real ()*wIm + h[cIndex].imag ()*wRe;
+				}
+			}
+		}
+
+		for (uint32_t j = 0; j < rxBeams.size (); j++)
+		{
+			// L[c] = sum_u conj(rxW[u])*g[u][c]
+			const std::complex<double> *rxW = &rxCodebook.m_beams[(size_t)rxBeams[j]*rxSize];
+			std::fill (lRe, lRe + numCluster, 0.0);
+			std::fill (lIm, lIm + numCluster, 0.0);
+			for (uint16_t rxIndex = 0; rxIndex < rxSize; rxIndex++)
+			{
+				double wRe = rxW[rxIndex].real (), wIm = rxW[rxIndex].imag ();
+				const double *rowRe = &gRe[(size_t)rxIndex*numCluster];
+				const double *rowIm = &gIm[(size_t)rxIndex*numCluster];
+				for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+				{
+					lRe[cIndex] += wRe*rowRe[cIndex] + wIm*rowIm[cIndex];
+					lIm[cIndex] += wRe*rowIm[cIndex] - wIm*rowRe[cIndex];
+				}
+			}
+
+			// L^H P L with P Hermitian
+			double power = 0;
+			for (uint8_t c1 = 0; c1 < numCluster; c1++)
+			{
+				const std::complex<double> *corr = &clusterCorr[(size_t)c1*numCluster];
+				double accRe = 0, accIm = 0;
+				for (uint8_t c2 = c1 + 1; c2 < numCluster; c2++)
+				{
+					accRe += corr[c2].real ()*lRe[c2] - corr[c2].imag ()*lIm[c2];
+					accIm += corr[c2].real ()*lIm[c2] + corr[c2].imag ()*lRe[c2];
+				}
+				power += corr[c1].real ()*(lRe[c1]*lRe[c1] + lIm[c1]*lIm[c1])
+						+ 2*(lRe[c1]*accRe + lIm[c1]*accIm);
+			}
+
+			if (bestGain < power)
+			{
+				bestGain = power;
+				bestTx = txBeams[i];
+				bestRx = rxBeams[j];
+			}
+		}
+	}
+}
+
 void
 MmWave3gppChannel::BeamSearchBeamforming (Ptr<const SpectrumValue> txPsd, Ptr<Params3gpp> params, Ptr<AntennaArrayModel> txAntenna,
 		Ptr<AntennaArrayModel> rxAntenna, uint8_t *txAntennaNum, uint8_t *rxAntennaNum) const
 {
 	double max = 0, maxTx = 0, maxRx =0, maxTxTheta=0, maxRxTheta=0;
 	NS_LOG_LOGIC("BeamSearchBeamforming method at time " << Simulator::Now().GetSeconds());
-	for (uint16_t txTheta = 60; txTheta < 121; txTheta=txTheta+10)
+	NS_ASSERT_MSG (params->m_delayPhase.size () == params->m_channel.GetNumCluster (), "the delay phase ramps are not computed for this channel");
+
+	// correlation of the cluster phases over the subbands carrying power, as averaged by CalBeamformingGain
+	uint8_t numCluster = params->m_channel.GetNumCluster ();
+	std::vector< std::complex<double> > clusterCorr ((size_t)numCluster*numCluster);
+	complexVector_t phase = params->m_delayPhase;
+	uint32_t activeBands = 0;
+	MmWaveBandRange bands = MmWaveSpectrumValueHelper::GetActiveBands (*txPsd);
+	if (bands.m_first > 0)
 	{
-		for(uint16_t tx=0; tx<=txAntennaNum[1]; tx++)
+		for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
 		{
-			for (uint16_t rxTheta = 60; rxTheta < 121; rxTheta=rxTheta+10)
+			phase[cIndex] *= std::polar (1.0, bands.m_first*std::arg (params->m_delayPhaseStep[cIndex]));
+		}
+	}
+	Values::const_iterator psd = txPsd->ConstValuesBegin () + bands.m_first;
+	for (uint32_t iSubband = bands.m_first; iSubband < bands.m_end; iSubband++, psd++)
+	{
+		if (*psd != 0.00)
+		{
+			for (uint8_t c1 = 0; c1 < numCluster; c1++)
 			{
-				for(uint16_t rx=0; rx<=rxAntennaNum[1]; rx++)
+				for (uint8_t c2 = c1; c2 < numCluster; c2++)
 				{
-					NS_LOG_LOGIC("txTheta " << txTheta << " rxTheta " << rxTheta << " tx sector " << 
-						(M_PI*(double)tx/(double)txAntennaNum[1]-0.5*M_PI)/(M_PI)*180 << " rx sector " << 
-						(M_PI*(double)rx/(double)rxAntennaNum[1]-0.5*M_PI)/(M_PI)*180);
-
-					txAntenna->SetSector(tx, txAntennaNum, txTheta);
-					rxAntenna->SetSector(rx, rxAntennaNum, rxTheta);
-					params->m_txW = txAntenna->GetBeamformingVector();
-					params->m_rxW = rxAntenna->GetBeamformingVector();
-					CalLongTerm(params);
-					Ptr<SpectrumValue> bfPsd = CalBeamformingGain(txPsd, params, Vector(0,0,0));
-
-					SpectrumValue bfGain = (*bfPsd)/(*txPsd);
-					uint8_t nbands = bfGain.GetSpectrumModel ()->GetNumBands ();
-					double power = Sum (bfGain)/nbands;
-
-					NS_LOG_LOGIC("gain " << power);
-					if (max < power)
-					{
-						max = power;
-						maxTx = tx;
-						maxRx = rx;
-						maxTxTheta = txTheta;
-						maxRxTheta = rxTheta;
-					}
+					clusterCorr[(size_t)c1*numCluster + c2] += std::conj (phase[c1])*phase[c2];
 				}
 			}
+			activeBands++;
+		}
+		for (uint8_t cIndex = 0; cIndex < numCluster; cIndex++)
+		{
+			phase[cIndex] *= params->m_delayPhaseStep[cIndex];
 		}
 	}
+	if (activeBands > 0)
+	{
+		for (uint32_t i = 0; i < clusterCorr.size (); i++)
+		{
+			clusterCorr[i] /= (double)activeBands;
+		}
+	}
+
+	const BeamCodebook3gpp &txCodebook = GetCodebook (txAntenna, txAntennaNum);
+	const BeamCodebook3gpp &rxCodebook = GetCodebook (rxAntenna, rxAntennaNum);
+	std::vector<uint16_t> txBeams, rxBeams;
+	uint16_t bestTx = 0, bestRx = 0;
+	if (m_hierarchicalBeamSearch)
+	{
+		CodebookGrid (txCodebook, 2, txBeams);
+		CodebookGrid (rxCodebook, 2, rxBeams);
+		SearchBeamPairs (params->m_channel, clusterCorr, txCodebook, txBeams, rxCodebook, rxBeams, max, bestTx, bestRx);
+		if (max > 0)
+		{
+			txBeams.clear ();
+			rxBeams.clear ();
+			CodebookNeighbors (txCodebook, bestTx, txBeams);
+			CodebookNeighbors (rxCodebook, bestRx, rxBeams);
+			SearchBeamPairs (params->m_channel, clusterCorr, txCodebook, txBeams, rxCodebook, rxBeams, max, bestTx, bestRx);
+		}
+	}
+	else
+	{
+		CodebookGrid (txCodebook, 1, txBeams);
+		CodebookGrid (rxCodebook, 1, rxBeams);
+		SearchBeamPairs (params->m_channel, clusterCorr, txCodebook, txBeams, rxCodebook, rxBeams, max, bestTx, bestRx);
+	}
+	if (max > 0)
+	{
+		maxTx = bestTx%txCodebook.m_numSectors;
+		maxRx = bestRx%rxCodebook.m_numSectors;
+		maxTxTheta = BEAM_SEARCH_MIN_ELEVATION + bestTx/txCodebook.m_numSectors*BEAM_SEARCH_ELEVATION_STEP;
+		maxRxTheta = BEAM_SEARCH_MIN_ELEVATION + bestRx/rxCodebook.m_numSectors*BEAM_SEARCH_ELEVATION_STEP;
+	}
+
 	NS_LOG_LOGIC("maxTx " << maxTx << " txAntennaNum[1] " << (uint16_t)txAntennaNum[1]);
 	NS_LOG_LOGIC("max gain " << max << " maxTx " << (M_PI*(double)maxTx/(double)txAntennaNum[1]-0.5*M_PI)/(M_PI)*180 << " maxRx " << (M_PI*(double)maxRx/(double)rxAntennaNum[1]-0.5*M_PI)/(M_PI)*180 << " maxTxTheta " << maxTxTheta << " maxRxTheta " << maxRxTheta);
 	txAntenna->SetSector(maxTx, txAntennaNum, maxTxTheta);
@@ -2533,6 +3454,10 @@ doubleVector_t
 MmWave3gppChannel::CalAttenuationOfBlockage (Ptr<Params3gpp> params,
 		doubleVector_t clusterAOA, doubleVector_t clusterZOA) const
 {
+	NormalRandomVariable *normalRvBlockage = params->m_normalRvBlockage != 0 ?
+			PeekPointer (params->m_normalRvBlockage) : PeekPointer (m_normalRvBlockage);
+	UniformRandomVariable *uniformRvBlockage = params->m_uniformRvBlockage != 0 ?
+			PeekPointer (params->m_uniformRvBlockage) : PeekPointer (m_uniformRvBlockage);
 	doubleVector_t powerAttenuation;
 	uint8_t clusterNum = clusterAOA.size ();
 	for(uint8_t cInd = 0; cInd < clusterNum; cInd++)
@@ -2567,17 +3492,17 @@ MmWave3gppChannel::CalAttenuationOfBlockage (Ptr<Params3gpp> params,
 		{
 			//draw value from table 7.6.4.1-2 Blocking region parameters
 			doubleVector_t table;
-			table.push_back (m_normalRvBlockage->GetValue()); //phi_k: store the normal RV that will be mapped to uniform (0,360) later.
+			table.push_back (normalRvBlockage->GetValue()); //phi_k: store the normal RV that will be mapped to uniform (0,360) later.
 			if(m_scenario == "InH-OfficeMixed" || m_scenario == "InH-OfficeOpen")
 			{
-				table.push_back (m_uniformRvBlockage->GetValue(15, 45)); //x_k
+				table.push_back (uniformRvBlockage->GetValue(15, 45)); //x_k
 				table.push_back (90); //Theta_k
-				table.push_back (m_uniformRvBlockage->GetValue(5, 15)); //y_k
+				table.push_back (uniformRvBlockage->GetValue(5, 15)); //y_k
 				table.push_back (2); //r
 			}
 			else
 			{
-				table.push_back (m_uniformRvBlockage->GetValue(5, 15)); //x_k
+				table.push_back (uniformRvBlockage->GetValue(5, 15)); //x_k
 				table.push_back (90); //Theta_k
 				table.push_back (5); //y_k
 				table.push_back (10); //r
@@ -2640,7 +3565,7 @@ MmWave3gppChannel::CalAttenuationOfBlockage (Ptr<Params3gpp> params,
 
 				//Generate a new correlated normal RV with the following formula
 				params->m_nonSelfBlocking.at(blockInd).at(PHI_INDEX) =
-						R*params->m_nonSelfBlocking.at(blockInd).at(PHI_INDEX) + sqrt(1-R*R)*m_normalRvBlockage->GetValue ();
+						R*params->m_nonSelfBlocking.at(blockInd).at(PHI_INDEX) + sqrt(1-R*R)*normalRvBlockage->GetValue ();
 			}
 		}
 
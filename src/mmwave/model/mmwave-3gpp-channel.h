@@ -33,7 +33,9 @@
 #include <ns3/mobility-model.h>
 #include <ns3/spectrum-propagation-loss-model.h>
 #include <ns3/net-device.h>
+#include <ns3/node.h>
 #include <map>
+#include <deque>
 #include <ns3/angles.h>
 #include <ns3/net-device-container.h>
 #include <ns3/random-variable-stream.h>
@@ -65,17 +67,101 @@ typedef std::vector<complex2DVector_t> complex3DVector_t;
 
 typedef std::pair<Ptr<NetDevice>, Ptr<NetDevice> > key_t;
 
+/**
+ * Channel coefficient tensor H[u][s][n], where u is the rx antenna element,
+ * s the tx antenna element and n the cluster index.
+ * The coefficients are kept in a single aligned buffer in which the clusters of an
+ * antenna pair (u,s) are contiguous, so that all the per-cluster inner loops
+ * run over unit-stride memory. The buffer is kept when the tensor is cleared,
+ * so that a consistent channel update does not reallocate it.
+ */
+class ChannelTensor3gpp
+{
+public:
+	ChannelTensor3gpp ();
+	ChannelTensor3gpp (const ChannelTensor3gpp &tensor);
+	ChannelTensor3gpp& operator= (const ChannelTensor3gpp &tensor);
+	~ChannelTensor3gpp ();
+
+	/**
+	 * Set the dimensions of the tensor and set all the coefficients to 0
+	 * @param the number of rx antenna elements
+	 * @param the number of tx antenna elements
+	 * @param the number of clusters (including the sub-clusters)
+	 */
+	void Resize (uint16_t rxSize, uint16_t txSize, uint8_t numCluster);
+
+	/**
+	 * Drop the coefficients, the allocated buffer is kept for reuse
+	 */
+	void Clear ();
+
+	bool IsEmpty () const
+	{
+		return m_rxSize == 0;
+	}
+	uint16_t GetRxSize () const
+	{
+		return m_rxSize;
+	}
+	uint16_t GetTxSize () const
+	{
+		return m_txSize;
+	}
+	uint8_t GetNumCluster () const
+	{
+		return m_numCluster;
+	}
+
+	/**
+	 * @returns a pointer to the GetNumCluster () contiguous coefficients of the pair (u,s)
+	 */
+	std::complex<double>* GetClusters (uint16_t u, uint16_t s)
+	{
+		return m_data + ((size_t)u*m_txSize + s)*m_numCluster;
+	}
+	const std::complex<double>* GetClusters (uint16_t u, uint16_t s) const
+	{
+		return m_data + ((size_t)u*m_txSize + s)*m_numCluster;
+	}
+
+	std::complex<double>& operator() (uint16_t u, uint16_t s, uint8_t n)
+	{
+		return GetClusters (u, s)[n];
+	}
+	const std::complex<double>& operator() (uint16_t u, uint16_t s, uint8_t n) const
+	{
+		return GetClusters (u, s)[n];
+	}
+
+private:
+	std::complex<double> *m_data;
+	size_t m_capacity; // number of coefficients that fit in m_data
+	uint16_t m_rxSize;
+	uint16_t m_txSize;
+	uint8_t m_numCluster;
+};
+
 /**
  * Data structure that stores a channel realization
  */
 struct Params3gpp : public SimpleRefCount<Params3gpp>
 {
+	Params3gpp ()
+		: m_longTermPending (false)
+	{
+	}
+
 	complexVector_t 		m_txW; // tx antenna weights.
 	complexVector_t 		m_rxW; // rx antenna weights.
-	complex3DVector_t  		m_channel; // channel matrix H[u][s][n].
+	ChannelTensor3gpp  		m_channel; // channel matrix H[u][s][n].
 	doubleVector_t  		m_delay; // cluster delay.
 	double2DVector_t		m_angle; //cluster angle angle[direction][n], where direction = 0(aoa), 1(zoa), 2(aod), 3(zod) in degree.
 	complexVector_t 		m_longTerm; // long term conponet.
+	bool					m_longTermPending; // m_longTerm is computed by a deferred job
+	complexVector_t 		m_delayPhase; // phase shift of each cluster delay at the first subband.
+	complexVector_t 		m_delayPhaseStep; // phase rotation of each cluster delay between adjacent subbands.
+	std::vector<Vector> 	m_arrivalDirection; // unit vector of the center arrival angle of each cluster, used for the doppler.
 
 	double2DVector_t		m_nonSelfBlocking; // store the blockages
 
@@ -94,6 +180,57 @@ struct Params3gpp : public SimpleRefCount<Params3gpp>
 	Vector m_speed;
 	double m_dis2D;
 	double m_dis3D;
+
+	/*Random streams of the link, set by the batch update only, so that the update of a link
+	 *does not depend on the order in which the links are processed. When they are not set
+	 *the streams of MmWave3gppChannel are used.*/
+	Ptr<NormalRandomVariable> m_normalRv;
+	Ptr<UniformRandomVariable> m_uniformRvBlockage;
+	Ptr<NormalRandomVariable> m_normalRvBlockage;
+};
+
+/**
+ * Data structure that stores the information of a device resolved the first time
+ * it is seen by the channel, i.e., its role, its antenna array and the antenna size
+ */
+struct DeviceInfo3gpp
+{
+	Ptr<NetDevice> m_device; // first NetDevice of the node
+	Ptr<AntennaArrayModel> m_antenna;
+	uint8_t m_antennaNum[2]; // number of vertical and horizontal antenna elements
+	bool m_isEnb;
+	bool m_isUe;
+	uint32_t m_index; // index among the eNBs or among the UEs, used to address the link table
+};
+
+/**
+ * Data structure that stores the state of the link between an eNB and a UE.
+ * Each array is indexed by the direction, 0 for eNB to UE and 1 for UE to eNB
+ */
+struct LinkState3gpp
+{
+	Ptr<Params3gpp> m_params[2]; // channel realization, 0 if not generated yet
+	bool m_connected[2];
+
+	LinkState3gpp ()
+	{
+		m_connected[0] = false;
+		m_connected[1] = false;
+	}
+};
+
+/**
+ * Data structure that stores the sector codebook of an antenna array geometry, i.e., the BF vectors
+ * set by AntennaArrayModel::SetSector for all the sectors and elevations scanned by the beam search.
+ * The beams are indexed by elevation first and then by sector
+ */
+struct BeamCodebook3gpp
+{
+	uint8_t m_antennaNum[2]; // number of vertical and horizontal antenna elements
+	double m_spacing[2]; // horizontal and vertical distance between the elements
+	uint16_t m_size; // number of antenna elements
+	uint16_t m_numSectors; // number of sectors for each elevation
+	std::vector< std::complex<double> > m_beams; // element e of beam b is m_beams[b*m_size + e]
 };
 
 /**
@@ -157,6 +294,41 @@ struct ParamsTable: public Object
 
 };
 
+/**
+ * Data structure that stores a link whose channel is due for a batch update
+ */
+struct BatchUpdate3gpp
+{
+	Ptr<const MobilityModel> m_txMobility;
+	Ptr<const MobilityModel> m_rxMobility;
+};
+
+/**
+ * Data structure that stores the inputs of the update of one channel in a batch update.
+ * The jobs are prepared and completed on the main thread, only UpdateChannel and the
+ * computation of the long term component run on the worker threads
+ */
+struct ChannelUpdateJob3gpp
+{
+	BatchUpdate3gpp m_link;
+	Ptr<Params3gpp> m_params;
+	Ptr<ParamsTable> m_table3gpp;
+	Ptr<NetDevice> m_txDevice;
+	Ptr<NetDevice> m_rxDevice;
+	Ptr<AntennaArrayModel> m_txAntenna;
+	Ptr<AntennaArrayModel> m_rxAntenna;
+	uint8_t m_txAntennaNum[2];
+	uint8_t m_rxAntennaNum[2];
+	Angles m_rxAngle;
+	Angles m_txAngle;
+	Vector m_locUT;
+	Vector m_speed;
+	double m_dis2D;
+	double m_dis3D;
+	bool m_connected;
+	bool m_longTerm; // the long term component can be computed on the worker thread
+};
+
 /**
  * \brief This class implements the fading computation of the 3GPP TR 38.900 channel model and performs the 
  * beamforming gain computation. It implements the SpectrumPropagationLossModel interface
@@ -218,6 +390,49 @@ public:
 	 */
 	void SetPathlossModel (Ptr<PropagationLossModel> pathloss);
 
+	/**
+	 * Per-subband beamforming gain kernel. The gain of subband k is
+	 * |sum_n clusterGain[n]*phase[n]*phaseStep[n]^k|^2, the phase of each cluster is
+	 * rotated incrementally from one subband to the next instead of evaluating exp().
+	 * Subbands with no power in txPsd are skipped, but their phase is still rotated.
+	 * Only the subbands in [firstBand, endBand) are visited, the others are set to 0 and
+	 * the phases are moved to firstBand in one rotation.
+	 * txPsd and rxPsd may point to the same buffer.
+	 * @params the complex gain of each cluster (long term component times doppler)
+	 * @params the delay phase of each cluster at the first subband
+	 * @params the delay phase rotation of each cluster between adjacent subbands
+	 * @params the number of clusters
+	 * @params the tx PSD values
+	 * @params the rx PSD values, written by the kernel
+	 * @params the number of subbands
+	 * @params the first subband carrying power
+	 * @params the subband after the last one carrying power
+	 * @returns the average gain over the subbands carrying power
+	 */
+	static double CalSubbandGain (const std::complex<double> *clusterGain, const std::complex<double> *phase,
+			const std::complex<double> *phaseStep, uint8_t numCluster,
+			const double *txPsd, double *rxPsd, uint32_t numBands, uint32_t firstBand, uint32_t endBand);
+
+	/**
+	 * Compute the dominant eigenvectors of the tx spatial correlation matrix txQ = sum_n H_n^H*H_n
+	 * and of the rx spatial correlation matrix rxQ = sum_n H_n*H_n^H, i.e., the dominant right and
+	 * left singular vectors of the channel. The correlation matrices are built directly from the
+	 * channel tensor and the eigenvectors are found with a Lanczos iteration.
+	 * @params the channel tensor
+	 * @params the tx antenna weights, resized and overwritten with a unit norm vector
+	 * @params the rx antenna weights, resized and overwritten with a unit norm vector
+	 */
+	static void CalDominantBeams (const ChannelTensor3gpp &channel, complexVector_t &txW, complexVector_t &rxW);
+
+	/**
+	 * Returns the sector codebook of the geometry of an antenna array, the codebook is
+	 * computed the first time the geometry is seen
+	 * @params the antenna array
+	 * @params the number of vertical and horizontal antenna elements
+	 * @returns a reference to the codebook, valid until the channel is disposed
+	 */
+	const BeamCodebook3gpp &GetCodebook (Ptr<AntennaArrayModel> antenna, uint8_t *antennaNum) const;
+
 private:
 
 	/**
@@ -225,12 +440,47 @@ private:
 	 * @params the transmitted PSD
 	 * @params the mobility model of the transmitter
 	 * @params the mobility model of the receiver
-	 * @returns the received PSD
+	 * @returns the received PSD, which is the transmitted PSD itself when no beamforming gain
+	 * is applied. The spectrum channels pass a PSD owned by the receiver, so it is not copied
 	 */
 	Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
 														Ptr<const MobilityModel> a,
 														Ptr<const MobilityModel> b) const;
 
+	/**
+	 * Inherited from SpectrumPropagationLossModel, the channel realization and the BF vectors
+	 * are computed as in DoCalcRxPowerSpectralDensity, while the long term component of a new
+	 * channel and the BF gain are left to a job
+	 * @params the transmitted PSD
+	 * @params the mobility model of the transmitter
+	 * @params the mobility model of the receiver
+	 * @params the jobs of the transmission
+	 * @returns the received PSD
+	 */
+	Ptr<SpectrumValue> DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+														Ptr<const MobilityModel> a,
+														Ptr<const MobilityModel> b,
+														SpectrumPropagationLossJobList &jobs) const;
+
+	/**
+	 * Compute the received PSD
+	 * @params the transmitted PSD
+	 * @params the mobility model of the transmitter
+	 * @params the mobility model of the receiver
+	 * @params the jobs of the transmission, 0 to compute the PSD immediately
+	 * @returns the received PSD
+	 */
+	Ptr<SpectrumValue> CalcRxPsd (Ptr<const SpectrumValue> txPsd, Ptr<const MobilityModel> a,
+			Ptr<const MobilityModel> b, SpectrumPropagationLossJobList *jobs) const;
+
+	/**
+	 * Returns the transmitted PSD as the received one, unmodified
+	 * @params the transmitted PSD
+	 */
+	static Ptr<SpectrumValue> ShareTxPsd (Ptr<const SpectrumValue> txPsd);
+
+	class BeamformingGainJob;
+
 	/**
 	 * Get a new realization of the channel
 	 * @params the ParamsTable for the specific scenario
@@ -265,13 +515,15 @@ private:
 	 * @params the rxAngle
 	 * @params the txAngle
 	 * @returns the channel realization in a Params3gpp object
+	 * The antennas are shared by several links and are passed by reference, since
+	 * the update can run on the worker threads of the batch update
 	 */
 	Ptr<Params3gpp> UpdateChannel(Ptr<Params3gpp> params3gpp, Ptr<ParamsTable> table3gpp,
-			Ptr<AntennaArrayModel> txAntenna, Ptr<AntennaArrayModel> rxAntenna,
+			const Ptr<AntennaArrayModel> &txAntenna, const Ptr<AntennaArrayModel> &rxAntenna,
 			uint8_t *txAntennaNum, uint8_t *rxAntennaNum, Angles &rxAngle, Angles &txAngle) const;
 
 	/**
-	 * Compute the optimal BF vector with the Power Method (Maximum Ratio Transmission method).
+	 * Compute the optimal BF vector (Maximum Ratio Transmission method) with CalDominantBeams.
 	 * The vector is stored in the Params3gpp object passed as parameter
 	 * @params the channel realizationin as a Params3gpp object
 	 */
@@ -279,7 +531,10 @@ private:
 	
 	/**
 	 * Scan all sectors with predefined code book and select the one returns maximum gain.
+	 * The gains of all the beam pairs are computed in one pass over the channel tensor with the
+	 * codebooks of the two arrays, optionally on a coarse grid refined around the best pair.
 	 * The BF vector is stored in the Params3gpp object passed as parameter
+	 * @params the tx PSD, the gain is averaged over the subbands carrying power
 	 * @params the channel realizationin as a Params3gpp object
 	 */
 	void BeamSearchBeamforming (Ptr<const SpectrumValue> txPsd, Ptr<Params3gpp> params, Ptr<AntennaArrayModel> txAntenna,
@@ -292,16 +547,25 @@ private:
 	 */
 	void CalLongTerm (Ptr<Params3gpp> params) const;
 
+	/**
+	 * Compute the per-subband phase ramps of the cluster delays and the cluster arrival
+	 * directions, which do not change until the next channel update
+	 * @params the channel realizationin as a Params3gpp object
+	 */
+	void CalDelayPhaseRamp (Ptr<Params3gpp> params) const;
+
 	/**
 	 * Compute the BF gain, apply frequency selectivity by phase-shifting with the cluster delays
 	 * and scale the txPsd to get the rxPsd
 	 * @params the tx PSD
 	 * @params the channel realizationin as a Params3gpp object
 	 * @params the relative speed between UE and eNB
-	 * @returns the rx PSD
+	 * @params the Doppler phase per m/s of speed along a cluster direction, at the time of the signal
+	 * @params the rx PSD, provided by the caller and overwritten (it can be the tx PSD itself)
+	 * @returns the average BF gain over the subbands carrying power
 	 */
-	Ptr<SpectrumValue> CalBeamformingGain (Ptr<const SpectrumValue> txPsd,
-												Ptr<Params3gpp> params, Vector speed) const;
+	double CalBeamformingGain (const SpectrumValue &txPsd, Ptr<Params3gpp> params,
+			Vector speed, double dopplerFactor, SpectrumValue &rxPsd) const;
 	
 	/**
 	 * Returns the bandwidth used in a scenario
@@ -339,8 +603,61 @@ private:
 	doubleVector_t CalAttenuationOfBlockage(Ptr<Params3gpp> params,
 			doubleVector_t clusterAOA, doubleVector_t clusterZOA) const;
 
-	mutable std::map< key_t, int > m_connectedPair;
-	mutable std::map< key_t, Ptr<Params3gpp> > m_channelMap;
+	/**
+	 * Returns the compact ID of the first device of a node, the device is registered
+	 * and its DeviceInfo3gpp resolved the first time it is seen
+	 * @params the node
+	 * @returns the index of the device in m_devices
+	 */
+	uint32_t GetDeviceId (Ptr<Node> node) const;
+
+	/**
+	 * Returns the state of the link between two devices, the link table is grown if needed
+	 * @params the info of the eNB device
+	 * @params the info of the UE device
+	 * @returns a reference to the link state, valid until the next registration of a device
+	 */
+	LinkState3gpp &GetLinkState (const DeviceInfo3gpp &enbInfo, const DeviceInfo3gpp &ueInfo) const;
+
+	/**
+	 * Get the channel condition of the pair (a,b) given by the 3GPP pathloss model
+	 * @params the mobility model of the transmitter
+	 * @params the mobility model of the receiver
+	 * @params set to true for the los condition
+	 * @params set to true for the outdoor to indoor condition
+	 */
+	void GetChannelCondition (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b,
+			bool &los, bool &o2i) const;
+
+	/**
+	 * Add the pair (a,b) to the batch update performed m_updatePeriod from now
+	 * @params the mobility model of the transmitter
+	 * @params the mobility model of the receiver
+	 */
+	void ScheduleBatchUpdate (Ptr<const MobilityModel> a, Ptr<const MobilityModel> b) const;
+
+	/**
+	 * Update all the channels due at the current time. The inputs are gathered on the main
+	 * thread, the channels are updated by up to m_updateThreads threads and the BF vectors
+	 * are then applied to the antennas on the main thread
+	 */
+	void BatchUpdate () const;
+
+	/**
+	 * Run the jobs first, first + stride, first + 2*stride, ... of m_updateJobs
+	 * @params the index of the first job
+	 * @params the distance between two jobs of this worker
+	 */
+	void RunUpdateJobs (uint32_t first, uint32_t stride) const;
+
+	mutable std::vector<int32_t> m_nodeToDevice; // node ID -> device ID, -1 if not registered
+	mutable std::vector<DeviceInfo3gpp> m_devices; // indexed by device ID
+	mutable uint32_t m_numEnb;
+	mutable uint32_t m_numUe;
+	mutable std::vector< std::vector<LinkState3gpp> > m_linkTable; // m_linkTable[enbIndex][ueIndex]
+	mutable std::map< Time, std::vector<BatchUpdate3gpp> > m_batchUpdates; // links due for update, by time
+	mutable std::vector<ChannelUpdateJob3gpp> m_updateJobs; // jobs of the batch update in progress
+	mutable std::deque<BeamCodebook3gpp> m_codebooks; // one for each antenna array geometry, a deque so that adding a geometry does not move the others
 
 	Ptr<UniformRandomVariable> m_uniformRv;
 	Ptr<UniformRandomVariable> m_uniformRvBlockage;
@@ -352,14 +669,21 @@ private:
 	Ptr<ExponentialRandomVariable> m_expRv;
 	Ptr<MmWavePhyMacCommon> m_phyMacConfig;
 	Ptr<PropagationLossModel> m_3gppPathloss;
+	// m_3gppPathloss resolved to its type once, only one of them is set
+	Ptr<MmWave3gppPropagationLossModel> m_3gppPropagationLoss;
+	Ptr<MmWave3gppBuildingsPropagationLossModel> m_3gppBuildingsLoss;
 	Ptr<ParamsTable> m_table3gpp;
 	Time m_updatePeriod;
+	bool m_batchUpdate;
+	uint32_t m_updateThreads;
 	bool m_cellScan;
+	bool m_hierarchicalBeamSearch;
 	bool m_blockage;
 	uint16_t m_numNonSelfBloking; //number of non-self-blocking regions.
 	bool m_portraitMode; //true (portrait mode); false (landscape mode).
 	std::string m_scenario;
 	double m_blockerSpeed;
+	double m_relevanceThreshold; // dB over the thermal noise, see the RelevanceThreshold attribute
 };
 
 
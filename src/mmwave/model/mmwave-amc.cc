@@ -33,6 +33,7 @@
 #include <ns3/math.h>
 #include "ns3/enum.h"
 #include "mmwave-mi-error-model.h"
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("MmWaveAmc");
 
@@ -103,6 +104,7 @@ static const int ModulationSchemeForMcs[32] = {
 };
 
 MmWaveAmc::MmWaveAmc ()
+: m_tbSizeTableLen (0)
 {
 	NS_LOG_ERROR ("This construcor should not be invoked");
 }
@@ -111,6 +113,16 @@ MmWaveAmc::MmWaveAmc (Ptr<MmWavePhyMacCommon> ConfigParams)
 : m_phyMacConfig (ConfigParams)
 {
 	NS_LOG_INFO ("Initialze AMC module");
+	// the schedulers look up the TB sizes many times per subframe, they depend on the numerology only
+	m_tbSizeTableLen = m_phyMacConfig->GetSymbolsPerSubframe () + 1;
+	m_tbSizeTable.resize (29 * m_tbSizeTableLen);
+	for (unsigned mcs = 0; mcs < 29; mcs++)
+	{
+		for (unsigned nsym = 0; nsym < m_tbSizeTableLen; nsym++)
+		{
+			m_tbSizeTable[mcs * m_tbSizeTableLen + nsym] = CalcTbSizeFromMcsSymbols (mcs, nsym);
+		}
+	}
 }
 
 MmWaveAmc::~MmWaveAmc ()
@@ -135,6 +147,11 @@ MmWaveAmc::GetTypeId (void)
 				 MakeEnumAccessor (&MmWaveAmc::m_amcModel),
 				 MakeEnumChecker (MmWaveAmc::MiErrorModel, "Vienna",
 								  MmWaveAmc::PiroEW2010, "PiroEW2010"))
+	.AddAttribute ("TargetBler",
+				 "The BLER of the first transmission that the MCS of a CQI can guarantee, with the MI error model",
+				 DoubleValue (0.1),
+				 MakeDoubleAccessor (&MmWaveAmc::m_targetBler),
+				 MakeDoubleChecker<double> (0.0, 1.0))
 	;
 	return tid;
 }
@@ -180,6 +197,16 @@ MmWaveAmc::GetTbSizeFromMcsSymbols (unsigned mcs, unsigned nsymb)
 {
 	NS_LOG_FUNCTION (mcs);
 	NS_ASSERT_MSG (mcs < 29, "MCS=" << mcs);
+	if (nsymb < m_tbSizeTableLen)
+	{
+		return m_tbSizeTable[mcs * m_tbSizeTableLen + nsymb];
+	}
+	return CalcTbSizeFromMcsSymbols (mcs, nsymb);
+}
+
+int
+MmWaveAmc::CalcTbSizeFromMcsSymbols (unsigned mcs, unsigned nsymb) const
+{
 	//unsigned itb = McsToItbs[mcs];
 	int rscElement = (m_phyMacConfig->GetNumSCperChunk ()*m_phyMacConfig->GetTotalNumChunk()
 			- m_phyMacConfig->GetNumRefScPerSym ())*nsymb;
@@ -217,6 +244,37 @@ MmWaveAmc::GetNumSymbolsFromTbsMcs (unsigned tbSize, unsigned mcs)
 	return ceil((double)reqRscElement / (double)rscElementPerSym);
 }
 
+void
+MmWaveAmc::GetMibPerModulation (const SpectrumValue& sinr, const std::vector<int>& map, double mib[3])
+{
+	// the MI depends on the modulation order only, MCSs 0, 10 and 17 are the first of each order
+	mib[0] = MmWaveMiErrorModel::Mib (sinr, map, 0);
+	mib[1] = MmWaveMiErrorModel::Mib (sinr, map, 10);
+	mib[2] = MmWaveMiErrorModel::Mib (sinr, map, 17);
+}
+
+uint8_t
+MmWaveAmc::GetFirstMcsAboveTargetBler (const double mib[3], const uint32_t tbSize[29]) const
+{
+	// the BLER grows with the MCS: MCSs up to low meet the target, MCSs from high exceed it
+	int low = -1;
+	int high = 29;
+	while (high - low > 1)
+	{
+		int mcs = (low + high) / 2;
+		double bler = MmWaveMiErrorModel::GetTbBler (mib[ModulationSchemeForMcs[mcs]/2 - 1], tbSize[mcs], mcs);
+		if (bler > m_targetBler)
+		{
+			high = mcs;
+		}
+		else
+		{
+			low = mcs;
+		}
+	}
+	return high;
+}
+
 std::vector<int>
 MmWaveAmc::CreateCqiFeedbacks (const SpectrumValue& sinr, uint8_t rbgSize)
 {
@@ -267,26 +325,19 @@ MmWaveAmc::CreateCqiFeedbacks (const SpectrumValue& sinr, uint8_t rbgSize)
 			rbgMap.push_back (rbId++);
 			if ((rbId % rbgSize == 0)||((it+1)==sinr.ConstValuesEnd ()))
 			{
-				uint8_t mcs = 0;
-				TbStats_t tbStats;
-				while (mcs <= 28)
-				{
-					MmWaveHarqProcessInfoList_t harqInfoList;
-					tbStats = MmWaveMiErrorModel::GetTbDecodificationStats (sinr, rbgMap, GetTbSizeFromMcs (mcs, rbgSize/18) / 8, mcs, harqInfoList);
-					if (tbStats.tbler > 0.1)
-					{
-						break;
-					}
-					mcs++;
-
-				}
-				if (mcs > 0)
+				double mib[3];
+				GetMibPerModulation (sinr, rbgMap, mib);
+				uint32_t tbSize[29];
+				for (uint8_t m = 0; m <= 28; m++)
 				{
-					mcs--;
+					tbSize[m] = GetTbSizeFromMcs (m, rbgSize/18) / 8;
 				}
-				NS_LOG_DEBUG (this << "\t RBG " << rbId << " MCS " << (uint16_t)mcs << " TBLER " << tbStats.tbler);
+				uint8_t firstMcsAbove = GetFirstMcsAboveTargetBler (mib, tbSize);
+				uint8_t mcs = firstMcsAbove > 0 ? firstMcsAbove - 1 : 0;
+				bool aboveTarget = firstMcsAbove <= 28;
+				NS_LOG_DEBUG (this << "\t RBG " << rbId << " MCS " << (uint16_t)mcs << " first MCS above the target BLER " << (uint16_t)firstMcsAbove);
 				int rbgCqi = 0;
-				if ((tbStats.tbler > 0.1)&&(mcs==0))
+				if (aboveTarget&&(mcs==0))
 				{
 					rbgCqi = 0;
 				}
@@ -360,31 +411,25 @@ MmWaveAmc::CreateCqiFeedbacksTdma (const SpectrumValue& sinr, uint8_t numSym)
 	}
 	else if (m_amcModel == MiErrorModel)
 	{
+		// the TB sizes are the same for all the chunks
+		uint32_t tbSize[29];
+		for (uint8_t m = 0; m <= 28; m++)
+		{
+			tbSize[m] = GetTbSizeFromMcsSymbols (m, numSym) / 8;
+		}
 		int chunkId = 0;
 		for (it = sinr.ConstValuesBegin (); it != sinr.ConstValuesEnd (); it++)
 		{
-			uint8_t mcs = 0;
-			TbStats_t tbStats;
 			std::vector <int> chunkMap;
 			chunkMap.push_back (chunkId++);
-			while (mcs <= 28)
-			{
-				MmWaveHarqProcessInfoList_t harqInfoList;
-				tbStats = MmWaveMiErrorModel::GetTbDecodificationStats (sinr, chunkMap, GetTbSizeFromMcsSymbols (mcs, numSym) / 8, mcs, harqInfoList);
-				if (tbStats.tbler > 0.1)
-				{
-					break;
-				}
-				mcs++;
-
-			}
-			if (mcs > 0)
-			{
-				mcs--;
-			}
-			NS_LOG_DEBUG (this << "\t MCS " << (uint16_t)mcs << " TBLER " << tbStats.tbler);
+			double mib[3];
+			GetMibPerModulation (sinr, chunkMap, mib);
+			uint8_t firstMcsAbove = GetFirstMcsAboveTargetBler (mib, tbSize);
+			uint8_t mcs = firstMcsAbove > 0 ? firstMcsAbove - 1 : 0;
+			bool aboveTarget = firstMcsAbove <= 28;
+			NS_LOG_DEBUG (this << "\t MCS " << (uint16_t)mcs << " first MCS above the target BLER " << (uint16_t)firstMcsAbove);
 			int chunkCqi = 0;
-			if ((tbStats.tbler > 0.1)&&(mcs==0))
+			if (aboveTarget&&(mcs==0))
 			{
 				chunkCqi = 0;
 			}
@@ -424,6 +469,9 @@ MmWaveAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t numSym, u
 	Values::const_iterator it;
 	if (m_amcModel == PiroEW2010)
 	{
+		// the number of bands is not taken from the SpectrumModel, whose reference count
+		// is shared by the schedulers of all the cells (see MmWaveEnbMac SchedulingThreads)
+		unsigned numBands = sinr.ConstValuesEnd () - sinr.ConstValuesBegin ();
 		//use PiroEW2010 model
 		for (it = sinr.ConstValuesBegin (); it != sinr.ConstValuesEnd (); it++)
 		{
@@ -449,7 +497,7 @@ MmWaveAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t numSym, u
 				mcsAvg += GetMcsFromSpectralEfficiency (s);
 				cqiAvg += cqi_;
 
-				NS_LOG_LOGIC (" PRB =" << sinr.GetSpectrumModel()->GetNumBands ()
+				NS_LOG_LOGIC (" PRB =" << numBands
 				              << ", sinr = " << sinr_
 				              << " (=" << 10 * std::log10 (sinr_) << " dB)"
 				              << ", spectral efficiency =" << s
@@ -457,9 +505,9 @@ MmWaveAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t numSym, u
 				//cqi.push_back (cqi_);
 			}
 		}
-		seAvg /= sinr.GetSpectrumModel()->GetNumBands ();
-		mcsAvg /= sinr.GetSpectrumModel()->GetNumBands ();
-		cqiAvg /= sinr.GetSpectrumModel()->GetNumBands ();
+		seAvg /= numBands;
+		mcsAvg /= numBands;
+		cqiAvg /= numBands;
 		cqi = ceil(cqiAvg); //GetCqiFromSpectralEfficiency (seAvg);
 		mcs = GetMcsFromSpectralEfficiency (seAvg); //ceil(mcsAvg);
 	}
@@ -475,28 +523,19 @@ MmWaveAmc::CreateCqiFeedbackWbTdma (const SpectrumValue& sinr, uint8_t numSym, u
 		}
 		sinrAvg /= chunkId;
 
-		mcs = 0;
-		TbStats_t tbStats;
-		while (mcs <= 28)
-		{
-			MmWaveHarqProcessInfoList_t harqInfoList;
-			tbStats = MmWaveMiErrorModel::GetTbDecodificationStats (sinr, chunkMap, tbSize, mcs, harqInfoList);
-			if (tbStats.tbler > 0.1)
-			{
-				break;
-			}
-			mcs++;
-		}
-		if (mcs > 0)
-		{
-			mcs--;
-		}
+		double mib[3];
+		GetMibPerModulation (sinr, chunkMap, mib);
+		uint32_t tbSizes[29];
+		std::fill (tbSizes, tbSizes + 29, tbSize);
+		uint8_t firstMcsAbove = GetFirstMcsAboveTargetBler (mib, tbSizes);
+		mcs = firstMcsAbove > 0 ? firstMcsAbove - 1 : 0;
+		bool aboveTarget = firstMcsAbove <= 28;
 //		MmWaveHarqProcessInfoList_t harqInfoList;
 //		TbStats_t tbStatsFinal = MmWaveMiErrorModel::GetTbDecodificationStats (sinr, chunkMap, tbSize, mcs, harqInfoList);
 //		NS_LOG_UNCOND ("TBLER " << tbStatsFinal.tbler << " for chunks " << chunkMap.size () << " numSym "
 //		               << (unsigned)numSym << " tbSize " << tbSize << " mcs " << (unsigned)mcs << " sinr " << sinrAvg);
 //		NS_LOG_UNCOND (sinr);
-		if ((tbStats.tbler > 0.1)&&(mcs==0))
+		if (aboveTarget&&(mcs==0))
 		{
 			cqi = 0;
 		}
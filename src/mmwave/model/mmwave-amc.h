@@ -50,6 +50,10 @@ public:
 
 	int GetMcsFromCqi (int cqi);
 	int GetTbSizeFromMcs (unsigned mcs, unsigned nprb);
+	/**
+	 * TB size in bits of a number of TDMA symbols, read from a table built at construction
+	 * for up to one subframe of symbols
+	 */
 	int GetTbSizeFromMcsSymbols (unsigned mcs, unsigned nsym);  // for TDMA
 	int GetNumSymbolsFromTbsMcs (unsigned tbSize, unsigned mcs);
 	std::vector<int> CreateCqiFeedbacks (const SpectrumValue& sinr, uint8_t rbgSize);
@@ -60,12 +64,39 @@ public:
 
 	static const unsigned int m_crcLen=24;
 
+	/**
+	 * Compute the mmib of the chunks once for each modulation order
+	 * @params the SINR
+	 * @params the chunks
+	 * @params the mmib for QPSK, 16QAM and 64QAM
+	 */
+	static void GetMibPerModulation (const SpectrumValue& sinr, const std::vector<int>& map, double mib[3]);
+
+	/**
+	 * Find the lowest MCS whose first transmission exceeds the target BLER, with a binary search
+	 * @params the mmib for QPSK, 16QAM and 64QAM
+	 * @params the TB size in bytes of each MCS
+	 * @returns 29 if all the MCSs meet the target
+	 */
+	uint8_t GetFirstMcsAboveTargetBler (const double mib[3], const uint32_t tbSize[29]) const;
+
+	/**
+	 * Compute the TB size in bits of a number of TDMA symbols, without the table
+	 * @params the MCS
+	 * @params the number of symbols
+	 */
+	int CalcTbSizeFromMcsSymbols (unsigned mcs, unsigned nsym) const;
+
 private:
 	  double m_ber;
+	  double m_targetBler;
 	  AmcModel m_amcModel;
 
 	  Ptr<MmWavePhyMacCommon> m_phyMacConfig;
 		Ptr<SpectrumModel> m_lteRbModel;
+
+	  std::vector<int> m_tbSizeTable; // TB size of each MCS and number of symbols, from 0 to one subframe
+	  unsigned m_tbSizeTableLen; // number of symbols of each MCS in m_tbSizeTable
 };
 
 } // end namespace ns3
@@ -36,6 +36,8 @@
 #include <ns3/mmwave-ue-phy.h>
 #include <ns3/mmwave-enb-phy.h>
 #include <ns3/double.h>
+#include <ns3/string.h>
+#include <ns3/uinteger.h>
 #include <algorithm>
 #include <fstream>
 
@@ -47,22 +49,10 @@ NS_LOG_COMPONENT_DEFINE ("MmWaveChannelRaytracing");
 NS_OBJECT_ENSURE_REGISTERED (MmWaveChannelRaytracing);
 
 
-doubleVector_t g_path; //number of multipath
-double2DVector_t g_delay; //delay spread in ns
-double2DVector_t g_pathloss;	//pathloss in DB
-double2DVector_t g_phase;	//???what is this
-double2DVector_t g_aodElevation;	//degree
-double2DVector_t g_aodAzimuth;	//degree
-double2DVector_t g_aoaElevation;	//degree
-double2DVector_t g_aoaAzimuth;	//degree
-
-
 MmWaveChannelRaytracing::MmWaveChannelRaytracing ()
 	:m_antennaSeparation(0.5)
 {
 	m_uniformRv = CreateObject<UniformRandomVariable> ();
-	LoadTraces();
-
 }
 
 TypeId
@@ -80,6 +70,20 @@ MmWaveChannelRaytracing::GetTypeId (void)
 			   DoubleValue (1.0),
 			   MakeDoubleAccessor (&MmWaveChannelRaytracing::m_speed),
 			   MakeDoubleChecker<double> ())
+	.AddAttribute ("TraceFile",
+			   "The raytracing trace, in the text format or in the binary format written by "
+			   "MmWaveRaytracingTrace::ConvertTextToBinary (see the mmwave-raytracing-trace-converter example). "
+			   "A binary file is mapped in memory and shared by concurrent simulations",
+			   StringValue ("src/mmwave/model/Raytracing/Quadriga.txt"),
+			   MakeStringAccessor (&MmWaveChannelRaytracing::m_traceFile),
+			   MakeStringChecker ())
+	.AddAttribute ("WindowSize",
+			   "Number of snapshots of the trace kept in memory when the trace is streamed, "
+			   "the next window is read in background while the current one is used. "
+			   "0 to load the whole trace",
+			   UintegerValue (0),
+			   MakeUintegerAccessor (&MmWaveChannelRaytracing::m_windowSize),
+			   MakeUintegerChecker<uint32_t> ())
 	;
 	return tid;
 }
@@ -93,6 +97,7 @@ void
 MmWaveChannelRaytracing::DoDispose ()
 {
 	NS_LOG_FUNCTION (this);
+	m_traces = 0;
 }
 
 void
@@ -110,76 +115,9 @@ MmWaveChannelRaytracing::GetConfigurationParameters (void) const
 void
 MmWaveChannelRaytracing::LoadTraces()
 {
-	std::string filename = "src/mmwave/model/Raytracing/Quadriga.txt";
-	NS_LOG_FUNCTION (this << "Loading Raytracing file " << filename);
-	std::ifstream singlefile;
-	singlefile.open (filename.c_str (), std::ifstream::in);
-
-	NS_LOG_INFO (this << " File: " << filename);
-	NS_ASSERT_MSG(singlefile.good (), " Raytracing file not found");
-    std::string line;
-    std::string token;
-    uint16_t counter = 0;
-    while( std::getline(singlefile, line) ) //Parse each line of the file
-    {
-    	if(counter == 8)
-    	{
-    		counter = 0;
-    	}
-    	doubleVector_t path;
-        std::istringstream stream(line);
-        while( getline(stream,token,',') ) //Parse each comma separated string in a line
-        {
-            double sigma = 0.00;
-            std::stringstream stream( token );
-            stream>>sigma;
-        	path.push_back(sigma);
-		}
-
-		switch (counter)
-		{
-		case 0:
-			g_path.push_back (path.at (0));
-			break;
-		case 1:
-			g_delay.push_back (path);
-			break;
-		case 2:
-			g_pathloss.push_back (path);
-			break;
-		case 3:
-			g_phase.push_back (path);
-			break;
-		case 4:
-			g_aodElevation.push_back (path);
-			break;
-		case 5:
-			g_aodAzimuth.push_back (path);
-			break;
-		case 6:
-			g_aoaElevation.push_back (path);
-			break;
-		case 7:
-			g_aoaAzimuth.push_back (path);
-			break;
-		default:
-			NS_FATAL_ERROR("Never call this");
-			break;
-		}
-		counter++;
-	}
-
-	/*NS_LOG_UNCOND(g_path.size());
-	NS_LOG_UNCOND(g_delay.size());
-	NS_LOG_UNCOND(g_pathloss.size());
-	NS_LOG_UNCOND(g_phase.size());
-	NS_LOG_UNCOND(g_aodElevation.size());
-	NS_LOG_UNCOND(g_aodAzimuth.size());
-	NS_LOG_UNCOND(g_aoaElevation.size());
-	NS_LOG_UNCOND(g_aoaAzimuth.size());*/
-
-
-
+	NS_LOG_FUNCTION (this << "Loading Raytracing file " << m_traceFile);
+	m_traces = Create<MmWaveRaytracingTrace> ();
+	m_traces->Open (m_traceFile, m_windowSize);
 }
 
 
@@ -289,9 +227,13 @@ MmWaveChannelRaytracing::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue>
 	{
 		NS_FATAL_ERROR ("The maximum trace index is 26050");
 	}*/
-	uint16_t traceIndex = (m_startDistance+time*m_speed)*6;
-	static uint16_t currentIndex = m_startDistance;
-	if(traceIndex > g_path.size())
+	uint32_t traceIndex = (m_startDistance+time*m_speed)*6;
+	static uint32_t currentIndex = m_startDistance;
+	if (m_traces == 0)
+	{
+		const_cast<MmWaveChannelRaytracing *> (this)->LoadTraces ();
+	}
+	if(traceIndex >= m_traces->GetNumSnapshots ())
 	{
 		NS_FATAL_ERROR ("The maximum trace index is reached");
 	}
@@ -306,20 +248,21 @@ MmWaveChannelRaytracing::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue>
 	if (it == m_channelMatrixMap.end ())
 	{
 
+		RaytracingSnapshot snapshot = m_traces->GetSnapshot (traceIndex);
 		complex2DVector_t txSpatialMatrix;
 		complex2DVector_t rxSpatialMatrix;
 		if(dl)
 		{
-			txSpatialMatrix = GenSpatialMatrix (traceIndex,txAntennaNum, true);
-			rxSpatialMatrix = GenSpatialMatrix (traceIndex,rxAntennaNum, false);
+			txSpatialMatrix = GenSpatialMatrix (snapshot,txAntennaNum, true);
+			rxSpatialMatrix = GenSpatialMatrix (snapshot,rxAntennaNum, false);
 		}
 		else
 		{
-			txSpatialMatrix = GenSpatialMatrix (traceIndex,txAntennaNum, false);
-			rxSpatialMatrix = GenSpatialMatrix (traceIndex,rxAntennaNum, true);
+			txSpatialMatrix = GenSpatialMatrix (snapshot,txAntennaNum, false);
+			rxSpatialMatrix = GenSpatialMatrix (snapshot,rxAntennaNum, true);
 		}
 		doubleVector_t dopplerShift;
-		for (unsigned int i = 0; i < g_path.at(traceIndex); i++)
+		for (unsigned int i = 0; i < snapshot.m_numPath; i++)
 		{
 			dopplerShift.push_back(m_uniformRv->GetValue (0,1));
 		}
@@ -328,8 +271,8 @@ MmWaveChannelRaytracing::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue>
 
 		channel->m_txSpatialMatrix = txSpatialMatrix;
 		channel->m_rxSpatialMatrix = rxSpatialMatrix;
-		channel->m_powerFraction = g_pathloss.at (traceIndex);
-		channel->m_delaySpread = g_delay.at (traceIndex);
+		channel->m_powerFraction = snapshot.GetField (RAYTRACING_PATHLOSS);
+		channel->m_delaySpread = snapshot.GetField (RAYTRACING_DELAY);
 		channel->m_doppler = dopplerShift;
 
 
@@ -339,8 +282,8 @@ MmWaveChannelRaytracing::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue>
 		Ptr<TraceParams> reverseChannel = Create<TraceParams> ();
 		reverseChannel->m_txSpatialMatrix = rxSpatialMatrix;
 		reverseChannel->m_rxSpatialMatrix = txSpatialMatrix;
-		reverseChannel->m_powerFraction = g_pathloss.at (traceIndex);;
-		reverseChannel->m_delaySpread = g_delay.at (traceIndex);
+		reverseChannel->m_powerFraction = channel->m_powerFraction;
+		reverseChannel->m_delaySpread = channel->m_delaySpread;
 		reverseChannel->m_doppler = dopplerShift;
 
 		m_channelMatrixMap.insert(std::make_pair(reverseKey,reverseChannel));
@@ -453,23 +396,25 @@ MmWaveChannelRaytracing::CalcBeamformingVector(complex2DVector_t spatialMatrix,
 
 
 complex2DVector_t
-MmWaveChannelRaytracing::GenSpatialMatrix (uint64_t traceIndex, uint8_t* antennaNum, bool bs) const
+MmWaveChannelRaytracing::GenSpatialMatrix (const RaytracingSnapshot &snapshot, uint8_t* antennaNum, bool bs) const
 {
 	complex2DVector_t spatialMatrix;
-	uint16_t pathNum = g_path.at (traceIndex);
+	uint16_t pathNum = snapshot.m_numPath;
 	for(unsigned int pathIndex = 0; pathIndex < pathNum; pathIndex++)
 	{
 		double azimuthAngle;
 		double verticalAngle;
 		if(bs)
 		{
-			azimuthAngle = g_aodAzimuth.at (traceIndex).at (pathIndex);
-			verticalAngle = g_aodElevation.at (traceIndex).at (pathIndex);
+			NS_ASSERT (pathIndex < snapshot.m_fieldLength[RAYTRACING_AOD_AZIMUTH] && pathIndex < snapshot.m_fieldLength[RAYTRACING_AOD_ELEVATION]);
+			azimuthAngle = snapshot.m_field[RAYTRACING_AOD_AZIMUTH][pathIndex];
+			verticalAngle = snapshot.m_field[RAYTRACING_AOD_ELEVATION][pathIndex];
 		}
 		else
 		{
-			azimuthAngle = g_aoaAzimuth.at (traceIndex).at (pathIndex);
-			verticalAngle = g_aoaElevation.at (traceIndex).at (pathIndex);
+			NS_ASSERT (pathIndex < snapshot.m_fieldLength[RAYTRACING_AOA_AZIMUTH] && pathIndex < snapshot.m_fieldLength[RAYTRACING_AOA_ELEVATION]);
+			azimuthAngle = snapshot.m_field[RAYTRACING_AOA_AZIMUTH][pathIndex];
+			verticalAngle = snapshot.m_field[RAYTRACING_AOA_ELEVATION][pathIndex];
 		}
 		complexVector_t singlePath;
 		singlePath = GenSinglePath (azimuthAngle*M_PI/180, verticalAngle*M_PI/180, antennaNum);
@@ -38,6 +38,7 @@
 #include <ns3/net-device-container.h>
 #include <ns3/random-variable-stream.h>
 #include "mmwave-phy-mac-common.h"
+#include "mmwave-raytracing-trace.h"
 
 
 
@@ -80,6 +81,10 @@ public:
 
 	static TypeId GetTypeId (void);
 	void DoDispose ();
+	/**
+	 * Open the trace file given by the TraceFile attribute, this is done at the first
+	 * computation of a channel if not called before
+	 */
 	void LoadTraces();
 	void ConnectDevices (Ptr<NetDevice> dev1, Ptr<NetDevice> dev2);
 	void Initial(NetDeviceContainer ueDevices, NetDeviceContainer enbDevices);
@@ -94,7 +99,7 @@ private:
 														Ptr<const MobilityModel> a,
 														Ptr<const MobilityModel> b) const;
 
-	complex2DVector_t GenSpatialMatrix (uint64_t traceIndex, uint8_t* antennaNum, bool bs) const;
+	complex2DVector_t GenSpatialMatrix (const RaytracingSnapshot &snapshot, uint8_t* antennaNum, bool bs) const;
 	complexVector_t GenSinglePath (double hAngle, double vAngle, uint8_t* antennaNum) const;
 	complexVector_t CalcBeamformingVector (complex2DVector_t SpatialMatrix, doubleVector_t powerFraction) const;
 	Ptr<SpectrumValue> GetChannelGain (Ptr<const SpectrumValue> txPsd, Ptr<mmWaveBeamFormingTraces> bfParams, double speed) const;
@@ -107,6 +112,9 @@ private:
 	Ptr<MmWavePhyMacCommon> m_phyMacConfig;
 	uint16_t m_startDistance;
 	double m_speed;
+	std::string m_traceFile;
+	uint32_t m_windowSize;
+	Ptr<MmWaveRaytracingTrace> m_traces;
 };
 
 
@@ -37,6 +37,7 @@ NS_LOG_COMPONENT_DEFINE ("mmWaveChunkProcessor");
 namespace ns3 {
 
 mmWaveChunkProcessor::mmWaveChunkProcessor ()
+  : m_empty (true)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -57,7 +58,8 @@ void
 mmWaveChunkProcessor::Start ()
 {
   NS_LOG_FUNCTION (this);
-  m_sumValues = 0;
+  // the buffers are kept, they are overwritten by the first chunk
+  m_empty = true;
   m_totDuration = MicroSeconds (0);
 }
 
@@ -66,11 +68,31 @@ void
 mmWaveChunkProcessor::EvaluateChunk (const SpectrumValue& sinr, Time duration)
 {
   NS_LOG_FUNCTION (this << sinr << duration);
-  if (m_sumValues == 0)
+  if (m_sumValues == 0 || m_sumValues->GetSpectrumModel () != sinr.GetSpectrumModel ())
     {
       m_sumValues = Create<SpectrumValue> (sinr.GetSpectrumModel ());
+      m_average = Create<SpectrumValue> (sinr.GetSpectrumModel ());
+      m_empty = true;
+    }
+  double seconds = duration.GetSeconds ();
+  Values::const_iterator value = sinr.ConstValuesBegin ();
+  Values::iterator sum = m_sumValues->ValuesBegin ();
+  if (m_empty)
+    {
+      // 0 + x*t, as in a sum starting from 0
+      for (; sum != m_sumValues->ValuesEnd (); ++sum, ++value)
+        {
+          *sum = 0.0 + *value * seconds;
+        }
+      m_empty = false;
+    }
+  else
+    {
+      for (; sum != m_sumValues->ValuesEnd (); ++sum, ++value)
+        {
+          *sum += *value * seconds;
+        }
     }
-  (*m_sumValues) += sinr * duration.GetSeconds ();
   m_totDuration += duration;
 }
 
@@ -80,10 +102,17 @@ mmWaveChunkProcessor::End ()
   NS_LOG_FUNCTION (this);
   if (m_totDuration.GetSeconds () > 0)
     {
+      // the average is computed once for all the callbacks
+      double seconds = m_totDuration.GetSeconds ();
+      Values::const_iterator sum = m_sumValues->ConstValuesBegin ();
+      for (Values::iterator average = m_average->ValuesBegin (); average != m_average->ValuesEnd (); ++average, ++sum)
+        {
+          *average = *sum / seconds;
+        }
       std::vector<mmWaveChunkProcessorCallback>::iterator it;
       for (it = m_mmWaveChunkProcessorCallbacks.begin (); it != m_mmWaveChunkProcessorCallbacks.end (); it++)
         {
-          (*it)((*m_sumValues) / m_totDuration.GetSeconds ());
+          (*it)(*m_average);
         }
     }
   else
@@ -40,6 +40,13 @@ class SpectrumValue;
 
 typedef Callback< void, const SpectrumValue& > mmWaveChunkProcessorCallback;
 
+/**
+ * Time average of the values of the chunks of a reception. The sum and the average are kept
+ * in buffers of the processor that are reused from one reception to the next, and all the
+ * callbacks are given a reference to the same average, valid until the next reception starts.
+ * The callbacks that need the same average should be added to one processor, so that the
+ * chunks are accumulated once.
+ */
 class mmWaveChunkProcessor : public SimpleRefCount<mmWaveChunkProcessor>
 {
 public:
@@ -55,7 +62,9 @@ public:
   virtual void End ();
 
 private:
-  Ptr<SpectrumValue> m_sumValues;
+  Ptr<SpectrumValue> m_sumValues; // sum of the values weighted by the chunk durations in seconds
+  Ptr<SpectrumValue> m_average; // average given to the callbacks
+  bool m_empty; // true if no chunk has been accumulated in m_sumValues since Start
   Time m_totDuration;
 
   std::vector<mmWaveChunkProcessorCallback> m_mmWaveChunkProcessorCallbacks;
@@ -35,13 +35,29 @@
 #include <ns3/lte-mac-sap.h>
 #include <ns3/lte-enb-cmac-sap.h>
 #include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/uinteger.h>
+#include <ns3/simulator.h>
+#include <ns3/core-config.h>
+#include <algorithm>
+#include <unistd.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-thread.h>
+#endif
 
 namespace ns3
 {
 NS_LOG_COMPONENT_DEFINE ("MmWaveEnbMac");
 
 NS_OBJECT_ENSURE_REGISTERED (MmWaveEnbMac);
+NS_OBJECT_ENSURE_REGISTERED (MmWaveSchedTriggerBatch);
 
+static bool
+CompareCellId (const MmWaveEnbMac* a, const MmWaveEnbMac* b)
+{
+	return a->GetCellId () < b->GetCellId ();
+}
 
 
 // //////////////////////////////////////
@@ -145,7 +161,7 @@ public:
 
 	virtual void SubframeIndication (SfnSf);
 
-	virtual void UlCqiReport (MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters cqi);
+	virtual void UlCqiReport (const MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& cqi);
 
 	virtual void ReceiveRachPreamble (uint32_t raId);
 
@@ -180,7 +196,7 @@ MmWaveMacEnbMemberPhySapUser::SubframeIndication (SfnSf sfn)
 }
 
 void
-MmWaveMacEnbMemberPhySapUser::UlCqiReport (MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters ulcqi)
+MmWaveMacEnbMemberPhySapUser::UlCqiReport (const MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& ulcqi)
 {
 	m_mac->DoUlCqiReport(ulcqi);
 }
@@ -292,6 +308,16 @@ MmWaveEnbMac::GetTypeId (void)
 	static TypeId tid = TypeId ("ns3::MmWaveEnbMac")
 			.SetParent<MmWaveMac> ()
 			.AddConstructor<MmWaveEnbMac> ()
+			.AddAttribute ("SchedulingThreads",
+			               "Number of threads running the scheduler triggers of the cells, "
+			               "0 for one thread per available core. With more than one thread, "
+			               "the triggers of all the cells for the same subframe are collected, "
+			               "run in parallel, and their allocations are applied in the order of "
+			               "the cell IDs, so the result does not depend on the number of threads. "
+			               "Must be set to the same value for all the eNBs installed by the same helper.",
+			               UintegerValue (1),
+			               MakeUintegerAccessor (&MmWaveEnbMac::m_schedThreads),
+			               MakeUintegerChecker<uint32_t> ())
 	;
 	return tid;
 }
@@ -300,7 +326,11 @@ MmWaveEnbMac::MmWaveEnbMac (void) :
 	 m_frameNum (0),
 	 m_sfNum (0),
 	 m_slotNum (0),
-	 m_tbUid (0)
+	 m_tbUid (0),
+	 m_cellId (0),
+	 m_schedThreads (1),
+	 m_captureSchedConfigInd (false),
+	 m_numCapturedSchedConfigInd (0)
 {
 	NS_LOG_FUNCTION (this);
 	m_cmacSapProvider = new MmWaveEnbMacMemberEnbCmacSapProvider (this);
@@ -325,6 +355,11 @@ MmWaveEnbMac::DoDispose (void)
 	//  m_dlHarqInfoListReceived.clear ();
 	//  m_ulHarqInfoListReceived.clear ();
 	m_miDlHarqProcessesPackets.clear ();
+	if (m_schedTriggerBatch != 0)
+	{
+		m_schedTriggerBatch->RemoveMac (this);
+		m_schedTriggerBatch = 0;
+	}
 	delete m_macSapProvider;
 	delete m_cmacSapProvider;
 	delete m_macSchedSapUser;
@@ -344,6 +379,18 @@ MmWaveEnbMac::GetConfigurationParameters (void) const
 	return m_phyMacConfig;
 }
 
+void
+MmWaveEnbMac::SetCellId (uint16_t cellId)
+{
+	m_cellId = cellId;
+}
+
+uint16_t
+MmWaveEnbMac::GetCellId (void) const
+{
+	return m_cellId;
+}
+
 void
 MmWaveEnbMac::ReceiveRachPreamble (uint32_t raId)
 {
@@ -377,13 +424,13 @@ MmWaveEnbMac::DoSubframeIndication (SfnSf sfnSf)
 	// --- DOWNLINK ---
 	// Send Dl-CQI info to the scheduler	if(m_dlCqiReceived.size () > 0)
 	{
-		MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters dlCqiInfoReq;
-		dlCqiInfoReq.m_sfnsf = sfnSf;
+		m_dlCqiInfoReq.m_sfnsf = sfnSf;
 
-		dlCqiInfoReq.m_cqiList.insert (dlCqiInfoReq.m_cqiList.begin (), m_dlCqiReceived.begin (), m_dlCqiReceived.end ());
-		m_dlCqiReceived.erase (m_dlCqiReceived.begin (), m_dlCqiReceived.end ());
+		// the received list is passed by swapping, and gets back the emptied list of the previous subframe
+		m_dlCqiInfoReq.m_cqiList.swap (m_dlCqiReceived);
+		m_dlCqiReceived.clear ();
 
-		m_macSchedSapProvider->SchedDlCqiInfoReq (dlCqiInfoReq);
+		m_macSchedSapProvider->SchedDlCqiInfoReq (m_dlCqiInfoReq);
 	}
 
 	if (!m_receivedRachPreambleCount.empty ())
@@ -420,11 +467,10 @@ MmWaveEnbMac::DoSubframeIndication (SfnSf sfnSf)
 	// Send UL BSR reports to the scheduler
 	if (m_ulCeReceived.size () > 0)
 	{
-		MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters ulMacReq;
-		ulMacReq.m_sfnSf = sfnSf;
-		ulMacReq.m_macCeList.insert (ulMacReq.m_macCeList.begin (), m_ulCeReceived.begin (), m_ulCeReceived.end ());
-		m_ulCeReceived.erase (m_ulCeReceived.begin (), m_ulCeReceived.end ());
-		m_macSchedSapProvider->SchedUlMacCtrlInfoReq (ulMacReq);
+		m_ulMacCtrlInfoReq.m_sfnSf = sfnSf;
+		m_ulMacCtrlInfoReq.m_macCeList.swap (m_ulCeReceived);
+		m_ulCeReceived.clear ();
+		m_macSchedSapProvider->SchedUlMacCtrlInfoReq (m_ulMacCtrlInfoReq);
 	}
 
 	if (m_slotNum == 0)
@@ -443,28 +489,196 @@ MmWaveEnbMac::DoSubframeIndication (SfnSf sfnSf)
 		  dlSchedSubframeNum = dlSchedSubframeNum + m_phyMacConfig->GetL1L2CtrlLatency();
 		}
 
-		MmWaveMacSchedSapProvider::SchedTriggerReqParameters params;
 		SfnSf schedSfn (dlSchedframeNum, dlSchedSubframeNum, 0);
-		params.m_snfSf = schedSfn;
+		m_schedTriggerReq.m_snfSf = schedSfn;
+
+		// Forward DL HARQ feebacks collected during last subframe TTI, the local buffer
+		// gets back the list of the previous trigger and is emptied
+		m_schedTriggerReq.m_dlHarqInfoList.swap (m_dlHarqInfoReceived);
+		m_dlHarqInfoReceived.clear ();
+
+		// Forward UL HARQ feebacks collected during last TTI
+		m_schedTriggerReq.m_ulHarqInfoList.swap (m_ulHarqInfoReceived);
+		m_ulHarqInfoReceived.clear ();
 
-		// Forward DL HARQ feebacks collected during last subframe TTI
-		if (m_dlHarqInfoReceived.size () > 0)
+		m_schedTriggerReq.m_ueList = m_associatedUe;
+		if (m_schedThreads != 1)
+		{
+			DeferSchedTriggerReq ();
+		}
+		else
 		{
-			params.m_dlHarqInfoList = m_dlHarqInfoReceived;
-			// empty local buffer
-			m_dlHarqInfoReceived.clear ();
+			m_macSchedSapProvider->SchedTriggerReq (m_schedTriggerReq);
 		}
+	}
+}
 
-		// Forward UL HARQ feebacks collected during last TTI
-		if (m_ulHarqInfoReceived.size () > 0)
+void
+MmWaveEnbMac::SetSchedTriggerBatch (Ptr<MmWaveSchedTriggerBatch> batch)
+{
+	if (m_schedTriggerBatch != 0)
+	{
+		m_schedTriggerBatch->RemoveMac (this);
+	}
+	m_schedTriggerBatch = batch;
+	if (m_schedTriggerBatch != 0)
+	{
+		m_schedTriggerBatch->AddMac (this);
+	}
+}
+
+void
+MmWaveEnbMac::DeferSchedTriggerReq (void)
+{
+	NS_LOG_FUNCTION (this << m_cellId);
+	if (m_schedTriggerBatch == 0)
+	{
+		SetSchedTriggerBatch (CreateObject<MmWaveSchedTriggerBatch> ());
+	}
+	m_schedTriggerBatch->Defer (this);
+}
+
+void
+MmWaveEnbMac::ApplyCapturedSchedConfigInd (void)
+{
+	m_captureSchedConfigInd = false;
+	for (unsigned i = 0; i < m_numCapturedSchedConfigInd; i++)
+	{
+		DoSchedConfigIndication (m_capturedSchedConfigInd[i]);
+	}
+	m_numCapturedSchedConfigInd = 0;
+}
+
+TypeId
+MmWaveSchedTriggerBatch::GetTypeId (void)
+{
+	static TypeId tid = TypeId ("ns3::MmWaveSchedTriggerBatch")
+			.SetParent<Object> ()
+			.AddConstructor<MmWaveSchedTriggerBatch> ()
+	;
+	return tid;
+}
+
+MmWaveSchedTriggerBatch::MmWaveSchedTriggerBatch (void)
+{
+	NS_LOG_FUNCTION (this);
+}
+
+MmWaveSchedTriggerBatch::~MmWaveSchedTriggerBatch (void)
+{
+	NS_LOG_FUNCTION (this);
+}
+
+void
+MmWaveSchedTriggerBatch::DoDispose (void)
+{
+	NS_LOG_FUNCTION (this);
+	m_macs.clear ();
+	m_deferred.clear ();
+	Object::DoDispose ();
+}
+
+void
+MmWaveSchedTriggerBatch::AddMac (MmWaveEnbMac* mac)
+{
+	NS_LOG_FUNCTION (this << mac);
+	if (std::find (m_macs.begin (), m_macs.end (), mac) == m_macs.end ())
+	{
+		m_macs.push_back (mac);
+	}
+}
+
+void
+MmWaveSchedTriggerBatch::RemoveMac (MmWaveEnbMac* mac)
+{
+	NS_LOG_FUNCTION (this << mac);
+	m_macs.erase (std::remove (m_macs.begin (), m_macs.end (), mac), m_macs.end ());
+	m_deferred.erase (std::remove (m_deferred.begin (), m_deferred.end (), mac), m_deferred.end ());
+}
+
+void
+MmWaveSchedTriggerBatch::Defer (MmWaveEnbMac* mac)
+{
+	NS_LOG_FUNCTION (this << mac->GetCellId ());
+	if (m_deferred.empty ())
+	{
+		// runs after the subframe indications of the other cells already scheduled for now
+		Simulator::ScheduleNow (&MmWaveSchedTriggerBatch::Run, Ptr<MmWaveSchedTriggerBatch> (this));
+	}
+	m_deferred.push_back (mac);
+}
+
+void
+MmWaveSchedTriggerBatch::Run (void)
+{
+	m_running.clear ();
+	m_running.swap (m_deferred);
+	if (m_running.empty ())
+	{
+		return;
+	}
+	std::stable_sort (m_running.begin (), m_running.end (), CompareCellId);
+
+	// a cell with a different value would run its trigger alone or in a different batch,
+	// and the allocations would depend on the thread count
+	uint32_t numThreads = m_macs.front ()->m_schedThreads;
+	for (std::vector<MmWaveEnbMac*>::const_iterator it = m_macs.begin (); it != m_macs.end (); ++it)
+	{
+		NS_ABORT_MSG_IF ((*it)->m_schedThreads != numThreads, "cell " << (*it)->GetCellId ()
+		                 << " has SchedulingThreads " << (*it)->m_schedThreads << " instead of " << numThreads
+		                 << ", all the cells of a batch must use the same value");
+	}
+#ifdef HAVE_PTHREAD_H
+	if (numThreads == 0)
+	{
+		numThreads = std::max (sysconf (_SC_NPROCESSORS_ONLN), 1L);
+	}
+#else
+	numThreads = 1;
+#endif
+	numThreads = std::min (numThreads, (uint32_t)m_running.size ());
+	NS_LOG_LOGIC (m_running.size () << " deferred scheduler triggers on " << numThreads << " threads");
+
+	for (std::vector<MmWaveEnbMac*>::iterator it = m_running.begin (); it != m_running.end (); ++it)
+	{
+		(*it)->m_captureSchedConfigInd = true;
+	}
+	if (numThreads > 1)
+	{
+#ifdef HAVE_PTHREAD_H
+		std::vector< Ptr<SystemThread> > threads;
+		for (uint32_t t = 0; t < numThreads; t++)
+		{
+			Callback<void, uint32_t, uint32_t> run = MakeCallback (&MmWaveSchedTriggerBatch::RunSchedTriggerReqs, this);
+			threads.push_back (Create<SystemThread> (run.TwoBind (t, numThreads)));
+			threads.back ()->Start ();
+		}
+		for (uint32_t t = 0; t < numThreads; t++)
 		{
-			params.m_ulHarqInfoList = m_ulHarqInfoReceived;
-			// empty local buffer
-			m_ulHarqInfoReceived.clear ();
+			threads[t]->Join ();
 		}
+#endif
+	}
+	else
+	{
+		RunSchedTriggerReqs (0, 1);
+	}
 
-		params.m_ueList = m_associatedUe;
-		m_macSchedSapProvider->SchedTriggerReq (params);
+	// the allocations modify the RLC and PHY of the cells, apply them on the simulation thread
+	for (std::vector<MmWaveEnbMac*>::iterator it = m_running.begin (); it != m_running.end (); ++it)
+	{
+		(*it)->ApplyCapturedSchedConfigInd ();
+	}
+	m_running.clear ();
+}
+
+void
+MmWaveSchedTriggerBatch::RunSchedTriggerReqs (uint32_t first, uint32_t stride)
+{
+	for (uint32_t i = first; i < m_running.size (); i += stride)
+	{
+		MmWaveEnbMac *mac = m_running[i];
+		mac->m_macSchedSapProvider->SchedTriggerReq (mac->m_schedTriggerReq);
 	}
 }
 
@@ -571,7 +785,7 @@ MmWaveEnbMac::SetMmWaveMacCschedSapProvider (MmWaveMacCschedSapProvider* ptr)
 }
 
 void
-MmWaveEnbMac::DoUlCqiReport (MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters ulcqi)
+MmWaveEnbMac::DoUlCqiReport (const MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& ulcqi)
 {
   if (ulcqi.m_ulCqi.m_type == UlCqiInfo::PUSCH)
     {
@@ -622,14 +836,14 @@ MmWaveEnbMac::DoReceiveControlMessage  (Ptr<MmWaveControlMessage> msg)
 }
 
 void
-MmWaveEnbMac::DoUlHarqFeedback (UlHarqInfo params)
+MmWaveEnbMac::DoUlHarqFeedback (const UlHarqInfo& params)
 {
   NS_LOG_FUNCTION (this);
   m_ulHarqInfoReceived.push_back (params);
 }
 
 void
-MmWaveEnbMac::DoDlHarqFeedback (DlHarqInfo params)
+MmWaveEnbMac::DoDlHarqFeedback (const DlHarqInfo& params)
 {
   NS_LOG_FUNCTION (this);
   // Update HARQ buffer
@@ -667,7 +881,7 @@ MmWaveEnbMac::DoDlHarqFeedback (DlHarqInfo params)
 }
 
 void
-MmWaveEnbMac::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParameters params)
+MmWaveEnbMac::DoReportBufferStatus (const LteMacSapProvider::ReportBufferStatusParameters& params)
 {
   NS_LOG_FUNCTION (this);
   MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters schedParams;
@@ -690,7 +904,7 @@ MmWaveEnbMac::DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParamet
 
 // forwarded from LteMacSapProvider
 void
-MmWaveEnbMac::DoTransmitPdu (LteMacSapProvider::TransmitPduParameters params)
+MmWaveEnbMac::DoTransmitPdu (const LteMacSapProvider::TransmitPduParameters& params)
 {
 	// TB UID passed back along with RLC data as HARQ process ID
 	uint32_t tbMapKey = ((params.rnti & 0xFFFF) << 8) | (params.harqProcessId & 0xFF);
@@ -717,14 +931,30 @@ MmWaveEnbMac::DoTransmitPdu (LteMacSapProvider::TransmitPduParameters params)
 }
 
 void
-MmWaveEnbMac::DoSchedConfigIndication (MmWaveMacSchedSapUser::SchedConfigIndParameters ind)
+MmWaveEnbMac::DoSchedConfigIndication (const MmWaveMacSchedSapUser::SchedConfigIndParameters& ind)
 {
+	if (m_captureSchedConfigInd)
+	{
+		// called by a deferred scheduler trigger, possibly on a worker thread. The indication
+		// is assigned to a kept element, whose containers are reused
+		if (m_numCapturedSchedConfigInd == m_capturedSchedConfigInd.size ())
+		{
+			m_capturedSchedConfigInd.push_back (ind);
+		}
+		else
+		{
+			m_capturedSchedConfigInd[m_numCapturedSchedConfigInd] = ind;
+		}
+		m_numCapturedSchedConfigInd++;
+		return;
+	}
+
 	m_phySapProvider->SetDlSfAllocInfo (ind.m_sfAllocInfo);
 	//m_phySapProvider->SetUlSfAllocInfo (ind.m_ulSfAllocInfo);
 
 	for (unsigned islot = 0; islot < ind.m_sfAllocInfo.m_slotAllocInfo.size (); islot++)
 	{
-		SlotAllocInfo &slotAllocInfo = ind.m_sfAllocInfo.m_slotAllocInfo[islot];
+		const SlotAllocInfo &slotAllocInfo = ind.m_sfAllocInfo.m_slotAllocInfo[islot];
 		if (slotAllocInfo.m_slotType != SlotAllocInfo::CTRL && slotAllocInfo.m_tddMode == SlotAllocInfo::DL)
 		{
 			uint16_t rnti = slotAllocInfo.m_dci.m_rnti;
@@ -736,14 +966,14 @@ MmWaveEnbMac::DoSchedConfigIndication (MmWaveMacSchedSapUser::SchedConfigIndPara
 			else
 			{
 				// Call RLC entities to generate RLC PDUs
-				DciInfoElementTdma &dciElem = slotAllocInfo.m_dci;
+				const DciInfoElementTdma &dciElem = slotAllocInfo.m_dci;
 				uint8_t tbUid = dciElem.m_harqProcess;
 
 				// update Harq Processes
 				if (dciElem.m_ndi == 1)
 				{
 					NS_ASSERT (dciElem.m_format == DciInfoElementTdma::DL);
-					std::vector<RlcPduInfo> &rlcPduInfo = slotAllocInfo.m_rlcPduInfo;
+					const std::vector<RlcPduInfo> &rlcPduInfo = slotAllocInfo.m_rlcPduInfo;
 					NS_ASSERT (rlcPduInfo.size () > 0);
 					SfnSf pduSfn = ind.m_sfnSf;
 					pduSfn.m_slotNum = slotAllocInfo.m_dci.m_symStart;
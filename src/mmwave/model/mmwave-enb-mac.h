@@ -48,10 +48,59 @@ namespace ns3
 
 typedef std::vector < MmWaveDlHarqProcessInfo> MmWaveDlHarqProcessesBuffer_t;
 
+class MmWaveEnbMac;
+
+/**
+ * \brief The deferred scheduler triggers of the cells of a simulation. The MACs installed
+ * by the same MmWaveHelper share one batch, the triggers of the cells for the same time are
+ * run on the SchedulingThreads threads of the MACs, which must all have the same value
+ */
+class MmWaveSchedTriggerBatch : public Object
+{
+public:
+	static TypeId GetTypeId (void);
+	MmWaveSchedTriggerBatch (void);
+	virtual ~MmWaveSchedTriggerBatch (void);
+	virtual void DoDispose (void);
+
+	/**
+	 * \brief Add a MAC to the batch
+	 * @params mac the MAC, removed by MmWaveEnbMac::DoDispose
+	 */
+	void AddMac (MmWaveEnbMac* mac);
+	void RemoveMac (MmWaveEnbMac* mac);
+
+	/**
+	 * \brief Keep the scheduler trigger of a MAC until the triggers of all the cells for the
+	 * same time have been collected
+	 * @params mac the MAC, its trigger is m_schedTriggerReq
+	 */
+	void Defer (MmWaveEnbMac* mac);
+
+private:
+	/**
+	 * \brief Run the deferred scheduler triggers of all the cells, then apply their
+	 * SchedConfigInd on the simulation thread in the order of the cell IDs
+	 */
+	void Run (void);
+
+	/**
+	 * \brief Run the deferred triggers first, first + stride, ... of the batch
+	 * @params first the index of the first MAC
+	 * @params stride the number of threads
+	 */
+	void RunSchedTriggerReqs (uint32_t first, uint32_t stride);
+
+	std::vector<MmWaveEnbMac*> m_macs; // MACs of the batch
+	std::vector<MmWaveEnbMac*> m_deferred; // MACs whose trigger waits for the current time, in the order of the deferrals
+	std::vector<MmWaveEnbMac*> m_running; // deferred MACs being run, sorted by cell ID
+};
+
 class MmWaveEnbMac : public Object
 {
 	friend class MmWaveEnbMacMemberEnbCmacSapProvider;
 	friend class MmWaveMacEnbMemberPhySapUser;
+	friend class MmWaveSchedTriggerBatch;
 
 public:
 	static TypeId GetTypeId (void);
@@ -105,10 +154,26 @@ public:
 	void SetConfigurationParameters (Ptr<MmWavePhyMacCommon> ptrConfig);
 	Ptr<MmWavePhyMacCommon> GetConfigurationParameters (void) const;
 
+	/**
+	 * \brief Set the cell ID, the deferred scheduler triggers of the cells are
+	 * run and applied in the order of their cell IDs
+	 * @params cellId the cell ID of the eNB
+	 */
+	void SetCellId (uint16_t cellId);
+	uint16_t GetCellId (void) const;
+
+	/**
+	 * \brief Set the batch that runs the scheduler trigger of the cell together with
+	 * the ones of the other cells, when SchedulingThreads is not 1. Without a batch,
+	 * the MAC creates its own at the first trigger
+	 * @params batch the batch shared by the cells of the simulation
+	 */
+	void SetSchedTriggerBatch (Ptr<MmWaveSchedTriggerBatch> batch);
+
 	// forwarded from LteMacSapProvider
-	void DoTransmitPdu (LteMacSapProvider::TransmitPduParameters);
-	void DoReportBufferStatus (LteMacSapProvider::ReportBufferStatusParameters);
-	void DoUlCqiReport (MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters ulcqi);
+	void DoTransmitPdu (const LteMacSapProvider::TransmitPduParameters&);
+	void DoReportBufferStatus (const LteMacSapProvider::ReportBufferStatusParameters&);
+	void DoUlCqiReport (const MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& ulcqi);
 
 	void DoSubframeIndication (SfnSf sfnSf);
 
@@ -124,7 +189,7 @@ public:
 
 	void DoReceiveControlMessage  (Ptr<MmWaveControlMessage> msg);
 
-	void DoSchedConfigIndication (MmWaveMacSchedSapUser::SchedConfigIndParameters ind);
+	void DoSchedConfigIndication (const MmWaveMacSchedSapUser::SchedConfigIndParameters& ind);
 
 	MmWaveEnbPhySapUser* GetPhySapUser ();
 	void SetPhySapProvider (MmWavePhySapProvider* ptr);
@@ -163,8 +228,19 @@ private:
 	LteEnbCmacSapProvider::AllocateNcRaPreambleReturnValue DoAllocateNcRaPreamble (uint16_t rnti);
 	uint8_t AllocateTbUid ();
 
-	void DoDlHarqFeedback (DlHarqInfo params);
-	void DoUlHarqFeedback (UlHarqInfo params);
+	void DoDlHarqFeedback (const DlHarqInfo& params);
+	void DoUlHarqFeedback (const UlHarqInfo& params);
+
+	/**
+	 * \brief Keep the scheduler trigger of the subframe, m_schedTriggerReq, in the
+	 * batch until the triggers of all the cells for the same time have been collected
+	 */
+	void DeferSchedTriggerReq (void);
+
+	/**
+	 * \brief Apply the SchedConfigInd captured while the deferred trigger ran
+	 */
+	void ApplyCapturedSchedConfigInd (void);
 
 	Ptr<MmWavePhyMacCommon> m_phyMacConfig;
 
@@ -203,6 +279,18 @@ private:
 	std::vector <UlHarqInfo> m_ulHarqInfoReceived; // UL HARQ feedback received
 	std::map <uint16_t, MmWaveDlHarqProcessesBuffer_t> m_miDlHarqProcessesPackets; // Packet under trasmission of the DL HARQ process
 
+	// the SAP parameters below are kept from one subframe to the next, so that their containers
+	// are reused instead of being allocated and copied at each call
+	MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters m_dlCqiInfoReq;
+	MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters m_ulMacCtrlInfoReq;
+	MmWaveMacSchedSapProvider::SchedTriggerReqParameters m_schedTriggerReq;
+
+	uint16_t m_cellId;
+	uint32_t m_schedThreads; // threads running the scheduler triggers of the cells, 1 runs them immediately
+	Ptr<MmWaveSchedTriggerBatch> m_schedTriggerBatch;
+	bool m_captureSchedConfigInd; // true while the deferred trigger runs, the indications are kept until the batch completes
+	std::vector <MmWaveMacSchedSapUser::SchedConfigIndParameters> m_capturedSchedConfigInd; // reused, the first m_numCapturedSchedConfigInd are valid
+	unsigned m_numCapturedSchedConfigInd;
 };
 
 }
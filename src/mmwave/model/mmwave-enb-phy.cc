@@ -31,6 +31,7 @@
 #include <ns3/log.h>
 #include <cfloat>
 #include <cmath>
+#include <algorithm>
 #include <ns3/simulator.h>
 #include <ns3/attribute-accessor-helper.h>
 #include <ns3/double.h>
@@ -255,7 +256,9 @@ MmWaveEnbPhy::StartSubFrame (void)
 
 	m_lastSfStart = Simulator::Now();
 
-	m_currSfAllocInfo = m_sfAllocInfo[m_sfNum];
+	// take the allocation of the subframe instead of copying it, the entry gets the containers of the
+	// previous subframe that the next SetDlSfAllocInfo of this subframe number reuses
+	std::swap (m_currSfAllocInfo, m_sfAllocInfo[m_sfNum]);
 	//m_currSfNumSlots = m_currSfAllocInfo.m_dlSlotAllocInfo.size () + m_currSfAllocInfo.m_ulSlotAllocInfo.size ();
 	m_currSfNumSlots = m_currSfAllocInfo.m_slotAllocInfo.size ();
 
@@ -340,7 +343,7 @@ MmWaveEnbPhy::StartSlot (void)
 			if (m_currSfAllocInfo.m_slotAllocInfo[islot].m_slotType != SlotAllocInfo::CTRL &&
 					m_currSfAllocInfo.m_slotAllocInfo[islot].m_tddMode == SlotAllocInfo::DL)
 			{
-				DciInfoElementTdma &dciElem = m_currSfAllocInfo.m_slotAllocInfo[islot].m_dci;
+				const DciInfoElementTdma &dciElem = m_currSfAllocInfo.m_slotAllocInfo[islot].m_dci;
 				NS_ASSERT (dciElem.m_format == DciInfoElementTdma::DL);
 				if (dciElem.m_tbSize > 0)
 				{
@@ -354,12 +357,14 @@ MmWaveEnbPhy::StartSlot (void)
 		}
 
 		unsigned ulSfNum = (m_sfNum + m_phyMacConfig->GetUlSchedDelay ()) % m_phyMacConfig->GetSubframesPerFrame ();
-		for (unsigned islot = 0; islot < m_sfAllocInfo[ulSfNum].m_slotAllocInfo.size (); islot++)
+		// with no UL scheduling delay, the allocation of the current subframe has already been taken
+		const SfAllocInfo &ulSfAllocInfo = ulSfNum == m_sfNum ? m_currSfAllocInfo : m_sfAllocInfo[ulSfNum];
+		for (unsigned islot = 0; islot < ulSfAllocInfo.m_slotAllocInfo.size (); islot++)
 		{
-			if (m_sfAllocInfo[ulSfNum].m_slotAllocInfo[islot].m_slotType != SlotAllocInfo::CTRL
-					&& m_sfAllocInfo[ulSfNum].m_slotAllocInfo[islot].m_tddMode == SlotAllocInfo::UL)
+			if (ulSfAllocInfo.m_slotAllocInfo[islot].m_slotType != SlotAllocInfo::CTRL
+					&& ulSfAllocInfo.m_slotAllocInfo[islot].m_tddMode == SlotAllocInfo::UL)
 			{
-				DciInfoElementTdma &dciElem = m_sfAllocInfo[ulSfNum].m_slotAllocInfo[islot].m_dci;
+				const DciInfoElementTdma &dciElem = ulSfAllocInfo.m_slotAllocInfo[islot].m_dci;
 				NS_ASSERT (dciElem.m_format == DciInfoElementTdma::UL);
 				if (dciElem.m_tbSize > 0)
 				{
@@ -631,8 +636,7 @@ MmWaveEnbPhy::GenerateDataCqiReport (const SpectrumValue& sinr)
   // here we use the start symbol index of the slot in place of the slot index because the absolute UL slot index is
   // not known to the scheduler when m_allocationMap gets populated
   ulcqi.m_sfnSf = SfnSf (m_frameNum, m_sfNum, m_currSymStart);
-  SpectrumValue newSinr = sinr;
-	m_ulSinrTrace (0, newSinr, newSinr);
+	m_ulSinrTrace (0, sinr, sinr);
   m_phySapUser->UlCqiReport (ulcqi);
 }
 
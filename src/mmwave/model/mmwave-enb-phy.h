@@ -161,7 +161,7 @@ private:
 
 	uint8_t m_currSymStart;
 
-	TracedCallback< uint64_t, SpectrumValue&, SpectrumValue& > m_ulSinrTrace;
+	TracedCallback< uint64_t, const SpectrumValue&, const SpectrumValue& > m_ulSinrTrace;
 };
 
 }
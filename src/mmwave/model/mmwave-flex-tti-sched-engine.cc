@@ -0,0 +1,1365 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/log.h>
+#include <ns3/abort.h>
+#include <ns3/eps-bearer.h>
+#include "mmwave-flex-tti-sched-engine.h"
+#include "mmwave-mac-scheduler.h"
+#include "mmwave-spectrum-value-helper.h"
+#include <stdlib.h>     /* abs */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("MmWaveFlexTtiSchedEngine");
+
+const unsigned MmWaveFlexTtiSchedEngine::m_subHdrSize = 4;
+
+static uint32_t
+BsrId2BufferSize (uint8_t val)
+{
+	NS_ABORT_MSG_UNLESS (val < 64, "val = " << val << " is out of range");
+	return BufferSizeLevelBsrTable[val];
+}
+
+MmWaveFlexTtiSchedEngine::MmWaveFlexTtiSchedEngine ()
+	: m_dlRlcSplit (EVEN_SPLIT),
+	  m_sfPeriod (1.0),
+	  m_timeWindow (99.0),
+	  m_harqOn (false),
+	  m_cqiTimersThreshold (100),
+	  m_tbUid (0),
+	  m_activeUesSorted (true)
+{
+}
+
+void
+MmWaveFlexTtiSchedEngine::Configure (Ptr<MmWavePhyMacCommon> config, Ptr<MmWaveAmc> amc, DlRlcSplit dlRlcSplit)
+{
+	m_phyMacConfig = config;
+	m_amc = amc;
+	m_dlRlcSplit = dlRlcSplit;
+	m_ulCqiSinr = Create<SpectrumValue> (MmWaveSpectrumValueHelper::GetSpectrumModel (m_phyMacConfig));
+	m_sfPeriod = m_phyMacConfig->GetSubframePeriod () * 1E-6;
+}
+
+void
+MmWaveFlexTtiSchedEngine::Dispose ()
+{
+	m_ueStorage.clear ();
+	m_freeUes.clear ();
+	m_ueByRnti.clear ();
+	m_ues.clear ();
+	m_activeUes.clear ();
+	m_allocatedUes.clear ();
+	m_rankedUes.clear ();
+	m_rlcBufferReq.clear ();
+	m_ceBsrRxed.clear ();
+	m_wbCqiRxed.clear ();
+	m_wbCqiTimers.clear ();
+	m_ueUlCqi.clear ();
+	m_ueCqiTimers.clear ();
+	m_ulAllocationMap.clear ();
+	m_dlHarqInfoList.clear ();
+	m_ulHarqInfoList.clear ();
+}
+
+void
+MmWaveFlexTtiSchedEngine::SetHarqEnabled (bool harqOn)
+{
+	m_harqOn = harqOn;
+}
+
+bool
+MmWaveFlexTtiSchedEngine::IsHarqEnabled () const
+{
+	return m_harqOn;
+}
+
+void
+MmWaveFlexTtiSchedEngine::SetCqiTimersThreshold (uint32_t threshold)
+{
+	m_cqiTimersThreshold = threshold;
+}
+
+uint32_t
+MmWaveFlexTtiSchedEngine::GetCqiTimersThreshold () const
+{
+	return m_cqiTimersThreshold;
+}
+
+MmWaveFlexTtiUeSchedInfo*
+MmWaveFlexTtiSchedEngine::AddUe (uint16_t rnti)
+{
+	UeSchedInfo *ue = GetUe (rnti);
+	if (ue != 0)
+	{
+		return ue;
+	}
+	if (m_freeUes.empty ())
+	{
+		m_ueStorage.push_back (UeSchedInfo (rnti));
+		ue = &m_ueStorage.back ();
+	}
+	else
+	{
+		ue = m_freeUes.back ();
+		m_freeUes.pop_back ();
+		*ue = UeSchedInfo (rnti);
+	}
+	for (unsigned i = 0; i <= 3; i++)
+	{
+		ue->m_flowStatsDl.push_back (FlowStats (false, ue, i));
+		ue->m_flowStatsUl.push_back (FlowStats (true, ue, i));
+	}
+	unsigned numHarqProcess = m_phyMacConfig->GetNumHarqProcess ();
+	ue->m_dlHarqProcessesStatus.resize (numHarqProcess, 0);
+	ue->m_dlHarqProcessesTimer.resize (numHarqProcess, 0);
+	ue->m_dlHarqProcessesDciInfo.resize (numHarqProcess);
+	ue->m_dlHarqProcessesRlcPdu.resize (numHarqProcess);
+	ue->m_ulHarqProcessesStatus.resize (numHarqProcess, 0);
+	ue->m_ulHarqProcessesTimer.resize (numHarqProcess, 0);
+	ue->m_ulHarqProcessesDciInfo.resize (numHarqProcess);
+
+	if (rnti >= m_ueByRnti.size ())
+	{
+		m_ueByRnti.resize (rnti + 1, 0);
+	}
+	m_ueByRnti[rnti] = ue;
+	m_ues.insert (std::lower_bound (m_ues.begin (), m_ues.end (), ue, CompareRnti), ue);
+	return ue;
+}
+
+void
+MmWaveFlexTtiSchedEngine::RemoveUe (uint16_t rnti)
+{
+	UeSchedInfo *ue = GetUe (rnti);
+	if (ue != 0)
+	{
+		m_ueByRnti[rnti] = 0;
+		m_ues.erase (std::lower_bound (m_ues.begin (), m_ues.end (), ue, CompareRnti));
+		if (ue->m_active)
+		{
+			m_activeUes.erase (std::find (m_activeUes.begin (), m_activeUes.end (), ue));
+		}
+		ue->m_flowStatsDl.clear ();
+		ue->m_flowStatsUl.clear ();
+		m_freeUes.push_back (ue);
+	}
+
+	m_wbCqiRxed.erase (rnti);
+	m_wbCqiTimers.erase (rnti);
+	m_ueUlCqi.erase (rnti);
+	m_ueCqiTimers.erase (rnti);
+	m_ceBsrRxed.erase (rnti);
+	std::list<MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters>::iterator it = m_rlcBufferReq.begin ();
+	while (it != m_rlcBufferReq.end ())
+	{
+		if ((*it).m_rnti == rnti)
+		{
+			NS_LOG_INFO (this << " Erase RNTI " << (*it).m_rnti << " LC " << (uint16_t)(*it).m_logicalChannelIdentity);
+			it = m_rlcBufferReq.erase (it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::ConfigureLcs (const struct MmWaveMacCschedSapProvider::CschedLcConfigReqParameters& params, std::vector<FlowStats*> &flows)
+{
+	UeSchedInfo *ue = GetUe (params.m_rnti);
+	if (ue == 0)
+	{
+		NS_LOG_ERROR ("Cannot find UE info entry");
+		return;
+	}
+	for (uint16_t i = 0; i < params.m_logicalChannelConfigList.size (); i++)
+	{
+		const LogicalChannelConfigListElement_s &lcConfig = params.m_logicalChannelConfigList[i];
+		if (lcConfig.m_direction == LogicalChannelConfigListElement_s::DIR_DL)
+		{
+			uint8_t lcid = lcConfig.m_logicalChannelIdentity;
+			for (unsigned j = ue->m_flowStatsDl.size (); j <= lcid; j++)
+			{
+				ue->m_flowStatsDl.push_back (FlowStats (false, ue, j));
+			}
+			ue->m_flowStatsDl[lcid].m_qci = lcConfig.m_qci;
+			if (lcConfig.m_qci == EpsBearer::GBR_ULTRA_LOW_LAT)
+			{
+				EpsBearer lowLatBearer (EpsBearer::GBR_ULTRA_LOW_LAT);
+				ue->m_flowStatsDl[lcid].m_deadlineUs = lowLatBearer.GetPacketDelayBudgetMs () * 1000;
+			}
+			flows.push_back (&ue->m_flowStatsDl[lcid]);
+		}
+		else if (lcConfig.m_direction == LogicalChannelConfigListElement_s::DIR_UL)
+		{
+			uint8_t lcid = lcConfig.m_logicalChannelGroup; // use LCG ID instead of LCID
+			for (unsigned j = ue->m_flowStatsUl.size (); j <= lcid; j++)
+			{
+				ue->m_flowStatsUl.push_back (FlowStats (true, ue, j));
+			}
+			ue->m_flowStatsUl[lcid].m_isUplink = true;
+			ue->m_flowStatsUl[lcid].m_qci = lcConfig.m_qci;
+			if (lcConfig.m_qci == EpsBearer::GBR_ULTRA_LOW_LAT)
+			{
+				EpsBearer lowLatBearer (EpsBearer::GBR_ULTRA_LOW_LAT);
+				ue->m_flowStatsUl[lcid].m_deadlineUs = lowLatBearer.GetPacketDelayBudgetMs () * 1000;
+			}
+			flows.push_back (&ue->m_flowStatsUl[lcid]);
+		}
+		else if (lcConfig.m_direction == LogicalChannelConfigListElement_s::DIR_BOTH)
+		{
+			uint8_t lcid = lcConfig.m_logicalChannelIdentity;
+			for (unsigned j = ue->m_flowStatsDl.size (); j <= lcid; j++)
+			{
+				ue->m_flowStatsDl.push_back (FlowStats (false, ue, j));
+				ue->m_flowStatsUl.push_back (FlowStats (true, ue, j));
+			}
+			ue->m_flowStatsDl[lcid].m_qci = lcConfig.m_qci;
+			ue->m_flowStatsUl[lcid].m_qci = lcConfig.m_qci;
+
+			EpsBearer lowLatBearer (EpsBearer::GBR_ULTRA_LOW_LAT);
+			ue->m_flowStatsDl[lcid].m_deadlineUs = lowLatBearer.GetPacketDelayBudgetMs () * 1000;
+			ue->m_flowStatsUl[lcid].m_deadlineUs = lowLatBearer.GetPacketDelayBudgetMs () * 1000;
+
+			flows.push_back (&ue->m_flowStatsDl[lcid]);
+			flows.push_back (&ue->m_flowStatsUl[lcid]);
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::ReleaseLcs (const struct MmWaveMacCschedSapProvider::CschedLcReleaseReqParameters& params)
+{
+	for (uint16_t i = 0; i < params.m_logicalChannelIdentity.size (); i++)
+	{
+		std::list<MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters>::iterator it = m_rlcBufferReq.begin ();
+		while (it!=m_rlcBufferReq.end ())
+		{
+			if (((*it).m_rnti == params.m_rnti)&&((*it).m_logicalChannelIdentity == params.m_logicalChannelIdentity.at (i)))
+			{
+				it = m_rlcBufferReq.erase (it);
+			}
+			else
+			{
+				it++;
+			}
+		}
+	}
+}
+
+MmWaveFlexTtiFlowStats*
+MmWaveFlexTtiSchedEngine::UpdateDlFlow (const struct MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters& params)
+{
+	UeSchedInfo *ue = GetUe (params.m_rnti);
+	if (ue == 0)
+	{
+		NS_LOG_ERROR ("UE entry not found in sched info map");
+		return 0;
+	}
+	uint8_t lcid = params.m_logicalChannelIdentity;
+	if ((unsigned)lcid >= ue->m_flowStatsDl.size ())
+	{
+		NS_LOG_ERROR ("LC not registered");
+		return 0;
+	}
+	FlowStats &flow = ue->m_flowStatsDl[lcid];
+	if (params.m_txPacketSizes.size () > 0)
+	{
+		flow.m_txPacketSizes.clear ();
+		flow.m_txPacketDelays.clear ();
+		// add the new DL PDCP packet sizes and their delays
+		uint32_t totalSize = 0;
+		double maxDelay = 0.0;
+		std::list<uint32_t>::const_iterator itSize = params.m_txPacketSizes.begin ();
+		std::list<double>::const_iterator itDelay = params.m_txPacketDelays.begin ();
+		while (itSize != params.m_txPacketSizes.end() && itDelay != params.m_txPacketDelays.end ())
+		{
+			totalSize += *itSize;
+			if (totalSize > flow.m_totalSchedSize)
+			{
+				flow.m_totalBufSize = params.m_rlcTransmissionQueueSize;
+				flow.m_txPacketSizes.push_back (*itSize);
+				flow.m_txPacketDelays.push_back (*itDelay);
+				if (*itDelay > maxDelay)
+				{
+					maxDelay = *itDelay;
+				}
+			}
+			itSize++;
+			itDelay++;
+		}
+		flow.m_txQueueHolDelay = maxDelay;
+	}
+	else if (params.m_rlcTransmissionQueueSize > 0)  // case for RlcSm
+	{
+		flow.m_totalBufSize = params.m_rlcTransmissionQueueSize;
+	}
+	if (flow.m_totalBufSize > 0)
+	{
+		ActivateUe (ue);
+	}
+	return &flow;
+}
+
+void
+MmWaveFlexTtiSchedEngine::UpdateUlFlows (const struct MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params, std::vector<FlowStats*> &flows)
+{
+	for (unsigned int i = 0; i < params.m_macCeList.size (); i++)
+	{
+		if ( params.m_macCeList.at (i).m_macCeType == MacCeElement::BSR )
+		{
+			uint16_t rnti = params.m_macCeList.at (i).m_rnti;
+			UeSchedInfo *ue = GetUe (rnti);
+			for (uint8_t lcg = 1; lcg <= 3; ++lcg)
+			{
+				uint8_t bsrId = params.m_macCeList.at (i).m_macCeValue.m_bufferStatus.at (lcg-1);
+				uint32_t bufSize = BsrId2BufferSize (bsrId);
+				if (bufSize > 0)
+				{
+					if (ue == 0)
+					{
+						NS_LOG_ERROR ("UE entry not found in sched info map");
+						continue;
+					}
+					FlowStats &flow = ue->m_flowStatsUl[lcg];
+					int diff = bufSize - (flow.m_totalBufSize + flow.m_totalSchedSize);
+					if (diff > 0)
+					{	// estimate additional packet sizes
+						flow.m_totalBufSize += diff;
+						ActivateUe (ue);
+						flow.m_txPacketSizes.push_back (diff);
+						// since we expect the BSR to be generated following a packet arrival and sent at least by the end of the prev. subframe,
+						// the maximum delay is one SF (in microseconds)
+						flow.m_txPacketDelays.push_back (m_phyMacConfig->GetSubframePeriod ());
+						if (flow.m_txQueueHolDelay == 0)
+						{
+							flow.m_txQueueHolDelay = m_phyMacConfig->GetSubframePeriod ();
+						}
+						flows.push_back (&flow);
+					}
+				}
+			}
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::StoreRlcBufferReq (const struct MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters& params)
+{
+	// API generated by RLC for updating RLC parameters on a LC (tx and retx queues)
+	std::list<MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters>::iterator it = m_rlcBufferReq.begin ();
+	bool newLc = true;
+	while (it != m_rlcBufferReq.end ())
+	{
+		// remove old entries of this UE-LC
+		if (((*it).m_rnti == params.m_rnti)&&((*it).m_logicalChannelIdentity == params.m_logicalChannelIdentity))
+		{
+			it = m_rlcBufferReq.erase (it);
+			newLc = false;
+		}
+		else
+		{
+			++it;
+		}
+	}
+	// add the new parameters
+	m_rlcBufferReq.insert (it, params);
+	NS_LOG_INFO ("BSR for RNTI " << params.m_rnti << " LC " << (uint16_t)params.m_logicalChannelIdentity << " RLC tx size " << params.m_rlcTransmissionQueueSize << " RLC retx size " << params.m_rlcRetransmissionQueueSize << " RLC stat size " <<  params.m_rlcStatusPduSize);
+	// initialize statistics of the flow in case of new flows
+	if (newLc == true)
+	{
+		m_wbCqiRxed.insert ( std::pair<uint16_t, uint8_t > (params.m_rnti, 1)); // only codeword 0 at this stage (SISO)
+		// initialized to 1 (i.e., the lowest value for transmitting a signal)
+		m_wbCqiTimers.insert ( std::pair<uint16_t, uint32_t > (params.m_rnti, m_cqiTimersThreshold));
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::StoreBsr (const struct MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params)
+{
+	for (unsigned int i = 0; i < params.m_macCeList.size (); i++)
+	{
+		if ( params.m_macCeList.at (i).m_macCeType == MacCeElement::BSR )
+		{
+			// the BSR of different LCGs are summed up to get a total queue size
+			uint32_t buffer = 0;
+			for (uint8_t lcg = 0; lcg < 4; ++lcg)
+			{
+				uint8_t bsrId = params.m_macCeList.at (i).m_macCeValue.m_bufferStatus.at (lcg);
+				buffer += BsrId2BufferSize (bsrId);
+			}
+
+			uint16_t rnti = params.m_macCeList.at (i).m_rnti;
+			std::map <uint16_t,uint32_t>::iterator it = m_ceBsrRxed.find (rnti);
+			if (it == m_ceBsrRxed.end ())
+			{
+				// create the new entry
+				m_ceBsrRxed.insert ( std::pair<uint16_t, uint32_t > (rnti, buffer));
+				NS_LOG_INFO (this << " Insert RNTI " << rnti << " queue " << buffer);
+			}
+			else
+			{
+				// update the buffer size value
+				(*it).second = buffer;
+				NS_LOG_INFO (this << " Update RNTI " << rnti << " queue " << buffer);
+			}
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::ReceiveDlCqi (const struct MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters& params)
+{
+	for (unsigned int i = 0; i < params.m_cqiList.size (); i++)
+	{
+		if ( params.m_cqiList.at (i).m_cqiType == DlCqiInfo::WB )
+		{
+			// wideband CQI reporting
+			uint16_t rnti = params.m_cqiList.at (i).m_rnti;
+			std::map <uint16_t,uint8_t>::iterator it = m_wbCqiRxed.find (rnti);
+			if (it == m_wbCqiRxed.end ())
+			{
+				// create the new entry
+				m_wbCqiRxed.insert ( std::pair<uint16_t, uint8_t > (rnti, params.m_cqiList.at (i).m_wbCqi) ); // only codeword 0 at this stage (SISO)
+				// generate correspondent timer
+				m_wbCqiTimers.insert ( std::pair<uint16_t, uint32_t > (rnti, m_cqiTimersThreshold));
+			}
+			else
+			{
+				// update the CQI value
+				(*it).second = params.m_cqiList.at (i).m_wbCqi;
+				// update correspondent timer
+				std::map <uint16_t,uint32_t>::iterator itTimers;
+				itTimers = m_wbCqiTimers.find (rnti);
+				(*itTimers).second = m_cqiTimersThreshold;
+			}
+		}
+		else if ( params.m_cqiList.at (i).m_cqiType == DlCqiInfo::SB )
+		{
+			// subband CQI reporting high layer configured
+			// Not used by the flex-TTI schedulers
+		}
+		else
+		{
+			NS_LOG_ERROR (this << " CQI type unknown");
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::ReceiveUlCqi (const struct MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& params)
+{
+	unsigned frameNum = params.m_sfnSf.m_frameNum;
+	unsigned subframeNum =  params.m_sfnSf.m_sfNum;
+	unsigned startSymIdx =  params.m_sfnSf.m_slotNum;
+
+	switch (params.m_ulCqi.m_type)
+	{
+		case UlCqiInfo::PUSCH:
+		{
+			std::map <uint32_t, struct AllocMapElem>::iterator itMap;
+			std::map <uint16_t, struct UlCqiMapElem>::iterator itCqi;
+			itMap = m_ulAllocationMap.find (params.m_sfnSf.Encode ());
+			if (itMap == m_ulAllocationMap.end ())
+			{
+				NS_LOG_INFO (this << " Does not find info on allocation, size : " << m_ulAllocationMap.size ());
+				return;
+			}
+			NS_ASSERT_MSG (itMap->second.m_rntiPerChunk.size () == m_phyMacConfig->GetTotalNumChunk (), "SINR chunk map must cover full BW in TDMA mode");
+			for (unsigned i = 0; i < itMap->second.m_rntiPerChunk.size (); i++)
+			{
+				itCqi = m_ueUlCqi.find (itMap->second.m_rntiPerChunk.at (i));
+				if (itCqi == m_ueUlCqi.end ())
+				{
+					// create a new entry
+					std::vector <double> newCqi;
+					for (unsigned j = 0; j < m_phyMacConfig->GetTotalNumChunk (); j++)
+					{
+						unsigned chunkInd = i;
+						if (chunkInd == j)
+						{
+							newCqi.push_back (params.m_ulCqi.m_sinr.at (i));
+							NS_LOG_INFO ("UL CQI report for RNTI " << itMap->second.m_rntiPerChunk.at (i) << " chunk " << i << " SINR " << params.m_ulCqi.m_sinr.at (i) << \
+							             " frame " << frameNum << " subframe " << subframeNum << " startSym " << startSymIdx);
+						}
+						else
+						{
+							// initialize with NO_SINR value.
+							newCqi.push_back (30.0);
+						}
+					}
+					m_ueUlCqi.insert (std::pair <uint16_t, struct UlCqiMapElem> (itMap->second.m_rntiPerChunk.at (i),
+					                                                             UlCqiMapElem (newCqi, itMap->second.m_numSym, itMap->second.m_tbSize)) );
+					// generate correspondent timer
+					m_ueCqiTimers.insert (std::pair <uint16_t, uint32_t > (itMap->second.m_rntiPerChunk.at (i), m_cqiTimersThreshold));
+				}
+				else
+				{
+					// update the value
+					(*itCqi).second.m_ueUlCqi.at (i) = params.m_ulCqi.m_sinr.at (i);
+					(*itCqi).second.m_numSym = itMap->second.m_numSym;
+					(*itCqi).second.m_tbSize = itMap->second.m_tbSize;
+					// update correspondent timer
+					std::map <uint16_t, uint32_t>::iterator itTimers;
+					itTimers = m_ueCqiTimers.find (itMap->second.m_rntiPerChunk.at (i));
+					(*itTimers).second = m_cqiTimersThreshold;
+
+					NS_LOG_INFO ("UL CQI report for RNTI " << itMap->second.m_rntiPerChunk.at (i) << " chunk " << i << " SINR " << params.m_ulCqi.m_sinr.at (i) << \
+					             " frame " << frameNum << " subframe " << subframeNum << " startSym " << startSymIdx);
+				}
+			}
+			// remove obsolete info on allocation
+			m_ulAllocationMap.erase (itMap);
+		}
+		break;
+		default:
+			NS_FATAL_ERROR ("Unknown type of UL-CQI");
+	}
+}
+
+uint8_t
+MmWaveFlexTtiSchedEngine::GetDlCqi (uint16_t rnti) const
+{
+	std::map <uint16_t,uint8_t>::const_iterator itCqi = m_wbCqiRxed.find (rnti);
+	if (itCqi != m_wbCqiRxed.end ())
+	{
+		return itCqi->second;
+	}
+	NS_LOG_INFO (this << " UE " << rnti << " does not have DL-CQI");
+	return 1; // lowest value for trying a transmission
+}
+
+int
+MmWaveFlexTtiSchedEngine::GetUlCqi (uint16_t rnti, int &mcs)
+{
+	std::map <uint16_t, struct UlCqiMapElem>::iterator itCqi = m_ueUlCqi.find (rnti);
+	if (itCqi == m_ueUlCqi.end ())
+	{
+		NS_LOG_INFO (this << " UE " << rnti << " does not have UL-CQI");
+		mcs = 0;
+		return 1;
+	}
+	// translate vector of doubles to SpectrumValue's
+	SpectrumValue &specVals = *m_ulCqiSinr;
+	Values::iterator specIt = specVals.ValuesBegin();
+	for (unsigned ichunk = 0; ichunk < m_phyMacConfig->GetTotalNumChunk (); ichunk++)
+	{
+		NS_ASSERT (specIt != specVals.ValuesEnd());
+		*specIt = itCqi->second.m_ueUlCqi.at (ichunk); //sinrLin;
+		specIt++;
+	}
+	// for UL CQI, we need to know the TB size previously allocated to accurately compute CQI/MCS
+	mcs = 0;
+	return m_amc->CreateCqiFeedbackWbTdma (specVals, itCqi->second.m_numSym, itCqi->second.m_tbSize, mcs);
+}
+
+void
+MmWaveFlexTtiSchedEngine::StartSubframe (const struct MmWaveMacSchedSapProvider::SchedTriggerReqParameters& params,
+                                         MmWaveMacSchedSapUser::SchedConfigIndParameters& ret,
+                                         int &symAvail, uint8_t &symIdx, uint8_t &slotIdx)
+{
+	ret.m_sfnSf = params.m_snfSf;
+	ret.m_sfAllocInfo.m_sfnSf = ret.m_sfnSf;
+	SfnSf ulSfn = ret.m_sfnSf;
+	if (ret.m_sfnSf.m_sfNum + m_phyMacConfig->GetUlSchedDelay () >=  m_phyMacConfig->GetSubframesPerFrame ())
+	{
+		ulSfn.m_frameNum++;
+	}
+	ulSfn.m_sfNum = (ret.m_sfnSf.m_sfNum + m_phyMacConfig->GetUlSchedDelay ()) % m_phyMacConfig->GetSubframesPerFrame ();
+	NS_LOG_DEBUG ("Scheduling DL frame "<< (unsigned)ret.m_sfnSf.m_frameNum << " subframe " << (unsigned)ret.m_sfnSf.m_sfNum
+	              << " UL frame " << (unsigned)ulSfn.m_frameNum << " subframe " << (unsigned)ulSfn.m_sfNum);
+
+	// add slot for DL control
+	SlotAllocInfo dlCtrlSlot (0, SlotAllocInfo::DL, SlotAllocInfo::CTRL, SlotAllocInfo::DIGITAL, 0);
+	dlCtrlSlot.m_dci.m_numSym = 1;
+	dlCtrlSlot.m_dci.m_symStart = 0;
+	ret.m_sfAllocInfo.m_slotAllocInfo.push_back (dlCtrlSlot);
+
+	symAvail = m_phyMacConfig->GetSymbolsPerSubframe () - m_phyMacConfig->GetDlCtrlSymbols() - m_phyMacConfig->GetUlCtrlSymbols();
+	slotIdx = 1;
+	symIdx = m_phyMacConfig->GetDlCtrlSymbols(); // symbols reserved for control at beginning of subframe
+
+	// process received CQIs
+	RefreshDlCqiMaps ();
+	RefreshUlCqiMaps ();
+
+	// Process DL HARQ feedback
+	RefreshHarqProcesses ();
+
+	// retrieve past HARQ retx buffered
+	m_dlHarqInfoList.insert (m_dlHarqInfoList.end (), params.m_dlHarqInfoList.begin (), params.m_dlHarqInfoList.end ());
+	m_ulHarqInfoList.insert (m_ulHarqInfoList.end (), params.m_ulHarqInfoList.begin (), params.m_ulHarqInfoList.end ());
+}
+
+void
+MmWaveFlexTtiSchedEngine::ScheduleHarqRetx (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret,
+                                            int &symAvail, uint8_t &symIdx, uint8_t &slotIdx)
+{
+	if (m_harqOn == false)		// Ignore HARQ feedback
+	{
+		m_dlHarqInfoList.clear ();
+		m_ulHarqInfoList.clear ();
+		return;
+	}
+
+	// Process DL HARQ feedback and assign slots for RETX if resources available
+	std::vector <struct DlHarqInfo> dlInfoListUntxed;  // TBs not able to be retransmitted in this sf
+	std::vector <struct UlHarqInfo> ulInfoListUntxed;
+
+	for (unsigned i = 0; i < m_dlHarqInfoList.size (); i++)
+	{
+		if (symAvail == 0)
+		{
+			break;	// no symbols left to allocate
+		}
+		uint8_t harqId = m_dlHarqInfoList.at (i).m_harqProcessId;
+		uint16_t rnti = m_dlHarqInfoList.at (i).m_rnti;
+		UeSchedInfo *ue = GetUe (rnti);
+		if (ue == 0)
+		{
+			NS_LOG_ERROR ("No HARQ status info found for UE (might have changed eNB) " << rnti);
+			continue;
+		}
+		if(m_dlHarqInfoList.at (i).m_harqStatus == DlHarqInfo::ACK || ue->m_dlHarqProcessesStatus.at (harqId) == 0)
+		{ // acknowledgment or process timeout, reset process
+			ue->m_dlHarqProcessesStatus.at (harqId) = 0;    // release process ID
+			ue->m_dlHarqProcessesRlcPdu.at (harqId).clear ();		// clear RLC buffers
+			continue;
+		}
+		else if(m_dlHarqInfoList.at (i).m_harqStatus == DlHarqInfo::NACK)
+		{
+			DciInfoElementTdma dciInfoReTx = ue->m_dlHarqProcessesDciInfo.at (harqId);
+			NS_ASSERT (harqId == dciInfoReTx.m_harqProcess);
+			NS_ASSERT(ue->m_dlHarqProcessesStatus.at (harqId)-1 == dciInfoReTx.m_rv);
+			if (dciInfoReTx.m_rv == 3) // maximum number of retx reached -> drop process
+			{
+				NS_LOG_INFO ("Max number of retransmissions reached -> drop process");
+				ue->m_dlHarqProcessesStatus.at (harqId) = 0;
+				ue->m_dlHarqProcessesRlcPdu.at (harqId).clear ();
+				continue;
+			}
+			// allocate retx if enough symbols are available
+			if (symAvail >= dciInfoReTx.m_numSym)
+			{
+				symAvail -= dciInfoReTx.m_numSym;
+				dciInfoReTx.m_symStart = symIdx;
+				symIdx += dciInfoReTx.m_numSym;
+				NS_ASSERT (symIdx <= m_phyMacConfig->GetSymbolsPerSubframe () - m_phyMacConfig->GetUlCtrlSymbols ());
+				dciInfoReTx.m_rv++;
+				dciInfoReTx.m_ndi = 0;
+				ue->m_dlHarqProcessesDciInfo.at (harqId) = dciInfoReTx;
+				ue->m_dlHarqProcessesStatus.at (harqId) = ue->m_dlHarqProcessesStatus.at (harqId) + 1;
+				SlotAllocInfo slotInfo (slotIdx++, SlotAllocInfo::DL, SlotAllocInfo::CTRL_DATA, SlotAllocInfo::DIGITAL, rnti);
+				slotInfo.m_dci = dciInfoReTx;
+				NS_LOG_DEBUG ("UE" << dciInfoReTx.m_rnti << " gets DL slots " << (unsigned)dciInfoReTx.m_symStart << "-" << (unsigned)(dciInfoReTx.m_symStart+dciInfoReTx.m_numSym-1) <<
+				              " tbs " << dciInfoReTx.m_tbSize << " harqId " << (unsigned)dciInfoReTx.m_harqProcess <<
+				              " rv " << (unsigned)dciInfoReTx.m_rv << " in frame " << ret.m_sfnSf.m_frameNum << " subframe " << (unsigned)ret.m_sfnSf.m_sfNum << " RETX");
+				slotInfo.m_rlcPduInfo = ue->m_dlHarqProcessesRlcPdu.at (dciInfoReTx.m_harqProcess);
+				ret.m_sfAllocInfo.m_slotAllocInfo.push_back (slotInfo);
+				ret.m_sfAllocInfo.m_numSymAlloc += dciInfoReTx.m_numSym;
+
+				ue->m_dlSymbolsRetx = dciInfoReTx.m_numSym;
+				AddAllocatedUe (ue);
+			}
+			else
+			{
+				NS_LOG_INFO ("No resource for this retx -> buffer it");
+				dlInfoListUntxed.push_back (m_dlHarqInfoList.at (i));
+			}
+		}
+	}
+
+	m_dlHarqInfoList.swap (dlInfoListUntxed);
+
+	// Process UL HARQ feedback
+	for (uint16_t i = 0; i < m_ulHarqInfoList.size (); i++)
+	{
+		if (symAvail == 0)
+		{
+			break;	// no symbols left to allocate
+		}
+		UlHarqInfo harqInfo = m_ulHarqInfoList.at (i);
+		uint8_t harqId = harqInfo.m_harqProcessId;
+		uint16_t rnti = harqInfo.m_rnti;
+		UeSchedInfo *ue = GetUe (rnti);
+		if (ue == 0)
+		{
+			NS_LOG_ERROR ("No info found in HARQ buffer for UE (might have changed eNB) " << rnti);
+			continue;
+		}
+		if (harqInfo.m_receptionStatus == UlHarqInfo::Ok || ue->m_ulHarqProcessesStatus.at (harqId) == 0)
+		{
+			ue->m_ulHarqProcessesStatus.at (harqId) = 0;  // release process ID
+		}
+		else if (harqInfo.m_receptionStatus == UlHarqInfo::NotOk)
+		{
+			// retx correspondent block: retrieve the UL-DCI
+			DciInfoElementTdma dciInfoReTx = ue->m_ulHarqProcessesDciInfo.at (harqId);
+			NS_ASSERT (harqId == dciInfoReTx.m_harqProcess);
+			NS_ASSERT(ue->m_ulHarqProcessesStatus.at (harqId) > 0);
+			NS_ASSERT(ue->m_ulHarqProcessesStatus.at (harqId)-1 == dciInfoReTx.m_rv);
+			if (dciInfoReTx.m_rv == 3)
+			{
+				NS_LOG_INFO ("Max number of retransmissions reached (UL)-> drop process");
+				ue->m_ulHarqProcessesStatus.at (harqId) = 0;
+				continue;
+			}
+
+			if (symAvail >= dciInfoReTx.m_numSym)
+			{
+				symAvail -= dciInfoReTx.m_numSym;
+				dciInfoReTx.m_symStart = symIdx;
+				symIdx += dciInfoReTx.m_numSym;
+				NS_ASSERT (symIdx <= m_phyMacConfig->GetSymbolsPerSubframe () - m_phyMacConfig->GetUlCtrlSymbols ());
+				dciInfoReTx.m_rv++;
+				dciInfoReTx.m_ndi = 0;
+				ue->m_ulHarqProcessesStatus.at (harqId) = ue->m_ulHarqProcessesStatus.at (harqId) + 1;
+				ue->m_ulHarqProcessesDciInfo.at (harqId) = dciInfoReTx;
+				SlotAllocInfo slotInfo (slotIdx++, SlotAllocInfo::UL, SlotAllocInfo::CTRL_DATA, SlotAllocInfo::DIGITAL, rnti);
+				slotInfo.m_dci = dciInfoReTx;
+				NS_LOG_DEBUG ("UE" << dciInfoReTx.m_rnti << " gets UL slots " << (unsigned)dciInfoReTx.m_symStart << "-" << (unsigned)(dciInfoReTx.m_symStart+dciInfoReTx.m_numSym-1) <<
+				              " tbs " << dciInfoReTx.m_tbSize << " harqId " << (unsigned)dciInfoReTx.m_harqProcess << " rv " << (unsigned)dciInfoReTx.m_rv <<
+				              " in frame " << ret.m_sfnSf.m_frameNum << " subframe " << (unsigned)ret.m_sfnSf.m_sfNum << " RETX");
+				ret.m_sfAllocInfo.m_slotAllocInfo.push_back (slotInfo);
+				ret.m_sfAllocInfo.m_numSymAlloc += dciInfoReTx.m_numSym;
+
+				ue->m_ulSymbolsRetx = dciInfoReTx.m_numSym;
+				AddAllocatedUe (ue);
+			}
+			else
+			{
+				ulInfoListUntxed.push_back (m_ulHarqInfoList.at (i));
+			}
+		}
+	}
+
+	m_ulHarqInfoList.swap (ulInfoListUntxed);
+}
+
+void
+MmWaveFlexTtiSchedEngine::SortAllocatedUes ()
+{
+	std::sort (m_allocatedUes.begin (), m_allocatedUes.end (), CompareRnti);
+}
+
+bool
+MmWaveFlexTtiSchedEngine::HasBufferedData (const UeSchedInfo *ue)
+{
+	for (unsigned iflow = 0; iflow < ue->m_flowStatsDl.size (); iflow++)
+	{
+		if (ue->m_flowStatsDl[iflow].m_totalBufSize > 0)
+		{
+			return true;
+		}
+	}
+	for (unsigned iflow = 0; iflow < ue->m_flowStatsUl.size (); iflow++)
+	{
+		if (ue->m_flowStatsUl[iflow].m_totalBufSize > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+MmWaveFlexTtiSchedEngine::ActivateUe (UeSchedInfo *ue)
+{
+	if (!ue->m_active)
+	{
+		ue->m_active = true;
+		if (!m_activeUes.empty () && m_activeUes.back ()->m_rnti > ue->m_rnti)
+		{
+			m_activeUesSorted = false;
+		}
+		m_activeUes.push_back (ue);
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::PrepareNewData (UeSchedInfo *ue, bool &dlOk, bool &ulOk)
+{
+	// get DL-CQI and compute DL rate per symbol
+	uint8_t cqi = GetDlCqi (ue->m_rnti);
+	dlOk = (cqi != 0);
+	if (dlOk)
+	{
+		ue->m_dlMcs = m_amc->GetMcsFromCqi (cqi);  // update MCS
+		// compute total DL bytes buffered
+		for (unsigned iflow = 0; iflow < ue->m_flowStatsDl.size(); iflow++)
+		{
+			if (ue->m_flowStatsDl[iflow].m_totalBufSize > 0)
+			{
+				ue->m_totBufDl += ue->m_flowStatsDl[iflow].m_totalBufSize;
+				RlcPduInfo newRlcEl;
+				newRlcEl.m_lcid = ue->m_flowStatsDl[iflow].m_lcid;
+				newRlcEl.m_size = ue->m_flowStatsDl[iflow].m_totalBufSize;
+				ue->m_rlcPduInfo.push_back (newRlcEl);
+			}
+		}
+		if (ue->m_totBufDl > 0)
+		{
+			uint32_t tbSizeMax = m_amc->GetTbSizeFromMcsSymbols (ue->m_dlMcs, 1);
+			ue->m_currTputDl = std::min(ue->m_totBufDl,tbSizeMax) / m_sfPeriod;
+		}
+	}
+
+	// get UL-CQI and compute UL rate per symbol
+	int mcs = 0;
+	ulOk = (GetUlCqi (ue->m_rnti, mcs) != 0);
+	if (ulOk)
+	{
+		ue->m_ulMcs = mcs;
+		for (unsigned iflow = 0; iflow < ue->m_flowStatsUl.size(); iflow++)
+		{
+			ue->m_totBufUl += ue->m_flowStatsUl[iflow].m_totalBufSize;
+		}
+		if (ue->m_totBufUl > 0)
+		{
+			uint32_t tbSizeMax = m_amc->GetTbSizeFromMcsSymbols (ue->m_ulMcs, 1);
+			ue->m_currTputUl = std::min(ue->m_totBufUl,tbSizeMax) / m_sfPeriod;
+		}
+	}
+
+	if ((dlOk && ue->m_totBufDl > 0) || (ulOk && ue->m_totBufUl > 0))
+	{
+		AddAllocatedUe (ue);
+	}
+}
+
+bool
+MmWaveFlexTtiSchedEngine::Grant (UeSchedInfo *ue)
+{
+	if (!UpdateDone (ue))
+	{
+		return false;
+	}
+	if ((ue->m_allocUlLast || ue->m_dlAllocDone) && !ue->m_ulAllocDone)
+	{
+		ue->m_ulSymbols++;
+		uint32_t tbSize = m_amc->GetTbSizeFromMcsSymbols (ue->m_ulMcs, ue->m_ulSymbols);
+		ue->m_ulTbSize = tbSize / 8;
+		if (ue->m_ulTbSize >= ue->m_totBufUl)
+		{
+			ue->m_ulAllocDone = true;
+			ue->m_lastAvgTputUl = ue->m_avgTputUl;
+		}
+		ue->m_allocUlLast = true;
+		ue->m_currTputUl = std::min (ue->m_totBufUl, tbSize) / m_sfPeriod;
+		ue->m_avgTputUl = ((1.0 - (1.0 / m_timeWindow)) * ue->m_lastAvgTputUl) +
+				((1.0 / m_timeWindow) * ((double)ue->m_ulTbSize / m_sfPeriod));
+	}
+	else
+	{
+		ue->m_dlSymbols++;
+		uint32_t tbSize = m_amc->GetTbSizeFromMcsSymbols (ue->m_dlMcs, ue->m_dlSymbols);
+		ue->m_dlTbSize = tbSize / 8;
+		if (ue->m_dlTbSize >= ue->m_totBufDl)
+		{
+			ue->m_dlAllocDone = true;
+			ue->m_lastAvgTputDl = ue->m_avgTputDl;
+		}
+		ue->m_allocUlLast = false;
+		ue->m_currTputDl = std::min (ue->m_totBufDl, tbSize) / m_sfPeriod;
+		ue->m_avgTputDl = ((1.0 - (1.0 / m_timeWindow)) * ue->m_lastAvgTputDl) +
+				((1.0 / m_timeWindow) * ((double)ue->m_dlTbSize / m_sfPeriod));
+	}
+	return true;
+}
+
+void
+MmWaveFlexTtiSchedEngine::CreateDcis (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, uint8_t &symIdx, uint8_t &slotIdx)
+{
+	SortAllocatedUes ();
+	for (unsigned i = 0; i < m_allocatedUes.size (); i++)
+	{
+		if (m_allocatedUes[i]->m_dlSymbols > 0)
+		{
+			CreateDlDci (ret, m_allocatedUes[i], symIdx, slotIdx);
+		}
+	}
+	slotIdx = ret.m_sfAllocInfo.m_slotAllocInfo.back ().m_slotIdx + 1;
+	symIdx = ret.m_sfAllocInfo.m_slotAllocInfo.back ().m_dci.m_symStart + ret.m_sfAllocInfo.m_slotAllocInfo.back ().m_dci.m_numSym;
+
+	for (unsigned i = 0; i < m_allocatedUes.size (); i++)
+	{
+		// Note: UL-DCI applies to subframe i+Tsched
+		if (m_allocatedUes[i]->m_ulSymbols > 0)
+		{
+			CreateUlDci (ret, m_allocatedUes[i], symIdx, slotIdx);
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::CreateDlDci (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, UeSchedInfo *ue, uint8_t &symIdx, uint8_t &slotIdx)
+{
+	DciInfoElementTdma dci;
+	dci.m_rnti = ue->m_rnti;
+	dci.m_format = 0;
+	dci.m_symStart = symIdx;
+	dci.m_numSym = ue->m_dlSymbols;
+	symIdx += ue->m_dlSymbols;
+	NS_ASSERT (symIdx <= m_phyMacConfig->GetSymbolsPerSubframe () - m_phyMacConfig->GetUlCtrlSymbols ());
+	dci.m_mcs = ue->m_dlMcs;
+	dci.m_rv = 0;
+	dci.m_ndi = 1;
+	dci.m_tbSize = m_amc->GetTbSizeFromMcsSymbols (dci.m_mcs, dci.m_numSym) / 8;
+	dci.m_harqProcess = UpdateDlHarqProcessId (ue);
+	NS_ASSERT (dci.m_harqProcess < m_phyMacConfig->GetNumHarqProcess ());
+	SlotAllocInfo slotInfo (slotIdx++, SlotAllocInfo::DL, SlotAllocInfo::CTRL_DATA, SlotAllocInfo::DIGITAL, ue->m_rnti);
+	slotInfo.m_dci = dci;
+	NS_LOG_DEBUG ("UE" << dci.m_rnti << " gets DL symbols " << (unsigned)dci.m_symStart << "-" << (unsigned)(dci.m_symStart+dci.m_numSym-1) <<
+	              " tbs " << dci.m_tbSize << " mcs " << (unsigned)dci.m_mcs << " harqId " << (unsigned)dci.m_harqProcess << " rv " << (unsigned)dci.m_rv << " in frame " << ret.m_sfnSf.m_frameNum << " subframe " << (unsigned)ret.m_sfnSf.m_sfNum);
+
+	if (m_harqOn == true)
+	{	// store DCI for HARQ buffer
+		ue->m_dlHarqProcessesDciInfo.at (dci.m_harqProcess) = dci;
+		// refresh timer
+		ue->m_dlHarqProcessesTimer.at (dci.m_harqProcess) = 0;
+	}
+
+	std::vector <struct RlcPduInfo> &rlcPduInfo = ue->m_rlcPduInfo;
+	if (m_dlRlcSplit == EVEN_SPLIT)
+	{
+		// distribute bytes between active RLC queues
+		unsigned numLc = rlcPduInfo.size ();
+		unsigned bytesRem = dci.m_tbSize;
+		unsigned numFulfilled = 0;
+		uint16_t avgPduSize = bytesRem / numLc;
+		// first for loop computes extra to add to average if some flows are less than average
+		for (unsigned i = 0; i < rlcPduInfo.size (); i++)
+		{
+			if (rlcPduInfo[i].m_size < avgPduSize)
+			{
+				bytesRem -= rlcPduInfo[i].m_size;
+				numFulfilled++;
+			}
+		}
+
+		if (numFulfilled < rlcPduInfo.size ())
+		{
+			avgPduSize = bytesRem / (rlcPduInfo.size () - numFulfilled);
+		}
+
+		for (unsigned i = 0; i < rlcPduInfo.size (); i++)
+		{
+			if (rlcPduInfo[i].m_size > avgPduSize)
+			{
+				rlcPduInfo[i].m_size = avgPduSize;
+			}
+			// else tbSize equals RLC queue size
+			NS_ASSERT(rlcPduInfo[i].m_size > 0);
+			// update RLC buffer info with expected queue size after scheduling
+			UpdateDlRlcBufferInfo (ue->m_rnti, rlcPduInfo[i].m_lcid, rlcPduInfo[i].m_size-m_subHdrSize);
+		}
+	}
+	else
+	{
+		unsigned totalBytesAlloc = 0;
+		for (unsigned i = 0; i < rlcPduInfo.size (); i++)
+		{
+			totalBytesAlloc += rlcPduInfo[i].m_size;
+		}
+		for (unsigned i = 0; i < rlcPduInfo.size (); i++)
+		{
+			// give remaining bytes to default bearer
+			if (rlcPduInfo[i].m_lcid == 3 && totalBytesAlloc < dci.m_tbSize)
+			{
+				rlcPduInfo[i].m_size += dci.m_tbSize-totalBytesAlloc;
+			}
+		}
+	}
+	slotInfo.m_rlcPduInfo.insert (slotInfo.m_rlcPduInfo.end (), rlcPduInfo.begin (), rlcPduInfo.end ());
+	if (m_harqOn == true)
+	{
+		// store RLC PDU list for HARQ
+		std::vector <struct RlcPduInfo> &harqRlcPdu = ue->m_dlHarqProcessesRlcPdu.at (dci.m_harqProcess);
+		harqRlcPdu.insert (harqRlcPdu.end (), rlcPduInfo.begin (), rlcPduInfo.end ());
+	}
+
+	// reorder/reindex slots to maintain DL before UL slot order
+	bool reordered = false;
+	std::deque <SlotAllocInfo>::iterator itSlot = ret.m_sfAllocInfo.m_slotAllocInfo.begin ();
+	for (unsigned islot = 0; islot < ret.m_sfAllocInfo.m_slotAllocInfo.size (); islot++)
+	{
+		if (ret.m_sfAllocInfo.m_slotAllocInfo [islot].m_tddMode == SlotAllocInfo::UL)
+		{
+			slotInfo.m_slotIdx = ret.m_sfAllocInfo.m_slotAllocInfo [islot].m_slotIdx;
+			slotInfo.m_dci.m_symStart = ret.m_sfAllocInfo.m_slotAllocInfo [islot].m_dci.m_symStart;
+			ret.m_sfAllocInfo.m_slotAllocInfo.insert (itSlot, slotInfo);
+			for (unsigned jslot = islot+1; jslot < ret.m_sfAllocInfo.m_slotAllocInfo.size (); jslot++)
+			{
+				ret.m_sfAllocInfo.m_slotAllocInfo[jslot].m_slotIdx++;	// increase indices of UL slots
+				ret.m_sfAllocInfo.m_slotAllocInfo[jslot].m_dci.m_symStart =
+						ret.m_sfAllocInfo.m_slotAllocInfo[jslot-1].m_dci.m_symStart +
+						ret.m_sfAllocInfo.m_slotAllocInfo[jslot-1].m_dci.m_numSym;
+			}
+			reordered = true;
+			break;
+		}
+		itSlot++;
+	}
+	if (!reordered)
+	{
+		ret.m_sfAllocInfo.m_slotAllocInfo.push_back (slotInfo);
+	}
+	ret.m_sfAllocInfo.m_numSymAlloc += dci.m_numSym;
+}
+
+void
+MmWaveFlexTtiSchedEngine::CreateUlDci (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, UeSchedInfo *ue, uint8_t &symIdx, uint8_t &slotIdx)
+{
+	DciInfoElementTdma dci;
+	dci.m_rnti = ue->m_rnti;
+	dci.m_format = 1;
+	dci.m_symStart = symIdx;
+	dci.m_numSym = ue->m_ulSymbols;
+	symIdx += ue->m_ulSymbols;
+	NS_ASSERT (symIdx <= m_phyMacConfig->GetSymbolsPerSubframe () - m_phyMacConfig->GetUlCtrlSymbols ());
+	dci.m_mcs = ue->m_ulMcs;
+	dci.m_ndi = 1;
+	dci.m_tbSize = m_amc->GetTbSizeFromMcsSymbols (dci.m_mcs, dci.m_numSym) / 8;
+	dci.m_harqProcess = UpdateUlHarqProcessId (ue);
+	NS_ASSERT (dci.m_harqProcess < m_phyMacConfig->GetNumHarqProcess ());
+	SlotAllocInfo slotInfo (slotIdx++, SlotAllocInfo::UL, SlotAllocInfo::CTRL_DATA, SlotAllocInfo::DIGITAL, ue->m_rnti);
+	slotInfo.m_dci = dci;
+	NS_LOG_DEBUG ("UE" << dci.m_rnti << " gets UL symbols " << (unsigned)dci.m_symStart << "-" << (unsigned)(dci.m_symStart+dci.m_numSym-1) <<
+	              " tbs " << dci.m_tbSize << " mcs " << (unsigned)dci.m_mcs << " harqId " << (unsigned)dci.m_harqProcess << " rv " << (unsigned)dci.m_rv << " in frame " << ret.m_sfnSf.m_frameNum << " subframe " << (unsigned)ret.m_sfnSf.m_sfNum);
+	UpdateUlRlcBufferInfo (ue->m_rnti, dci.m_tbSize - m_subHdrSize);
+	ret.m_sfAllocInfo.m_slotAllocInfo.push_back (slotInfo);
+	ret.m_sfAllocInfo.m_numSymAlloc += dci.m_numSym;
+	std::vector<uint16_t> ueChunkMap (m_phyMacConfig->GetTotalNumChunk (), dci.m_rnti);
+	SfnSf slotSfn = ret.m_sfAllocInfo.m_sfnSf;
+	slotSfn.m_slotNum = dci.m_symStart;  // use the start symbol index of the slot because the absolute UL slot index depends on the future DL allocation
+	// insert into allocation map to recall previous allocations upon receiving UL-CQI
+	m_ulAllocationMap.insert ( std::pair<uint32_t, struct AllocMapElem> (slotSfn.Encode (), AllocMapElem(ueChunkMap, dci.m_numSym, dci.m_tbSize)) );
+
+	if (m_harqOn == true)
+	{
+		uint8_t harqId = dci.m_harqProcess;
+		ue->m_ulHarqProcessesDciInfo.at (harqId) = dci;
+		// Update HARQ process status (RV 0)
+		NS_ASSERT (ue->m_ulHarqProcessesStatus[harqId] > 0);
+		// refresh timer
+		ue->m_ulHarqProcessesTimer.at (harqId) = 0;
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::EndSubframe (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, bool newData)
+{
+	// add slot for UL control
+	SlotAllocInfo ulCtrlSlot (0xFF, SlotAllocInfo::UL, SlotAllocInfo::CTRL, SlotAllocInfo::DIGITAL, 0);
+	ulCtrlSlot.m_dci.m_numSym = 1;
+	ulCtrlSlot.m_dci.m_symStart = m_phyMacConfig->GetSymbolsPerSubframe()-1;
+	ret.m_sfAllocInfo.m_slotAllocInfo.push_back (ulCtrlSlot);
+
+	// reset the alloc info for the next scheduler call
+	for (unsigned i = 0; i < m_allocatedUes.size (); i++)
+	{
+		UeSchedInfo *ue = m_allocatedUes[i];
+		ue->m_dlSymbolsRetx = 0;
+		ue->m_ulSymbolsRetx = 0;
+		if (newData)
+		{
+			ue->m_dlSymbols = 0;
+			ue->m_ulSymbols = 0;
+			ue->m_dlTbSize = 0;
+			ue->m_ulTbSize = 0;
+			ue->m_maxDlBufSize = 0;
+			ue->m_maxUlBufSize = 0;
+			ue->m_maxDlSymbols = 0;
+			ue->m_maxUlSymbols = 0;
+			ue->m_currTputDl = 0;
+			ue->m_currTputUl = 0;
+			ue->m_avgTputDl = 0;
+			ue->m_avgTputUl = 0;
+			ue->m_totBufDl = 0;
+			ue->m_totBufUl = 0;
+			ue->m_dlAllocDone = false;
+			ue->m_ulAllocDone = false;
+			ue->m_rlcPduInfo.clear ();
+		}
+		ue->m_allocated = false;
+	}
+	m_allocatedUes.clear ();
+}
+
+unsigned
+MmWaveFlexTtiSchedEngine::CalcMinTbSizeNumSym (unsigned mcs, unsigned bufSize, unsigned &tbSize)
+{
+	// bisection line search to find minimum number of slots needed to encode entire buffer
+	int numSymLow = 0;
+	int numSymHigh = m_phyMacConfig->GetSymbolsPerSubframe();
+
+	int diff = 0;
+	tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymHigh) / 8); // start with max value
+	while ((unsigned)tbSize > bufSize)
+	{
+		diff = abs(numSymHigh-numSymLow)/2;
+		if (diff == 0)
+		{
+			tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymHigh) / 8);
+			return numSymHigh;
+		}
+		tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymHigh - diff) / 8);
+		if ((unsigned)tbSize > bufSize)
+		{
+			numSymHigh -= diff;
+		}
+		while ((unsigned)tbSize < bufSize)
+		{
+			diff = abs(numSymHigh-numSymLow)/2;
+			if (diff == 0)
+			{
+				tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymHigh) / 8);
+				return numSymHigh;
+			}
+			tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymLow + diff) / 8);
+			if ((unsigned)tbSize < bufSize)
+			{
+				numSymLow += diff;
+			}
+		}
+	}
+
+	tbSize = (m_amc->GetTbSizeFromMcsSymbols (mcs, numSymHigh) / 8);
+	return (unsigned)numSymHigh;
+}
+
+void
+MmWaveFlexTtiSchedEngine::RefreshDlCqiMaps ()
+{
+	NS_LOG_FUNCTION (this << m_wbCqiTimers.size ());
+	// refresh DL CQI P01 Map
+	std::map <uint16_t,uint32_t>::iterator itP10 = m_wbCqiTimers.begin ();
+	while (itP10 != m_wbCqiTimers.end ())
+	{
+		NS_LOG_INFO (this << " P10-CQI for user " << (*itP10).first << " is " << (uint32_t)(*itP10).second << " thr " << (uint32_t)m_cqiTimersThreshold);
+		if ((*itP10).second == 0)
+		{
+			// delete correspondent entries
+			std::map <uint16_t,uint8_t>::iterator itMap = m_wbCqiRxed.find ((*itP10).first);
+			NS_ASSERT_MSG (itMap != m_wbCqiRxed.end (), " Does not find CQI report for user " << (*itP10).first);
+			NS_LOG_INFO (this << " P10-CQI exired for user " << (*itP10).first);
+			m_wbCqiRxed.erase (itMap);
+			m_wbCqiTimers.erase (itP10++);
+		}
+		else
+		{
+			(*itP10).second--;
+			itP10++;
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::RefreshUlCqiMaps ()
+{
+	// refresh UL CQI  Map
+	std::map <uint16_t,uint32_t>::iterator itUl = m_ueCqiTimers.begin ();
+	while (itUl != m_ueCqiTimers.end ())
+	{
+		NS_LOG_INFO (this << " UL-CQI for user " << (*itUl).first << " is " << (uint32_t)(*itUl).second << " thr " << (uint32_t)m_cqiTimersThreshold);
+		if ((*itUl).second == 0)
+		{
+			// delete correspondent entries
+			std::map <uint16_t, struct UlCqiMapElem>::iterator itMap = m_ueUlCqi.find ((*itUl).first);
+			NS_ASSERT_MSG (itMap != m_ueUlCqi.end (), " Does not find CQI report for user " << (*itUl).first);
+			NS_LOG_INFO (this << " UL-CQI expired for user " << (*itUl).first);
+			m_ueUlCqi.erase (itMap);
+			m_ueCqiTimers.erase (itUl++);
+		}
+		else
+		{
+			(*itUl).second--;
+			itUl++;
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::RefreshHarqProcesses ()
+{
+	NS_LOG_FUNCTION (this);
+
+	uint8_t harqTimeout = m_phyMacConfig->GetHarqTimeout ();
+	for (unsigned iue = 0; iue < m_ues.size (); iue++)
+	{
+		UeSchedInfo *ue = m_ues[iue];
+		for (unsigned i = 0; i < ue->m_dlHarqProcessesTimer.size (); i++)
+		{
+			if (ue->m_dlHarqProcessesTimer[i] == harqTimeout)
+			{ // reset HARQ process
+				NS_LOG_INFO (this << " Reset HARQ proc " << i << " for RNTI " << ue->m_rnti);
+				ue->m_dlHarqProcessesStatus[i] = 0;
+				ue->m_dlHarqProcessesTimer[i] = 0;
+			}
+			else
+			{
+				ue->m_dlHarqProcessesTimer[i]++;
+			}
+		}
+		for (unsigned i = 0; i < ue->m_ulHarqProcessesTimer.size (); i++)
+		{
+			if (ue->m_ulHarqProcessesTimer[i] == harqTimeout)
+			{ // reset HARQ process
+				NS_LOG_INFO (this << " Reset HARQ proc " << i << " for RNTI " << ue->m_rnti);
+				ue->m_ulHarqProcessesStatus[i] = 0;
+				ue->m_ulHarqProcessesTimer[i] = 0;
+			}
+			else
+			{
+				ue->m_ulHarqProcessesTimer[i]++;
+			}
+		}
+	}
+}
+
+uint8_t
+MmWaveFlexTtiSchedEngine::UpdateDlHarqProcessId (UeSchedInfo *ue)
+{
+	if (m_harqOn == false)
+	{
+		uint8_t tbUid = m_tbUid;
+		m_tbUid = (m_tbUid+1) % m_phyMacConfig->GetNumHarqProcess ();
+		return tbUid;
+	}
+
+	// search for available process ID, if none available return numHarqProcess
+	uint8_t harqId = m_phyMacConfig->GetNumHarqProcess ();
+	for (unsigned i = 0; i < ue->m_dlHarqProcessesStatus.size (); i++)
+	{
+		if (ue->m_dlHarqProcessesStatus[i] == 0)
+		{
+			ue->m_dlHarqProcessesStatus[i] = 1;
+			harqId = i;
+			break;
+		}
+	}
+	return harqId;
+}
+
+uint8_t
+MmWaveFlexTtiSchedEngine::UpdateUlHarqProcessId (UeSchedInfo *ue)
+{
+	if (m_harqOn == false)
+	{
+		uint8_t tbUid = m_tbUid;
+		m_tbUid = (m_tbUid+1) % m_phyMacConfig->GetNumHarqProcess ();
+		return tbUid;
+	}
+
+	// search for available process ID, if none available return numHarqProcess
+	uint8_t harqId = m_phyMacConfig->GetNumHarqProcess ();
+	for (unsigned i = 0; i < ue->m_ulHarqProcessesStatus.size (); i++)
+	{
+		if (ue->m_ulHarqProcessesStatus[i] == 0)
+		{
+			ue->m_ulHarqProcessesStatus[i] = 1;
+			harqId = i;
+			break;
+		}
+	}
+	return harqId;
+}
+
+void
+MmWaveFlexTtiSchedEngine::UpdateDlRlcBufferInfo (uint16_t rnti, uint8_t lcid, uint16_t size)
+{
+	std::list<MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters>::iterator it;
+	for (it = m_rlcBufferReq.begin (); it != m_rlcBufferReq.end (); it++)
+	{
+		if (((*it).m_rnti == rnti) && ((*it).m_logicalChannelIdentity == lcid))
+		{
+			NS_LOG_INFO (this << " UE " << rnti << " LC " << (uint16_t)lcid << " txqueue " << (*it).m_rlcTransmissionQueueSize << " retxqueue " << (*it).m_rlcRetransmissionQueueSize << " status " << (*it).m_rlcStatusPduSize << " decrease " << size);
+			// Update queues: RLC tx order Status, ReTx, Tx
+			// Update status queue
+			if (((*it).m_rlcStatusPduSize > 0) && (size >= (*it).m_rlcStatusPduSize))
+			{
+				(*it).m_rlcStatusPduSize = 0;
+			}
+
+			if ((*it).m_rlcRetransmissionQueueSize > 0)
+			{
+				if ((*it).m_rlcRetransmissionQueueSize <= (unsigned)(size - (*it).m_rlcStatusPduSize))
+				{
+					(*it).m_rlcRetransmissionQueueSize = 0;
+				}
+				else
+				{
+					(*it).m_rlcRetransmissionQueueSize -= (size - (*it).m_rlcStatusPduSize);
+				}
+			}
+			else if ((*it).m_rlcTransmissionQueueSize > 0)
+			{
+				uint32_t rlcOverhead;
+				if (lcid == 1)
+				{
+					// for SRB1 (using RLC AM) it's better to
+					// overestimate RLC overhead rather than
+					// underestimate it and risk unneeded
+					// segmentation which increases delay
+					rlcOverhead = 4;
+				}
+				else
+				{
+					// minimum RLC overhead due to header
+					rlcOverhead = 2;
+				}
+				// update transmission queue
+				if ((*it).m_rlcTransmissionQueueSize <= (size - rlcOverhead - (*it).m_rlcStatusPduSize))
+				{
+					(*it).m_rlcTransmissionQueueSize = 0;
+				}
+				else
+				{
+					(*it).m_rlcTransmissionQueueSize -= (size - rlcOverhead - (*it).m_rlcStatusPduSize);
+				}
+			}
+			return;
+		}
+	}
+}
+
+void
+MmWaveFlexTtiSchedEngine::UpdateUlRlcBufferInfo (uint16_t rnti, uint16_t size)
+{
+	// only the schedulers that keep the BSRs (StoreBsr) track the UL buffers
+	std::map <uint16_t,uint32_t>::iterator it = m_ceBsrRxed.find (rnti);
+	if (it != m_ceBsrRxed.end ())
+	{
+		size = size - 2; // remove the minimum RLC overhead
+		NS_LOG_INFO (this << " Update RLC BSR UE " << rnti << " size " << size << " BSR " << (*it).second);
+		if ((*it).second >= size)
+		{
+			(*it).second -= size;
+		}
+		else
+		{
+			(*it).second = 0;
+		}
+	}
+}
+
+}
@@ -0,0 +1,881 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SRC_MMWAVE_MODEL_MMWAVE_FLEX_TTI_SCHED_ENGINE_H_
+#define SRC_MMWAVE_MODEL_MMWAVE_FLEX_TTI_SCHED_ENGINE_H_
+
+#include <ns3/ptr.h>
+#include <ns3/assert.h>
+#include "mmwave-amc.h"
+#include "mmwave-phy-mac-common.h"
+#include "mmwave-mac-sched-sap.h"
+#include "mmwave-mac-csched-sap.h"
+#include <vector>
+#include <deque>
+#include <list>
+#include <map>
+#include <algorithm>
+
+namespace ns3 {
+
+/**
+ * \brief Binary max-heap of items identified by an index, with the position of each item kept
+ * so that its key can be changed or the item removed in O(log N) instead of ranking all the
+ * items again. The ties are broken by the lowest index
+ */
+class MmWaveIndexedHeap
+{
+public:
+	/**
+	 * Number of item indices that can be used, the items in the heap are kept
+	 * @params the number of items
+	 */
+	void Resize (unsigned numItems)
+	{
+		m_pos.resize (numItems, NOT_IN_HEAP);
+		m_keys.resize (numItems, 0.0);
+	}
+
+	/**
+	 * Remove all the items, in O(size of the heap)
+	 */
+	void Clear ()
+	{
+		for (unsigned i = 0; i < m_heap.size (); i++)
+		{
+			m_pos[m_heap[i]] = NOT_IN_HEAP;
+		}
+		m_heap.clear ();
+	}
+
+	bool IsEmpty () const
+	{
+		return m_heap.empty ();
+	}
+
+	unsigned GetSize () const
+	{
+		return m_heap.size ();
+	}
+
+	/**
+	 * @params a position in the heap, lower than GetSize
+	 * @returns the item at the position, to visit the items in no particular order
+	 */
+	unsigned GetItem (unsigned pos) const
+	{
+		return m_heap[pos];
+	}
+
+	bool Contains (unsigned item) const
+	{
+		return item < m_pos.size () && m_pos[item] != NOT_IN_HEAP;
+	}
+
+	/**
+	 * @returns the item with the highest key
+	 */
+	unsigned Top () const
+	{
+		NS_ASSERT (!m_heap.empty ());
+		return m_heap[0];
+	}
+
+	/**
+	 * Insert an item or change its key
+	 * @params the item
+	 * @params the key
+	 */
+	void Set (unsigned item, double key)
+	{
+		NS_ASSERT (item < m_pos.size ());
+		if (m_pos[item] == NOT_IN_HEAP)
+		{
+			m_pos[item] = m_heap.size ();
+			m_heap.push_back (item);
+			m_keys[item] = key;
+			SiftUp (m_pos[item]);
+		}
+		else
+		{
+			m_keys[item] = key;
+			SiftUp (m_pos[item]);
+			SiftDown (m_pos[item]);
+		}
+	}
+
+	void Remove (unsigned item)
+	{
+		NS_ASSERT (Contains (item));
+		unsigned pos = m_pos[item];
+		unsigned last = m_heap.back ();
+		m_heap.pop_back ();
+		m_pos[item] = NOT_IN_HEAP;
+		if (last != item)
+		{
+			m_heap[pos] = last;
+			m_pos[last] = pos;
+			SiftUp (pos);
+			SiftDown (m_pos[last]);
+		}
+	}
+
+	/**
+	 * Change the key of an item in the heap without moving it, Heapify must be called
+	 * before the next Top, Set or Remove. Used to change the keys of many items in O(N)
+	 */
+	void SetKey (unsigned item, double key)
+	{
+		NS_ASSERT (Contains (item));
+		m_keys[item] = key;
+	}
+
+	void Heapify ()
+	{
+		for (unsigned pos = m_heap.size () / 2; pos > 0; pos--)
+		{
+			SiftDown (pos - 1);
+		}
+	}
+
+private:
+	enum { NOT_IN_HEAP = 0xffffffff };
+
+	bool Before (unsigned lItem, unsigned rItem) const
+	{
+		return m_keys[lItem] > m_keys[rItem] || (m_keys[lItem] == m_keys[rItem] && lItem < rItem);
+	}
+
+	void Swap (unsigned lPos, unsigned rPos)
+	{
+		std::swap (m_heap[lPos], m_heap[rPos]);
+		m_pos[m_heap[lPos]] = lPos;
+		m_pos[m_heap[rPos]] = rPos;
+	}
+
+	void SiftUp (unsigned pos)
+	{
+		while (pos > 0 && Before (m_heap[pos], m_heap[(pos - 1) / 2]))
+		{
+			Swap (pos, (pos - 1) / 2);
+			pos = (pos - 1) / 2;
+		}
+	}
+
+	void SiftDown (unsigned pos)
+	{
+		while (true)
+		{
+			unsigned best = pos;
+			unsigned child = 2 * pos + 1;
+			if (child < m_heap.size () && Before (m_heap[child], m_heap[best]))
+			{
+				best = child;
+			}
+			if (child + 1 < m_heap.size () && Before (m_heap[child + 1], m_heap[best]))
+			{
+				best = child + 1;
+			}
+			if (best == pos)
+			{
+				break;
+			}
+			Swap (pos, best);
+			pos = best;
+		}
+	}
+
+	std::vector<unsigned> m_heap; // items, ordered as a binary heap
+	std::vector<unsigned> m_pos;  // position of each item in m_heap
+	std::vector<double> m_keys;   // key of each item
+};
+
+struct MmWaveFlexTtiUeSchedInfo;
+
+/**
+ * \brief Buffered data of a DL logical channel or of a UL logical channel group of a UE
+ */
+struct MmWaveFlexTtiFlowStats
+{
+	MmWaveFlexTtiFlowStats (bool uplink, MmWaveFlexTtiUeSchedInfo* ueSchedInfo, uint8_t lcid) :
+		m_isUplink (uplink), m_ueSchedInfo (ueSchedInfo),
+		m_lcid (lcid), m_arrivalRate (0.0), m_grantedRate(0.0),
+		m_qci (0), m_txQueueHolDelay (0), m_reTxQueueHolDelay (0), m_probErr (0.0),
+		m_deadlineUs (0), m_totalBufSize (0), m_totalSchedSize(0), m_flowIndex (0)
+	{
+		NS_ASSERT (ueSchedInfo != 0);
+	}
+
+	bool			m_isUplink;					// is uplink?
+	MmWaveFlexTtiUeSchedInfo* m_ueSchedInfo;	// pointer to parent UE Info
+	uint8_t		m_lcid;						// LCID (for DL) or LC Group ID (for UL)
+	double 		m_arrivalRate;		// Mbps
+	double 		m_grantedRate;		// Mbps
+	uint8_t		m_qci;						// We interpret QCI 69 as delay critical
+	double	m_txQueueHolDelay;
+	uint32_t	m_reTxQueueHolDelay;
+	double		m_probErr;				// expected probability of each HARQ TX/reTX failure (i.e. 1/E[num TX to success])
+	double	m_deadlineUs;			// relative deadline
+	std::list<uint32_t> m_txPacketSizes;		// estimated packet sizes from consecutive BSRs
+	uint32_t	m_totalBufSize;
+	std::list<uint32_t> m_retxPacketSizes;
+	std::list<double> m_txPacketDelays;		// estimated delays for each packet
+	std::list<double> m_retxPacketDelays;
+
+	// We maintain a queue of PDU sizes scheduled in the last M subframes.
+	// M = delay between scheduling and transmission (default DL = 1, UL = 2)
+	// The sum of these M elements is subtracted from the BSR to account for
+	// data that has been scheduled but not yet extracted from the DL or UL queue.
+	std::list<uint32_t> m_schedPacketSizes;
+	uint32_t 	m_totalSchedSize;		// total of last M elements in list
+	uint32_t	m_flowIndex;			// position in the flow array of a scheduler ranking the flows
+};
+
+/**
+ * \brief Scheduling state of a UE in the flex-TTI schedulers: the allocation of the current
+ * subframe, the flows and the HARQ processes
+ */
+struct MmWaveFlexTtiUeSchedInfo
+{
+	typedef std::vector < uint8_t > HarqProcessesStatus_t;
+	typedef std::vector < uint8_t > HarqProcessesTimer_t;
+	typedef std::vector < DciInfoElementTdma > HarqProcessesDciInfoList_t;
+	typedef std::vector < std::vector <struct RlcPduInfo> > DlHarqRlcPduList_t; // vector of the LCs per per UE HARQ process
+
+	MmWaveFlexTtiUeSchedInfo (uint16_t rnti) :
+		m_rnti (rnti), m_dlMcs (0), m_ulMcs (0), m_maxDlBufSize (0),
+		m_maxUlBufSize (0), m_maxDlSymbols (0), m_maxUlSymbols (0),
+		m_dlSymbols (0), m_ulSymbols (0),
+		m_dlSymbolsRetx (0), m_ulSymbolsRetx (0),
+		m_dlTbSize (0), m_ulTbSize (0),
+		m_dlAllocDone (false), m_ulAllocDone (false),
+		m_avgTputDl (0.0), m_avgTputUl (0.0),
+		m_lastAvgTputDl (0.0), m_lastAvgTputUl (0.0),
+		m_currTputDl (0.0), m_currTputUl (0.0),
+		m_totBufDl (0), m_totBufUl (0),
+		m_allocUlLast (false),
+		m_active (false), m_allocated (false)
+	{
+	}
+
+	uint16_t	m_rnti;
+	uint8_t		m_dlMcs;
+	uint8_t		m_ulMcs;
+	uint32_t	m_maxDlBufSize;
+	uint32_t	m_maxUlBufSize;
+	uint8_t		m_maxDlSymbols;
+	uint8_t		m_maxUlSymbols;
+	uint8_t		m_dlSymbols;
+	uint8_t		m_ulSymbols;
+	uint8_t		m_dlSymbolsRetx;
+	uint8_t		m_ulSymbolsRetx;
+	uint32_t	m_dlTbSize;
+	uint32_t	m_ulTbSize;
+	std::vector <struct RlcPduInfo> m_rlcPduInfo;
+	bool			m_dlAllocDone;
+	bool			m_ulAllocDone;
+	// for each LC, the flows must not move when an LC is added
+	std::deque<MmWaveFlexTtiFlowStats> m_flowStatsDl;
+	std::deque<MmWaveFlexTtiFlowStats> m_flowStatsUl;
+	double 		m_avgTputDl;
+	double 		m_avgTputUl;
+	double 		m_lastAvgTputDl;
+	double 		m_lastAvgTputUl;
+	double 		m_currTputDl;
+	double 		m_currTputUl;
+	uint32_t	m_totBufDl;
+	uint32_t	m_totBufUl;
+	bool 			m_allocUlLast;
+
+	//HARQ status
+	// 0: process Id available
+	// x>0: process Id equal to `x` trasmission count
+	HarqProcessesStatus_t m_dlHarqProcessesStatus;
+	HarqProcessesTimer_t m_dlHarqProcessesTimer;
+	HarqProcessesDciInfoList_t m_dlHarqProcessesDciInfo;
+	DlHarqRlcPduList_t m_dlHarqProcessesRlcPdu;
+	HarqProcessesStatus_t m_ulHarqProcessesStatus;
+	HarqProcessesTimer_t m_ulHarqProcessesTimer;
+	HarqProcessesDciInfoList_t m_ulHarqProcessesDciInfo;
+
+	bool			m_active;			// in the active UEs of the engine
+	bool			m_allocated;	// in the allocated UEs of the current subframe
+};
+
+/**
+ * \brief State and subframe steps shared by the flex-TTI schedulers (FlexTti, PF, MaxRate and
+ * MaxWeight): the UEs, their flows and HARQ processes, the CQI maps, the HARQ retransmissions,
+ * the symbol allocation of the new data and the DCIs. A scheduler only decides which UE or flow
+ * gets the symbols of the new data.
+ *
+ * The UEs are kept in dense arrays: a record for each configured UE, addressed by RNTI, and the
+ * arrays of the active UEs, of the UEs allocated in the current subframe and of the UEs of each
+ * ranking class. The ranking is a policy, a class with static members passed to AllocateNewData,
+ * so that the per-symbol loop is inlined for each scheduler. A policy defines
+ * static const unsigned NUM_CLASSES, static const bool RANK_IDLE_UES (rank the UEs without
+ * buffered data), static void AddUe (MmWaveFlexTtiSchedEngine &engine, UeSchedInfo *ue,
+ * bool dlOk, bool ulOk) and static void Allocate (MmWaveFlexTtiSchedEngine &engine, int &symAvail)
+ */
+class MmWaveFlexTtiSchedEngine
+{
+public:
+	typedef MmWaveFlexTtiUeSchedInfo UeSchedInfo;
+	typedef MmWaveFlexTtiFlowStats FlowStats;
+
+	/**
+	 * Split of the TB of a DL DCI between the RLC PDUs of the UE
+	 */
+	enum DlRlcSplit
+	{
+		EVEN_SPLIT,							// same size for each LC, the RLC buffers are updated
+		REMAINDER_TO_DEFAULT_LC	// the PDUs keep their size, the rest of the TB goes to LC 3
+	};
+
+	MmWaveFlexTtiSchedEngine ();
+
+	/**
+	 * @params the PHY-MAC configuration
+	 * @params the AMC of the scheduler
+	 * @params the split of the DL TBs between the LCs
+	 */
+	void Configure (Ptr<MmWavePhyMacCommon> config, Ptr<MmWaveAmc> amc, DlRlcSplit dlRlcSplit);
+
+	void Dispose ();
+
+	void SetHarqEnabled (bool harqOn);
+	bool IsHarqEnabled () const;
+	void SetCqiTimersThreshold (uint32_t threshold);
+	uint32_t GetCqiTimersThreshold () const;
+
+	Ptr<MmWaveAmc> GetAmc () const
+	{
+		return m_amc;
+	}
+
+	/**
+	 * Create the record of a UE, with the flows of the LCs 0 to 3 and the HARQ processes
+	 * @params the RNTI
+	 * @returns the record, the existing one if the UE is configured
+	 */
+	UeSchedInfo* AddUe (uint16_t rnti);
+
+	/**
+	 * Remove a UE with its HARQ processes, CQIs and buffer reports
+	 */
+	void RemoveUe (uint16_t rnti);
+
+	/**
+	 * @returns the record of the UE, 0 if the UE is not configured
+	 */
+	UeSchedInfo* GetUe (uint16_t rnti) const
+	{
+		return rnti < m_ueByRnti.size () ? m_ueByRnti[rnti] : 0;
+	}
+
+	/**
+	 * @returns the configured UEs, in increasing RNTI order
+	 */
+	const std::vector<UeSchedInfo*> &GetUes () const
+	{
+		return m_ues;
+	}
+
+	/**
+	 * Add the flows of the configured LCs of a UE
+	 * @params the LC configuration
+	 * @params the configured flows, DL and UL
+	 */
+	void ConfigureLcs (const struct MmWaveMacCschedSapProvider::CschedLcConfigReqParameters& params, std::vector<FlowStats*> &flows);
+
+	/**
+	 * Drop the RLC buffer reports of the released LCs
+	 */
+	void ReleaseLcs (const struct MmWaveMacCschedSapProvider::CschedLcReleaseReqParameters& params);
+
+	/**
+	 * Update the packets of a DL flow from an RLC buffer report, the UE becomes active if the
+	 * flow has buffered data
+	 * @returns the flow, 0 if the UE or the LC is not configured
+	 */
+	FlowStats* UpdateDlFlow (const struct MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters& params);
+
+	/**
+	 * Estimate the new packets of the UL flows from the buffer status reports, the UE becomes
+	 * active if a flow grows
+	 * @params the MAC CEs
+	 * @params the flows that grew
+	 */
+	void UpdateUlFlows (const struct MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params, std::vector<FlowStats*> &flows);
+
+	/**
+	 * Keep the last RLC buffer report of each LC, for the schedulers that allocate the
+	 * reported queues
+	 */
+	void StoreRlcBufferReq (const struct MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters& params);
+
+	/**
+	 * Keep the total UL buffer of each UE from the buffer status reports
+	 */
+	void StoreBsr (const struct MmWaveMacSchedSapProvider::SchedUlMacCtrlInfoReqParameters& params);
+
+	std::list <MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters> &GetRlcBufferReqs ()
+	{
+		return m_rlcBufferReq;
+	}
+
+	std::map <uint16_t,uint32_t> &GetBsrs ()
+	{
+		return m_ceBsrRxed;
+	}
+
+	void ReceiveDlCqi (const struct MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters& params);
+	void ReceiveUlCqi (const struct MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& params);
+
+	/**
+	 * @returns the DL wideband CQI of the UE, 1 if the UE did not report one
+	 */
+	uint8_t GetDlCqi (uint16_t rnti) const;
+
+	/**
+	 * UL CQI from the SINR of the last UL allocation of the UE
+	 * @params the RNTI
+	 * @params the MCS of the CQI, 0 if there is no UL SINR for the UE
+	 * @returns the CQI, 1 if there is no UL SINR for the UE
+	 */
+	int GetUlCqi (uint16_t rnti, int &mcs);
+
+	/**
+	 * Add the DL control slot, refresh the CQIs and the HARQ processes and collect the HARQ
+	 * feedback
+	 * @params the trigger
+	 * @params the allocation of the subframe
+	 * @params the symbols available for data
+	 * @params the first data symbol
+	 * @params the index of the first data slot
+	 */
+	void StartSubframe (const struct MmWaveMacSchedSapProvider::SchedTriggerReqParameters& params,
+	                    MmWaveMacSchedSapUser::SchedConfigIndParameters& ret,
+	                    int &symAvail, uint8_t &symIdx, uint8_t &slotIdx);
+
+	/**
+	 * Allocate the HARQ retransmissions, DL then UL, the UEs with a retransmission are allocated
+	 * in the subframe. The feedback is dropped if the HARQ is disabled, the feedback of an
+	 * unknown UE is always dropped
+	 */
+	void ScheduleHarqRetx (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret,
+	                       int &symAvail, uint8_t &symIdx, uint8_t &slotIdx);
+
+	/**
+	 * Allocate the symbols of the new data of the active UEs, or of all the UEs if the policy
+	 * ranks the idle ones, with a ranking policy. The DL and UL buffers, MCSs and throughputs
+	 * of the UEs are computed first, the UEs with data in a direction with a valid CQI are
+	 * allocated in the subframe
+	 * @params the available symbols, decreased by the allocated ones
+	 */
+	template <class Policy>
+	void AllocateNewData (int &symAvail);
+
+	/**
+	 * Schedule a subframe for a scheduler that ranks the UEs: the HARQ retransmissions, the
+	 * new data with a ranking policy and the DCIs
+	 * @params the trigger
+	 * @params the allocation of the subframe
+	 */
+	template <class Policy>
+	void ScheduleSubframe (const struct MmWaveMacSchedSapProvider::SchedTriggerReqParameters& params,
+	                       MmWaveMacSchedSapUser::SchedConfigIndParameters& ret);
+
+	/**
+	 * Add a UE to the UEs of the subframe, once
+	 */
+	void AddAllocatedUe (UeSchedInfo *ue)
+	{
+		if (!ue->m_allocated)
+		{
+			ue->m_allocated = true;
+			m_allocatedUes.push_back (ue);
+		}
+	}
+
+	std::vector<UeSchedInfo*> &GetAllocatedUes ()
+	{
+		return m_allocatedUes;
+	}
+
+	/**
+	 * Sort the UEs of the subframe by RNTI
+	 */
+	void SortAllocatedUes ();
+
+	/**
+	 * Add a UE to a ranking class of the policy, the UEs are added in increasing RNTI order and
+	 * a UE is added once to each class
+	 * @params the UE
+	 * @params the ranking class, 0 if the policy has a single class
+	 */
+	void AddRankedUe (UeSchedInfo *ue, unsigned rankClass)
+	{
+		NS_ASSERT (rankClass < m_rankedUes.size ());
+		std::vector<UeSchedInfo*> &ues = m_rankedUes[rankClass];
+		if (ues.empty () || ues.back () != ue)
+		{
+			ues.push_back (ue);
+		}
+	}
+
+	std::vector<UeSchedInfo*> &GetRankedUes (unsigned rankClass)
+	{
+		return m_rankedUes[rankClass];
+	}
+
+	/**
+	 * Heap of the policy, indexed by the position of the UEs in a class
+	 */
+	MmWaveIndexedHeap &GetHeap ()
+	{
+		return m_heap;
+	}
+
+	/**
+	 * Mark the directions without buffered data of a UE as allocated
+	 * @returns true if a direction of the UE still needs symbols
+	 */
+	static bool UpdateDone (UeSchedInfo *ue)
+	{
+		if (ue->m_totBufDl == 0)
+		{
+			ue->m_dlAllocDone = true;
+		}
+		if (ue->m_totBufUl == 0)
+		{
+			ue->m_ulAllocDone = true;
+		}
+		return !(ue->m_dlAllocDone && ue->m_ulAllocDone);
+	}
+
+	/**
+	 * Grant one symbol to a UE, in UL after a UL symbol or when the DL is allocated, else in DL,
+	 * and update its TB sizes and throughputs
+	 * @params the UE
+	 * @returns false if both directions of the UE are allocated
+	 */
+	bool Grant (UeSchedInfo *ue);
+
+	/**
+	 * Create the DL DCIs of the allocated UEs in RNTI order, then their UL DCIs
+	 */
+	void CreateDcis (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, uint8_t &symIdx, uint8_t &slotIdx);
+
+	/**
+	 * Create the DL DCI of the symbols allocated to a UE and split its TB between the RLC PDUs.
+	 * The slot goes before the UL slots of the subframe
+	 */
+	void CreateDlDci (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, UeSchedInfo *ue, uint8_t &symIdx, uint8_t &slotIdx);
+
+	/**
+	 * Create the UL DCI of the symbols allocated to a UE, and keep the allocation for the UL CQI
+	 */
+	void CreateUlDci (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, UeSchedInfo *ue, uint8_t &symIdx, uint8_t &slotIdx);
+
+	/**
+	 * Add the UL control slot and reset the allocation of the UEs of the subframe
+	 * @params the allocation of the subframe
+	 * @params false if the new data was not allocated, only the retransmissions are reset
+	 */
+	void EndSubframe (MmWaveMacSchedSapUser::SchedConfigIndParameters& ret, bool newData = true);
+
+	/**
+	 * Bisection search of the minimum number of symbols of a TB of the buffer
+	 * @params the MCS
+	 * @params the buffer size in bytes
+	 * @params the TB size in bytes
+	 * @returns the number of symbols
+	 */
+	unsigned CalcMinTbSizeNumSym (unsigned mcs, unsigned bufSize, unsigned &tbSize);
+
+private:
+	struct UlCqiMapElem
+	{
+		UlCqiMapElem (std::vector<double> ulCqi, uint8_t nSym, uint32_t tbs) :
+			m_ueUlCqi (ulCqi), m_numSym (nSym), m_tbSize (tbs)
+		{
+		}
+		std::vector <double> m_ueUlCqi;
+		uint8_t 	m_numSym;
+		uint32_t	m_tbSize;
+	};
+
+	struct AllocMapElem
+	{
+		AllocMapElem (std::vector<uint16_t> rntiMap, uint8_t nSym, uint32_t tbs) :
+			m_rntiPerChunk (rntiMap), m_numSym (nSym), m_tbSize (tbs)
+		{
+		}
+
+		std::vector <uint16_t> m_rntiPerChunk;
+		uint8_t m_numSym;
+		uint32_t m_tbSize;
+	};
+
+	static bool CompareRnti (const UeSchedInfo *lue, const UeSchedInfo *rue)
+	{
+		return lue->m_rnti < rue->m_rnti;
+	}
+
+	/**
+	 * @returns true if a DL or UL flow of the UE has buffered data
+	 */
+	static bool HasBufferedData (const UeSchedInfo *ue);
+
+	/**
+	 * Add a UE to the active UEs, the array is sorted before the next allocation
+	 */
+	void ActivateUe (UeSchedInfo *ue);
+
+	/**
+	 * Compute the DL and UL buffers, MCSs and achievable throughputs of a UE for the new data
+	 * @params the UE
+	 * @params set if the DL CQI is in range
+	 * @params set if the UL CQI is in range
+	 */
+	void PrepareNewData (UeSchedInfo *ue, bool &dlOk, bool &ulOk);
+
+	void RefreshDlCqiMaps ();
+	void RefreshUlCqiMaps ();
+	void RefreshHarqProcesses ();
+	uint8_t UpdateDlHarqProcessId (UeSchedInfo *ue);
+	uint8_t UpdateUlHarqProcessId (UeSchedInfo *ue);
+	void UpdateDlRlcBufferInfo (uint16_t rnti, uint8_t lcid, uint16_t size);
+	void UpdateUlRlcBufferInfo (uint16_t rnti, uint16_t size);
+
+	static const unsigned m_subHdrSize;
+
+	Ptr<MmWavePhyMacCommon> m_phyMacConfig;
+	Ptr<MmWaveAmc> m_amc;
+	Ptr<SpectrumValue> m_ulCqiSinr; // UL SINR of the MCS selection
+	DlRlcSplit m_dlRlcSplit;
+	double m_sfPeriod; // seconds
+	double m_timeWindow;
+	bool m_harqOn;
+	uint32_t m_cqiTimersThreshold; // # of TTIs for which a CQI can be considered valid
+	uint8_t m_tbUid;
+
+	std::deque<UeSchedInfo> m_ueStorage;		// records of the UEs, they do not move
+	std::vector<UeSchedInfo*> m_freeUes;		// records of the released UEs
+	std::vector<UeSchedInfo*> m_ueByRnti;		// configured UEs by RNTI, 0 for the others
+	std::vector<UeSchedInfo*> m_ues;				// configured UEs, in RNTI order
+	std::vector<UeSchedInfo*> m_activeUes;	// UEs with buffered data, the only ones ranked for new data
+	bool m_activeUesSorted;
+	std::vector<UeSchedInfo*> m_allocatedUes;	// UEs of the current subframe
+	std::vector< std::vector<UeSchedInfo*> > m_rankedUes;	// UEs of each ranking class
+	MmWaveIndexedHeap m_heap;
+
+	std::list <MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters> m_rlcBufferReq;
+	std::map <uint16_t,uint32_t> m_ceBsrRxed;
+
+	std::map <uint16_t,uint8_t> m_wbCqiRxed;
+	std::map <uint16_t,uint32_t> m_wbCqiTimers;
+	std::map <uint16_t, struct UlCqiMapElem> m_ueUlCqi;
+	std::map <uint16_t, uint32_t> m_ueCqiTimers;
+	/*
+	 * Map of previous allocated UE per RBG
+	 * (used to retrieve info from UL-CQI)
+	 */
+	std::map <uint32_t, struct AllocMapElem> m_ulAllocationMap;
+
+	std::vector <DlHarqInfo> m_dlHarqInfoList; // HARQ retx buffered
+	std::vector <UlHarqInfo> m_ulHarqInfoList; // HARQ retx buffered
+};
+
+template <class Policy>
+void
+MmWaveFlexTtiSchedEngine::AllocateNewData (int &symAvail)
+{
+	m_rankedUes.resize (Policy::NUM_CLASSES);
+	for (unsigned i = 0; i < Policy::NUM_CLASSES; i++)
+	{
+		m_rankedUes[i].clear ();
+	}
+	if (Policy::RANK_IDLE_UES)
+	{
+		for (unsigned i = 0; i < m_ues.size (); i++)
+		{
+			bool dlOk, ulOk;
+			PrepareNewData (m_ues[i], dlOk, ulOk);
+			Policy::AddUe (*this, m_ues[i], dlOk, ulOk);
+		}
+	}
+	else
+	{
+		if (!m_activeUesSorted)
+		{
+			std::sort (m_activeUes.begin (), m_activeUes.end (), CompareRnti);
+			m_activeUesSorted = true;
+		}
+		// the UEs without buffered data are dropped, the cost does not grow with the idle UEs
+		unsigned numActive = 0;
+		for (unsigned i = 0; i < m_activeUes.size (); i++)
+		{
+			UeSchedInfo *ue = m_activeUes[i];
+			if (!HasBufferedData (ue))
+			{
+				ue->m_active = false;
+				continue;
+			}
+			m_activeUes[numActive++] = ue;
+			bool dlOk, ulOk;
+			PrepareNewData (ue, dlOk, ulOk);
+			Policy::AddUe (*this, ue, dlOk, ulOk);
+		}
+		m_activeUes.resize (numActive);
+	}
+	Policy::Allocate (*this, symAvail);
+}
+
+template <class Policy>
+void
+MmWaveFlexTtiSchedEngine::ScheduleSubframe (const struct MmWaveMacSchedSapProvider::SchedTriggerReqParameters& params,
+                                            MmWaveMacSchedSapUser::SchedConfigIndParameters& ret)
+{
+	int symAvail;
+	uint8_t slotIdx;
+	uint8_t symIdx;
+	StartSubframe (params, ret, symAvail, symIdx, slotIdx);
+
+	// assign slots for the HARQ RETX first, if resources available
+	ScheduleHarqRetx (ret, symAvail, symIdx, slotIdx);
+
+	// no further allocations
+	if (symAvail == 0)
+	{
+		EndSubframe (ret, false);
+		return;
+	}
+
+	// ********************* END OF HARQ SECTION, START OF NEW DATA SCHEDULING ********************* //
+
+	AllocateNewData<Policy> (symAvail);
+
+	// iterate through the allocated UEs, assign TDMA symbol indices and create DCIs
+	if (!m_allocatedUes.empty ())
+	{
+		CreateDcis (ret, symIdx, slotIdx);
+	}
+	EndSubframe (ret);
+}
+
+/**
+ * \brief Proportional fair ranking: each symbol goes to the UE with the highest ratio of its
+ * achievable throughput to its average throughput, the ties are broken by RNTI. The UEs are
+ * kept in an indexed heap, a symbol costs O(log N)
+ */
+struct MmWavePfRankingPolicy
+{
+	static const unsigned NUM_CLASSES = 1;
+	static const bool RANK_IDLE_UES = false;
+
+	static double Metric (const MmWaveFlexTtiUeSchedInfo *ue)
+	{
+		return std::max (ue->m_currTputDl, ue->m_currTputUl) / std::max (1E-9, (ue->m_avgTputDl + ue->m_avgTputDl));
+	}
+
+	static void AddUe (MmWaveFlexTtiSchedEngine &engine, MmWaveFlexTtiUeSchedInfo *ue, bool dlOk, bool ulOk)
+	{
+		if ((dlOk && ue->m_totBufDl > 0) || (ulOk && ue->m_totBufUl > 0))
+		{
+			engine.AddRankedUe (ue, 0);
+		}
+	}
+
+	static void Allocate (MmWaveFlexTtiSchedEngine &engine, int &symAvail)
+	{
+		std::vector<MmWaveFlexTtiUeSchedInfo*> &ues = engine.GetRankedUes (0);
+		MmWaveIndexedHeap &heap = engine.GetHeap ();
+		heap.Clear ();
+		heap.Resize (ues.size ());
+		for (unsigned i = 0; i < ues.size (); i++)
+		{
+			if (MmWaveFlexTtiSchedEngine::UpdateDone (ues[i]))
+			{
+				heap.Set (i, Metric (ues[i]));
+			}
+		}
+		// only the metric of the granted UE changes after each symbol
+		while (symAvail > 0 && !heap.IsEmpty ())
+		{
+			unsigned best = heap.Top ();
+			engine.Grant (ues[best]);
+			symAvail--;
+			if (MmWaveFlexTtiSchedEngine::UpdateDone (ues[best]))
+			{
+				heap.Set (best, Metric (ues[best]));
+			}
+			else
+			{
+				heap.Remove (best);
+			}
+		}
+	}
+};
+
+/**
+ * \brief Maximum rate ranking: the symbols go to the UEs with the highest MCS first, round robin
+ * among the UEs of the same MCS. A UE is ranked by its DL and by its UL MCS
+ */
+struct MmWaveMaxRateRankingPolicy
+{
+	static const unsigned NUM_CLASSES = 29; // MCS 0 to 28
+	static const bool RANK_IDLE_UES = true;
+
+	static void AddUe (MmWaveFlexTtiSchedEngine &engine, MmWaveFlexTtiUeSchedInfo *ue, bool dlOk, bool ulOk)
+	{
+		if (dlOk)
+		{
+			engine.AddRankedUe (ue, ue->m_dlMcs);
+		}
+		if (ulOk)
+		{
+			engine.AddRankedUe (ue, ue->m_ulMcs);
+		}
+	}
+
+	static void Allocate (MmWaveFlexTtiSchedEngine &engine, int &symAvail)
+	{
+		for (int imcs = NUM_CLASSES - 1; imcs >= 0 && symAvail > 0; imcs--)
+		{
+			std::vector<MmWaveFlexTtiUeSchedInfo*> &ues = engine.GetRankedUes (imcs);
+			bool ueAlloc = !ues.empty ();
+			while (symAvail > 0 && ueAlloc)
+			{
+				ueAlloc = false;
+				for (unsigned i = 0; i < ues.size () && symAvail > 0; i++)
+				{
+					if (engine.Grant (ues[i]))
+					{
+						symAvail--;
+						ueAlloc = true;
+					}
+				}
+			}
+		}
+	}
+};
+
+}
+
+#endif /* SRC_MMWAVE_MODEL_MMWAVE_FLEX_TTI_SCHED_ENGINE_H_ */
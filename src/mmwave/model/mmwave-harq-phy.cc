@@ -75,7 +75,7 @@ MmWaveHarqPhy::GetAccumulatedMiDl (uint16_t rnti, uint8_t harqId)
   return (mi);
 }
 
-MmWaveHarqProcessInfoList_t
+const MmWaveHarqProcessInfoList_t&
 MmWaveHarqPhy::GetHarqProcessInfoDl (uint16_t rnti, uint8_t harqProcId)
 {
 	NS_LOG_FUNCTION (this << rnti << (uint16_t)harqProcId);
@@ -86,8 +86,8 @@ MmWaveHarqPhy::GetHarqProcessInfoDl (uint16_t rnti, uint8_t harqProcId)
 		// new entry
 		std::vector <MmWaveHarqProcessInfoList_t> harqList;
 		harqList.resize (m_harqNum);
-		m_miDlHarqProcessesInfoMap.insert (std::pair <uint16_t, std::vector <MmWaveHarqProcessInfoList_t> > (rnti, harqList));
-		return (harqList.at (harqProcId));
+		it = m_miDlHarqProcessesInfoMap.insert (std::pair <uint16_t, std::vector <MmWaveHarqProcessInfoList_t> > (rnti, harqList)).first;
+		return ((*it).second.at (harqProcId));
 	}
 	else
 	{
@@ -113,7 +113,7 @@ MmWaveHarqPhy::GetAccumulatedMiUl (uint16_t rnti, uint8_t harqId)
   return (mi);
 }
 
-MmWaveHarqProcessInfoList_t
+const MmWaveHarqProcessInfoList_t&
 MmWaveHarqPhy::GetHarqProcessInfoUl (uint16_t rnti, uint8_t harqProcId)
 {
 	NS_LOG_FUNCTION (this << rnti << (uint16_t)harqProcId);
@@ -124,8 +124,8 @@ MmWaveHarqPhy::GetHarqProcessInfoUl (uint16_t rnti, uint8_t harqProcId)
 		// new entry
 		std::vector <MmWaveHarqProcessInfoList_t> harqList;
 		harqList.resize (m_harqNum);
-		m_miUlHarqProcessesInfoMap.insert (std::pair <uint16_t, std::vector <MmWaveHarqProcessInfoList_t> > (rnti, harqList));
-		return (harqList.at (harqProcId));
+		it = m_miUlHarqProcessesInfoMap.insert (std::pair <uint16_t, std::vector <MmWaveHarqProcessInfoList_t> > (rnti, harqList)).first;
+		return ((*it).second.at (harqProcId));
 	}
 	else
 	{
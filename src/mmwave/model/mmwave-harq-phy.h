@@ -82,9 +82,9 @@ public:
   * for DL (asynchronous)
   * \param harqProcId the HARQ proc id
   * \param layer layer no. (for MIMO spatail multiplexing)
-  * \return the vector of the info related to HARQ proc Id
+  * \return the vector of the info related to HARQ proc Id, valid until the process is updated or reset
   */
-  MmWaveHarqProcessInfoList_t GetHarqProcessInfoDl (uint16_t rnti, uint8_t harqProcId);
+  const MmWaveHarqProcessInfoList_t& GetHarqProcessInfoDl (uint16_t rnti, uint8_t harqProcId);
 
   /**
   * \brief Return the cumulated MI of the HARQ procId in case of retranmissions
@@ -98,9 +98,9 @@ public:
   * for UL (asynchronous)
   * \param rnti the RNTI of the transmitter
   * \param harqProcId the HARQ proc id
-  * \return the vector of the info related to HARQ proc Id
+  * \return the vector of the info related to HARQ proc Id, valid until the process is updated or reset
   */
-  MmWaveHarqProcessInfoList_t GetHarqProcessInfoUl (uint16_t rnti, uint8_t harqProcId);
+  const MmWaveHarqProcessInfoList_t& GetHarqProcessInfoUl (uint16_t rnti, uint8_t harqProcId);
 
   /**
   * \brief Update the Info associated to the decodification of an HARQ process
@@ -32,6 +32,7 @@
 #include <ns3/log.h>
 #include "mmwave-chunk-processor.h"
 #include <stdio.h>
+#include <algorithm>
 
 
 
@@ -41,10 +42,10 @@ namespace ns3 {
 
 
 mmWaveInterference::mmWaveInterference ()
- 	 : m_receiving (false),
-	   m_lastSignalId (0),
-	   m_lastSignalIdBeforeReset (0)
+ 	 : m_receiving (false)
 {
+	m_rxBands.m_first = 0;
+	m_rxBands.m_end = 0;
 	NS_LOG_FUNCTION (this);
 }
 
@@ -61,7 +62,9 @@ mmWaveInterference::DoDispose ()
 	m_sinrChunkProcessorList.clear ();
 	m_rxSignal = 0;
 	m_allSignals = 0;
+	m_sinr = 0;
 	m_noise = 0;
+	m_ledger.clear ();
 	Object::DoDispose ();
 } 
 
@@ -80,10 +83,19 @@ void
 mmWaveInterference::StartRx (Ptr<const SpectrumValue> rxPsd)
 { 
 	NS_LOG_FUNCTION (this << *rxPsd);
+	RetireSignals (Now ());
 	if (m_receiving == false)
 	{
 		NS_LOG_LOGIC ("first signal");
-		m_rxSignal = rxPsd->Copy ();
+		if (m_rxSignal != 0 && m_rxSignal->GetSpectrumModel () == rxPsd->GetSpectrumModel ())
+		{
+			std::copy (rxPsd->ConstValuesBegin (), rxPsd->ConstValuesEnd (), m_rxSignal->ValuesBegin ());
+		}
+		else
+		{
+			m_rxSignal = rxPsd->Copy ();
+		}
+		m_rxBands = MmWaveSpectrumValueHelper::GetActiveBands (*rxPsd);
 		m_lastChangeTime = Now ();
 		m_receiving = true;
 		for (std::list<Ptr<mmWaveChunkProcessor> >::const_iterator it = m_PowerChunkProcessorList.begin (); it != m_PowerChunkProcessorList.end (); ++it)
@@ -101,8 +113,9 @@ mmWaveInterference::StartRx (Ptr<const SpectrumValue> rxPsd)
       	// receiving multiple simultaneous signals, make sure they are synchronized
       	NS_ASSERT (m_lastChangeTime == Now ());
      	// make sure they use orthogonal resource blocks
-     	NS_ASSERT (Sum ((*rxPsd) * (*m_rxSignal)) == 0.0);
+     	NS_ASSERT (!Overlap (*rxPsd, *m_rxSignal));
     	(*m_rxSignal) += (*rxPsd);
+    	m_rxBands = MmWaveSpectrumValueHelper::MergeBands (m_rxBands, MmWaveSpectrumValueHelper::GetActiveBands (*rxPsd));
     }
 }
 
@@ -135,43 +148,59 @@ void
 mmWaveInterference::AddSignal (Ptr<const SpectrumValue> spd, const Time duration)
 {
 	NS_LOG_FUNCTION (this << *spd << duration);
-	DoAddSignal (spd);
-	uint32_t signalId = ++m_lastSignalId;
-	if (signalId == m_lastSignalIdBeforeReset)
-    {
-		// This happens when m_lastSignalId eventually wraps around. Given that so
-		// many signals have elapsed since the last reset, we hope that by now there is
-		// no stale pending signal (i.e., a signal that was scheduled
-		// for subtraction before the reset). So we just move the
-		// boundary further.
-		m_lastSignalIdBeforeReset += 0x10000000;
-    }
-	Simulator::Schedule (duration, &mmWaveInterference::DoSubtractSignal, this, spd, signalId);
+	MmWaveBandRange bands = MmWaveSpectrumValueHelper::GetActiveBands (*spd);
+	DoAddSignal (*spd, bands);
+	// the signal is retired from the ledger at the first evaluation after its end,
+	// signals ending at the same time are retired in the order they were added
+	LedgerEntry entry;
+	entry.m_end = Now () + duration;
+	entry.m_psd = spd;
+	entry.m_subtract = true;
+	entry.m_bands = bands;
+	std::deque<LedgerEntry>::iterator it = m_ledger.end ();
+	while (it != m_ledger.begin () && (it - 1)->m_end > entry.m_end)
+	{
+		--it;
+	}
+	m_ledger.insert (it, entry);
 }
 
 
 void
-mmWaveInterference::DoAddSignal  (Ptr<const SpectrumValue> spd)
+mmWaveInterference::DoAddSignal (const SpectrumValue &spd, MmWaveBandRange bands)
 { 
-	NS_LOG_FUNCTION (this << *spd);
+	NS_LOG_FUNCTION (this << spd);
 	ConditionallyEvaluateChunk ();
-	(*m_allSignals) += (*spd);
+	NS_ASSERT (m_allSignals->GetSpectrumModel () == spd.GetSpectrumModel ());
+	// the other bands of spd are 0 and would leave the sum unchanged
+	Values::const_iterator psd = spd.ConstValuesBegin () + bands.m_first;
+	Values::iterator all = m_allSignals->ValuesBegin () + bands.m_first;
+	for (uint32_t i = bands.m_first; i < bands.m_end; i++, ++psd, ++all)
+	{
+		*all += *psd;
+	}
 }
 
 void
-mmWaveInterference::DoSubtractSignal  (Ptr<const SpectrumValue> spd, uint32_t signalId)
-{ 
-	NS_LOG_FUNCTION (this << *spd);
-	ConditionallyEvaluateChunk ();
-	int32_t deltaSignalId = signalId - m_lastSignalIdBeforeReset;
-	if (deltaSignalId > 0)
-    {   
-		(*m_allSignals) -= (*spd);
-    }
-	else
-    {
-		NS_LOG_INFO ("ignoring signal scheduled for subtraction before last reset");
-    }
+mmWaveInterference::RetireSignals (Time time)
+{
+	while (!m_ledger.empty () && m_ledger.front ().m_end <= time)
+	{
+		// close the chunk at the end of the signal before removing it
+		LedgerEntry &entry = m_ledger.front ();
+		NS_LOG_LOGIC (this << " retire signal ended at " << entry.m_end);
+		EvaluateChunk (entry.m_end);
+		if (entry.m_subtract)
+		{
+			Values::const_iterator psd = entry.m_psd->ConstValuesBegin () + entry.m_bands.m_first;
+			Values::iterator all = m_allSignals->ValuesBegin () + entry.m_bands.m_first;
+			for (uint32_t i = entry.m_bands.m_first; i < entry.m_bands.m_end; i++, ++psd, ++all)
+			{
+				*all -= *psd;
+			}
+		}
+		m_ledger.pop_front ();
+	}
 }
 
 
@@ -179,29 +208,68 @@ void
 mmWaveInterference::ConditionallyEvaluateChunk ()
 {
 	NS_LOG_FUNCTION (this);
+	RetireSignals (Now ());
+	EvaluateChunk (Now ());
+}
+
+void
+mmWaveInterference::EvaluateChunk (Time time)
+{
 	if (m_receiving)
     {
 		NS_LOG_DEBUG (this << " Receiving");
     }
-	NS_LOG_DEBUG (this << " now "  << Now () << " last " << m_lastChangeTime);
-	if (m_receiving && (Now () > m_lastChangeTime))
+	NS_LOG_DEBUG (this << " time "  << time << " last " << m_lastChangeTime);
+	if (m_receiving && (time > m_lastChangeTime))
     {
 		NS_LOG_LOGIC (this << " signal = " << *m_rxSignal << " allSignals = " << *m_allSignals << " noise = " << *m_noise);
-		SpectrumValue interf =  (*m_allSignals) - (*m_rxSignal) + (*m_noise);
-		SpectrumValue sinr = (*m_rxSignal) / interf;
-		Time duration = Now () - m_lastChangeTime;
+		CalcSinr ();
+		Time duration = time - m_lastChangeTime;
 		for (std::list<Ptr<mmWaveChunkProcessor> >::const_iterator it = m_PowerChunkProcessorList.begin (); it != m_PowerChunkProcessorList.end (); ++it)
 		{
 		  (*it)->EvaluateChunk (*m_rxSignal, duration);
 		}
 		for (std::list<Ptr<mmWaveChunkProcessor> >::const_iterator it = m_sinrChunkProcessorList.begin (); it != m_sinrChunkProcessorList.end (); ++it)
 		{
-		  (*it)->EvaluateChunk (sinr, duration);
+		  (*it)->EvaluateChunk (*m_sinr, duration);
 		}
-		m_lastChangeTime = Now ();
+		m_lastChangeTime = time;
     }
 }
 
+void
+mmWaveInterference::CalcSinr ()
+{
+	// signal / (all - signal + noise) in one pass, in the scratch buffer of the receiver.
+	// The SINR is 0 where the received signal has no power
+	NS_ASSERT (m_sinr->GetSpectrumModel () == m_rxSignal->GetSpectrumModel ());
+	Values::iterator begin = m_sinr->ValuesBegin ();
+	std::fill (begin, begin + m_rxBands.m_first, 0.0);
+	std::fill (begin + m_rxBands.m_end, m_sinr->ValuesEnd (), 0.0);
+	Values::const_iterator signal = m_rxSignal->ConstValuesBegin () + m_rxBands.m_first;
+	Values::const_iterator all = m_allSignals->ConstValuesBegin () + m_rxBands.m_first;
+	Values::const_iterator noise = m_noise->ConstValuesBegin () + m_rxBands.m_first;
+	Values::iterator end = begin + m_rxBands.m_end;
+	for (Values::iterator sinr = begin + m_rxBands.m_first; sinr != end; ++sinr, ++signal, ++all, ++noise)
+	{
+		*sinr = *signal / (*all - *signal + *noise);
+	}
+}
+
+bool
+mmWaveInterference::Overlap (const SpectrumValue &a, const SpectrumValue &b)
+{
+	Values::const_iterator itB = b.ConstValuesBegin ();
+	for (Values::const_iterator itA = a.ConstValuesBegin (); itA != a.ConstValuesEnd (); ++itA, ++itB)
+	{
+		if (*itA * *itB != 0.0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 void
 mmWaveInterference::SetNoisePowerSpectralDensity (Ptr<const SpectrumValue> noisePsd)
 {
@@ -209,12 +277,19 @@ mmWaveInterference::SetNoisePowerSpectralDensity (Ptr<const SpectrumValue> noise
 	ConditionallyEvaluateChunk ();
 	m_noise = noisePsd;
 	m_allSignals = Create<SpectrumValue> (noisePsd->GetSpectrumModel ());
+	m_sinr = Create<SpectrumValue> (noisePsd->GetSpectrumModel ());
+	m_rxSignal = Create<SpectrumValue> (noisePsd->GetSpectrumModel ());
 	if (m_receiving == true)
     {
 		// abort rx
 		m_receiving = false;
     }
-	m_lastSignalIdBeforeReset = m_lastSignalId;
+	// the signals received before the reset are not subtracted from the new sum,
+	// they still close the chunk at their end
+	for (std::deque<LedgerEntry>::iterator it = m_ledger.begin (); it != m_ledger.end (); ++it)
+	{
+		it->m_subtract = false;
+	}
 }
 
 void
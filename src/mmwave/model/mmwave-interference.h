@@ -35,7 +35,9 @@
 #include <ns3/nstime.h>
 #include <ns3/spectrum-value.h>
 #include <string.h>
+#include <deque>
 #include <ns3/mmwave-chunk-processor.h>
+#include <ns3/mmwave-spectrum-value-helper.h>
 
 
 namespace ns3 {
@@ -55,9 +57,37 @@ public:
 	void AddSinrChunkProcessor (Ptr<mmWaveChunkProcessor> p);
 
 private:
+	/**
+	 * Retire the signals ended before now and evaluate the chunk up to now
+	 */
 	void ConditionallyEvaluateChunk ();
-	void DoAddSignal (Ptr<const SpectrumValue> spd);
-	void DoSubtractSignal  (Ptr<const SpectrumValue> spd, uint32_t signalId);
+	/**
+	 * Evaluate the chunk from the last change to a time, if receiving
+	 * @params the end of the chunk
+	 */
+	void EvaluateChunk (Time time);
+	/**
+	 * Subtract the signals of the ledger ended at or before a time, the chunk is evaluated
+	 * at the end of each signal
+	 * @params the time
+	 */
+	void RetireSignals (Time time);
+	/**
+	 * Compute the SINR of the received signal into m_sinr, the bands outside m_rxBands are set to 0
+	 */
+	void CalcSinr ();
+	/**
+	 * Returns true if two power spectral densities share a band, without temporaries
+	 * @params the first power spectral density
+	 * @params the second power spectral density
+	 */
+	static bool Overlap (const SpectrumValue &a, const SpectrumValue &b);
+	/**
+	 * Add a signal to m_allSignals over its occupied bands
+	 * @params the power spectral density
+	 * @params the bands of the power spectral density carrying power
+	 */
+	void DoAddSignal (const SpectrumValue &spd, MmWaveBandRange bands);
 	std::list<Ptr<mmWaveChunkProcessor> > m_PowerChunkProcessorList;
 	std::list<Ptr<mmWaveChunkProcessor> > m_sinrChunkProcessorList;
 
@@ -65,13 +95,24 @@ private:
 	bool m_receiving;
 
 	Ptr<SpectrumValue> m_rxSignal;
+	MmWaveBandRange m_rxBands; // bands of m_rxSignal carrying power
 	Ptr<SpectrumValue> m_allSignals;
+	Ptr<SpectrumValue> m_sinr; // scratch buffer, read by the sinr chunk processors
 	Ptr<const SpectrumValue> m_noise;
 
 	Time m_lastChangeTime;
 
-	uint32_t m_lastSignalId;
-	uint32_t m_lastSignalIdBeforeReset;
+	/**
+	 * A signal added to m_allSignals, to be subtracted at its end
+	 */
+	struct LedgerEntry
+	{
+		Time m_end;
+		Ptr<const SpectrumValue> m_psd;
+		bool m_subtract; // false for the signals added before the last reset of the noise
+		MmWaveBandRange m_bands; // bands of m_psd carrying power, the only ones subtracted
+	};
+	std::deque<LedgerEntry> m_ledger; // the signals being received, sorted by end time
 };
 
 } // namespace ns3
@@ -29,6 +29,8 @@
 
 #include <list>
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <ns3/log.h>
 #include <ns3/pointer.h>
 #include <stdint.h>
@@ -36,6 +38,11 @@
 #include <stdint.h>
 #include "stdlib.h"
 #include "mmwave-mi-error-model.h"
+#include <ns3/core-config.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-mutex.h>
+#endif
 
 
 
@@ -46,169 +53,169 @@ namespace ns3 {
 
 
 
+/*
+ * MI map of a modulation order. Since the values of the axis are uniformly spaced, the index
+ * of a SINR is ((sinrLin - axis[0]) / (axis[SIZE-1] - axis[0])) * (SIZE-1), the scaling
+ * coefficient is computed once
+ */
+struct MiMap
+{
+  MiMap (const double *mi, const double *axis, uint16_t size)
+    : m_mi (mi),
+      m_axis0 (axis[0]),
+      m_axisMax (axis[size-1]),
+      m_scaling ((size - 1) / (axis[size-1] - axis[0])),
+      m_maxIndex (size - 1)
+  {
+  }
+  const double *m_mi;
+  double m_axis0;
+  double m_axisMax;
+  double m_scaling;
+  double m_maxIndex;
+};
+
+static const MiMap&
+GetMiMap (uint8_t mcs)
+{
+  static const MiMap qpsk (MI_map_qpsk, MI_map_qpsk_axis, MI_MAP_QPSK_SIZE);
+  static const MiMap qam16 (MI_map_16qam, MI_map_16qam_axis, MI_MAP_16QAM_SIZE);
+  static const MiMap qam64 (MI_map_64qam, MI_map_64qam_axis, MI_MAP_64QAM_SIZE);
+  if (mcs <= MI_QPSK_MAX_ID)
+    {
+      return qpsk;
+    }
+  else if (mcs <= MI_16QAM_MAX_ID)
+    {
+      return qam16;
+    }
+  return qam64;
+}
+
+/*
+ * Parameters of the BLER curves for each CB size of cbMiSizeTable and each ECR. A missing curve
+ * is replaced by the curve of the next larger CB size including it, for removing CB size
+ * quantization errors
+ */
+struct MiBlerCurves
+{
+  MiBlerCurves ()
+  {
+    for (int cbIndex = 0; cbIndex < 9; cbIndex++)
+      {
+        for (int ecrId = 0; ecrId <= MI_64QAM_BLER_MAX_ID; ecrId++)
+          {
+            double b = bEcrTable[cbIndex][ecrId];
+            int i = cbIndex;
+            while ((i<9)&&(b<0))
+              {
+                b = bEcrTable[i++][ecrId];
+              }
+            double c = cEcrTable[cbIndex][ecrId];
+            i = cbIndex;
+            while ((i<9)&&(c<0))
+              {
+                c = cEcrTable[i++][ecrId];
+              }
+            m_b[cbIndex][ecrId] = b;
+            m_c[cbIndex][ecrId] = c;
+            m_scaledC[cbIndex][ecrId] = sqrt(2)*c;
+          }
+      }
+  }
+  double m_b[9][38];
+  double m_c[9][38];
+  double m_scaledC[9][38]; // sqrt(2)*c
+};
+
+static const MiBlerCurves&
+GetMiBlerCurves ()
+{
+  static const MiBlerCurves curves;
+  return curves;
+}
+
+
 double 
 MmWaveMiErrorModel::Mib (const SpectrumValue& sinr, const std::vector<int>& map, uint8_t mcs)
 {
   NS_LOG_FUNCTION (sinr << &map << (uint32_t) mcs);
-  
-  double MI;
+
+  // the modulation is the same for all the RBs, the loop reads the SINRs in place and
+  // selects the MI without branches
+  const MiMap &miMap = GetMiMap (mcs);
+  const double *sinrLin = &(*sinr.ConstValuesBegin ());
   double MIsum = 0.0;
-  SpectrumValue sinrCopy = sinr;
-  
   for (uint32_t i = 0; i < map.size (); i++)
     {
-      double sinrLin = sinrCopy[map.at (i)];
-      if (mcs <= MI_QPSK_MAX_ID) // QPSK
-        {
-
-          if (sinrLin > MI_map_qpsk_axis[MI_MAP_QPSK_SIZE-1])
-            {
-              MI = 1;
-            }
-          else 
-            { 
-              // since the values in MI_map_qpsk_axis are uniformly spaced, we have
-              // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-              // the scaling coefficient is always the same, so we use a static const
-              // to speed up the calculation
-              static const double scalingCoeffQpsk = 
-                (MI_MAP_QPSK_SIZE - 1) / (MI_map_qpsk_axis[MI_MAP_QPSK_SIZE-1] - MI_map_qpsk_axis[0]);
-              double sinrIndexDouble = (sinrLin -  MI_map_qpsk_axis[0]) * scalingCoeffQpsk + 1;
-              uint32_t sinrIndex = std::max(0.0, std::floor (sinrIndexDouble));
-              NS_ASSERT_MSG (sinrIndex < MI_MAP_QPSK_SIZE, "MI map out of data");
-              MI = MI_map_qpsk[sinrIndex];
-            }
-        }
-      else
-        {
-          if (mcs > MI_QPSK_MAX_ID && mcs <= MI_16QAM_MAX_ID )	// 16-QAM
-            {
-              if (sinrLin > MI_map_16qam_axis[MI_MAP_16QAM_SIZE-1])
-                {
-                  MI = 1;
-                }
-              else 
-                {
-                  // since the values in MI_map_16QAM_axis are uniformly spaced, we have
-                  // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-                  // the scaling coefficient is always the same, so we use a static const
-                  // to speed up the calculation
-                  static const double scalingCoeff16qam = 
-                    (MI_MAP_16QAM_SIZE - 1) / (MI_map_16qam_axis[MI_MAP_16QAM_SIZE-1] - MI_map_16qam_axis[0]);
-                  double sinrIndexDouble = (sinrLin -  MI_map_16qam_axis[0]) * scalingCoeff16qam + 1;
-                  uint32_t sinrIndex = std::max(0.0, std::floor (sinrIndexDouble));
-                  NS_ASSERT_MSG (sinrIndex < MI_MAP_16QAM_SIZE, "MI map out of data");
-                  MI = MI_map_16qam[sinrIndex];
-                }
-            }
-          else // 64-QAM
-            {
-              if (sinrLin > MI_map_64qam_axis[MI_MAP_64QAM_SIZE-1])
-                {
-                  MI = 1;
-                }
-              else
-                {
-                  // since the values in MI_map_64QAM_axis are uniformly spaced, we have
-                  // index = ((sinrLin - value[0]) / (value[SIZE-1] - value[0])) * (SIZE-1)
-                  // the scaling coefficient is always the same, so we use a static const
-                  // to speed up the calculation
-                  static const double scalingCoeff64qam = 
-                    (MI_MAP_64QAM_SIZE - 1) / (MI_map_64qam_axis[MI_MAP_64QAM_SIZE-1] - MI_map_64qam_axis[0]);
-                  double sinrIndexDouble = (sinrLin -  MI_map_64qam_axis[0]) * scalingCoeff64qam + 1;
-                  uint32_t sinrIndex = std::max(0.0, std::floor (sinrIndexDouble));
-                  NS_ASSERT_MSG (sinrIndex < MI_MAP_64QAM_SIZE, "MI map out of data");
-                  MI = MI_map_64qam[sinrIndex];
-                }
-            }
-        }
-      NS_LOG_LOGIC (" RB " << map.at (i) << "Minimum SNR = " << 10 * std::log10 (sinrLin) << " dB, " << sinrLin << " V, MCS = " << (uint16_t)mcs << ", MI = " << MI);
-      MIsum += MI;
+      double s = sinrLin[map[i]];
+      double sinrIndex = std::min (std::max (0.0, std::floor ((s - miMap.m_axis0) * miMap.m_scaling + 1)), miMap.m_maxIndex);
+      double MI = miMap.m_mi[(uint32_t) sinrIndex];
+      MIsum += (s > miMap.m_axisMax) ? 1.0 : MI;
     }
-  MI = MIsum / map.size ();
+  double MI = MIsum / map.size ();
   NS_LOG_LOGIC (" MI = " << MI);
   return MI;
 }
 
 
-double 
-MmWaveMiErrorModel::MappingMiBler (double mib, uint8_t ecrId, uint32_t cbSize)
+uint8_t
+MmWaveMiErrorModel::GetCbMiSizeIndex (uint32_t cbSize)
 {
-  NS_LOG_FUNCTION (mib << (uint32_t) ecrId << (uint32_t) cbSize);
-  double b = 0;
-  double c = 0;
-
-  NS_ASSERT_MSG (ecrId <= MI_64QAM_BLER_MAX_ID, "ECR out of range [0..37]: " << (uint16_t) ecrId);
   int cbIndex = 1;
   while ((cbIndex < 9)&&(cbMiSizeTable[cbIndex]<= cbSize))
     {
       cbIndex++;
     }
   cbIndex--;
-  NS_LOG_LOGIC (" ECRid " << (uint16_t)ecrId << " ECR " << BlerCurvesEcrMap[ecrId] << " CB size " << cbSize << " CB size curve " << cbMiSizeTable[cbIndex]);
+  return cbIndex;
+}
 
-  b = bEcrTable[cbIndex][ecrId];
-  if (b<0.0)
-    {
-      //take the lowest CB size including this CB for removing CB size
-      //quatization errors
-      int i = cbIndex;
-      while ((i<9)&&(b<0))
-        {
-          b = bEcrTable[i++][ecrId];
-        }
-    }
-  c = cEcrTable[cbIndex][ecrId];
-  if (c<0.0)
-    {
-      //take the lowest CB size including this CB for removing CB size
-      //quatization errors
-      int i = cbIndex;
-      while ((i<9)&&(c<0))
-        {
-          c = cEcrTable[i++][ecrId];
-        }
-    }
+double 
+MmWaveMiErrorModel::MappingMiBler (double mib, uint8_t ecrId, uint32_t cbSize)
+{
+  NS_LOG_FUNCTION (mib << (uint32_t) ecrId << (uint32_t) cbSize);
+  return MappingMiBlerCurve (mib, ecrId, GetCbMiSizeIndex (cbSize));
+}
+
+double
+MmWaveMiErrorModel::MappingMiBlerCurve (double mib, uint8_t ecrId, uint8_t cbIndex)
+{
+  NS_ASSERT_MSG (ecrId <= MI_64QAM_BLER_MAX_ID, "ECR out of range [0..37]: " << (uint16_t) ecrId);
+  NS_LOG_LOGIC (" ECRid " << (uint16_t)ecrId << " ECR " << BlerCurvesEcrMap[ecrId] << " CB size curve " << cbMiSizeTable[cbIndex]);
+  const MiBlerCurves &curves = GetMiBlerCurves ();
+  double b = curves.m_b[cbIndex][ecrId];
   // see IEEE802.16m EMD formula 55 of section 4.3.2.1
-  double bler = 0.5*( 1 - erf((mib-b)/(sqrt(2)*c)) );
-  NS_LOG_LOGIC ("MIB: " << mib << " BLER:" << bler << " b:" << b << " c:" << c);
+  double bler = 0.5*( 1 - erf((mib-b)/curves.m_scaledC[cbIndex][ecrId]) );
+  NS_LOG_LOGIC ("MIB: " << mib << " BLER:" << bler << " b:" << b << " c:" << curves.m_c[cbIndex][ecrId]);
   return bler;
 }
 
-TbStats_t
-MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const std::vector<int>& map, uint32_t size, uint8_t mcs, MmWaveHarqProcessInfoList_t miHistory)
+const CbSegmentation_t&
+MmWaveMiErrorModel::GetCbSegmentation (uint32_t size)
 {
-  NS_LOG_FUNCTION (sinr << &map << (uint32_t) size << (uint32_t) mcs);
-
-  double tbMi = Mib(sinr, map, mcs);
-  double MI = 0.0;
-  double Reff = 0.0;
-  NS_ASSERT (mcs < 29);
-  if (miHistory.size ()>0)
-    {
-      // evaluate R_eff and MI_eff
-      uint32_t codeBitsSum = 0;
-      double miSum = 0.0;
-      for (uint16_t i = 0; i < miHistory.size (); i++)
-        {
-          NS_LOG_DEBUG (" Sum MI " << miHistory.at (i).m_mi << " Ci " << miHistory.at (i).m_codeBits);
-          codeBitsSum += miHistory.at (i).m_codeBits;
-          miSum += (miHistory.at (i).m_mi*miHistory.at (i).m_codeBits);
-        }
-      codeBitsSum += (((double)size*8.0) / McsEcrTable [mcs]);
-      miSum += (tbMi*(((double)size*8.0) / McsEcrTable [mcs]));
-      Reff = miHistory.at (0).m_infoBits / (double)codeBitsSum; // information bits are the size of the first TB
-      MI = miSum / (double)codeBitsSum;
-    }
-  else
+  // there are few different TB sizes. The MCS selection of the schedulers
+  // can run on several threads (see MmWaveEnbMac SchedulingThreads), the
+  // elements of the map are not moved by the insertions of the other threads
+  static std::map<uint32_t, CbSegmentation_t> cache;
+#ifdef HAVE_PTHREAD_H
+  static SystemMutex mutex;
+  CriticalSection lock (mutex);
+#endif
+  std::map<uint32_t, CbSegmentation_t>::iterator it = cache.find (size);
+  if (it == cache.end ())
     {
-      MI = tbMi;
+      it = cache.insert (std::make_pair (size, CalCbSegmentation (size))).first;
     }
-  NS_LOG_DEBUG (" MI " << MI << " Reff " << Reff << " HARQ " << miHistory.size ());
+  return it->second;
+}
+
+CbSegmentation_t
+MmWaveMiErrorModel::CalCbSegmentation (uint32_t size)
+{
   // estimate CB size (according to sec 5.1.2 of TS 36.212)
   uint16_t Z = 6144; // max size of a codeblock (including CRC)
   uint32_t B = size * 8;
-//   B = 1234;
   uint32_t L = 0;
   uint32_t C = 0; // no. of codeblocks
   uint32_t Cplus = 0; // no. of codeblocks with size K+
@@ -231,15 +238,6 @@ MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const s
       B1 = B + C * L;
     }
   // first segmentation: K+ = minimum K in table such that C * K >= B1
-//   uint i = 0;
-//   while (B1 > cbSizeTable[i] * C)
-//     {
-// //       NS_LOG_INFO (" K+ " << cbSizeTable[i] << " means " << cbSizeTable[i] * C);
-//       i++;
-//     }
-//   uint32_t KplusId = i;
-//   Kplus = cbSizeTable[i];
-
   // implement a modified binary search
   int min = 0;
   int max = 187;
@@ -297,7 +295,116 @@ MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const s
     }
   NS_LOG_INFO ("--------------------LteMiErrorModel: TB size of " << B << " needs of " << B1 << " bits reparted in " << C << " CBs as "<< Cplus << " block(s) of " << Kplus << " and " << Cminus << " of " << Kminus);
 
+  CbSegmentation_t segmentation;
+  segmentation.b1 = B1;
+  segmentation.c = C;
+  segmentation.cPlus = Cplus;
+  segmentation.kPlus = Kplus;
+  segmentation.cMinus = Cminus;
+  segmentation.kMinus = Kminus;
+  segmentation.cbIndexPlus = GetCbMiSizeIndex (Kplus);
+  segmentation.cbIndexMinus = GetCbMiSizeIndex (Kminus);
+  return segmentation;
+}
+
+double
+MmWaveMiErrorModel::CalTbBler (double mib, uint8_t ecrId, const CbSegmentation_t& segmentation)
+{
   double errorRate = 1.0;
+  if (segmentation.c!=1)
+    {
+      double cbler = MappingMiBlerCurve (mib, ecrId, segmentation.cbIndexPlus);
+      errorRate *= pow (1.0 - cbler, segmentation.cPlus);
+      cbler = MappingMiBlerCurve (mib, ecrId, segmentation.cbIndexMinus);
+      errorRate *= pow (1.0 - cbler, segmentation.cMinus);
+      errorRate = 1.0 - errorRate;
+    }
+  else
+    {
+      errorRate = MappingMiBlerCurve (mib, ecrId, segmentation.cbIndexPlus);
+    }
+  return errorRate;
+}
+
+double
+MmWaveMiErrorModel::GetTbBler (double mib, uint32_t size, uint8_t mcs)
+{
+  NS_ASSERT (mcs < 29);
+  return CalTbBler (mib, McsEcrBlerTableMapping[mcs], GetCbSegmentation (size));
+}
+
+TbStats_t
+MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const std::vector<int>& map, uint32_t size, uint8_t mcs, const MmWaveHarqProcessInfoList_t& miHistory)
+{
+  NS_LOG_FUNCTION (sinr << &map << (uint32_t) size << (uint32_t) mcs);
+
+  return CalTbStats (Mib (sinr, map, mcs), size, mcs, miHistory);
+}
+
+void
+MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, std::vector<TbDecodeInfo_t>& tbs)
+{
+  NS_LOG_FUNCTION (sinr << tbs.size ());
+
+  // MI of each RB for the QPSK, 16QAM and 64QAM maps, computed as in Mib at the first TB
+  // using the modulation
+  std::vector<double> rbMi[3];
+  const double *sinrLin = &(*sinr.ConstValuesBegin ());
+  uint32_t numRb = sinr.GetSpectrumModel ()->GetNumBands ();
+  for (std::vector<TbDecodeInfo_t>::iterator tb = tbs.begin (); tb != tbs.end (); ++tb)
+    {
+      uint8_t modulation = tb->mcs <= MI_QPSK_MAX_ID ? 0 : (tb->mcs <= MI_16QAM_MAX_ID ? 1 : 2);
+      std::vector<double> &mi = rbMi[modulation];
+      if (mi.empty ())
+        {
+          const MiMap &miMap = GetMiMap (tb->mcs);
+          mi.resize (numRb);
+          for (uint32_t i = 0; i < numRb; i++)
+            {
+              double s = sinrLin[i];
+              double sinrIndex = std::min (std::max (0.0, std::floor ((s - miMap.m_axis0) * miMap.m_scaling + 1)), miMap.m_maxIndex);
+              mi[i] = (s > miMap.m_axisMax) ? 1.0 : miMap.m_mi[(uint32_t) sinrIndex];
+            }
+        }
+      const std::vector<int> &map = *tb->map;
+      double MIsum = 0.0;
+      for (uint32_t i = 0; i < map.size (); i++)
+        {
+          MIsum += mi[map[i]];
+        }
+      tb->stats = CalTbStats (MIsum / map.size (), tb->size, tb->mcs, *tb->miHistory);
+    }
+}
+
+TbStats_t
+MmWaveMiErrorModel::CalTbStats (double tbMi, uint32_t size, uint8_t mcs, const MmWaveHarqProcessInfoList_t& miHistory)
+{
+  double MI = 0.0;
+  double Reff = 0.0;
+  NS_ASSERT (mcs < 29);
+  if (miHistory.size ()>0)
+    {
+      // evaluate R_eff and MI_eff
+      uint32_t codeBitsSum = 0;
+      double miSum = 0.0;
+      for (uint16_t i = 0; i < miHistory.size (); i++)
+        {
+          NS_LOG_DEBUG (" Sum MI " << miHistory.at (i).m_mi << " Ci " << miHistory.at (i).m_codeBits);
+          codeBitsSum += miHistory.at (i).m_codeBits;
+          miSum += (miHistory.at (i).m_mi*miHistory.at (i).m_codeBits);
+        }
+      codeBitsSum += (((double)size*8.0) / McsEcrTable [mcs]);
+      miSum += (tbMi*(((double)size*8.0) / McsEcrTable [mcs]));
+      Reff = miHistory.at (0).m_infoBits / (double)codeBitsSum; // information bits are the size of the first TB
+      MI = miSum / (double)codeBitsSum;
+    }
+  else
+    {
+      MI = tbMi;
+    }
+  NS_LOG_DEBUG (" MI " << MI << " Reff " << Reff << " HARQ " << miHistory.size ());
+  const CbSegmentation_t &segmentation = GetCbSegmentation (size);
+
   uint8_t ecrId = 0;
   if (miHistory.size ()==0)
     {
@@ -342,19 +449,7 @@ MmWaveMiErrorModel::GetTbDecodificationStats (const SpectrumValue& sinr, const s
       NS_LOG_DEBUG ("HARQ ECR " << (uint16_t)ecrId);
     }
 
-  if (C!=1)
-    {
-      double cbler = MappingMiBler (MI, ecrId, Kplus);
-      errorRate *= pow (1.0 - cbler, Cplus);
-      cbler = MappingMiBler (MI, ecrId, Kminus);
-      errorRate *= pow (1.0 - cbler, Cminus);
-      errorRate = 1.0 - errorRate;
-    }
-  else
-    {
-      errorRate = MappingMiBler (MI, ecrId, Kplus);
-    }
-
+  double errorRate = CalTbBler (MI, ecrId, segmentation);
   NS_LOG_LOGIC (" Error rate " << errorRate);
   TbStats_t ret;
   ret.tbler = errorRate;
@@ -58,6 +58,34 @@ struct TbStats_t
   double mi;
   double miTotal;
 };
+
+/**
+ * A TB of a batch decoded by MmWaveMiErrorModel::GetTbDecodificationStats, the map and the
+ * HARQ history are referenced and must outlive the call
+ */
+struct TbDecodeInfo_t
+{
+  const std::vector<int> *map; // the active RBs of the TB
+  uint32_t size; // the size in bytes of the TB
+  uint8_t mcs;
+  const MmWaveHarqProcessInfoList_t *miHistory; // the HARQ history of the TB
+  TbStats_t stats; // written by GetTbDecodificationStats
+};
+
+/**
+ * Codeblock segmentation of a TB (sec 5.1.2 of TS 36.212)
+ */
+struct CbSegmentation_t
+{
+  uint32_t b1; // bits of the TB including the CRCs of the codeblocks
+  uint32_t c; // no. of codeblocks
+  uint32_t cPlus; // no. of codeblocks with size K+
+  uint32_t kPlus;
+  uint32_t cMinus; // no. of codeblocks with size K-
+  uint32_t kMinus;
+  uint8_t cbIndexPlus; // index of the BLER curve of K+ in cbMiSizeTable
+  uint8_t cbIndexMinus; // index of the BLER curve of K- in cbMiSizeTable
+};
   
 // global table of the effective code rates (ECR)s that have BLER performance curves
 static const double BlerCurvesEcrMap[38] = {
@@ -345,13 +373,78 @@ public:
    * \param mcs the MCS of the TB
    * \return the TB error rate and MI
    */
-  static TbStats_t GetTbDecodificationStats (const SpectrumValue& sinr, const std::vector<int>& map, uint32_t size, uint8_t mcs, MmWaveHarqProcessInfoList_t miHistory);
+  static TbStats_t GetTbDecodificationStats (const SpectrumValue& sinr, const std::vector<int>& map, uint32_t size, uint8_t mcs, const MmWaveHarqProcessInfoList_t& miHistory);
+
+  /**
+   * \brief run the error-model algorithm for all the TBs received with the same SINR. The MI
+   * of each RB is computed once for each modulation order used by the TBs, and the mmib of
+   * each TB is then averaged over its RBs. The results are the same as with one call of
+   * GetTbDecodificationStats for each TB
+   * \param sinr the perceived sinrs in the whole bandwidth
+   * \param tbs the TBs, their stats are written in place
+   */
+  static void GetTbDecodificationStats (const SpectrumValue& sinr, std::vector<TbDecodeInfo_t>& tbs);
+
+  /**
+   * \brief get the codeblock segmentation of a TB, the segmentations are computed
+   * once for each TB size and then cached
+   * \param size the size in bytes of the TB
+   * \return the segmentation
+   */
+  static const CbSegmentation_t& GetCbSegmentation (uint32_t size);
+
+  /**
+   * \brief get the error rate of the first transmission of a TB, the MI of the RBs can be
+   * computed once with Mib for each modulation order and used for all the MCSs of the order
+   * \param mib the mmib of the RBs for the modulation of the MCS
+   * \param size the size in bytes of the TB
+   * \param mcs the MCS of the TB
+   * \return the TB error rate, as given by GetTbDecodificationStats without HARQ history
+   */
+  static double GetTbBler (double mib, uint32_t size, uint8_t mcs);
 
+private:
+  /**
+   * \brief compute the codeblock segmentation of a TB
+   * \param size the size in bytes of the TB
+   * \return the segmentation
+   */
+  static CbSegmentation_t CalCbSegmentation (uint32_t size);
 
-//private:
+  /**
+   * \brief find the BLER curve of a CB size
+   * \param cbSize the size of the CB
+   * \return the index of the largest size of cbMiSizeTable not larger than cbSize
+   */
+  static uint8_t GetCbMiSizeIndex (uint32_t cbSize);
 
+  /**
+   * \brief map the mmib to the code block error rate with the cached BLER curves
+   * \param mib mean mutual information per bit of a code-block
+   * \param ecrId Effective Code Rate ID
+   * \param cbIndex the index of the CB size in cbMiSizeTable
+   * \return the code block error rate
+   */
+  static double MappingMiBlerCurve (double mib, uint8_t ecrId, uint8_t cbIndex);
 
+  /**
+   * \brief compute the TB error rate from the code block error rates
+   * \param mib the effective mmib
+   * \param ecrId Effective Code Rate ID
+   * \param segmentation the codeblock segmentation of the TB
+   * \return the TB error rate
+   */
+  static double CalTbBler (double mib, uint8_t ecrId, const CbSegmentation_t& segmentation);
 
+  /**
+   * \brief run the error-model algorithm for a TB whose mmib is known
+   * \param tbMi the mmib of the RBs of the TB
+   * \param size the size in bytes of the TB
+   * \param mcs the MCS of the TB
+   * \param miHistory the HARQ history of the TB
+   * \return the TB error rate and MI
+   */
+  static TbStats_t CalTbStats (double tbMi, uint32_t size, uint8_t mcs, const MmWaveHarqProcessInfoList_t& miHistory);
 };
 
 
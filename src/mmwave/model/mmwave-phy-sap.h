@@ -49,9 +49,14 @@ public:
 
 	virtual void SendRachPreamble(uint8_t PreambleId, uint8_t Rnti) = 0;
 
-	virtual void SetDlSfAllocInfo (SfAllocInfo sfAllocInfo) = 0;
+	/**
+	 * \brief Set the allocation of a future subframe, copied in the containers
+	 * of the allocation the PHY keeps for the subframe
+	 * @params sfAllocInfo the allocation
+	 */
+	virtual void SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo) = 0;
 
-	virtual void SetUlSfAllocInfo (SfAllocInfo sfAllocInfo) = 0;
+	virtual void SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo) = 0;
 };
 
 /* Phy to Mac comm */
@@ -86,7 +91,7 @@ public:
    * \brief Returns to MAC level the UL-CQI evaluated
    * \param ulcqi the UL-CQI (see FF MAC API 4.3.29)
    */
-	virtual void UlCqiReport (MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters ulcqi) = 0;
+	virtual void UlCqiReport (const MmWaveMacSchedSapProvider::SchedUlCqiInfoReqParameters& ulcqi) = 0;
 
 	/**
 	 * notify the reception of a RACH preamble on the PRACH
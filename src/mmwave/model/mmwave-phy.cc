@@ -56,9 +56,9 @@ public:
 
 	virtual void SendRachPreamble(uint8_t PreambleId, uint8_t Rnti);
 
-	virtual void SetDlSfAllocInfo (SfAllocInfo sfAllocInfo);
+	virtual void SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo);
 
-	virtual void SetUlSfAllocInfo (SfAllocInfo sfAllocInfo);
+	virtual void SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo);
 
 private:
 	MmWavePhy* m_phy;
@@ -89,13 +89,13 @@ MmWaveMemberPhySapProvider::SendRachPreamble(uint8_t PreambleId, uint8_t Rnti)
 }
 
 void
-MmWaveMemberPhySapProvider::SetDlSfAllocInfo (SfAllocInfo sfAllocInfo)
+MmWaveMemberPhySapProvider::SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
 {
 	m_phy->SetDlSfAllocInfo (sfAllocInfo);
 }
 
 void
-MmWaveMemberPhySapProvider::SetUlSfAllocInfo (SfAllocInfo sfAllocInfo)
+MmWaveMemberPhySapProvider::SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
 {
 	m_phy->SetUlSfAllocInfo (sfAllocInfo);
 }
@@ -319,18 +319,19 @@ MmWavePhy::GetSfAllocInfo (uint8_t subframeNum)
 }
 
 void
-MmWavePhy::SetDlSfAllocInfo (SfAllocInfo sfAllocInfo)
+MmWavePhy::SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
 {
 	// get previously enqueued SfAllocInfo and set DL slot allocations
 	//SfAllocInfo &sf = m_sfAllocInfo[sfAllocInfo.m_sfnSf.m_sfNum];
 	// merge slot lists
 	//sf.m_dlSlotAllocInfo = sfAllocInfo.m_dlSlotAllocInfo;
+	// the assignment reuses the slots and the RLC PDU vectors of the allocation in place
 	m_sfAllocInfo[sfAllocInfo.m_sfnSf.m_sfNum] = sfAllocInfo;
 	//m_sfAllocInfoUpdated = true;
 }
 
 void
-MmWavePhy::SetUlSfAllocInfo (SfAllocInfo sfAllocInfo)
+MmWavePhy::SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
 {
 	// add new SfAllocInfo with UL slot allocation
 	//m_sfAllocInfo[sfAllocInfo.m_sfnSf.m_sfNum] = sfAllocInfo;
@@ -110,8 +110,8 @@ public:
 	void UpdateCurrentAllocationAndSchedule (uint32_t frame, uint32_t sf);
 
 	SfAllocInfo GetSfAllocInfo (uint8_t subframeNum);
-	void SetDlSfAllocInfo (SfAllocInfo sfAllocInfo);
-	void SetUlSfAllocInfo (SfAllocInfo sfAllocInfo);
+	void SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo);
+	void SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo);
 
 protected:
 	Ptr<MmWaveNetDevice> m_netDevice;
@@ -0,0 +1,467 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ *   Author: Marco Mezzavilla < mezzavilla@nyu.edu>
+ *        	 Sourjya Dutta <sdutta@nyu.edu>
+ *        	 Russell Ford <russell.ford@nyu.edu>
+ *        	 Menglei Zhang <menglei@nyu.edu>
+ */
+
+#include "mmwave-raytracing-trace.h"
+#include <ns3/log.h>
+#include <ns3/assert.h>
+#include <ns3/abort.h>
+#include <algorithm>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ns3{
+
+NS_LOG_COMPONENT_DEFINE ("MmWaveRaytracingTrace");
+
+// header of the binary format
+static const char RAYTRACING_MAGIC[8] = {'M', 'M', 'W', 'R', 'T', 'R', 'C', '1'};
+static const uint64_t RAYTRACING_VERSION = ((uint64_t)0x01020304 << 32) | 1; // byte order mark and version
+static const uint64_t RAYTRACING_HEADER_WORDS = 3; // magic, version, number of snapshots
+static const uint64_t RAYTRACING_RECORD_HEADER_WORDS = 1 + RAYTRACING_NUM_FIELDS; // paths, field lengths
+
+/*
+ * Read words at a word position of a file, returns false if the file is too short
+ */
+static bool
+ReadWords (int fd, uint64_t *words, uint64_t numWords, uint64_t position)
+{
+	char *buffer = reinterpret_cast<char *> (words);
+	uint64_t size = numWords*sizeof (uint64_t);
+	uint64_t done = 0;
+	while (done < size)
+	{
+		ssize_t n = pread (fd, buffer + done, size - done, position*sizeof (uint64_t) + done);
+		if (n <= 0)
+		{
+			return false;
+		}
+		done += n;
+	}
+	return true;
+}
+
+MmWaveRaytracingTrace::MmWaveRaytracingTrace ()
+	: m_map (0),
+	  m_mapSize (0),
+	  m_words (0),
+	  m_numWords (0),
+	  m_numSnapshots (0),
+	  m_windowSize (0),
+	  m_fd (-1),
+	  m_prefetchWindow (0)
+{
+	m_current.m_index = NO_WINDOW;
+	m_next.m_index = NO_WINDOW;
+}
+
+MmWaveRaytracingTrace::~MmWaveRaytracingTrace ()
+{
+	Close ();
+}
+
+void
+MmWaveRaytracingTrace::Close ()
+{
+#ifdef HAVE_PTHREAD_H
+	if (m_prefetch != 0)
+	{
+		m_prefetch->Join ();
+		m_prefetch = 0;
+	}
+#endif
+	if (m_map != 0)
+	{
+		munmap (m_map, m_mapSize);
+		m_map = 0;
+		m_mapSize = 0;
+	}
+	if (m_fd >= 0)
+	{
+		close (m_fd);
+		m_fd = -1;
+	}
+	if (m_text.is_open ())
+	{
+		m_text.close ();
+	}
+	m_textWindows.clear ();
+	m_current.m_index = NO_WINDOW;
+	m_current.m_offsets.clear ();
+	m_current.m_words.clear ();
+	m_next.m_index = NO_WINDOW;
+	m_next.m_offsets.clear ();
+	m_next.m_words.clear ();
+	m_buffer.clear ();
+	m_words = 0;
+	m_numWords = 0;
+	m_numSnapshots = 0;
+	m_windowSize = 0;
+}
+
+void
+MmWaveRaytracingTrace::Open (std::string filename, uint32_t windowSize)
+{
+	Close ();
+	std::ifstream file (filename.c_str (), std::ifstream::in | std::ifstream::binary);
+	NS_ABORT_MSG_IF (!file.good (), "Raytracing file " << filename << " not found");
+	char magic[sizeof (RAYTRACING_MAGIC)];
+	file.read (magic, sizeof (magic));
+	bool binary = file.gcount () == sizeof (magic) && memcmp (magic, RAYTRACING_MAGIC, sizeof (magic)) == 0;
+	file.close ();
+
+	if (windowSize > 0)
+	{
+		m_windowSize = windowSize;
+		OpenStream (filename, binary);
+	}
+	else if (binary)
+	{
+		MapBinary (filename);
+	}
+	else
+	{
+		ParseText (filename);
+	}
+	NS_LOG_INFO ("Raytracing file " << filename << (windowSize > 0 ? " streamed, " : (binary ? " mapped, " : " parsed, "))
+			<< m_numSnapshots << " snapshots");
+}
+
+bool
+MmWaveRaytracingTrace::ReadTextSnapshot (std::istream &in, std::vector<uint64_t> &records)
+{
+	// the line with the number of paths followed by one line for each field
+	std::string line;
+	uint64_t numPath = 0;
+	doubleVector_t fields[RAYTRACING_NUM_FIELDS];
+	for (uint8_t counter = 0; counter < RAYTRACING_NUM_FIELDS + 1; counter++)
+	{
+		if (!std::getline (in, line))
+		{
+			if (counter == 0)
+			{
+				return false;
+			}
+			break;
+		}
+
+		// parse the comma separated values, an empty value is 0
+		doubleVector_t path;
+		const char *begin = line.c_str ();
+		const char *end = begin + line.size ();
+		while (begin < end)
+		{
+			const char *comma = std::find (begin, end, ',');
+			std::string token (begin, comma);
+			path.push_back (strtod (token.c_str (), 0));
+			begin = comma + 1;
+		}
+
+		if (counter == 0)
+		{
+			NS_ABORT_MSG_IF (path.empty (), "Raytracing file: missing number of paths");
+			numPath = path.at (0);
+		}
+		else
+		{
+			fields[counter - 1] = path;
+		}
+	}
+
+	records.push_back (numPath);
+	for (uint8_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+	{
+		records.push_back (fields[f].size ());
+	}
+	for (uint8_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+	{
+		for (uint32_t i = 0; i < fields[f].size (); i++)
+		{
+			uint64_t word;
+			memcpy (&word, &fields[f][i], sizeof (word));
+			records.push_back (word);
+		}
+	}
+	return true;
+}
+
+void
+MmWaveRaytracingTrace::ParseText (std::string filename)
+{
+	std::ifstream singlefile;
+	singlefile.open (filename.c_str (), std::ifstream::in);
+	NS_ABORT_MSG_IF (!singlefile.good (), "Raytracing file " << filename << " not found");
+
+	std::vector<uint64_t> records;
+	std::vector<uint64_t> offsets;
+	while (true)
+	{
+		uint64_t start = records.size ();
+		if (!ReadTextSnapshot (singlefile, records))
+		{
+			break;
+		}
+		offsets.push_back (start);
+	}
+
+	uint64_t numSnapshots = offsets.size ();
+	uint64_t recordStart = RAYTRACING_HEADER_WORDS + numSnapshots + 1;
+	m_buffer.resize (recordStart + records.size ());
+	memcpy (&m_buffer[0], RAYTRACING_MAGIC, sizeof (RAYTRACING_MAGIC));
+	m_buffer[1] = RAYTRACING_VERSION;
+	m_buffer[2] = numSnapshots;
+	for (uint64_t i = 0; i < numSnapshots; i++)
+	{
+		m_buffer[RAYTRACING_HEADER_WORDS + i] = recordStart + offsets[i];
+	}
+	m_buffer[RAYTRACING_HEADER_WORDS + numSnapshots] = recordStart + records.size ();
+	std::copy (records.begin (), records.end (), m_buffer.begin () + recordStart);
+	SetImage (&m_buffer[0], m_buffer.size ());
+}
+
+void
+MmWaveRaytracingTrace::MapBinary (std::string filename)
+{
+	int fd = open (filename.c_str (), O_RDONLY);
+	NS_ABORT_MSG_IF (fd < 0, "Raytracing file " << filename << " cannot be opened");
+	struct stat st;
+	NS_ABORT_MSG_IF (fstat (fd, &st) != 0, "Raytracing file " << filename << " cannot be read");
+	m_mapSize = st.st_size;
+	// shared read-only mapping, the pages are loaded on the first access to a snapshot
+	// and are shared with the other processes mapping the same file
+	void *map = mmap (0, m_mapSize, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	NS_ABORT_MSG_IF (map == MAP_FAILED, "Raytracing file " << filename << " cannot be mapped");
+	m_map = map;
+	SetImage (static_cast<const uint64_t *> (m_map), m_mapSize/sizeof (uint64_t));
+}
+
+void
+MmWaveRaytracingTrace::SetImage (const uint64_t *words, uint64_t numWords)
+{
+	NS_ABORT_MSG_IF (numWords < RAYTRACING_HEADER_WORDS + 1
+			|| memcmp (words, RAYTRACING_MAGIC, sizeof (RAYTRACING_MAGIC)) != 0,
+			"Not a raytracing binary file");
+	NS_ABORT_MSG_IF (words[1] != RAYTRACING_VERSION, "Unsupported raytracing file version or byte order");
+	uint64_t numSnapshots = words[2];
+	NS_ABORT_MSG_IF (numSnapshots > 0xffffffff || RAYTRACING_HEADER_WORDS + numSnapshots + 1 > numWords,
+			"Corrupted raytracing file");
+	const uint64_t *offsets = words + RAYTRACING_HEADER_WORDS;
+	for (uint64_t i = 0; i < numSnapshots; i++)
+	{
+		NS_ABORT_MSG_IF (offsets[i] + RAYTRACING_RECORD_HEADER_WORDS > offsets[i + 1] || offsets[i + 1] > numWords,
+				"Corrupted raytracing file");
+	}
+	m_words = words;
+	m_numWords = numWords;
+	m_numSnapshots = numSnapshots;
+}
+
+uint32_t
+MmWaveRaytracingTrace::GetNumSnapshots () const
+{
+	return m_numSnapshots;
+}
+
+bool
+MmWaveRaytracingTrace::IsMapped () const
+{
+	return m_map != 0;
+}
+
+RaytracingSnapshot
+MmWaveRaytracingTrace::MakeSnapshot (const uint64_t *words, uint64_t begin, uint64_t end, uint32_t index)
+{
+	NS_ABORT_MSG_IF (begin + RAYTRACING_RECORD_HEADER_WORDS > end, "Corrupted raytracing snapshot " << index);
+	const uint64_t *record = words + begin;
+
+	RaytracingSnapshot snapshot;
+	snapshot.m_numPath = record[0];
+	uint64_t position = begin + RAYTRACING_RECORD_HEADER_WORDS;
+	for (uint8_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+	{
+		uint64_t length = record[1 + f];
+		NS_ABORT_MSG_IF (position + length > end, "Corrupted raytracing snapshot " << index);
+		snapshot.m_field[f] = reinterpret_cast<const double *> (words + position);
+		snapshot.m_fieldLength[f] = length;
+		position += length;
+	}
+	return snapshot;
+}
+
+RaytracingSnapshot
+MmWaveRaytracingTrace::GetSnapshot (uint32_t index)
+{
+	NS_ASSERT_MSG (index < m_numSnapshots, "The maximum trace index is reached");
+	if (m_windowSize == 0)
+	{
+		return MakeSnapshot (m_words, m_words[RAYTRACING_HEADER_WORDS + index],
+				m_words[RAYTRACING_HEADER_WORDS + index + 1], index);
+	}
+	MoveWindow (index / m_windowSize);
+	uint32_t i = index - m_current.m_first;
+	return MakeSnapshot (&m_current.m_words[0], m_current.m_offsets[i], m_current.m_offsets[i + 1], index);
+}
+
+void
+MmWaveRaytracingTrace::OpenStream (std::string filename, bool binary)
+{
+	if (binary)
+	{
+		m_fd = open (filename.c_str (), O_RDONLY);
+		NS_ABORT_MSG_IF (m_fd < 0, "Raytracing file " << filename << " cannot be opened");
+		uint64_t header[RAYTRACING_HEADER_WORDS];
+		NS_ABORT_MSG_IF (!ReadWords (m_fd, header, RAYTRACING_HEADER_WORDS, 0), "Not a raytracing binary file");
+		NS_ABORT_MSG_IF (header[1] != RAYTRACING_VERSION, "Unsupported raytracing file version or byte order");
+		NS_ABORT_MSG_IF (header[2] > 0xffffffff, "Corrupted raytracing file");
+		m_numSnapshots = header[2];
+		return;
+	}
+
+	// count the snapshots, one every 8 lines, and keep the position of each window
+	m_text.open (filename.c_str (), std::ifstream::in);
+	NS_ABORT_MSG_IF (!m_text.good (), "Raytracing file " << filename << " not found");
+	uint64_t linesPerWindow = (uint64_t)(RAYTRACING_NUM_FIELDS + 1)*m_windowSize;
+	uint64_t numLines = 0;
+	std::string line;
+	while (true)
+	{
+		std::streampos position = m_text.tellg ();
+		if (!std::getline (m_text, line))
+		{
+			break;
+		}
+		if (numLines % linesPerWindow == 0)
+		{
+			m_textWindows.push_back (position);
+		}
+		numLines++;
+	}
+	m_text.clear ();
+	uint64_t numSnapshots = (numLines + RAYTRACING_NUM_FIELDS)/(RAYTRACING_NUM_FIELDS + 1);
+	NS_ABORT_MSG_IF (numSnapshots > 0xffffffff, "Raytracing file " << filename << " is too long");
+	m_numSnapshots = numSnapshots;
+}
+
+void
+MmWaveRaytracingTrace::ReadWindow (uint32_t index, Window &window)
+{
+	uint32_t first = index*m_windowSize;
+	uint32_t count = std::min (m_windowSize, m_numSnapshots - first);
+	window.m_index = index;
+	window.m_first = first;
+	window.m_offsets.clear ();
+	window.m_words.clear ();
+
+	if (m_fd >= 0)
+	{
+		window.m_offsets.resize (count + 1);
+		NS_ABORT_MSG_IF (!ReadWords (m_fd, &window.m_offsets[0], count + 1, RAYTRACING_HEADER_WORDS + first),
+				"Corrupted raytracing file");
+		uint64_t base = window.m_offsets[0];
+		for (uint32_t i = 0; i < count; i++)
+		{
+			NS_ABORT_MSG_IF (window.m_offsets[i] + RAYTRACING_RECORD_HEADER_WORDS > window.m_offsets[i + 1],
+					"Corrupted raytracing file");
+		}
+		window.m_words.resize (window.m_offsets[count] - base);
+		NS_ABORT_MSG_IF (!ReadWords (m_fd, &window.m_words[0], window.m_words.size (), base),
+				"Corrupted raytracing file");
+		for (uint32_t i = 0; i <= count; i++)
+		{
+			window.m_offsets[i] -= base;
+		}
+	}
+	else
+	{
+		m_text.clear ();
+		m_text.seekg (m_textWindows.at (index));
+		for (uint32_t i = 0; i < count; i++)
+		{
+			window.m_offsets.push_back (window.m_words.size ());
+			NS_ABORT_MSG_IF (!ReadTextSnapshot (m_text, window.m_words), "Corrupted raytracing file");
+		}
+		window.m_offsets.push_back (window.m_words.size ());
+	}
+}
+
+void
+MmWaveRaytracingTrace::MoveWindow (uint32_t index)
+{
+	if (m_current.m_index == index)
+	{
+		return;
+	}
+#ifdef HAVE_PTHREAD_H
+	if (m_prefetch != 0)
+	{
+		m_prefetch->Join ();
+		m_prefetch = 0;
+	}
+#endif
+	if (m_next.m_index == index)
+	{
+		std::swap (m_current, m_next);
+	}
+	else
+	{
+		NS_LOG_INFO ("Raytracing window " << index << " not prefetched, read on the simulation thread");
+		ReadWindow (index, m_current);
+	}
+	// drop the previous window, its storage is reused by the next one
+	m_next.m_index = NO_WINDOW;
+
+#ifdef HAVE_PTHREAD_H
+	if ((uint64_t)(index + 1)*m_windowSize < m_numSnapshots)
+	{
+		m_prefetchWindow = index + 1;
+		m_prefetch = Create<SystemThread> (MakeCallback (&MmWaveRaytracingTrace::Prefetch, this));
+		m_prefetch->Start ();
+	}
+#endif
+}
+
+void
+MmWaveRaytracingTrace::Prefetch ()
+{
+	ReadWindow (m_prefetchWindow, m_next);
+}
+
+void
+MmWaveRaytracingTrace::ConvertTextToBinary (std::string textFile, std::string binaryFile)
+{
+	MmWaveRaytracingTrace trace;
+	trace.ParseText (textFile);
+	std::ofstream out (binaryFile.c_str (), std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+	NS_ABORT_MSG_IF (!out.good (), "Raytracing file " << binaryFile << " cannot be created");
+	out.write (reinterpret_cast<const char *> (&trace.m_buffer[0]), trace.m_buffer.size ()*sizeof (uint64_t));
+	NS_ABORT_MSG_IF (!out.good (), "Raytracing file " << binaryFile << " cannot be written");
+	NS_LOG_INFO ("Converted " << textFile << " to " << binaryFile << ", " << trace.m_numSnapshots << " snapshots");
+}
+
+}// namespace ns3
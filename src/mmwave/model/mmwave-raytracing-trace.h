@@ -0,0 +1,228 @@
+ /* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+ /*
+ *   Copyright (c) 2015, NYU WIRELESS, Tandon School of Engineering, New York University
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2 as
+ *   published by the Free Software Foundation;
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ *   Author: Marco Mezzavilla < mezzavilla@nyu.edu>
+ *        	 Sourjya Dutta <sdutta@nyu.edu>
+ *        	 Russell Ford <russell.ford@nyu.edu>
+ *        	 Menglei Zhang <menglei@nyu.edu>
+ */
+
+
+#ifndef MMWAVE_RAYTRACING_TRACE_H_
+#define MMWAVE_RAYTRACING_TRACE_H_
+
+#include <ns3/simple-ref-count.h>
+#include <ns3/ptr.h>
+#include <ns3/core-config.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-thread.h>
+#endif
+
+namespace ns3{
+
+typedef std::vector<double> doubleVector_t;
+
+/**
+ * Fields of a raytracing snapshot, in the order of the lines of the text format.
+ * The text format has one line with the number of paths followed by one line for each field,
+ * the values of a line are separated by commas
+ */
+enum RaytracingField
+{
+	RAYTRACING_DELAY = 0, // delay spread in ns
+	RAYTRACING_PATHLOSS, // pathloss in dB
+	RAYTRACING_PHASE,
+	RAYTRACING_AOD_ELEVATION, // degree
+	RAYTRACING_AOD_AZIMUTH, // degree
+	RAYTRACING_AOA_ELEVATION, // degree
+	RAYTRACING_AOA_AZIMUTH, // degree
+	RAYTRACING_NUM_FIELDS
+};
+
+/**
+ * The multipath components of one position of the raytracing trace. The values point to
+ * the storage of the MmWaveRaytracingTrace and are valid as long as the trace is alive,
+ * or, when the trace is streamed, until a snapshot of another window is requested
+ */
+struct RaytracingSnapshot
+{
+	uint32_t m_numPath; // number of multipath components
+	const double *m_field[RAYTRACING_NUM_FIELDS];
+	uint32_t m_fieldLength[RAYTRACING_NUM_FIELDS];
+
+	/**
+	 * Returns a copy of the values of a field
+	 * @params the field
+	 */
+	doubleVector_t GetField (RaytracingField field) const
+	{
+		return doubleVector_t (m_field[field], m_field[field] + m_fieldLength[field]);
+	}
+};
+
+/**
+ * \brief Raytracing trace read from a text file or from a binary file.
+ * The binary file, written by ConvertTextToBinary, is mapped read-only in memory, so that its
+ * pages are loaded when a snapshot is first accessed and are shared by all the processes
+ * that use the same file. A text file is parsed into the same layout in memory.
+ *
+ * The binary layout is made of 64 bit words: the magic "MMWRTRC1", the version and a byte
+ * order mark, the number of snapshots N, the N+1 word offsets of the snapshot records and the
+ * records. A record holds the number of paths, the length of each field and then the values.
+ *
+ * With a window size, the trace is streamed instead: only the window of snapshots containing
+ * the last requested index is kept in memory, and the following window is read on a background
+ * thread, so that traces of any length are run in bounded memory as long as the snapshots are
+ * requested in increasing order. The older windows are dropped.
+ */
+class MmWaveRaytracingTrace : public SimpleRefCount<MmWaveRaytracingTrace>
+{
+public:
+	MmWaveRaytracingTrace ();
+	~MmWaveRaytracingTrace ();
+
+	/**
+	 * Open a trace file, a binary file is recognized by its magic, any other file is parsed as text
+	 * @params the file name
+	 * @params the number of snapshots of a streaming window, 0 to load the whole trace
+	 */
+	void Open (std::string filename, uint32_t windowSize = 0);
+
+	uint32_t GetNumSnapshots () const;
+
+	/**
+	 * Returns the snapshot of a trace index, when the trace is streamed the window of the
+	 * index is loaded and the next one is prefetched
+	 * @params the trace index, smaller than GetNumSnapshots ()
+	 */
+	RaytracingSnapshot GetSnapshot (uint32_t index);
+
+	/**
+	 * Returns true if the file is mapped in memory, false if it was parsed as text
+	 */
+	bool IsMapped () const;
+
+	/**
+	 * Convert a trace from the text format to the binary format
+	 * @params the name of the text file
+	 * @params the name of the binary file
+	 */
+	static void ConvertTextToBinary (std::string textFile, std::string binaryFile);
+
+private:
+	/**
+	 * Parse a text file into m_buffer
+	 * @params the file name
+	 */
+	void ParseText (std::string filename);
+
+	/**
+	 * Map a binary file in memory
+	 * @params the file name
+	 */
+	void MapBinary (std::string filename);
+
+	/**
+	 * Check the header of the image and set m_words and m_numSnapshots
+	 * @params the image
+	 * @params the number of words of the image
+	 */
+	void SetImage (const uint64_t *words, uint64_t numWords);
+
+	void Close ();
+
+	/**
+	 * Snapshots [m_first, m_first + number of offsets - 1) of a streamed trace
+	 */
+	struct Window
+	{
+		uint32_t m_index; // window index, NO_WINDOW if empty
+		uint32_t m_first;
+		std::vector<uint64_t> m_offsets; // offsets of the records in m_words, one more than the snapshots
+		std::vector<uint64_t> m_words;
+	};
+
+	static const uint32_t NO_WINDOW = 0xffffffff;
+
+	/**
+	 * Read the next snapshot of a text file and append its record
+	 * @params the text stream
+	 * @params the records
+	 * @returns false at the end of the file
+	 */
+	static bool ReadTextSnapshot (std::istream &in, std::vector<uint64_t> &records);
+
+	/**
+	 * Build a snapshot from its record
+	 * @params the image holding the record
+	 * @params the offset of the record in the image
+	 * @params the offset of the end of the record in the image
+	 * @params the trace index, for the error messages
+	 */
+	static RaytracingSnapshot MakeSnapshot (const uint64_t *words, uint64_t begin, uint64_t end, uint32_t index);
+
+	/**
+	 * Open a file for streaming, count its snapshots and locate the windows of a text file
+	 * @params the file name
+	 * @params true for a binary file
+	 */
+	void OpenStream (std::string filename, bool binary);
+
+	/**
+	 * Read a window of a streamed file, this is called on the prefetch thread
+	 * @params the window index
+	 * @params the window to fill
+	 */
+	void ReadWindow (uint32_t index, Window &window);
+
+	/**
+	 * Make a window the current one and start the prefetch of the following window
+	 * @params the window index
+	 */
+	void MoveWindow (uint32_t index);
+
+	void Prefetch ();
+
+	std::vector<uint64_t> m_buffer; // image of a parsed text file
+	void *m_map; // mapped binary file
+	uint64_t m_mapSize;
+	const uint64_t *m_words; // image in use, m_buffer or m_map
+	uint64_t m_numWords;
+	uint32_t m_numSnapshots;
+
+	// streaming
+	uint32_t m_windowSize; // 0 if the whole trace is loaded
+	int m_fd; // binary file, read with pread
+	std::ifstream m_text; // text file
+	std::vector<std::streampos> m_textWindows; // position of each window in the text file
+	Window m_current;
+	Window m_next;
+#ifdef HAVE_PTHREAD_H
+	Ptr<SystemThread> m_prefetch; // thread reading m_next
+#endif
+	uint32_t m_prefetchWindow;
+};
+
+}  //namespace ns3
+
+#endif /* MMWAVE_RAYTRACING_TRACE_H_ */
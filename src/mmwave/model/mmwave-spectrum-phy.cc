@@ -354,10 +354,6 @@ MmWaveSpectrumPhy::StartRxData (Ptr<MmwaveSpectrumSignalParametersDataFrame> par
 
 	NS_LOG_FUNCTION(this);
 
-	Ptr<MmWaveEnbNetDevice> enbRx =
-				DynamicCast<MmWaveEnbNetDevice> (GetDevice ());
-	Ptr<MmWaveUeNetDevice> ueRx =
-				DynamicCast<MmWaveUeNetDevice> (GetDevice ());
 	switch(m_state)
 	{
 	case TX:
@@ -395,6 +391,8 @@ MmWaveSpectrumPhy::StartRxData (Ptr<MmwaveSpectrumSignalParametersDataFrame> par
 			if (params->packetBurst && !params->packetBurst->GetPackets ().empty ())
 			{
 				m_rxPacketBurstList.push_back (params->packetBurst);
+				NS_ASSERT (params->pduInfo.size () == params->packetBurst->GetNPackets ());
+				m_rxPduInfo.insert (m_rxPduInfo.end (), params->pduInfo.begin (), params->pduInfo.end ());
 			}
 			//NS_LOG_DEBUG (this << " insert msgs " << params->ctrlMsgList.size ());
 			m_rxControlMessageList.insert (m_rxControlMessageList.end (), params->ctrlMsgList.begin (), params->ctrlMsgList.end ());
@@ -499,74 +497,94 @@ MmWaveSpectrumPhy::EndRxData ()
 {
 	m_interferenceData->EndRx();
 
-	double sinrAvg = Sum(m_sinrPerceived)/(m_sinrPerceived.GetSpectrumModel()->GetNumBands());
+	// average and minimum SINR in one pass
+	double sinrSum = 0;
 	double sinrMin = 99999999999;
 	for (Values::const_iterator it = m_sinrPerceived.ConstValuesBegin (); it != m_sinrPerceived.ConstValuesEnd (); it++)
 	{
+		sinrSum += *it;
 		if (*it < sinrMin)
 		{
 			sinrMin = *it;
 		}
 	}
+	double sinrAvg = sinrSum/(m_sinrPerceived.GetSpectrumModel()->GetNumBands());
 
-	Ptr<MmWaveEnbNetDevice> enbRx = DynamicCast<MmWaveEnbNetDevice> (GetDevice ());
-	Ptr<MmWaveUeNetDevice> ueRx = DynamicCast<MmWaveUeNetDevice> (GetDevice ());
+	// cell of the traces of all the packets
+	uint16_t traceCellId = 0;
+	bool traceUe = false;
+	if (m_isEnb)
+	{
+		traceCellId = DynamicCast<MmWaveEnbNetDevice> (GetDevice ())->GetCellId();
+	}
+	else
+	{
+		Ptr<MmWaveUeNetDevice> ueRx = DynamicCast<MmWaveUeNetDevice> (GetDevice ());
+		if (ueRx)
+		{
+			traceCellId = ueRx->GetTargetEnb()->GetCellId();
+			traceUe = true;
+		}
+	}
 
 	NS_ASSERT(m_state = RX_DATA);
-	ExpectedTbMap_t::iterator itTb = m_expectedTbs.begin ();
-	while (itTb != m_expectedTbs.end ())
+	ExpectedTbMap_t::iterator itTb;
+	if ((m_dataErrorModelEnabled)&&(m_rxPacketBurstList.size ()>0))
 	{
-		if ((m_dataErrorModelEnabled)&&(m_rxPacketBurstList.size ()>0))
+		// decode all the TBs of the slot in one batch, with their HARQ history by reference
+		static const MmWaveHarqProcessInfoList_t noHarqHistory;
+		std::vector<TbDecodeInfo_t> tbs;
+		tbs.reserve (m_expectedTbs.size ());
+		for (itTb = m_expectedTbs.begin (); itTb != m_expectedTbs.end (); itTb++)
 		{
-			MmWaveHarqProcessInfoList_t harqInfoList;
-			uint8_t rv = 0;
+			TbDecodeInfo_t tb;
+			tb.map = &itTb->second.rbBitmap;
+			tb.size = itTb->second.size;
+			tb.mcs = itTb->second.mcs;
+			tb.miHistory = &noHarqHistory;
 			if (itTb->second.ndi == 0)
 			{
 				// TB retxed: retrieve HARQ history
 				if (itTb->second.downlink)
 				{
-					harqInfoList = m_harqPhyModule->GetHarqProcessInfoDl (itTb->first, itTb->second.harqProcessId);
+					tb.miHistory = &m_harqPhyModule->GetHarqProcessInfoDl (itTb->first, itTb->second.harqProcessId);
 				}
 				else
 				{
-					harqInfoList = m_harqPhyModule->GetHarqProcessInfoUl (itTb->first, itTb->second.harqProcessId);
-				}
-				if (harqInfoList.size () > 0)
-				{
-					rv = harqInfoList.back ().m_rv;
+					tb.miHistory = &m_harqPhyModule->GetHarqProcessInfoUl (itTb->first, itTb->second.harqProcessId);
 				}
 			}
+			tbs.push_back (tb);
+		}
+		MmWaveMiErrorModel::GetTbDecodificationStats (m_sinrPerceived, tbs);
 
-			TbStats_t tbStats = MmWaveMiErrorModel::GetTbDecodificationStats (m_sinrPerceived,
-					itTb->second.rbBitmap, itTb->second.size, itTb->second.mcs, harqInfoList);
-			itTb->second.tbler = tbStats.tbler;
-			itTb->second.mi = tbStats.miTotal;
-			itTb->second.corrupt = m_random->GetValue () > tbStats.tbler ? false : true;
+		std::vector<TbDecodeInfo_t>::const_iterator tb = tbs.begin ();
+		for (itTb = m_expectedTbs.begin (); itTb != m_expectedTbs.end (); itTb++, tb++)
+		{
+			itTb->second.tbler = tb->stats.tbler;
+			itTb->second.mi = tb->stats.miTotal;
+			itTb->second.corrupt = m_random->GetValue () > tb->stats.tbler ? false : true;
 			if (itTb->second.corrupt)
 			{
-				NS_LOG_INFO (this << " RNTI " << itTb->first << " size " << itTb->second.size << " mcs " << (uint32_t)itTb->second.mcs << " bitmap " << itTb->second.rbBitmap.size () << " rv " << rv << " TBLER " << tbStats.tbler << " corrupted " << itTb->second.corrupt);
+				uint8_t rv = tb->miHistory->size () > 0 ? tb->miHistory->back ().m_rv : 0;
+				NS_LOG_INFO (this << " RNTI " << itTb->first << " size " << itTb->second.size << " mcs " << (uint32_t)itTb->second.mcs << " bitmap " << itTb->second.rbBitmap.size () << " rv " << rv << " TBLER " << tb->stats.tbler << " corrupted " << itTb->second.corrupt);
 			}
 		}
-		itTb++;
 	}
 
 	std::map <uint16_t, DlHarqInfo> harqDlInfoMap;
+	std::vector<MmWavePduInfo>::const_iterator pduInfo = m_rxPduInfo.begin ();
 	for (std::list<Ptr<PacketBurst> >::const_iterator i = m_rxPacketBurstList.begin ();
 			i != m_rxPacketBurstList.end (); ++i)
 	{
-		for (std::list<Ptr<Packet> >::const_iterator j = (*i)->Begin (); j != (*i)->End (); ++j)
+		for (std::list<Ptr<Packet> >::const_iterator j = (*i)->Begin (); j != (*i)->End (); ++j, ++pduInfo)
 		{
 			if ((*j)->GetSize () == 0)
 			{
 				continue;
 			}
 
-			LteRadioBearerTag bearerTag;
-			if((*j)->PeekPacketTag (bearerTag) == false)
-			{
-				NS_FATAL_ERROR ("No radio bearer tag found");
-			}
-			uint16_t rnti = bearerTag.GetRnti ();
+			uint16_t rnti = pduInfo->m_rnti;
 			itTb = m_expectedTbs.find (rnti);
 			if(itTb != m_expectedTbs.end ())
 			{
@@ -579,17 +597,11 @@ MmWaveSpectrumPhy::EndRxData ()
 					NS_LOG_INFO ("TB failed");
 				}
 
-				MmWaveMacPduTag pduTag;
-				if((*j)->PeekPacketTag (pduTag) == false)
-				{
-					NS_FATAL_ERROR ("No radio bearer tag found");
-				}
-
 				RxPacketTraceParams traceParams;
 				traceParams.m_tbSize = itTb->second.size;
-				traceParams.m_frameNum = pduTag.GetSfn ().m_frameNum;
-				traceParams.m_sfNum = pduTag.GetSfn ().m_sfNum;
-				traceParams.m_slotNum = pduTag.GetSfn ().m_slotNum;
+				traceParams.m_frameNum = pduInfo->m_sfn.m_frameNum;
+				traceParams.m_sfNum = pduInfo->m_sfn.m_sfNum;
+				traceParams.m_slotNum = pduInfo->m_sfn.m_slotNum;
 				traceParams.m_rnti = rnti;
 				traceParams.m_mcs = itTb->second.mcs;
 				traceParams.m_rv = itTb->second.rv;
@@ -600,14 +612,13 @@ MmWaveSpectrumPhy::EndRxData ()
 				traceParams.m_symStart = itTb->second.symStart;
 				traceParams.m_numSym = itTb->second.numSym;
 
-				if (enbRx)
+				traceParams.m_cellId = traceCellId;
+				if (m_isEnb)
 				{
-					traceParams.m_cellId = enbRx->GetCellId();
 					m_rxPacketTraceEnb (traceParams);
 				}
-				else if (ueRx)
+				else if (traceUe)
 				{
-					traceParams.m_cellId = ueRx->GetTargetEnb()->GetCellId();
 					m_rxPacketTraceUe (traceParams);
 				}
 
@@ -721,6 +732,7 @@ MmWaveSpectrumPhy::EndRxData ()
 
 	m_state = IDLE;
 	m_rxPacketBurstList.clear ();
+	m_rxPduInfo.clear ();
 	m_expectedTbs.clear ();
 	m_rxControlMessageList.clear ();
 }
@@ -766,6 +778,32 @@ MmWaveSpectrumPhy::StartTxDataFrames (Ptr<PacketBurst> pb, std::list<Ptr<MmWaveC
 		txParams->txPhy = this->GetObject<SpectrumPhy> ();
 		txParams->psd = m_txPsd;
 		txParams->packetBurst = pb;
+		if (pb)
+		{
+			// read the tags once here, the receivers get the RNTI and the subframe of each PDU from pduInfo
+			txParams->pduInfo.reserve (pb->GetNPackets ());
+			for (std::list<Ptr<Packet> >::const_iterator it = pb->Begin (); it != pb->End (); ++it)
+			{
+				MmWavePduInfo info;
+				info.m_rnti = 0;
+				if ((*it)->GetSize () > 0)
+				{
+					LteRadioBearerTag bearerTag;
+					if((*it)->PeekPacketTag (bearerTag) == false)
+					{
+						NS_FATAL_ERROR ("No radio bearer tag found");
+					}
+					info.m_rnti = bearerTag.GetRnti ();
+					MmWaveMacPduTag pduTag;
+					if((*it)->PeekPacketTag (pduTag) == false)
+					{
+						NS_FATAL_ERROR ("No MAC PDU tag found");
+					}
+					info.m_sfn = pduTag.GetSfn ();
+				}
+				txParams->pduInfo.push_back (info);
+			}
+		}
 		txParams->cellId = m_cellId;
 		txParams->ctrlMsgList = ctrlMsgList;
 		txParams->slotInd = slotInd;
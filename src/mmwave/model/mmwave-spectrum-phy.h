@@ -161,6 +161,7 @@ private:
 	Ptr<SpectrumValue> m_txPsd;
 	//Ptr<PacketBurst> m_txPacketBurst;
 	std::list<Ptr<PacketBurst> > m_rxPacketBurstList;
+	std::vector<MmWavePduInfo> m_rxPduInfo; // of each packet of m_rxPacketBurstList, in order
 	std::list<Ptr<MmWaveControlMessage> > m_rxControlMessageList;
 
 	Time m_firstRxStart;
@@ -80,6 +80,7 @@ MmwaveSpectrumSignalParametersDataFrame::MmwaveSpectrumSignalParametersDataFrame
     {
       packetBurst = p.packetBurst->Copy ();
     }
+  pduInfo = p.pduInfo;
   ctrlMsgList = p.ctrlMsgList;
 }
 
@@ -31,6 +31,7 @@
 
 
 #include <ns3/spectrum-signal-parameters.h>
+#include "mmwave-phy-mac-common.h"
 
 namespace ns3 {
 
@@ -64,6 +65,18 @@ struct mmwaveSpectrumSignalParameters : public SpectrumSignalParameters
 
 
 
+/**
+ * \ingroup mmwave
+ *
+ * RNTI and subframe of a MAC PDU of a data frame, read from the tags of the PDU by the
+ * transmitter so that the receivers do not search the packet tags
+ */
+struct MmWavePduInfo
+{
+  uint16_t m_rnti;
+  SfnSf m_sfn;
+};
+
 struct MmwaveSpectrumSignalParametersDataFrame : public SpectrumSignalParameters
 {
   
@@ -82,6 +95,8 @@ struct MmwaveSpectrumSignalParametersDataFrame : public SpectrumSignalParameters
   
   Ptr<PacketBurst> packetBurst;
 
+  std::vector<MmWavePduInfo> pduInfo; // one for each packet of packetBurst, in the same order
+
   std::list<Ptr<MmWaveControlMessage> > ctrlMsgList;
   
   uint16_t cellId;
@@ -35,6 +35,7 @@
 #include <ns3/abort.h>
 
 #include "mmwave-spectrum-value-helper.h"
+#include <algorithm>
 
 namespace std {
 
@@ -144,4 +145,42 @@ MmWaveSpectrumValueHelper::CreateNoisePowerSpectralDensity (double noiseFigureDb
   return noisePsd;
 }
 
+MmWaveBandRange
+MmWaveSpectrumValueHelper::GetActiveBands (const SpectrumValue &psd)
+{
+  Values::const_iterator begin = psd.ConstValuesBegin ();
+  Values::const_iterator end = psd.ConstValuesEnd ();
+  MmWaveBandRange range;
+  range.m_first = 0;
+  while (begin != end && *begin == 0.0)
+    {
+      ++begin;
+      range.m_first++;
+    }
+  range.m_end = psd.GetSpectrumModel ()->GetNumBands ();
+  while (end != begin && *(end - 1) == 0.0)
+    {
+      --end;
+      range.m_end--;
+    }
+  return range;
+}
+
+MmWaveBandRange
+MmWaveSpectrumValueHelper::MergeBands (MmWaveBandRange a, MmWaveBandRange b)
+{
+  if (a.m_first == a.m_end)
+    {
+      return b;
+    }
+  if (b.m_first == b.m_end)
+    {
+      return a;
+    }
+  MmWaveBandRange range;
+  range.m_first = std::min (a.m_first, b.m_first);
+  range.m_end = std::max (a.m_end, b.m_end);
+  return range;
+}
+
 } // namespace ns3
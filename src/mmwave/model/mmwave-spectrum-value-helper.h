@@ -37,6 +37,19 @@
 namespace ns3 {
 
 
+/**
+ * \ingroup mmwave
+ *
+ * \brief Range [m_first, m_end) of the bands of a PSD outside of which all the values are 0.
+ * The PSDs are stored dense, the range lets the per band computations skip the bands that
+ * are not occupied by a transmission
+ */
+struct MmWaveBandRange
+{
+  uint32_t m_first;
+  uint32_t m_end; // equal to m_first if all the values are 0
+};
+
 /**
  * \ingroup mmwave
  *
@@ -63,6 +76,21 @@ public:
 
   static Ptr<SpectrumValue> CreateNoisePowerSpectralDensity (double noiseFigure, Ptr<SpectrumModel> spectrumModel);
 
+  /**
+   * Find the occupied bands of a PSD, the bands are scanned from both ends up to the
+   * first non zero value, so the cost is proportional to the unoccupied bands
+   * @params the PSD
+   * @returns the range of the bands between the first and the last non zero value
+   */
+  static MmWaveBandRange GetActiveBands (const SpectrumValue &psd);
+
+  /**
+   * @params a range of bands
+   * @params another range of bands
+   * @returns the smallest range containing both ranges
+   */
+  static MmWaveBandRange MergeBands (MmWaveBandRange a, MmWaveBandRange b);
+
 private:
   static Ptr<SpectrumModel> m_model;
 };
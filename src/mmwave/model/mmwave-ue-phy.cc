@@ -30,6 +30,7 @@
 #include <ns3/log.h>
 #include <cfloat>
 #include <cmath>
+#include <algorithm>
 #include <ns3/simulator.h>
 #include <ns3/double.h>
 #include "mmwave-ue-phy.h"
@@ -422,10 +423,18 @@ MmWaveUePhy::SubframeIndication (uint16_t frameNum, uint8_t sfNum)
 	m_frameNum = frameNum;
 	m_sfNum = sfNum;
 	m_lastSfStart = Simulator::Now();
-	m_currSfAllocInfo = m_sfAllocInfo[m_sfNum];
+	// take the allocation of the subframe and reset the entry of the next frame in the
+	// containers of the previous subframe instead of copying and reallocating them
+	std::swap (m_currSfAllocInfo, m_sfAllocInfo[m_sfNum]);
 	NS_ASSERT ((m_currSfAllocInfo.m_sfnSf.m_frameNum == m_frameNum) &&
 	           (m_currSfAllocInfo.m_sfnSf.m_sfNum == m_sfNum));
-	m_sfAllocInfo[m_sfNum] = SfAllocInfo (SfnSf (m_frameNum+1, m_sfNum, 0));
+	SfAllocInfo &nextSfAllocInfo = m_sfAllocInfo[m_sfNum];
+	nextSfAllocInfo.m_sfnSf = SfnSf (m_frameNum+1, m_sfNum, 0);
+	nextSfAllocInfo.m_numSymAlloc = 0;
+	nextSfAllocInfo.m_ulSymStart = 0;
+	nextSfAllocInfo.m_dlSlotAllocInfo.clear ();
+	nextSfAllocInfo.m_ulSlotAllocInfo.clear ();
+	nextSfAllocInfo.m_slotAllocInfo.clear ();
 	SlotAllocInfo dlCtrlSlot;
 	dlCtrlSlot.m_slotType = SlotAllocInfo::CTRL;
 	dlCtrlSlot.m_numCtrlSym = 1;
@@ -672,7 +681,6 @@ MmWaveUePhy::CreateDlCqiFeedbackMessage (const SpectrumValue& sinr)
 		m_amc = CreateObject <MmWaveAmc> (m_phyMacConfig);
 	}
 	NS_LOG_FUNCTION (this);
-	SpectrumValue newSinr = sinr;
 	// CREATE DlCqiLteControlMessage
 	Ptr<MmWaveDlCqiMessage> msg = Create<MmWaveDlCqiMessage> ();
 	DlCqiInfo dlcqi;
@@ -685,7 +693,7 @@ MmWaveUePhy::CreateDlCqiFeedbackMessage (const SpectrumValue& sinr)
 	//uint8_t dlBandwidth = m_phyMacConfig->GetNumChunkPerRb () * m_phyMacConfig->GetNumRb ();
 	NS_ASSERT (m_currSlot.m_dci.m_format==0);
 	int mcs;
-	dlcqi.m_wbCqi = m_amc->CreateCqiFeedbackWbTdma (newSinr, m_currSlot.m_dci.m_numSym, m_currSlot.m_dci.m_tbSize, mcs);
+	dlcqi.m_wbCqi = m_amc->CreateCqiFeedbackWbTdma (sinr, m_currSlot.m_dci.m_numSym, m_currSlot.m_dci.m_tbSize, mcs);
 
 //	int activeSubChannels = newSinr.GetSpectrumModel()->GetNumBands ();
 	/*cqi = m_amc->CreateCqiFeedbacksTdma (newSinr, m_currNumSym);
@@ -721,15 +729,14 @@ MmWaveUePhy::GenerateDlCqiReport (const SpectrumValue& sinr)
 	{
 		if (Simulator::Now () > m_wbCqiLast + m_wbCqiPeriod)
 		{
-			SpectrumValue newSinr = sinr;
-			Ptr<MmWaveDlCqiMessage> msg = CreateDlCqiFeedbackMessage (newSinr);
+			Ptr<MmWaveDlCqiMessage> msg = CreateDlCqiFeedbackMessage (sinr);
 
 			if (msg)
 			{
 				DoSendControlMessage (msg);
 			}
 			Ptr<MmWaveUeNetDevice> UeRx = DynamicCast<MmWaveUeNetDevice> (GetDevice());
-			m_reportCurrentCellRsrpSinrTrace (UeRx->GetImsi(), newSinr, newSinr);
+			m_reportCurrentCellRsrpSinrTrace (UeRx->GetImsi(), sinr, sinr);
 		}
 	}
 }
@@ -167,7 +167,7 @@ private:
 	bool m_dlConfigured;
 	bool m_ulConfigured;
 
-	TracedCallback< uint64_t, SpectrumValue&, SpectrumValue& > m_reportCurrentCellRsrpSinrTrace;
+	TracedCallback< uint64_t, const SpectrumValue&, const SpectrumValue& > m_reportCurrentCellRsrpSinrTrace;
 
 	TracedCallback<uint64_t, uint64_t> m_reportUlTbSize;
 	TracedCallback<uint64_t, uint64_t> m_reportDlTbSize;
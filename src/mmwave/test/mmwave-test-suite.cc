@@ -31,6 +31,32 @@
 
 // An essential include is test.h
 #include "ns3/test.h"
+#include "ns3/mmwave-3gpp-channel.h"
+#include "ns3/antenna-array-model.h"
+#include "ns3/mmwave-raytracing-trace.h"
+#include "ns3/mmwave-interference.h"
+#include "ns3/mmwave-chunk-processor.h"
+#include "ns3/mmwave-mi-error-model.h"
+#include "ns3/mmwave-amc.h"
+#include "ns3/mmwave-flex-tti-sched-engine.h"
+#include "ns3/mmwave-flex-tti-maxweight-mac-scheduler.h"
+#include "ns3/mmwave-enb-mac.h"
+#include "ns3/mmwave-phy-sap.h"
+#include "ns3/mmwave-control-messages.h"
+#include "ns3/mmwave-3gpp-propagation-loss-model.h"
+#include "ns3/mmwave-spectrum-value-helper.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/integer.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/string.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
 
 // Do not put your test classes in namespace ns3.  You may find it useful
 // to use the using directive to access the ns3 namespace directly
@@ -72,6 +98,2123 @@ MmwaveTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+/**
+ * The subband kernel of MmWave3gppChannel rotates the delay phase of each cluster from one
+ * subband to the next. Check its gains against the direct evaluation of exp() at the frequency
+ * of each subband, for PSDs with empty subbands and for an in-place computation
+ */
+class MmWave3gppSubbandGainTestCase : public TestCase
+{
+public:
+  MmWave3gppSubbandGainTestCase ();
+  virtual ~MmWave3gppSubbandGainTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWave3gppSubbandGainTestCase::MmWave3gppSubbandGainTestCase ()
+  : TestCase ("Subband beamforming gain kernel against the direct exp evaluation")
+{
+}
+
+MmWave3gppSubbandGainTestCase::~MmWave3gppSubbandGainTestCase ()
+{
+}
+
+void
+MmWave3gppSubbandGainTestCase::DoRun (void)
+{
+  const uint8_t numCluster = 19;
+  const uint32_t numBands = 72;
+  double fStart = 27.5e9;
+  double fStep = 13.89e6;
+  std::complex<double> clusterGain[numCluster];
+  std::complex<double> phase[numCluster];
+  std::complex<double> phaseStep[numCluster];
+  double delay[numCluster];
+  double amplitude = 0;
+  for (uint8_t n = 0; n < numCluster; n++)
+    {
+      delay[n] = 1e-9 * (3.1 + 47.3 * n);
+      clusterGain[n] = std::polar (1.0 / (1 + n), 0.37 * n * n);
+      phase[n] = std::exp (std::complex<double> (0, -2 * M_PI * fStart * delay[n]));
+      phaseStep[n] = std::exp (std::complex<double> (0, -2 * M_PI * fStep * delay[n]));
+      amplitude += std::abs (clusterGain[n]);
+    }
+  // bound of the rounding error of the incremental phase rotation
+  double tolerance = 1e-9 * amplitude * amplitude;
+  double txPsd[numBands];
+  double rxPsd[numBands];
+  for (uint32_t k = 0; k < numBands; k++)
+    {
+      // the first and the last subbands carry no power
+      txPsd[k] = (k < 4 || k >= numBands - 6) ? 0 : 1e-3 * (1 + k % 5);
+    }
+
+  double average = MmWave3gppChannel::CalSubbandGain (clusterGain, phase, phaseStep, numCluster,
+                                                       txPsd, rxPsd, numBands, 0, numBands);
+  double gainSum = 0;
+  uint32_t activeBands = 0;
+  for (uint32_t k = 0; k < numBands; k++)
+    {
+      if (txPsd[k] == 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (rxPsd[k], 0, "power in the empty subband " << k);
+          continue;
+        }
+      std::complex<double> sum = 0;
+      for (uint8_t n = 0; n < numCluster; n++)
+        {
+          sum += clusterGain[n] * std::exp (std::complex<double> (0, -2 * M_PI * (fStart + k * fStep) * delay[n]));
+        }
+      double gain = std::norm (sum);
+      gainSum += gain;
+      activeBands++;
+      NS_TEST_ASSERT_MSG_EQ_TOL (rxPsd[k] / txPsd[k], gain, tolerance, "wrong gain of subband " << k);
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (average, gainSum / activeBands, tolerance, "wrong average gain");
+
+  // restricted to the subbands carrying power, the phases start at the first one
+  double restricted[numBands];
+  double restrictedAverage = MmWave3gppChannel::CalSubbandGain (clusterGain, phase, phaseStep, numCluster,
+                                                                 txPsd, restricted, numBands, 4, numBands - 6);
+  for (uint32_t k = 0; k < numBands; k++)
+    {
+      NS_TEST_ASSERT_MSG_EQ_TOL (restricted[k], rxPsd[k], tolerance * txPsd[k], "different restricted gain of subband " << k);
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (restrictedAverage, average, tolerance, "different restricted average gain");
+
+  // the rx PSD may be the tx PSD
+  double inPlace[numBands];
+  std::copy (txPsd, txPsd + numBands, inPlace);
+  MmWave3gppChannel::CalSubbandGain (clusterGain, phase, phaseStep, numCluster, inPlace, inPlace, numBands, 0, numBands);
+  for (uint32_t k = 0; k < numBands; k++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (inPlace[k], rxPsd[k], "different in-place gain of subband " << k);
+    }
+
+  // no subband with power
+  std::fill (txPsd, txPsd + numBands, 0.0);
+  average = MmWave3gppChannel::CalSubbandGain (clusterGain, phase, phaseStep, numCluster, txPsd, rxPsd, numBands, 0, numBands);
+  NS_TEST_ASSERT_MSG_EQ (average, 0, "average gain without power");
+  average = MmWave3gppChannel::CalSubbandGain (clusterGain, phase, phaseStep, numCluster, txPsd, rxPsd, numBands,
+                                               numBands, numBands);
+  NS_TEST_ASSERT_MSG_EQ (average, 0, "average gain of an empty range");
+  for (uint32_t k = 0; k < numBands; k++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (rxPsd[k], 0, "power in subband " << k << " of an empty range");
+    }
+}
+
+/**
+ * \return true if the two PSDs have the same values
+ */
+static bool
+IsSamePsd (const SpectrumValue &a, const SpectrumValue &b)
+{
+  return a.GetSpectrumModel ()->GetNumBands () == b.GetSpectrumModel ()->GetNumBands ()
+         && std::equal (a.ConstValuesBegin (), a.ConstValuesEnd (), b.ConstValuesBegin ());
+}
+
+/**
+ * eNBs and UEs with mmWave devices for the tests of MmWave3gppChannel. The devices are
+ * installed by MmWaveHelper, the UE i is served by the eNB i % numEnb, and the channels are
+ * computed by a MmWave3gppChannel created by the test
+ */
+class MmWave3gppChannelTestNodes
+{
+public:
+  MmWave3gppChannelTestNodes (uint32_t numEnb, uint32_t numUe);
+
+  /**
+   * Create a channel, with the attributes set by Config::SetDefault
+   * \param connect connect the serving pairs
+   * \return the channel
+   */
+  Ptr<MmWave3gppChannel> CreateChannel (bool connect = true);
+
+  /**
+   * Connect the serving pairs, the channels of the pairs are generated
+   * \param channel the channel
+   */
+  void Connect (Ptr<MmWave3gppChannel> channel) const;
+
+  /**
+   * \param psd the value of every subband (W/Hz)
+   * \return a tx PSD over all the subbands
+   */
+  Ptr<SpectrumValue> CreateTxPsd (double psd) const;
+
+  /**
+   * Compute the pathloss of a pair, as the spectrum channel does before the 3GPP channel
+   * \param a the transmitter
+   * \param b the receiver
+   */
+  void CalcPathloss (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const;
+
+  Ptr<MobilityModel> GetEnb (uint32_t i) const;
+  Ptr<MobilityModel> GetUe (uint32_t i) const;
+  Ptr<NetDevice> GetEnbDevice (uint32_t i) const;
+  Ptr<NetDevice> GetUeDevice (uint32_t i) const;
+  Ptr<AntennaArrayModel> GetEnbAntenna (uint32_t i) const;
+  Ptr<AntennaArrayModel> GetUeAntenna (uint32_t i) const;
+
+private:
+  Ptr<MmWavePhyMacCommon> m_config;
+  Ptr<MmWave3gppPropagationLossModel> m_pathloss;
+  NodeContainer m_enbNodes;
+  NodeContainer m_ueNodes;
+  NetDeviceContainer m_enbDevices;
+  NetDeviceContainer m_ueDevices;
+};
+
+MmWave3gppChannelTestNodes::MmWave3gppChannelTestNodes (uint32_t numEnb, uint32_t numUe)
+{
+  m_config = CreateObject<MmWavePhyMacCommon> ();
+  m_enbNodes.Create (numEnb);
+  m_ueNodes.Create (numUe);
+  Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator> ();
+  for (uint32_t i = 0; i < numEnb; i++)
+    {
+      positions->Add (Vector (1000.0 * i, 0, 35));
+    }
+  for (uint32_t i = 0; i < numUe; i++)
+    {
+      positions->Add (Vector (1000.0 * (i % numEnb) + 40 + 15 * i, 10.0 * (i % 3), 1.5));
+    }
+  MobilityHelper mobility;
+  mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+  mobility.SetPositionAllocator (positions);
+  mobility.Install (m_enbNodes);
+  mobility.Install (m_ueNodes);
+
+  Ptr<MmWaveHelper> helper = CreateObject<MmWaveHelper> ();
+  helper->SetAttribute ("PathlossModel", StringValue ("ns3::MmWave3gppPropagationLossModel"));
+  helper->SetAttribute ("ChannelModel", StringValue ("ns3::MmWave3gppChannel"));
+  m_enbDevices = helper->InstallEnbDevice (m_enbNodes);
+  m_ueDevices = helper->InstallUeDevice (m_ueNodes);
+  for (uint32_t i = 0; i < numUe; i++)
+    {
+      Ptr<MmWaveEnbNetDevice> enb = DynamicCast<MmWaveEnbNetDevice> (m_enbDevices.Get (i % numEnb));
+      DynamicCast<MmWaveUeNetDevice> (m_ueDevices.Get (i))->SetTargetEnb (enb);
+    }
+  m_pathloss = CreateObject<MmWave3gppPropagationLossModel> ();
+}
+
+Ptr<MmWave3gppChannel>
+MmWave3gppChannelTestNodes::CreateChannel (bool connect)
+{
+  Ptr<MmWave3gppChannel> channel = CreateObject<MmWave3gppChannel> ();
+  channel->SetConfigurationParameters (m_config);
+  channel->SetPathlossModel (m_pathloss);
+  if (connect)
+    {
+      Connect (channel);
+    }
+  return channel;
+}
+
+void
+MmWave3gppChannelTestNodes::Connect (Ptr<MmWave3gppChannel> channel) const
+{
+  channel->Initial (m_ueDevices, m_enbDevices);
+}
+
+Ptr<SpectrumValue>
+MmWave3gppChannelTestNodes::CreateTxPsd (double psd) const
+{
+  std::vector<int> subchannels;
+  for (uint32_t i = 0; i < m_config->GetTotalNumChunk (); i++)
+    {
+      subchannels.push_back (i);
+    }
+  Ptr<SpectrumValue> txPsd = MmWaveSpectrumValueHelper::CreateTxPowerSpectralDensity (m_config, 0, subchannels);
+  (*txPsd) = psd;
+  return txPsd;
+}
+
+void
+MmWave3gppChannelTestNodes::CalcPathloss (Ptr<MobilityModel> a, Ptr<MobilityModel> b) const
+{
+  m_pathloss->GetLoss (a, b);
+}
+
+Ptr<MobilityModel>
+MmWave3gppChannelTestNodes::GetEnb (uint32_t i) const
+{
+  return m_enbNodes.Get (i)->GetObject<MobilityModel> ();
+}
+
+Ptr<MobilityModel>
+MmWave3gppChannelTestNodes::GetUe (uint32_t i) const
+{
+  return m_ueNodes.Get (i)->GetObject<MobilityModel> ();
+}
+
+Ptr<NetDevice>
+MmWave3gppChannelTestNodes::GetEnbDevice (uint32_t i) const
+{
+  return m_enbDevices.Get (i);
+}
+
+Ptr<NetDevice>
+MmWave3gppChannelTestNodes::GetUeDevice (uint32_t i) const
+{
+  return m_ueDevices.Get (i);
+}
+
+Ptr<AntennaArrayModel>
+MmWave3gppChannelTestNodes::GetEnbAntenna (uint32_t i) const
+{
+  Ptr<MmWaveEnbNetDevice> enb = DynamicCast<MmWaveEnbNetDevice> (m_enbDevices.Get (i));
+  return DynamicCast<AntennaArrayModel> (enb->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
+}
+
+Ptr<AntennaArrayModel>
+MmWave3gppChannelTestNodes::GetUeAntenna (uint32_t i) const
+{
+  Ptr<MmWaveUeNetDevice> ue = DynamicCast<MmWaveUeNetDevice> (m_ueDevices.Get (i));
+  return DynamicCast<AntennaArrayModel> (ue->GetPhy ()->GetDlSpectrumPhy ()->GetRxAntenna ());
+}
+
+/**
+ * The channel of a pair that is not connected is generated only when its received power with
+ * the maximum array gain exceeds the noise by RelevanceThreshold. Check that such a pair only
+ * gets the pathloss below the threshold, that it is generated once it crosses the threshold,
+ * and that the connected pairs always get their beamforming gain
+ */
+class MmWave3gppRelevanceTestCase : public TestCase
+{
+public:
+  MmWave3gppRelevanceTestCase ();
+  virtual ~MmWave3gppRelevanceTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWave3gppRelevanceTestCase::MmWave3gppRelevanceTestCase ()
+  : TestCase ("3GPP channels of the interfering pairs generated above the relevance threshold")
+{
+}
+
+MmWave3gppRelevanceTestCase::~MmWave3gppRelevanceTestCase ()
+{
+}
+
+void
+MmWave3gppRelevanceTestCase::DoRun (void)
+{
+  Config::SetDefault ("ns3::MmWave3gppChannel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+  MmWave3gppChannelTestNodes nodes (2, 2);
+  Ptr<MmWave3gppChannel> channel = nodes.CreateChannel ();
+  // UE 1 is served by eNB 1, eNB 0 interferes
+  Ptr<MobilityModel> enb = nodes.GetEnb (0);
+  Ptr<MobilityModel> servingEnb = nodes.GetEnb (1);
+  Ptr<MobilityModel> ue = nodes.GetUe (1);
+  nodes.CalcPathloss (enb, ue);
+
+  // 1e-22 W/Hz with the 64x16 array gain is about 14 dB above the thermal noise
+  Ptr<SpectrumValue> txPsd = nodes.CreateTxPsd (1e-22);
+  channel->SetAttribute ("RelevanceThreshold", DoubleValue (20));
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      Ptr<SpectrumValue> rxPsd = channel->CalcRxPowerSpectralDensity (txPsd, enb, ue);
+      NS_TEST_ASSERT_MSG_EQ (IsSamePsd (*rxPsd, *txPsd), true, "beamforming gain below the threshold");
+      Ptr<SpectrumValue> servingPsd = channel->CalcRxPowerSpectralDensity (txPsd, servingEnb, ue);
+      NS_TEST_ASSERT_MSG_EQ (IsSamePsd (*servingPsd, *txPsd), false, "no beamforming gain for the connected pair");
+    }
+
+  // nothing was stored below the threshold, the channel is generated once the pair crosses it
+  channel->SetAttribute ("RelevanceThreshold", DoubleValue (10));
+  Ptr<SpectrumValue> rxPsd = channel->CalcRxPowerSpectralDensity (txPsd, enb, ue);
+  NS_TEST_ASSERT_MSG_EQ (IsSamePsd (*rxPsd, *txPsd), false, "no beamforming gain above the threshold");
+  channel->SetAttribute ("RelevanceThreshold", DoubleValue (20));
+  Ptr<SpectrumValue> storedPsd = channel->CalcRxPowerSpectralDensity (txPsd, enb, ue);
+  NS_TEST_ASSERT_MSG_EQ (IsSamePsd (*storedPsd, *rxPsd), true, "the generated channel is not kept");
+
+  channel->Dispose ();
+  Simulator::Destroy ();
+  Config::Reset ();
+}
+
+/**
+ * The batch update of MmWave3gppChannel gives each link its own random streams, so that the
+ * updated channels do not depend on the number of threads. Update the channels of all the
+ * pairs twice with UpdateThreads 1 and with several threads, and compare the received PSDs
+ */
+class MmWave3gppBatchUpdateTestCase : public TestCase
+{
+public:
+  MmWave3gppBatchUpdateTestCase ();
+  virtual ~MmWave3gppBatchUpdateTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param threads the UpdateThreads attribute
+   * \return the PSDs received on all the pairs after two batch updates
+   */
+  std::vector<double> RunUpdates (uint32_t threads);
+
+  /**
+   * Append the PSDs received on all the pairs to m_rxPsds
+   */
+  void RecordPsds (void);
+
+  static const uint32_t m_numEnb = 2;
+  static const uint32_t m_numUe = 6;
+  MmWave3gppChannelTestNodes *m_nodes;
+  Ptr<MmWave3gppChannel> m_channel;
+  Ptr<SpectrumValue> m_txPsd;
+  std::vector<double> m_rxPsds;
+};
+
+MmWave3gppBatchUpdateTestCase::MmWave3gppBatchUpdateTestCase ()
+  : TestCase ("3GPP channel batch update with one and several threads"),
+    m_nodes (0)
+{
+}
+
+MmWave3gppBatchUpdateTestCase::~MmWave3gppBatchUpdateTestCase ()
+{
+}
+
+void
+MmWave3gppBatchUpdateTestCase::RecordPsds (void)
+{
+  for (uint32_t enb = 0; enb < m_numEnb; enb++)
+    {
+      for (uint32_t ue = 0; ue < m_numUe; ue++)
+        {
+          Ptr<SpectrumValue> dlPsd = m_channel->CalcRxPowerSpectralDensity (m_txPsd, m_nodes->GetEnb (enb), m_nodes->GetUe (ue));
+          m_rxPsds.insert (m_rxPsds.end (), dlPsd->ConstValuesBegin (), dlPsd->ConstValuesEnd ());
+          Ptr<SpectrumValue> ulPsd = m_channel->CalcRxPowerSpectralDensity (m_txPsd, m_nodes->GetUe (ue), m_nodes->GetEnb (enb));
+          m_rxPsds.insert (m_rxPsds.end (), ulPsd->ConstValuesBegin (), ulPsd->ConstValuesEnd ());
+        }
+    }
+}
+
+std::vector<double>
+MmWave3gppBatchUpdateTestCase::RunUpdates (uint32_t threads)
+{
+  // the random streams of both runs start from the same state
+  Config::SetDefault ("ns3::RandomVariableStream::Stream", IntegerValue (11));
+  Config::SetDefault ("ns3::MmWave3gppChannel::UpdatePeriod", TimeValue (MilliSeconds (1)));
+  Config::SetDefault ("ns3::MmWave3gppChannel::BatchUpdate", BooleanValue (true));
+  Config::SetDefault ("ns3::MmWave3gppChannel::UpdateThreads", UintegerValue (threads));
+
+  m_nodes = new MmWave3gppChannelTestNodes (m_numEnb, m_numUe);
+  m_channel = m_nodes->CreateChannel ();
+  m_txPsd = m_nodes->CreateTxPsd (1e-9);
+  for (uint32_t enb = 0; enb < m_numEnb; enb++)
+    {
+      for (uint32_t ue = 0; ue < m_numUe; ue++)
+        {
+          m_nodes->CalcPathloss (m_nodes->GetEnb (enb), m_nodes->GetUe (ue));
+          m_nodes->CalcPathloss (m_nodes->GetUe (ue), m_nodes->GetEnb (enb));
+        }
+    }
+  m_rxPsds.clear ();
+  // the first signals create the channels of the interfering pairs
+  RecordPsds ();
+  Simulator::Schedule (MicroSeconds (2500), &MmWave3gppBatchUpdateTestCase::RecordPsds, this);
+  Simulator::Stop (MilliSeconds (3));
+  Simulator::Run ();
+
+  m_channel->Dispose ();
+  m_channel = 0;
+  m_txPsd = 0;
+  Simulator::Destroy ();
+  delete m_nodes;
+  m_nodes = 0;
+  Config::Reset ();
+  return m_rxPsds;
+}
+
+void
+MmWave3gppBatchUpdateTestCase::DoRun (void)
+{
+  std::vector<double> serial = RunUpdates (1);
+  std::vector<double> parallel = RunUpdates (4);
+  NS_TEST_ASSERT_MSG_EQ (parallel.size (), serial.size (), "different number of PSD values");
+  // the channels were updated between the two records
+  uint32_t recordSize = serial.size () / 2;
+  NS_TEST_ASSERT_MSG_EQ (std::equal (serial.begin (), serial.begin () + recordSize, serial.begin () + recordSize),
+                         false, "the channels were not updated");
+  for (uint32_t i = 0; i < serial.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (parallel[i], serial[i], "different PSD value " << i << " with 4 threads");
+    }
+}
+
+/**
+ * The long term beamforming vectors of MmWave3gppChannel are the dominant eigenvectors of the
+ * tx and rx spatial correlation matrices, found with a Lanczos iteration. Check them against a
+ * dense power iteration on the same matrices
+ */
+class MmWave3gppDominantBeamsTestCase : public TestCase
+{
+public:
+  MmWave3gppDominantBeamsTestCase ();
+  virtual ~MmWave3gppDominantBeamsTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  typedef std::vector<complexVector_t> ComplexMatrix;
+
+  /**
+   * \param q a Hermitian matrix
+   * \param w a vector
+   * \return w^H q w
+   */
+  static double GetRayleighQuotient (const ComplexMatrix &q, const complexVector_t &w);
+
+  /**
+   * \param q a Hermitian positive semi-definite matrix
+   * \return the unit norm dominant eigenvector of q, by power iteration
+   */
+  static complexVector_t GetPowerIteration (const ComplexMatrix &q);
+
+  /**
+   * Check a vector found by CalDominantBeams against the power iteration
+   * \param q the correlation matrix
+   * \param w the vector
+   * \param name the name of the vector in the messages
+   */
+  void CheckBeam (const ComplexMatrix &q, const complexVector_t &w, std::string name);
+};
+
+MmWave3gppDominantBeamsTestCase::MmWave3gppDominantBeamsTestCase ()
+  : TestCase ("3GPP long term beamforming vectors against a dense power iteration")
+{
+}
+
+MmWave3gppDominantBeamsTestCase::~MmWave3gppDominantBeamsTestCase ()
+{
+}
+
+double
+MmWave3gppDominantBeamsTestCase::GetRayleighQuotient (const ComplexMatrix &q, const complexVector_t &w)
+{
+  std::complex<double> sum = 0;
+  for (uint32_t i = 0; i < w.size (); i++)
+    {
+      for (uint32_t j = 0; j < w.size (); j++)
+        {
+          sum += std::conj (w[i]) * q[i][j] * w[j];
+        }
+    }
+  return sum.real ();
+}
+
+complexVector_t
+MmWave3gppDominantBeamsTestCase::GetPowerIteration (const ComplexMatrix &q)
+{
+  uint32_t size = q.size ();
+  complexVector_t w (size, std::complex<double> (1, 0));
+  for (uint32_t iter = 0; iter < 5000; iter++)
+    {
+      complexVector_t next (size, 0);
+      double norm = 0;
+      for (uint32_t i = 0; i < size; i++)
+        {
+          for (uint32_t j = 0; j < size; j++)
+            {
+              next[i] += q[i][j] * w[j];
+            }
+          norm += std::norm (next[i]);
+        }
+      norm = std::sqrt (norm);
+      for (uint32_t i = 0; i < size; i++)
+        {
+          w[i] = next[i] / norm;
+        }
+    }
+  return w;
+}
+
+void
+MmWave3gppDominantBeamsTestCase::CheckBeam (const ComplexMatrix &q, const complexVector_t &w, std::string name)
+{
+  complexVector_t reference = GetPowerIteration (q);
+  NS_TEST_ASSERT_MSG_EQ (w.size (), reference.size (), "wrong size of the " << name << " vector");
+  double norm = 0;
+  std::complex<double> inner = 0;
+  for (uint32_t i = 0; i < w.size (); i++)
+    {
+      norm += std::norm (w[i]);
+      inner += std::conj (reference[i]) * w[i];
+    }
+  NS_TEST_ASSERT_MSG_EQ_TOL (norm, 1, 1e-9, "the " << name << " vector is not unit norm");
+  // the eigenvector is defined up to a phase
+  NS_TEST_ASSERT_MSG_EQ_TOL (std::abs (inner), 1, 1e-6, "the " << name << " vector is not the dominant eigenvector");
+  double eigenvalue = GetRayleighQuotient (q, reference);
+  NS_TEST_ASSERT_MSG_EQ_TOL (GetRayleighQuotient (q, w), eigenvalue, 1e-9 * eigenvalue,
+                             "wrong eigenvalue of the " << name << " vector");
+}
+
+void
+MmWave3gppDominantBeamsTestCase::DoRun (void)
+{
+  uint16_t rxSize = 16;
+  uint16_t txSize = 64;
+  uint8_t numCluster = 12;
+  ChannelTensor3gpp channel;
+  channel.Resize (rxSize, txSize, numCluster);
+  for (uint16_t u = 0; u < rxSize; u++)
+    {
+      for (uint16_t s = 0; s < txSize; s++)
+        {
+          for (uint8_t n = 0; n < numCluster; n++)
+            {
+              // clusters of decreasing power, each with its own angles of departure and arrival
+              channel (u, s, n) = std::polar (1.0 / (1 + n), 2.3 * n * u + 0.9 * n * n * s + 0.1 * u * s);
+            }
+        }
+    }
+
+  // txQ = sum_n H_n^H*H_n and rxQ = sum_n H_n*H_n^H
+  ComplexMatrix txQ (txSize, complexVector_t (txSize, 0));
+  ComplexMatrix rxQ (rxSize, complexVector_t (rxSize, 0));
+  for (uint8_t n = 0; n < numCluster; n++)
+    {
+      for (uint16_t i = 0; i < txSize; i++)
+        {
+          for (uint16_t j = 0; j < txSize; j++)
+            {
+              for (uint16_t u = 0; u < rxSize; u++)
+                {
+                  txQ[i][j] += std::conj (channel (u, i, n)) * channel (u, j, n);
+                }
+            }
+        }
+      for (uint16_t i = 0; i < rxSize; i++)
+        {
+          for (uint16_t j = 0; j < rxSize; j++)
+            {
+              for (uint16_t s = 0; s < txSize; s++)
+                {
+                  rxQ[i][j] += channel (i, s, n) * std::conj (channel (j, s, n));
+                }
+            }
+        }
+    }
+
+  complexVector_t txW;
+  complexVector_t rxW;
+  MmWave3gppChannel::CalDominantBeams (channel, txW, rxW);
+  CheckBeam (txQ, txW, "tx");
+  CheckBeam (rxQ, rxW, "rx");
+}
+
+/**
+ * The beam search of MmWave3gppChannel holds the codebook of the tx geometry while it looks up
+ * the one of the rx geometry. Check that the codebooks stay in place when new geometries are
+ * added, and that a search that creates both codebooks selects the same beams, taken from the
+ * codebooks, as one with a warm cache
+ */
+class MmWave3gppBeamSearchTestCase : public TestCase
+{
+public:
+  MmWave3gppBeamSearchTestCase ();
+  virtual ~MmWave3gppBeamSearchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param codebook a codebook
+   * \param w a BF vector
+   * \return true if w is one of the beams of the codebook
+   */
+  static bool IsCodebookBeam (const BeamCodebook3gpp &codebook, const complexVector_t &w);
+};
+
+MmWave3gppBeamSearchTestCase::MmWave3gppBeamSearchTestCase ()
+  : TestCase ("Beam search between two antenna geometries with an empty codebook cache")
+{
+}
+
+MmWave3gppBeamSearchTestCase::~MmWave3gppBeamSearchTestCase ()
+{
+}
+
+bool
+MmWave3gppBeamSearchTestCase::IsCodebookBeam (const BeamCodebook3gpp &codebook, const complexVector_t &w)
+{
+  if (w.size () != codebook.m_size)
+    {
+      return false;
+    }
+  for (uint32_t b = 0; b < codebook.m_beams.size () / codebook.m_size; b++)
+    {
+      if (std::equal (w.begin (), w.end (), codebook.m_beams.begin () + b * codebook.m_size))
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+MmWave3gppBeamSearchTestCase::DoRun (void)
+{
+  // both channels draw the same realization
+  Config::SetDefault ("ns3::RandomVariableStream::Stream", IntegerValue (13));
+  Config::SetDefault ("ns3::MmWave3gppChannel::UpdatePeriod", TimeValue (MilliSeconds (0)));
+  Config::SetDefault ("ns3::MmWave3gppChannel::CellScan", BooleanValue (true));
+  MmWave3gppChannelTestNodes nodes (1, 1);
+  Ptr<AntennaArrayModel> enbAntenna = nodes.GetEnbAntenna (0);
+  Ptr<AntennaArrayModel> ueAntenna = nodes.GetUeAntenna (0);
+  uint8_t enbNum[2] = {8, 8};
+  uint8_t ueNum[2] = {4, 4};
+  uint8_t smallNum[2] = {2, 2};
+  Ptr<SpectrumValue> txPsd = nodes.CreateTxPsd (1e-9);
+
+  // the search of the serving pair adds the codebook of the eNB and then the one of the UE
+  Ptr<MmWave3gppChannel> cold = nodes.CreateChannel ();
+  complexVector_t coldEnbW = enbAntenna->GetBeamformingVector (nodes.GetUeDevice (0));
+  complexVector_t coldUeW = ueAntenna->GetBeamformingVector (nodes.GetEnbDevice (0));
+  Ptr<SpectrumValue> coldPsd = cold->CalcRxPowerSpectralDensity (txPsd, nodes.GetEnb (0), nodes.GetUe (0));
+
+  const BeamCodebook3gpp &enbCodebook = cold->GetCodebook (enbAntenna, enbNum);
+  const BeamCodebook3gpp &ueCodebook = cold->GetCodebook (ueAntenna, ueNum);
+  const BeamCodebook3gpp &smallCodebook = cold->GetCodebook (ueAntenna, smallNum);
+  NS_TEST_ASSERT_MSG_EQ (&cold->GetCodebook (enbAntenna, enbNum), &enbCodebook, "the eNB codebook moved");
+  NS_TEST_ASSERT_MSG_EQ (&cold->GetCodebook (ueAntenna, ueNum), &ueCodebook, "the UE codebook moved");
+  NS_TEST_ASSERT_MSG_EQ ((&smallCodebook != &ueCodebook), true, "the 2x2 geometry has no codebook of its own");
+  NS_TEST_ASSERT_MSG_EQ ((uint16_t) enbCodebook.m_antennaNum[1], 8, "wrong eNB codebook");
+  NS_TEST_ASSERT_MSG_EQ (enbCodebook.m_size, 64, "wrong eNB codebook");
+  NS_TEST_ASSERT_MSG_EQ (ueCodebook.m_size, 16, "wrong UE codebook");
+  NS_TEST_ASSERT_MSG_EQ (smallCodebook.m_size, 4, "wrong 2x2 codebook");
+  NS_TEST_ASSERT_MSG_EQ (IsCodebookBeam (enbCodebook, coldEnbW), true, "the eNB beam is not in the codebook");
+  NS_TEST_ASSERT_MSG_EQ (IsCodebookBeam (ueCodebook, coldUeW), true, "the UE beam is not in the codebook");
+
+  // same search with both codebooks already computed, in the opposite order
+  Ptr<MmWave3gppChannel> warm = nodes.CreateChannel (false);
+  warm->GetCodebook (ueAntenna, ueNum);
+  warm->GetCodebook (enbAntenna, enbNum);
+  nodes.Connect (warm);
+  NS_TEST_ASSERT_MSG_EQ ((enbAntenna->GetBeamformingVector (nodes.GetUeDevice (0)) == coldEnbW), true, "different eNB beams");
+  NS_TEST_ASSERT_MSG_EQ ((ueAntenna->GetBeamformingVector (nodes.GetEnbDevice (0)) == coldUeW), true, "different UE beams");
+  Ptr<SpectrumValue> warmPsd = warm->CalcRxPowerSpectralDensity (txPsd, nodes.GetEnb (0), nodes.GetUe (0));
+  NS_TEST_ASSERT_MSG_EQ (IsSamePsd (*warmPsd, *coldPsd), true, "different received PSDs");
+
+  cold->Dispose ();
+  warm->Dispose ();
+  Simulator::Destroy ();
+  Config::Reset ();
+}
+
+/**
+ * A raytracing trace is parsed from the text format or mapped from the binary format written by
+ * ConvertTextToBinary, and both can be streamed through a window of snapshots. Write a text trace,
+ * convert it, and check that both files give the snapshots that were written, with and without
+ * streaming, when the snapshots are requested in order and with jumps
+ */
+class MmWaveRaytracingTraceTestCase : public TestCase
+{
+public:
+  MmWaveRaytracingTraceTestCase ();
+  virtual ~MmWaveRaytracingTraceTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param snapshot the snapshot index
+   * \return the number of paths of the snapshot
+   */
+  static uint32_t GetNumPath (uint32_t snapshot);
+
+  /**
+   * \param snapshot the snapshot index
+   * \param field the field
+   * \param path the path index
+   * \return the value written in the text trace
+   */
+  static double GetValue (uint32_t snapshot, uint32_t field, uint32_t path);
+
+  /**
+   * \param snapshot the snapshot index
+   * \param field the field
+   * \param path the path index
+   * \return true if the value is left empty in the text trace
+   */
+  static bool IsEmpty (uint32_t snapshot, uint32_t field, uint32_t path);
+
+  /**
+   * Write the text trace
+   * \param filename the file name
+   */
+  void WriteText (std::string filename) const;
+
+  /**
+   * Check the snapshots of a trace against the values written in the text trace
+   * \param trace the trace
+   * \param order the order in which the snapshots are requested
+   * \param name the name of the trace in the messages
+   */
+  void CheckTrace (MmWaveRaytracingTrace &trace, const std::vector<uint32_t> &order, std::string name);
+
+  static const uint32_t m_numSnapshots = 7;
+};
+
+MmWaveRaytracingTraceTestCase::MmWaveRaytracingTraceTestCase ()
+  : TestCase ("Raytracing trace in the text and in the binary format, loaded and streamed")
+{
+}
+
+MmWaveRaytracingTraceTestCase::~MmWaveRaytracingTraceTestCase ()
+{
+}
+
+uint32_t
+MmWaveRaytracingTraceTestCase::GetNumPath (uint32_t snapshot)
+{
+  return 1 + snapshot % 3;
+}
+
+double
+MmWaveRaytracingTraceTestCase::GetValue (uint32_t snapshot, uint32_t field, uint32_t path)
+{
+  // the middle phase of the snapshots with three paths is left empty in the text trace, it is read as 0
+  if (IsEmpty (snapshot, field, path))
+    {
+      return 0;
+    }
+  return snapshot * 100 + field * 10 + path + 0.125 - (field == RAYTRACING_PATHLOSS ? 200 : 0);
+}
+
+bool
+MmWaveRaytracingTraceTestCase::IsEmpty (uint32_t snapshot, uint32_t field, uint32_t path)
+{
+  return field == RAYTRACING_PHASE && path == 1 && GetNumPath (snapshot) == 3;
+}
+
+void
+MmWaveRaytracingTraceTestCase::WriteText (std::string filename) const
+{
+  std::ofstream out (filename.c_str ());
+  out.precision (17);
+  for (uint32_t s = 0; s < m_numSnapshots; s++)
+    {
+      out << GetNumPath (s) << std::endl;
+      for (uint32_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+        {
+          for (uint32_t p = 0; p < GetNumPath (s); p++)
+            {
+              if (p > 0)
+                {
+                  out << ",";
+                }
+              if (!IsEmpty (s, f, p))
+                {
+                  out << GetValue (s, f, p);
+                }
+            }
+          out << std::endl;
+        }
+    }
+}
+
+void
+MmWaveRaytracingTraceTestCase::CheckTrace (MmWaveRaytracingTrace &trace, const std::vector<uint32_t> &order, std::string name)
+{
+  NS_TEST_ASSERT_MSG_EQ (trace.GetNumSnapshots (), m_numSnapshots, "wrong number of snapshots of the " << name << " trace");
+  for (uint32_t i = 0; i < order.size (); i++)
+    {
+      uint32_t s = order[i];
+      RaytracingSnapshot snapshot = trace.GetSnapshot (s);
+      NS_TEST_ASSERT_MSG_EQ (snapshot.m_numPath, GetNumPath (s), "wrong number of paths of snapshot " << s << " of the " << name << " trace");
+      for (uint32_t f = 0; f < RAYTRACING_NUM_FIELDS; f++)
+        {
+          doubleVector_t values = snapshot.GetField (RaytracingField (f));
+          NS_TEST_ASSERT_MSG_EQ (values.size (), GetNumPath (s), "wrong length of field " << f << " of snapshot " << s
+                                 << " of the " << name << " trace");
+          for (uint32_t p = 0; p < values.size (); p++)
+            {
+              NS_TEST_ASSERT_MSG_EQ (values[p], GetValue (s, f, p), "wrong value " << p << " of field " << f
+                                     << " of snapshot " << s << " of the " << name << " trace");
+            }
+        }
+    }
+}
+
+void
+MmWaveRaytracingTraceTestCase::DoRun (void)
+{
+  std::string textFile = CreateTempDirFilename ("raytracing-trace.txt");
+  std::string binaryFile = CreateTempDirFilename ("raytracing-trace.bin");
+  WriteText (textFile);
+  MmWaveRaytracingTrace::ConvertTextToBinary (textFile, binaryFile);
+
+  std::vector<uint32_t> sequential;
+  for (uint32_t s = 0; s < m_numSnapshots; s++)
+    {
+      sequential.push_back (s);
+    }
+  // jumps forward and backward, within a window and to other windows
+  uint32_t jumps[] = {5, 0, 6, 2, 3, 3, 1, 4, 6, 0};
+  std::vector<uint32_t> random (jumps, jumps + sizeof (jumps) / sizeof (jumps[0]));
+
+  MmWaveRaytracingTrace text;
+  text.Open (textFile);
+  NS_TEST_ASSERT_MSG_EQ (text.IsMapped (), false, "the text trace is mapped");
+  CheckTrace (text, sequential, "text");
+  CheckTrace (text, random, "text");
+
+  MmWaveRaytracingTrace binary;
+  binary.Open (binaryFile);
+  NS_TEST_ASSERT_MSG_EQ (binary.IsMapped (), true, "the binary trace is not mapped");
+  CheckTrace (binary, sequential, "binary");
+  CheckTrace (binary, random, "binary");
+
+  // streamed traces, the last window is shorter than the others
+  uint32_t windowSizes[] = {1, 2, 3, m_numSnapshots};
+  for (uint32_t w = 0; w < sizeof (windowSizes) / sizeof (windowSizes[0]); w++)
+    {
+      std::ostringstream name;
+      name << "window " << windowSizes[w];
+      MmWaveRaytracingTrace streamedText;
+      streamedText.Open (textFile, windowSizes[w]);
+      CheckTrace (streamedText, sequential, "text " + name.str ());
+      CheckTrace (streamedText, random, "text " + name.str ());
+      MmWaveRaytracingTrace streamedBinary;
+      streamedBinary.Open (binaryFile, windowSizes[w]);
+      CheckTrace (streamedBinary, random, "binary " + name.str ());
+      CheckTrace (streamedBinary, sequential, "binary " + name.str ());
+    }
+
+  std::remove (textFile.c_str ());
+  std::remove (binaryFile.c_str ());
+}
+
+/**
+ * A chunk evaluated by mmWaveInterference, or by the reference model of the test
+ */
+struct MmWaveInterferenceTestChunk
+{
+  bool m_sinr; // SINR or received power
+  Time m_duration;
+  std::vector<double> m_values;
+};
+
+/**
+ * Chunk processor that records the chunks it is given
+ */
+class MmWaveRecordingChunkProcessor : public mmWaveChunkProcessor
+{
+public:
+  MmWaveRecordingChunkProcessor (bool sinr, std::vector<MmWaveInterferenceTestChunk> *chunks);
+  virtual void EvaluateChunk (const SpectrumValue& value, Time duration);
+
+private:
+  bool m_sinr;
+  std::vector<MmWaveInterferenceTestChunk> *m_chunks;
+};
+
+MmWaveRecordingChunkProcessor::MmWaveRecordingChunkProcessor (bool sinr, std::vector<MmWaveInterferenceTestChunk> *chunks)
+  : m_sinr (sinr),
+    m_chunks (chunks)
+{
+}
+
+void
+MmWaveRecordingChunkProcessor::EvaluateChunk (const SpectrumValue& value, Time duration)
+{
+  MmWaveInterferenceTestChunk chunk;
+  chunk.m_sinr = m_sinr;
+  chunk.m_duration = duration;
+  chunk.m_values.assign (value.ConstValuesBegin (), value.ConstValuesEnd ());
+  m_chunks->push_back (chunk);
+}
+
+/**
+ * Reference model of the interference: the event-based subtraction that mmWaveInterference
+ * used before its ledger. Each signal schedules its own subtraction, which evaluates the chunk
+ * up to its end, and the subtractions scheduled before a reset of the noise are ignored
+ */
+class MmWaveEventInterference
+{
+public:
+  MmWaveEventInterference (std::vector<MmWaveInterferenceTestChunk> *chunks);
+  void StartRx (Ptr<const SpectrumValue> rxPsd);
+  void EndRx ();
+  void AddSignal (Ptr<const SpectrumValue> psd, Time duration);
+  void SetNoisePowerSpectralDensity (Ptr<const SpectrumValue> noisePsd);
+
+private:
+  void DoSubtractSignal (Ptr<const SpectrumValue> psd, uint32_t reset);
+  void ConditionallyEvaluateChunk ();
+
+  bool m_receiving;
+  Ptr<SpectrumValue> m_rxSignal;
+  Ptr<SpectrumValue> m_allSignals;
+  Ptr<const SpectrumValue> m_noise;
+  Time m_lastChangeTime;
+  uint32_t m_reset; // number of resets of the noise
+  std::vector<MmWaveInterferenceTestChunk> *m_chunks;
+};
+
+MmWaveEventInterference::MmWaveEventInterference (std::vector<MmWaveInterferenceTestChunk> *chunks)
+  : m_receiving (false),
+    m_reset (0),
+    m_chunks (chunks)
+{
+}
+
+void
+MmWaveEventInterference::StartRx (Ptr<const SpectrumValue> rxPsd)
+{
+  if (!m_receiving)
+    {
+      m_rxSignal = rxPsd->Copy ();
+      m_lastChangeTime = Now ();
+      m_receiving = true;
+    }
+  else
+    {
+      (*m_rxSignal) += (*rxPsd);
+    }
+}
+
+void
+MmWaveEventInterference::EndRx ()
+{
+  if (m_receiving)
+    {
+      ConditionallyEvaluateChunk ();
+      m_receiving = false;
+    }
+}
+
+void
+MmWaveEventInterference::AddSignal (Ptr<const SpectrumValue> psd, Time duration)
+{
+  ConditionallyEvaluateChunk ();
+  (*m_allSignals) += (*psd);
+  Simulator::Schedule (duration, &MmWaveEventInterference::DoSubtractSignal, this, psd, m_reset);
+}
+
+void
+MmWaveEventInterference::DoSubtractSignal (Ptr<const SpectrumValue> psd, uint32_t reset)
+{
+  ConditionallyEvaluateChunk ();
+  if (reset == m_reset)
+    {
+      (*m_allSignals) -= (*psd);
+    }
+}
+
+void
+MmWaveEventInterference::ConditionallyEvaluateChunk ()
+{
+  if (m_receiving && (Now () > m_lastChangeTime))
+    {
+      SpectrumValue interf = (*m_allSignals) - (*m_rxSignal) + (*m_noise);
+      SpectrumValue sinr = (*m_rxSignal) / interf;
+      MmWaveInterferenceTestChunk chunk;
+      chunk.m_duration = Now () - m_lastChangeTime;
+      chunk.m_sinr = false;
+      chunk.m_values.assign (m_rxSignal->ConstValuesBegin (), m_rxSignal->ConstValuesEnd ());
+      m_chunks->push_back (chunk);
+      chunk.m_sinr = true;
+      chunk.m_values.assign (sinr.ConstValuesBegin (), sinr.ConstValuesEnd ());
+      m_chunks->push_back (chunk);
+      m_lastChangeTime = Now ();
+    }
+}
+
+void
+MmWaveEventInterference::SetNoisePowerSpectralDensity (Ptr<const SpectrumValue> noisePsd)
+{
+  ConditionallyEvaluateChunk ();
+  m_noise = noisePsd;
+  m_allSignals = Create<SpectrumValue> (noisePsd->GetSpectrumModel ());
+  m_receiving = false;
+  m_reset++;
+}
+
+/**
+ * mmWaveInterference retires the signals through a ledger sorted by end time. Run a schedule of
+ * signals, with receptions, signals ending together, signals ending between two evaluations and
+ * resets of the noise, through mmWaveInterference and through the event-based reference model,
+ * and check that they evaluate the same chunks
+ */
+class MmWaveInterferenceLedgerTestCase : public TestCase
+{
+public:
+  MmWaveInterferenceLedgerTestCase ();
+  virtual ~MmWaveInterferenceLedgerTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  enum Action
+  {
+    NOISE,
+    SIGNAL, // interfering signal
+    START_RX, // signal received by the receiver
+    END_RX
+  };
+
+  struct Step
+  {
+    uint32_t m_time; // us
+    Action m_action;
+    uint32_t m_psd; // index in m_psds
+    uint32_t m_duration; // us
+  };
+
+  /**
+   * Run a step on both models and schedule the next one, the subtractions scheduled by the
+   * reference model at the time of the next step run before it
+   * \param step the index of the step
+   */
+  void RunStep (uint32_t step);
+
+  std::vector<Step> m_steps;
+  std::vector<Ptr<SpectrumValue> > m_psds;
+  Ptr<mmWaveInterference> m_interference;
+  MmWaveEventInterference *m_reference;
+};
+
+MmWaveInterferenceLedgerTestCase::MmWaveInterferenceLedgerTestCase ()
+  : TestCase ("Interference ledger against the event-based subtraction"),
+    m_reference (0)
+{
+}
+
+MmWaveInterferenceLedgerTestCase::~MmWaveInterferenceLedgerTestCase ()
+{
+}
+
+void
+MmWaveInterferenceLedgerTestCase::RunStep (uint32_t step)
+{
+  const Step &s = m_steps[step];
+  Ptr<SpectrumValue> psd = m_psds[s.m_psd];
+  switch (s.m_action)
+    {
+    case NOISE:
+      m_interference->SetNoisePowerSpectralDensity (psd);
+      m_reference->SetNoisePowerSpectralDensity (psd);
+      break;
+    case SIGNAL:
+      m_interference->AddSignal (psd, MicroSeconds (s.m_duration));
+      m_reference->AddSignal (psd, MicroSeconds (s.m_duration));
+      break;
+    case START_RX:
+      m_interference->AddSignal (psd, MicroSeconds (s.m_duration));
+      m_reference->AddSignal (psd, MicroSeconds (s.m_duration));
+      m_interference->StartRx (psd);
+      m_reference->StartRx (psd);
+      break;
+    case END_RX:
+      m_interference->EndRx ();
+      m_reference->EndRx ();
+      break;
+    }
+  if (step + 1 < m_steps.size ())
+    {
+      Simulator::Schedule (MicroSeconds (m_steps[step + 1].m_time - s.m_time),
+                           &MmWaveInterferenceLedgerTestCase::RunStep, this, step + 1);
+    }
+}
+
+void
+MmWaveInterferenceLedgerTestCase::DoRun (void)
+{
+  std::vector<double> freqs;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      freqs.push_back (28e9 + i * 1e6);
+    }
+  Ptr<SpectrumModel> model = Create<SpectrumModel> (freqs);
+  for (uint32_t p = 0; p < 12; p++)
+    {
+      Ptr<SpectrumValue> psd = Create<SpectrumValue> (model);
+      for (uint32_t b = 0; b < freqs.size (); b++)
+        {
+          // the received signals (1, 5, 8 and 10) use the first three bands
+          bool received = p == 1 || p == 5 || p == 8 || p == 10;
+          (*psd)[b] = (received && b >= 3) ? 0 : 1e-17 * (1 + (p * 7 + b * 3) % 11) / 3;
+        }
+      m_psds.push_back (psd);
+    }
+  // psd 0 and 11 are noises
+  Step steps[] = {
+    {0, NOISE, 0, 0},
+    {0, SIGNAL, 2, 10},
+    {1, START_RX, 1, 5},
+    {2, SIGNAL, 3, 4}, // ends with the received signal
+    {3, SIGNAL, 4, 20},
+    {6, END_RX, 0, 0},
+    {7, START_RX, 5, 4},
+    {8, SIGNAL, 6, 1}, // ends between two evaluations
+    {10, SIGNAL, 7, 3},
+    {11, END_RX, 0, 0},
+    {12, NOISE, 11, 0}, // the signals 4 and 7 are not subtracted
+    {12, START_RX, 8, 5},
+    {15, SIGNAL, 9, 10},
+    {15, SIGNAL, 2, 10},
+    {17, END_RX, 0, 0},
+    {20, START_RX, 10, 4},
+    {21, SIGNAL, 3, 1},
+    {22, NOISE, 0, 0}, // aborts the reception
+    {25, SIGNAL, 6, 2},
+    {26, START_RX, 1, 3},
+    {29, END_RX, 0, 0}
+  };
+  m_steps.assign (steps, steps + sizeof (steps) / sizeof (steps[0]));
+
+  std::vector<MmWaveInterferenceTestChunk> chunks;
+  std::vector<MmWaveInterferenceTestChunk> referenceChunks;
+  m_interference = CreateObject<mmWaveInterference> ();
+  m_interference->AddPowerChunkProcessor (Create<MmWaveRecordingChunkProcessor> (false, &chunks));
+  m_interference->AddSinrChunkProcessor (Create<MmWaveRecordingChunkProcessor> (true, &chunks));
+  m_reference = new MmWaveEventInterference (&referenceChunks);
+  Simulator::ScheduleNow (&MmWaveInterferenceLedgerTestCase::RunStep, this, 0);
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (chunks.size (), referenceChunks.size (), "different number of chunks");
+  NS_TEST_ASSERT_MSG_GT (chunks.size (), 20, "too few chunks");
+  for (uint32_t i = 0; i < chunks.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (chunks[i].m_sinr, referenceChunks[i].m_sinr, "different type of chunk " << i);
+      NS_TEST_ASSERT_MSG_EQ (chunks[i].m_duration, referenceChunks[i].m_duration, "different duration of chunk " << i);
+      NS_TEST_ASSERT_MSG_EQ ((chunks[i].m_values == referenceChunks[i].m_values), true, "different values of chunk " << i);
+    }
+
+  m_interference->Dispose ();
+  m_interference = 0;
+  delete m_reference;
+  m_reference = 0;
+}
+
+/**
+ * The MI of a RB is read from the MI map of the modulation, with the index clamped to the
+ * table. Check the SINRs at the edges of the axis of the three maps: below the first point,
+ * in the last step, exactly on the last point and above it, where the MI saturates to 1
+ */
+class MmWaveMiClampTestCase : public TestCase
+{
+public:
+  MmWaveMiClampTestCase ();
+  virtual ~MmWaveMiClampTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWaveMiClampTestCase::MmWaveMiClampTestCase ()
+  : TestCase ("MI error model clamp of the SINR to the MI map axis")
+{
+}
+
+MmWaveMiClampTestCase::~MmWaveMiClampTestCase ()
+{
+}
+
+void
+MmWaveMiClampTestCase::DoRun (void)
+{
+  Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+  SpectrumValue sinr (MmWaveSpectrumValueHelper::GetSpectrumModel (config));
+
+  uint8_t mcss[] = {0, MI_QPSK_MAX_ID, MI_QPSK_MAX_ID + 1, MI_16QAM_MAX_ID, MI_16QAM_MAX_ID + 1, MI_64QAM_MAX_ID};
+  const double *maps[] = {MI_map_qpsk, MI_map_qpsk, MI_map_16qam, MI_map_16qam, MI_map_64qam, MI_map_64qam};
+  const double *axes[] = {MI_map_qpsk_axis, MI_map_qpsk_axis, MI_map_16qam_axis, MI_map_16qam_axis, MI_map_64qam_axis, MI_map_64qam_axis};
+  uint16_t sizes[] = {MI_MAP_QPSK_SIZE, MI_MAP_QPSK_SIZE, MI_MAP_16QAM_SIZE, MI_MAP_16QAM_SIZE, MI_MAP_64QAM_SIZE, MI_MAP_64QAM_SIZE};
+  std::vector<int> map (1, 0);
+  for (unsigned i = 0; i < sizeof (mcss) / sizeof (mcss[0]); i++)
+    {
+      const double *axis = axes[i];
+      uint16_t last = sizes[i] - 1;
+
+      sinr[0] = 2 * axis[0] - axis[1];
+      NS_TEST_ASSERT_MSG_EQ (MmWaveMiErrorModel::Mib (sinr, map, mcss[i]), maps[i][0],
+                             "wrong MI below the axis of MCS " << (uint32_t) mcss[i]);
+      sinr[0] = (axis[last - 1] + axis[last]) / 2;
+      NS_TEST_ASSERT_MSG_EQ (MmWaveMiErrorModel::Mib (sinr, map, mcss[i]), maps[i][last],
+                             "wrong MI in the last step of the axis of MCS " << (uint32_t) mcss[i]);
+      sinr[0] = axis[last];
+      NS_TEST_ASSERT_MSG_EQ (MmWaveMiErrorModel::Mib (sinr, map, mcss[i]), maps[i][last],
+                             "wrong MI on the last point of the axis of MCS " << (uint32_t) mcss[i]);
+      sinr[0] = axis[last] * 1.001;
+      NS_TEST_ASSERT_MSG_EQ (MmWaveMiErrorModel::Mib (sinr, map, mcss[i]), 1.0,
+                             "MI not saturated above the axis of MCS " << (uint32_t) mcss[i]);
+    }
+
+  // the MI of a TB is the mean over its RBs
+  std::vector<int> twoRbs;
+  twoRbs.push_back (0);
+  twoRbs.push_back (1);
+  sinr[0] = MI_map_64qam_axis[MI_MAP_64QAM_SIZE - 1];
+  sinr[1] = MI_map_64qam_axis[MI_MAP_64QAM_SIZE - 1] * 2;
+  NS_TEST_ASSERT_MSG_EQ_TOL (MmWaveMiErrorModel::Mib (sinr, twoRbs, MI_64QAM_MAX_ID),
+                             (MI_map_64qam[MI_MAP_64QAM_SIZE - 1] + 1.0) / 2, 1e-12,
+                             "wrong mean MI at the top of the axis");
+}
+
+/**
+ * The AMC finds the first MCS above the target BLER with a binary search. Compare it with a
+ * linear scan of the MCSs, for SINRs from the lowest to the highest MCS and several TB lengths
+ */
+class MmWaveAmcMcsSearchTestCase : public TestCase
+{
+public:
+  MmWaveAmcMcsSearchTestCase ();
+  virtual ~MmWaveAmcMcsSearchTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWaveAmcMcsSearchTestCase::MmWaveAmcMcsSearchTestCase ()
+  : TestCase ("AMC binary search of the first MCS above the target BLER")
+{
+}
+
+MmWaveAmcMcsSearchTestCase::~MmWaveAmcMcsSearchTestCase ()
+{
+}
+
+void
+MmWaveAmcMcsSearchTestCase::DoRun (void)
+{
+  Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+  Ptr<MmWaveAmc> amc = CreateObject<MmWaveAmc> (config);
+  SpectrumValue sinr (MmWaveSpectrumValueHelper::GetSpectrumModel (config));
+  std::vector<int> map (1, 0);
+  DoubleValue targetBler;
+  amc->GetAttribute ("TargetBler", targetBler);
+  unsigned numSyms[] = {1, 4, 24};
+
+  for (unsigned i = 0; i < sizeof (numSyms) / sizeof (numSyms[0]); i++)
+    {
+      uint32_t tbSize[29];
+      for (uint8_t mcs = 0; mcs <= 28; mcs++)
+        {
+          tbSize[mcs] = amc->GetTbSizeFromMcsSymbols (mcs, numSyms[i]) / 8;
+        }
+      for (double sinrDb = -10.0; sinrDb <= 30.0; sinrDb += 0.25)
+        {
+          sinr = std::pow (10.0, sinrDb / 10.0);
+          double mib[3];
+          MmWaveAmc::GetMibPerModulation (sinr, map, mib);
+
+          uint8_t expected = 29;
+          for (uint8_t mcs = 0; mcs <= 28; mcs++)
+            {
+              // QPSK up to MCS 9, 16QAM up to MCS 16, 64QAM above
+              unsigned modIdx = mcs <= 9 ? 0 : (mcs <= 16 ? 1 : 2);
+              if (MmWaveMiErrorModel::GetTbBler (mib[modIdx], tbSize[mcs], mcs) > targetBler.Get ())
+                {
+                  expected = mcs;
+                  break;
+                }
+            }
+          NS_TEST_ASSERT_MSG_EQ ((uint32_t) amc->GetFirstMcsAboveTargetBler (mib, tbSize), (uint32_t) expected,
+                                 "different MCS at SINR " << sinrDb << " dB and " << numSyms[i] << " symbols");
+        }
+    }
+}
+
+/**
+ * The occupied bands of a PSD are the range between its first and last non zero values, and the
+ * merge of two ranges is the smallest range containing both, an empty range being neutral
+ */
+class MmWaveActiveBandsTestCase : public TestCase
+{
+public:
+  MmWaveActiveBandsTestCase ();
+  virtual ~MmWaveActiveBandsTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param first the first band of the range
+   * \param end the band after the last one of the range
+   * \return the range
+   */
+  static MmWaveBandRange MakeRange (uint32_t first, uint32_t end);
+
+  /**
+   * Check the active bands of a PSD that is 0 except in some bands
+   * \param bands the bands set to 1
+   * \param first the expected first band
+   * \param end the expected band after the last one
+   */
+  void CheckActiveBands (std::vector<uint32_t> bands, uint32_t first, uint32_t end);
+
+  Ptr<const SpectrumModel> m_model;
+};
+
+MmWaveActiveBandsTestCase::MmWaveActiveBandsTestCase ()
+  : TestCase ("Occupied bands of a PSD and merge of the band ranges")
+{
+}
+
+MmWaveActiveBandsTestCase::~MmWaveActiveBandsTestCase ()
+{
+}
+
+MmWaveBandRange
+MmWaveActiveBandsTestCase::MakeRange (uint32_t first, uint32_t end)
+{
+  MmWaveBandRange range;
+  range.m_first = first;
+  range.m_end = end;
+  return range;
+}
+
+void
+MmWaveActiveBandsTestCase::CheckActiveBands (std::vector<uint32_t> bands, uint32_t first, uint32_t end)
+{
+  SpectrumValue psd (m_model);
+  for (uint32_t i = 0; i < bands.size (); i++)
+    {
+      psd[bands[i]] = 1;
+    }
+  MmWaveBandRange range = MmWaveSpectrumValueHelper::GetActiveBands (psd);
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, first, "wrong first band of " << bands.size () << " occupied bands");
+  NS_TEST_ASSERT_MSG_EQ (range.m_end, end, "wrong end band of " << bands.size () << " occupied bands");
+}
+
+void
+MmWaveActiveBandsTestCase::DoRun (void)
+{
+  m_model = MmWaveSpectrumValueHelper::GetSpectrumModel (CreateObject<MmWavePhyMacCommon> ());
+  uint32_t numBands = m_model->GetNumBands ();
+
+  std::vector<uint32_t> bands;
+  SpectrumValue empty (m_model);
+  MmWaveBandRange range = MmWaveSpectrumValueHelper::GetActiveBands (empty);
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, range.m_end, "bands occupied in a PSD of 0");
+
+  bands.push_back (5);
+  CheckActiveBands (bands, 5, 6);
+  bands.push_back (9);
+  bands.push_back (20);
+  CheckActiveBands (bands, 5, 21);
+  bands.clear ();
+  bands.push_back (0);
+  CheckActiveBands (bands, 0, 1);
+  bands.clear ();
+  bands.push_back (numBands - 1);
+  CheckActiveBands (bands, numBands - 1, numBands);
+  for (uint32_t i = 0; i < numBands; i++)
+    {
+      bands.push_back (i);
+    }
+  CheckActiveBands (bands, 0, numBands);
+
+  range = MmWaveSpectrumValueHelper::MergeBands (MakeRange (3, 7), MakeRange (10, 12));
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, 3, "wrong first band of disjoint ranges");
+  NS_TEST_ASSERT_MSG_EQ (range.m_end, 12, "wrong end band of disjoint ranges");
+  range = MmWaveSpectrumValueHelper::MergeBands (MakeRange (4, 20), MakeRange (6, 9));
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, 4, "wrong first band of nested ranges");
+  NS_TEST_ASSERT_MSG_EQ (range.m_end, 20, "wrong end band of nested ranges");
+  // the empty ranges can be anywhere, they do not extend the other range
+  range = MmWaveSpectrumValueHelper::MergeBands (MakeRange (numBands, numBands), MakeRange (6, 9));
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, 6, "wrong first band with an empty range");
+  NS_TEST_ASSERT_MSG_EQ (range.m_end, 9, "wrong end band with an empty range");
+  range = MmWaveSpectrumValueHelper::MergeBands (MakeRange (6, 9), MakeRange (0, 0));
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, 6, "wrong first band with an empty range");
+  NS_TEST_ASSERT_MSG_EQ (range.m_end, 9, "wrong end band with an empty range");
+  range = MmWaveSpectrumValueHelper::MergeBands (MakeRange (2, 2), MakeRange (7, 7));
+  NS_TEST_ASSERT_MSG_EQ (range.m_first, range.m_end, "merge of two empty ranges not empty");
+}
+
+/**
+ * The MI error model decodes the TBs received with the same SINR in one batch. Compare the
+ * stats of a batch with those of one GetTbDecodificationStats call for each TB: TBs over
+ * different chunks, with MCSs of the three modulation orders and with or without HARQ history
+ */
+class MmWaveMiBatchDecodeTestCase : public TestCase
+{
+public:
+  MmWaveMiBatchDecodeTestCase ();
+  virtual ~MmWaveMiBatchDecodeTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWaveMiBatchDecodeTestCase::MmWaveMiBatchDecodeTestCase ()
+  : TestCase ("MI error model batch decoding of the TBs of a SINR")
+{
+}
+
+MmWaveMiBatchDecodeTestCase::~MmWaveMiBatchDecodeTestCase ()
+{
+}
+
+void
+MmWaveMiBatchDecodeTestCase::DoRun (void)
+{
+  Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+  SpectrumValue sinr (MmWaveSpectrumValueHelper::GetSpectrumModel (config));
+  unsigned numChunks = 0;
+  for (Values::iterator it = sinr.ValuesBegin (); it != sinr.ValuesEnd (); it++, numChunks++)
+    {
+      *it = std::pow (10.0, (-5.0 + (numChunks * 7) % 30) / 10.0);
+    }
+
+  uint8_t mcss[] = {0, 4, 9, 10, 16, 17, 22, 28};
+  unsigned numMcs = sizeof (mcss) / sizeof (mcss[0]);
+  std::vector< std::vector<int> > maps (numMcs);
+  MmWaveHarqProcessInfoList_t noHistory;
+  std::vector<MmWaveHarqProcessInfoList_t> histories (numMcs);
+  std::vector<TbDecodeInfo_t> tbs (2 * numMcs);
+  for (unsigned i = 0; i < numMcs; i++)
+    {
+      // every other TB over a different half of the chunks
+      for (unsigned j = (i % 2) * numChunks / 2; j < (i % 2 + 1) * numChunks / 2; j++)
+        {
+          maps[i].push_back (j);
+        }
+      MmWaveHarqProcessInfoElement_t el;
+      el.m_mi = 0.3;
+      el.m_rv = 0;
+      el.m_infoBits = 100 * (i + 1) * 8;
+      el.m_codeBits = el.m_infoBits * 2;
+      histories[i].push_back (el);
+
+      // a first transmission and a retransmission of each MCS
+      for (unsigned k = 0; k < 2; k++)
+        {
+          TbDecodeInfo_t &tb = tbs[2 * i + k];
+          tb.map = &maps[i];
+          tb.size = 100 * (i + 1);
+          tb.mcs = mcss[i];
+          tb.miHistory = k == 0 ? &noHistory : &histories[i];
+        }
+    }
+
+  MmWaveMiErrorModel::GetTbDecodificationStats (sinr, tbs);
+  for (unsigned i = 0; i < tbs.size (); i++)
+    {
+      TbStats_t expected = MmWaveMiErrorModel::GetTbDecodificationStats (sinr, *tbs[i].map, tbs[i].size, tbs[i].mcs, *tbs[i].miHistory);
+      NS_TEST_ASSERT_MSG_EQ_TOL (tbs[i].stats.tbler, expected.tbler, 1e-12, "different TBLER of TB " << i);
+      NS_TEST_ASSERT_MSG_EQ_TOL (tbs[i].stats.mi, expected.mi, 1e-12, "different MI of TB " << i);
+      NS_TEST_ASSERT_MSG_EQ_TOL (tbs[i].stats.miTotal, expected.miTotal, 1e-12, "different total MI of TB " << i);
+    }
+}
+
+/**
+ * The PF ranking gives each symbol to the UE with the highest metric and breaks the ties by
+ * RNTI. UEs configured out of RNTI order, with the same buffer and no CQI report, all have the
+ * metric of a UE without average throughput: the symbols go to the lowest RNTIs, one each
+ */
+class MmWavePfTieTestCase : public TestCase
+{
+public:
+  MmWavePfTieTestCase ();
+  virtual ~MmWavePfTieTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWavePfTieTestCase::MmWavePfTieTestCase ()
+  : TestCase ("PF ranking of the UEs with the same metric in RNTI order")
+{
+}
+
+MmWavePfTieTestCase::~MmWavePfTieTestCase ()
+{
+}
+
+void
+MmWavePfTieTestCase::DoRun (void)
+{
+  Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+  MmWaveFlexTtiSchedEngine engine;
+  engine.Configure (config, CreateObject<MmWaveAmc> (config), MmWaveFlexTtiSchedEngine::EVEN_SPLIT);
+
+  const unsigned numUes = 20;
+  for (unsigned i = 0; i < numUes; i++)
+    {
+      MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters report;
+      report.m_rnti = 1 + (i * 7) % numUes;
+      report.m_logicalChannelIdentity = 3;
+      report.m_rlcTransmissionQueueSize = 100000;
+      engine.AddUe (report.m_rnti);
+      NS_TEST_ASSERT_MSG_NE (engine.UpdateDlFlow (report), 0, "flow of RNTI " << report.m_rnti << " not found");
+    }
+
+  const int numSym = 8;
+  int symAvail = numSym;
+  engine.AllocateNewData<MmWavePfRankingPolicy> (symAvail);
+  NS_TEST_ASSERT_MSG_EQ (symAvail, 0, "symbols left");
+  NS_TEST_ASSERT_MSG_EQ (engine.GetUes ().size (), numUes, "wrong number of UEs");
+  for (unsigned i = 0; i < engine.GetUes ().size (); i++)
+    {
+      const MmWaveFlexTtiUeSchedInfo *ue = engine.GetUes ()[i];
+      NS_TEST_ASSERT_MSG_EQ (ue->m_rnti, i + 1, "UEs not in RNTI order");
+      NS_TEST_ASSERT_MSG_EQ ((unsigned) ue->m_dlSymbols, (ue->m_rnti <= numSym ? 1u : 0u), "wrong symbols of RNTI " << ue->m_rnti);
+      NS_TEST_ASSERT_MSG_EQ ((unsigned) ue->m_ulSymbols, 0u, "UL symbols of RNTI " << ue->m_rnti);
+    }
+  engine.Dispose ();
+}
+
+/**
+ * The indexed heap of the flex-TTI schedulers against a linear scan of the keys: random
+ * Set, Remove and SetKey followed by Heapify, with few distinct keys so that the ties by
+ * lowest index are exercised
+ */
+class MmWaveIndexedHeapTestCase : public TestCase
+{
+public:
+  MmWaveIndexedHeapTestCase ();
+  virtual ~MmWaveIndexedHeapTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWaveIndexedHeapTestCase::MmWaveIndexedHeapTestCase ()
+  : TestCase ("Indexed heap Set, Remove, SetKey and Top")
+{
+}
+
+MmWaveIndexedHeapTestCase::~MmWaveIndexedHeapTestCase ()
+{
+}
+
+void
+MmWaveIndexedHeapTestCase::DoRun (void)
+{
+  const unsigned numItems = 20;
+  MmWaveIndexedHeap heap;
+  heap.Resize (numItems);
+  std::vector<double> keys (numItems, 0.0);
+  std::vector<bool> inHeap (numItems, false);
+
+  uint32_t seed = 1;
+  for (unsigned step = 0; step < 5000; step++)
+    {
+      seed = seed * 1103515245 + 12345;  // deterministic sequence, independent of the ns-3 RNG
+      unsigned op = (seed >> 16) % 8;
+      unsigned item = (seed >> 8) % numItems;
+      double key = (seed >> 20) % 5;
+      if (op < 4)
+        {
+          heap.Set (item, key);
+          keys[item] = key;
+          inHeap[item] = true;
+        }
+      else if (op < 6)
+        {
+          if (inHeap[item])
+            {
+              heap.Remove (item);
+              inHeap[item] = false;
+            }
+        }
+      else if (op < 7)
+        {
+          // change the keys of all the items, then rebuild the heap
+          for (unsigned i = 0; i < numItems; i++)
+            {
+              if (inHeap[i])
+                {
+                  keys[i] = (keys[i] + i) - 5 * std::floor ((keys[i] + i) / 5);
+                  heap.SetKey (i, keys[i]);
+                }
+            }
+          heap.Heapify ();
+        }
+      else if (step % 100 == 7)
+        {
+          heap.Clear ();
+          std::fill (inHeap.begin (), inHeap.end (), false);
+        }
+
+      unsigned size = 0;
+      unsigned expectedTop = numItems;
+      for (unsigned i = 0; i < numItems; i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (heap.Contains (i), inHeap[i], "wrong membership of item " << i << " at step " << step);
+          if (inHeap[i])
+            {
+              size++;
+              if (expectedTop == numItems || keys[i] > keys[expectedTop])
+                {
+                  expectedTop = i;
+                }
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (heap.GetSize (), size, "wrong size at step " << step);
+      NS_TEST_ASSERT_MSG_EQ (heap.IsEmpty (), (size == 0), "wrong emptiness at step " << step);
+      if (size > 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (heap.Top (), expectedTop, "wrong top at step " << step);
+        }
+    }
+}
+
+/**
+ * SAP users of a scheduler under test, the last allocation is kept
+ */
+class MmWaveTestMacSchedSapUser : public MmWaveMacSchedSapUser
+{
+public:
+  virtual void SchedConfigInd (const struct SchedConfigIndParameters& params)
+  {
+    m_lastConfig = params;
+  }
+
+  SchedConfigIndParameters m_lastConfig;
+};
+
+class MmWaveTestMacCschedSapUser : public MmWaveMacCschedSapUser
+{
+public:
+  virtual void CschedCellConfigCnf (const struct CschedCellConfigCnfParameters& params) {}
+  virtual void CschedUeConfigCnf (const struct CschedUeConfigCnfParameters& params) {}
+  virtual void CschedLcConfigCnf (const struct CschedLcConfigCnfParameters& params) {}
+  virtual void CschedLcReleaseCnf (const struct CschedLcReleaseCnfParameters& params) {}
+  virtual void CschedUeReleaseCnf (const struct CschedUeReleaseCnfParameters& params) {}
+  virtual void CschedUeConfigUpdateInd (const struct CschedUeConfigUpdateIndParameters& params) {}
+  virtual void CschedCellConfigUpdateInd (const struct CschedCellConfigUpdateIndParameters& params) {}
+};
+
+/**
+ * The MaxWeight scheduler ranks the flows of the configured LCs in its EDF heap. Configure the
+ * LCs of a UE in two steps, the second one with a higher LCID that adds flows to the UE, then
+ * reconfigure the first LC, and check that a packet of the first LC is scheduled once
+ */
+class MmWaveMaxWeightFlowTestCase : public TestCase
+{
+public:
+  MmWaveMaxWeightFlowTestCase ();
+  virtual ~MmWaveMaxWeightFlowTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \param lcid the LCID
+   * \returns the configuration of a DL LC
+   */
+  static LogicalChannelConfigListElement_s CreateLc (uint8_t lcid);
+
+  /**
+   * \param config the allocation of a subframe
+   * \param rnti the RNTI
+   * \param lcid the LCID
+   * \returns the number of RLC PDUs of the LC in the DL data slots of the UE
+   */
+  static unsigned CountDlPdus (const MmWaveMacSchedSapUser::SchedConfigIndParameters &config, uint16_t rnti, uint8_t lcid);
+};
+
+MmWaveMaxWeightFlowTestCase::MmWaveMaxWeightFlowTestCase ()
+  : TestCase ("MaxWeight flows of LCs configured in two steps")
+{
+}
+
+MmWaveMaxWeightFlowTestCase::~MmWaveMaxWeightFlowTestCase ()
+{
+}
+
+LogicalChannelConfigListElement_s
+MmWaveMaxWeightFlowTestCase::CreateLc (uint8_t lcid)
+{
+  LogicalChannelConfigListElement_s lc;
+  lc.m_logicalChannelIdentity = lcid;
+  lc.m_logicalChannelGroup = 1;
+  lc.m_direction = LogicalChannelConfigListElement_s::DIR_DL;
+  lc.m_qosBearerType = LogicalChannelConfigListElement_s::QBT_NON_GBR;
+  lc.m_qci = EpsBearer::NGBR_VIDEO_TCP_DEFAULT;
+  lc.m_eRabMaximulBitrateUl = lc.m_eRabMaximulBitrateDl = 0;
+  lc.m_eRabGuaranteedBitrateUl = lc.m_eRabGuaranteedBitrateDl = 0;
+  return lc;
+}
+
+unsigned
+MmWaveMaxWeightFlowTestCase::CountDlPdus (const MmWaveMacSchedSapUser::SchedConfigIndParameters &config, uint16_t rnti, uint8_t lcid)
+{
+  unsigned numPdus = 0;
+  const std::deque<SlotAllocInfo> &slots = config.m_sfAllocInfo.m_slotAllocInfo;
+  for (std::deque<SlotAllocInfo>::const_iterator it = slots.begin (); it != slots.end (); it++)
+    {
+      if (it->m_tddMode != SlotAllocInfo::DL || it->m_slotType != SlotAllocInfo::CTRL_DATA || it->m_dci.m_rnti != rnti)
+        {
+          continue;
+        }
+      for (unsigned i = 0; i < it->m_rlcPduInfo.size (); i++)
+        {
+          if (it->m_rlcPduInfo[i].m_lcid == lcid)
+            {
+              numPdus++;
+            }
+        }
+    }
+  return numPdus;
+}
+
+void
+MmWaveMaxWeightFlowTestCase::DoRun (void)
+{
+  Ptr<MmWaveMacScheduler> scheduler = CreateObject<MmWaveFlexTtiMaxWeightMacScheduler> ();
+  MmWaveTestMacSchedSapUser schedUser;
+  MmWaveTestMacCschedSapUser cschedUser;
+  scheduler->ConfigureCommonParameters (CreateObject<MmWavePhyMacCommon> ());
+  scheduler->SetMacSchedSapUser (&schedUser);
+  scheduler->SetMacCschedSapUser (&cschedUser);
+  MmWaveMacSchedSapProvider *schedSap = scheduler->GetMacSchedSapProvider ();
+  MmWaveMacCschedSapProvider *cschedSap = scheduler->GetMacCschedSapProvider ();
+
+  uint16_t rnti = 1;
+  MmWaveMacCschedSapProvider::CschedUeConfigReqParameters ueConfig;
+  ueConfig.m_rnti = rnti;
+  ueConfig.m_transmissionMode = 0;
+  ueConfig.m_reconfigureFlag = false;
+  cschedSap->CschedUeConfigReq (ueConfig);
+
+  MmWaveMacCschedSapProvider::CschedLcConfigReqParameters lcConfig;
+  lcConfig.m_rnti = rnti;
+  lcConfig.m_reconfigureFlag = false;
+  lcConfig.m_logicalChannelConfigList.push_back (CreateLc (3));
+  cschedSap->CschedLcConfigReq (lcConfig);
+  lcConfig.m_logicalChannelConfigList.clear ();
+  lcConfig.m_logicalChannelConfigList.push_back (CreateLc (10));
+  cschedSap->CschedLcConfigReq (lcConfig);
+  lcConfig.m_reconfigureFlag = true;
+  lcConfig.m_logicalChannelConfigList.clear ();
+  lcConfig.m_logicalChannelConfigList.push_back (CreateLc (3));
+  cschedSap->CschedLcConfigReq (lcConfig);
+
+  SfnSf sfn (0, 0, 0);
+  MmWaveMacSchedSapProvider::SchedDlCqiInfoReqParameters cqiParams;
+  cqiParams.m_sfnsf = sfn;
+  DlCqiInfo cqi;
+  cqi.m_rnti = rnti;
+  cqi.m_ri = 1;
+  cqi.m_cqiType = DlCqiInfo::WB;
+  cqi.m_wbCqi = 15;
+  cqi.m_wbPmi = 0;
+  cqiParams.m_cqiList.push_back (cqi);
+  schedSap->SchedDlCqiInfoReq (cqiParams);
+
+  MmWaveMacSchedSapProvider::SchedDlRlcBufferReqParameters rlcParams;
+  rlcParams.m_rnti = rnti;
+  rlcParams.m_logicalChannelIdentity = 3;
+  rlcParams.m_rlcTransmissionQueueSize = 100;
+  rlcParams.m_rlcTransmissionQueueHolDelay = 0;
+  rlcParams.m_rlcRetransmissionQueueSize = 0;
+  rlcParams.m_rlcRetransmissionHolDelay = 0;
+  rlcParams.m_rlcStatusPduSize = 0;
+  rlcParams.m_arrivalRate = 0;
+  rlcParams.m_txPacketSizes.push_back (100);
+  rlcParams.m_txPacketDelays.push_back (0.0);
+  schedSap->SchedDlRlcBufferReq (rlcParams);
+
+  MmWaveMacSchedSapProvider::SchedTriggerReqParameters trigger;
+  trigger.m_snfSf = sfn;
+  schedSap->SchedTriggerReq (trigger);
+  NS_TEST_ASSERT_MSG_EQ (CountDlPdus (schedUser.m_lastConfig, rnti, 3), 1, "the packet of LC 3 is not scheduled once");
+
+  // the packet is served, the flow leaves the EDF heap
+  trigger.m_snfSf.m_sfNum++;
+  schedSap->SchedTriggerReq (trigger);
+  NS_TEST_ASSERT_MSG_EQ (CountDlPdus (schedUser.m_lastConfig, rnti, 3), 0, "the packet of LC 3 is scheduled again");
+
+  scheduler->Dispose ();
+}
+
+/**
+ * The AMC reads the TB sizes of up to one subframe of symbols from a table built at
+ * construction. Compare GetTbSizeFromMcsSymbols with CalcTbSizeFromMcsSymbols, within the
+ * table and beyond it, for the default numerology and a longer subframe
+ */
+class MmWaveAmcTbSizeTableTestCase : public TestCase
+{
+public:
+  MmWaveAmcTbSizeTableTestCase ();
+  virtual ~MmWaveAmcTbSizeTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+MmWaveAmcTbSizeTableTestCase::MmWaveAmcTbSizeTableTestCase ()
+  : TestCase ("AMC TB size table against the TB size computation")
+{
+}
+
+MmWaveAmcTbSizeTableTestCase::~MmWaveAmcTbSizeTableTestCase ()
+{
+}
+
+void
+MmWaveAmcTbSizeTableTestCase::DoRun (void)
+{
+  for (unsigned iconfig = 0; iconfig < 2; iconfig++)
+    {
+      Ptr<MmWavePhyMacCommon> config = CreateObject<MmWavePhyMacCommon> ();
+      if (iconfig == 1)
+        {
+          config->SetSymbolsPerSubframe (2 * config->GetSymbolsPerSubframe ());
+        }
+      Ptr<MmWaveAmc> amc = CreateObject<MmWaveAmc> (config);
+      unsigned numSym = config->GetSymbolsPerSubframe ();
+      for (unsigned mcs = 0; mcs < 29; mcs++)
+        {
+          // the table covers up to one subframe, the last two counts are computed
+          for (unsigned nsym = 0; nsym <= numSym + 2; nsym++)
+            {
+              NS_TEST_ASSERT_MSG_EQ (amc->GetTbSizeFromMcsSymbols (mcs, nsym), amc->CalcTbSizeFromMcsSymbols (mcs, nsym),
+                                     "different TB size of MCS " << mcs << " and " << nsym << " symbols");
+            }
+        }
+    }
+}
+
+/**
+ * PHY of an eNB MAC of MmWaveSchedTriggerBatchTestCase, it records the allocations of the cell
+ */
+class MmWaveTestEnbPhySapProvider : public MmWavePhySapProvider
+{
+public:
+  MmWaveTestEnbPhySapProvider (std::string *allocations)
+    : m_allocations (allocations)
+  {
+  }
+
+  virtual void SendMacPdu (Ptr<Packet> p)
+  {
+  }
+
+  virtual void SendControlMessage (Ptr<MmWaveControlMessage> msg)
+  {
+  }
+
+  virtual void SendRachPreamble (uint8_t preambleId, uint8_t rnti)
+  {
+  }
+
+  virtual void SetDlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
+  {
+    std::ostringstream os;
+    os << sfAllocInfo.m_sfnSf.m_frameNum << "/" << (uint16_t) sfAllocInfo.m_sfnSf.m_sfNum << ":";
+    for (unsigned i = 0; i < sfAllocInfo.m_slotAllocInfo.size (); i++)
+      {
+        const SlotAllocInfo &slot = sfAllocInfo.m_slotAllocInfo[i];
+        os << " " << slot.m_tddMode << "," << slot.m_slotType << "," << slot.m_dci.m_rnti
+           << "," << (uint16_t) slot.m_dci.m_symStart << "," << (uint16_t) slot.m_dci.m_numSym
+           << "," << (uint16_t) slot.m_dci.m_mcs << "," << slot.m_dci.m_tbSize;
+      }
+    *m_allocations += os.str () + "\n";
+  }
+
+  virtual void SetUlSfAllocInfo (const SfAllocInfo& sfAllocInfo)
+  {
+  }
+
+private:
+  std::string *m_allocations;
+};
+
+/**
+ * RLC of the LCs of MmWaveSchedTriggerBatchTestCase, the transmission opportunities are not used
+ */
+class MmWaveTestMacSapUser : public LteMacSapUser
+{
+public:
+  virtual void NotifyTxOpportunity (uint32_t bytes, uint8_t layer, uint8_t harqId)
+  {
+  }
+
+  virtual void NotifyHarqDeliveryFailure ()
+  {
+  }
+
+  virtual void ReceivePdu (Ptr<Packet> p)
+  {
+  }
+};
+
+/**
+ * Drive the MACs of several cells with the same buffer reports and CQIs with SchedulingThreads
+ * 1, i.e., the scheduler triggers run immediately, and with several threads, i.e., the triggers
+ * of the cells are run by their MmWaveSchedTriggerBatch, and check that the allocations are the same
+ */
+class MmWaveSchedTriggerBatchTestCase : public TestCase
+{
+public:
+  MmWaveSchedTriggerBatchTestCase (std::string schedulerType);
+  virtual ~MmWaveSchedTriggerBatchTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * Run the cells for m_numSubframes subframes
+   * \param numThreads the SchedulingThreads of the MACs
+   * \return the allocations of each cell
+   */
+  std::vector<std::string> RunCells (uint32_t numThreads);
+
+  /**
+   * Report the buffers and the CQIs of the UEs of a cell and start its subframe
+   */
+  void SubframeIndication (Ptr<MmWaveEnbMac> mac, uint16_t cell, uint32_t subframe);
+
+  std::string m_schedulerType;
+  Ptr<MmWavePhyMacCommon> m_config;
+  uint16_t m_numCells;
+  uint16_t m_numUes; // per cell
+  uint32_t m_numSubframes;
+};
+
+MmWaveSchedTriggerBatchTestCase::MmWaveSchedTriggerBatchTestCase (std::string schedulerType)
+  : TestCase ("Scheduler triggers of " + schedulerType + " run serially and by the batch on several threads"),
+    m_schedulerType (schedulerType),
+    m_numCells (3),
+    m_numUes (4),
+    m_numSubframes (200)
+{
+}
+
+MmWaveSchedTriggerBatchTestCase::~MmWaveSchedTriggerBatchTestCase ()
+{
+}
+
+void
+MmWaveSchedTriggerBatchTestCase::SubframeIndication (Ptr<MmWaveEnbMac> mac, uint16_t cell, uint32_t subframe)
+{
+  for (uint16_t rnti = 1; rnti <= m_numUes; rnti++)
+    {
+      if ((cell + rnti + subframe) % 3 != 0)
+        {
+          LteMacSapProvider::ReportBufferStatusParameters buffer;
+          buffer.rnti = rnti;
+          buffer.lcid = 3;
+          buffer.txQueueSize = 200 + ((7 * cell + 13 * rnti + 3 * subframe) % 11) * 400;
+          buffer.txQueueHolDelay = 0;
+          buffer.retxQueueSize = 0;
+          buffer.retxQueueHolDelay = 0;
+          buffer.statusPduSize = 0;
+          buffer.txPacketSizes.push_back (buffer.txQueueSize);
+          buffer.txPacketDelays.push_back (subframe % 4);
+          buffer.arrivalRate = 0;
+          mac->GetUeMacSapProvider ()->ReportBufferStatus (buffer);
+        }
+      if (subframe % 10 == rnti % 10)
+        {
+          DlCqiInfo cqi;
+          cqi.m_rnti = rnti;
+          cqi.m_ri = 1;
+          cqi.m_cqiType = DlCqiInfo::WB;
+          cqi.m_wbCqi = 2 + (cell + 3 * rnti + subframe / 10) % 13;
+          cqi.m_wbPmi = 0;
+          Ptr<MmWaveDlCqiMessage> msg = Create<MmWaveDlCqiMessage> ();
+          msg->SetDlCqi (cqi);
+          mac->GetPhySapUser ()->ReceiveControlMessage (msg);
+        }
+    }
+  uint32_t subframesPerFrame = m_config->GetSubframesPerFrame ();
+  mac->GetPhySapUser ()->SubframeIndication (SfnSf (subframe / subframesPerFrame, subframe % subframesPerFrame, 0));
+}
+
+std::vector<std::string>
+MmWaveSchedTriggerBatchTestCase::RunCells (uint32_t numThreads)
+{
+  std::vector<std::string> allocations (m_numCells);
+  std::vector<MmWaveTestEnbPhySapProvider*> phys;
+  MmWaveTestMacSapUser rlc;
+  std::vector< Ptr<MmWaveEnbMac> > macs;
+  std::vector< Ptr<MmWaveMacScheduler> > schedulers;
+  Ptr<MmWaveSchedTriggerBatch> batch = CreateObject<MmWaveSchedTriggerBatch> ();
+  ObjectFactory schedulerFactory;
+  schedulerFactory.SetTypeId (m_schedulerType);
+  schedulerFactory.Set ("HarqEnabled", BooleanValue (false));
+
+  for (uint16_t cell = 0; cell < m_numCells; cell++)
+    {
+      Ptr<MmWaveEnbMac> mac = CreateObject<MmWaveEnbMac> ();
+      mac->SetAttribute ("SchedulingThreads", UintegerValue (numThreads));
+      mac->SetConfigurationParameters (m_config);
+      mac->SetCellId (cell + 1);
+      mac->SetSchedTriggerBatch (batch);
+      Ptr<MmWaveMacScheduler> scheduler = schedulerFactory.Create<MmWaveMacScheduler> ();
+      scheduler->ConfigureCommonParameters (m_config);
+      mac->SetMmWaveMacSchedSapProvider (scheduler->GetMacSchedSapProvider ());
+      mac->SetMmWaveMacCschedSapProvider (scheduler->GetMacCschedSapProvider ());
+      scheduler->SetMacSchedSapUser (mac->GetMmWaveMacSchedSapUser ());
+      scheduler->SetMacCschedSapUser (mac->GetMmWaveMacCschedSapUser ());
+      phys.push_back (new MmWaveTestEnbPhySapProvider (&allocations[cell]));
+      mac->SetPhySapProvider (phys.back ());
+
+      for (uint16_t rnti = 1; rnti <= m_numUes; rnti++)
+        {
+          mac->GetEnbCmacSapProvider ()->AddUe (rnti);
+          LteEnbCmacSapProvider::LcInfo lc;
+          lc.rnti = rnti;
+          lc.lcId = 3;
+          lc.lcGroup = 1;
+          lc.qci = EpsBearer::NGBR_VIDEO_TCP_DEFAULT;
+          lc.isGbr = false;
+          lc.mbrUl = 0;
+          lc.mbrDl = 0;
+          lc.gbrUl = 0;
+          lc.gbrDl = 0;
+          mac->GetEnbCmacSapProvider ()->AddLc (lc, &rlc);
+        }
+      macs.push_back (mac);
+      schedulers.push_back (scheduler);
+    }
+
+  for (uint32_t subframe = 0; subframe < m_numSubframes; subframe++)
+    {
+      for (uint16_t cell = 0; cell < m_numCells; cell++)
+        {
+          Simulator::Schedule (MicroSeconds (subframe * m_config->GetSubframePeriod ()),
+                               &MmWaveSchedTriggerBatchTestCase::SubframeIndication, this, macs[cell], cell, subframe);
+        }
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  for (uint16_t cell = 0; cell < m_numCells; cell++)
+    {
+      macs[cell]->Dispose ();
+      schedulers[cell]->Dispose ();
+      delete phys[cell];
+    }
+  return allocations;
+}
+
+void
+MmWaveSchedTriggerBatchTestCase::DoRun (void)
+{
+  m_config = CreateObject<MmWavePhyMacCommon> ();
+  std::vector<std::string> serial = RunCells (1);
+  uint32_t threads[] = {2, 3, 0};
+  for (uint32_t i = 0; i < sizeof (threads) / sizeof (threads[0]); i++)
+    {
+      std::vector<std::string> batch = RunCells (threads[i]);
+      for (uint16_t cell = 0; cell < m_numCells; cell++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (serial[cell].empty (), false, "no allocation for cell " << cell + 1);
+          NS_TEST_ASSERT_MSG_EQ (batch[cell], serial[cell], "different allocations of cell " << cell + 1
+                                 << " with SchedulingThreads " << threads[i]);
+        }
+    }
+  m_config = 0;
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -87,6 +2230,24 @@ MmwaveTestSuite::MmwaveTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new MmwaveTestCase1, TestCase::QUICK);
+  AddTestCase (new MmWave3gppSubbandGainTestCase, TestCase::QUICK);
+  AddTestCase (new MmWave3gppRelevanceTestCase, TestCase::QUICK);
+  AddTestCase (new MmWave3gppBatchUpdateTestCase, TestCase::QUICK);
+  AddTestCase (new MmWave3gppDominantBeamsTestCase, TestCase::QUICK);
+  AddTestCase (new MmWave3gppBeamSearchTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveRaytracingTraceTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveInterferenceLedgerTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveMiClampTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveAmcMcsSearchTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveActiveBandsTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveMiBatchDecodeTestCase, TestCase::QUICK);
+  AddTestCase (new MmWavePfTieTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveIndexedHeapTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveMaxWeightFlowTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveAmcTbSizeTableTestCase, TestCase::QUICK);
+  AddTestCase (new MmWaveSchedTriggerBatchTestCase ("ns3::MmWaveFlexTtiMacScheduler"), TestCase::QUICK);
+  AddTestCase (new MmWaveSchedTriggerBatchTestCase ("ns3::MmWaveFlexTtiPfMacScheduler"), TestCase::QUICK);
+  AddTestCase (new MmWaveSchedTriggerBatchTestCase ("ns3::MmWaveFlexTtiMaxWeightMacScheduler"), TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite
@@ -26,6 +26,7 @@
 #include <ns3/net-device.h>
 #include <ns3/node.h>
 #include <ns3/double.h>
+#include <ns3/uinteger.h>
 #include <ns3/mobility-model.h>
 #include <ns3/spectrum-phy.h>
 #include <ns3/spectrum-converter.h>
@@ -36,6 +37,9 @@
 #include <ns3/angles.h>
 #include <iostream>
 #include <utility>
+#include <algorithm>
+#include <cmath>
+#include <unistd.h>
 #include "multi-model-spectrum-channel.h"
 
 
@@ -82,8 +86,22 @@ RxSpectrumModelInfo::RxSpectrumModelInfo (Ptr<const SpectrumModel> rxSpectrumMod
 
 
 MultiModelSpectrumChannel::MultiModelSpectrumChannel ()
+  : m_rxIndexValid (false),
+    m_fanOut (false)
 {
   NS_LOG_FUNCTION (this);
+#ifdef HAVE_PTHREAD_H
+  m_fanOutRound = 0;
+  m_fanOutStride = 1;
+  m_fanOutBusy = 0;
+  m_fanOutStop = false;
+#endif
+}
+
+MultiModelSpectrumChannel::~MultiModelSpectrumChannel ()
+{
+  // the workers wait on the members of this channel
+  StopFanOutWorkers ();
 }
 
 void
@@ -95,6 +113,15 @@ MultiModelSpectrumChannel::DoDispose ()
   m_spectrumPropagationLoss = 0;
   m_txSpectrumModelInfoMap.clear ();
   m_rxSpectrumModelInfoMap.clear ();
+  for (std::set<Ptr<MobilityModel> >::iterator it = m_rxMobilities.begin (); it != m_rxMobilities.end (); ++it)
+    {
+      (*it)->TraceDisconnectWithoutContext ("CourseChange", MakeCallback (&MultiModelSpectrumChannel::RxCourseChanged, this));
+    }
+  m_rxMobilities.clear ();
+  m_rxGrid.clear ();
+  m_rxUnindexed.clear ();
+  m_rxInRange.clear ();
+  StopFanOutWorkers ();
   SpectrumChannel::DoDispose ();
 }
 
@@ -119,6 +146,28 @@ MultiModelSpectrumChannel::GetTypeId (void)
                    DoubleValue (1.0e9),
                    MakeDoubleAccessor (&MultiModelSpectrumChannel::m_maxLossDb),
                    MakeDoubleChecker<double> ())
+    .AddAttribute ("MaxRange",
+                   "Maximum distance in meters between a transmitter and a "
+                   "receiver for which transmissions are passed to the "
+                   "receiving PHY. The receivers further away are skipped "
+                   "before the signal parameters are copied and the "
+                   "propagation models are evaluated, and the PathLoss "
+                   "trace is not fired for them. Only the receivers of the "
+                   "transmitters and receivers with a MobilityModel are "
+                   "skipped. 0 considers all the receivers.",
+                   DoubleValue (0),
+                   MakeDoubleAccessor (&MultiModelSpectrumChannel::m_maxRange),
+                   MakeDoubleChecker<double> (0))
+    .AddAttribute ("FanOutThreads",
+                   "Number of threads computing the received PSDs of a "
+                   "transmission, 0 for one thread per available core. "
+                   "With more than one thread, the parts of the computation "
+                   "deferred by the SpectrumPropagationLossModel run in "
+                   "parallel, and the receptions are scheduled in the same "
+                   "order as with one thread.",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&MultiModelSpectrumChannel::m_fanOutThreads),
+                   MakeUintegerChecker<uint32_t> ())
     .AddTraceSource ("PathLoss",
                      "This trace is fired whenever a new path loss value "
                      "is calculated. The first and second parameters "
@@ -171,6 +220,7 @@ MultiModelSpectrumChannel::AddRx (Ptr<SpectrumPhy> phy)
     }
 
   ++m_numDevices;
+  m_rxIndexValid = false;
 
   RxSpectrumModelInfoMap_t::iterator rxInfoIterator = m_rxSpectrumModelInfoMap.find (rxSpectrumModelUid);
 
@@ -272,108 +322,400 @@ MultiModelSpectrumChannel::StartTx (Ptr<SpectrumSignalParameters> txParams)
   NS_LOG_LOGIC ("converter map size: " << txInfoIteratorerator->second.m_spectrumConverterMap.size ());
   NS_LOG_LOGIC ("converter map first element: " << txInfoIteratorerator->second.m_spectrumConverterMap.begin ()->first);
 
-  for (RxSpectrumModelInfoMap_t::const_iterator rxInfoIterator = m_rxSpectrumModelInfoMap.begin ();
-       rxInfoIterator != m_rxSpectrumModelInfoMap.end ();
-       ++rxInfoIterator)
-    {
-      SpectrumModelUid_t rxSpectrumModelUid = rxInfoIterator->second.m_rxSpectrumModel->GetUid ();
-      NS_LOG_LOGIC (" rxSpectrumModelUids " << rxSpectrumModelUid);
+  m_fanOut = m_fanOutThreads != 1 && m_spectrumPropagationLoss != 0;
 
+  if (m_maxRange > 0 && txMobility != 0)
+    {
+      // visit the receivers in range only, in the same order as below
+      FindRxInRange (txMobility->GetPosition ());
       Ptr <SpectrumValue> convertedTxPowerSpectrum;
-      if (txSpectrumModelUid == rxSpectrumModelUid)
+      SpectrumModelUid_t rxSpectrumModelUid = 0;
+      for (std::vector<RxIndexEntry>::const_iterator rxIt = m_rxInRange.begin ();
+           rxIt != m_rxInRange.end ();
+           ++rxIt)
         {
-          NS_LOG_LOGIC ("no spectrum conversion needed");
-          convertedTxPowerSpectrum = txParams->psd;
+          if (convertedTxPowerSpectrum == 0 || rxIt->m_spectrumModelUid != rxSpectrumModelUid)
+            {
+              rxSpectrumModelUid = rxIt->m_spectrumModelUid;
+              NS_LOG_LOGIC (" rxSpectrumModelUids " << rxSpectrumModelUid);
+              convertedTxPowerSpectrum = ConvertTxPowerSpectrum (txInfoIteratorerator->second, rxSpectrumModelUid, txParams->psd);
+            }
+          PropagateToRx (txParams, convertedTxPowerSpectrum, txMobility, rxIt->m_phy);
         }
-      else
+    }
+  else
+    {
+      for (RxSpectrumModelInfoMap_t::const_iterator rxInfoIterator = m_rxSpectrumModelInfoMap.begin ();
+           rxInfoIterator != m_rxSpectrumModelInfoMap.end ();
+           ++rxInfoIterator)
         {
-          NS_LOG_LOGIC (" converting txPowerSpectrum SpectrumModelUids" << txSpectrumModelUid << " --> " << rxSpectrumModelUid);
-          SpectrumConverterMap_t::const_iterator rxConverterIterator = txInfoIteratorerator->second.m_spectrumConverterMap.find (rxSpectrumModelUid);
-          NS_ASSERT (rxConverterIterator != txInfoIteratorerator->second.m_spectrumConverterMap.end ());
-          convertedTxPowerSpectrum = rxConverterIterator->second.Convert (txParams->psd);
+          SpectrumModelUid_t rxSpectrumModelUid = rxInfoIterator->second.m_rxSpectrumModel->GetUid ();
+          NS_LOG_LOGIC (" rxSpectrumModelUids " << rxSpectrumModelUid);
+
+          Ptr <SpectrumValue> convertedTxPowerSpectrum = ConvertTxPowerSpectrum (txInfoIteratorerator->second, rxSpectrumModelUid, txParams->psd);
+
+          for (std::set<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = rxInfoIterator->second.m_rxPhySet.begin ();
+               rxPhyIterator != rxInfoIterator->second.m_rxPhySet.end ();
+               ++rxPhyIterator)
+            {
+              NS_ASSERT_MSG ((*rxPhyIterator)->GetRxSpectrumModel ()->GetUid () == rxSpectrumModelUid,
+                             "SpectrumModel change was not notified to MultiModelSpectrumChannel (i.e., AddRx should be called again after model is changed)");
+
+              PropagateToRx (txParams, convertedTxPowerSpectrum, txMobility, *rxPhyIterator);
+            }
+
         }
+    }
 
+  if (m_fanOut)
+    {
+      CompleteFanOut ();
+      m_fanOut = false;
+    }
+}
 
-      for (std::set<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = rxInfoIterator->second.m_rxPhySet.begin ();
-           rxPhyIterator != rxInfoIterator->second.m_rxPhySet.end ();
-           ++rxPhyIterator)
+Ptr<SpectrumValue>
+MultiModelSpectrumChannel::ConvertTxPowerSpectrum (const TxSpectrumModelInfo &txInfo,
+                                                   SpectrumModelUid_t rxSpectrumModelUid,
+                                                   Ptr<SpectrumValue> txPowerSpectrum) const
+{
+  if (txInfo.m_txSpectrumModel->GetUid () == rxSpectrumModelUid)
+    {
+      NS_LOG_LOGIC ("no spectrum conversion needed");
+      return txPowerSpectrum;
+    }
+  NS_LOG_LOGIC (" converting txPowerSpectrum SpectrumModelUids" << txInfo.m_txSpectrumModel->GetUid () << " --> " << rxSpectrumModelUid);
+  SpectrumConverterMap_t::const_iterator rxConverterIterator = txInfo.m_spectrumConverterMap.find (rxSpectrumModelUid);
+  NS_ASSERT (rxConverterIterator != txInfo.m_spectrumConverterMap.end ());
+  return rxConverterIterator->second.Convert (txPowerSpectrum);
+}
+
+void
+MultiModelSpectrumChannel::PropagateToRx (Ptr<SpectrumSignalParameters> txParams, Ptr<SpectrumValue> txPowerSpectrum,
+                                          Ptr<MobilityModel> txMobility, Ptr<SpectrumPhy> receiver)
+{
+  if (receiver == txParams->txPhy)
+    {
+      return;
+    }
+
+  Ptr<MobilityModel> receiverMobility = receiver->GetMobility ();
+  double pathLossDb = 0;
+  if (txMobility && receiverMobility)
+    {
+      if (txParams->txAntenna != 0)
         {
-          NS_ASSERT_MSG ((*rxPhyIterator)->GetRxSpectrumModel ()->GetUid () == rxSpectrumModelUid,
-                         "SpectrumModel change was not notified to MultiModelSpectrumChannel (i.e., AddRx should be called again after model is changed)");
+          Angles txAngles (receiverMobility->GetPosition (), txMobility->GetPosition ());
+          double txAntennaGain = txParams->txAntenna->GetGainDb (txAngles);
+          NS_LOG_LOGIC ("txAntennaGain = " << txAntennaGain << " dB");
+          pathLossDb -= txAntennaGain;
+        }
+      Ptr<AntennaModel> rxAntenna = receiver->GetRxAntenna ();
+      if (rxAntenna != 0)
+        {
+          Angles rxAngles (txMobility->GetPosition (), receiverMobility->GetPosition ());
+          double rxAntennaGain = rxAntenna->GetGainDb (rxAngles);
+          NS_LOG_LOGIC ("rxAntennaGain = " << rxAntennaGain << " dB");
+          pathLossDb -= rxAntennaGain;
+        }
+      if (m_propagationLoss)
+        {
+          double propagationGainDb = m_propagationLoss->CalcRxPower (0, txMobility, receiverMobility);
+          NS_LOG_LOGIC ("propagationGainDb = " << propagationGainDb << " dB");
+          pathLossDb -= propagationGainDb;
+        }
+      NS_LOG_LOGIC ("total pathLoss = " << pathLossDb << " dB");
+      m_pathLossTrace (txParams->txPhy, receiver, pathLossDb);
+      if ( pathLossDb > m_maxLossDb)
+        {
+          // beyond range, the signal parameters are not copied
+          return;
+        }
+    }
+
+  NS_LOG_LOGIC (" copying signal parameters " << txParams);
+  Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
+  if (txPowerSpectrum != txParams->psd)
+    {
+      rxParams->psd = Copy<SpectrumValue> (txPowerSpectrum);
+    }
+  // otherwise the parameters already hold their own copy of the tx PSD
+  Time delay = MicroSeconds (0);
+
+  if (txMobility && receiverMobility)
+    {
+      double pathGainLinear = std::pow (10.0, (-pathLossDb) / 10.0);
+      *(rxParams->psd) *= pathGainLinear;
+
+      if (m_spectrumPropagationLoss && m_fanOut)
+        {
+          rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, txMobility, receiverMobility, m_jobs);
+        }
+      else if (m_spectrumPropagationLoss)
+        {
+          rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, txMobility, receiverMobility);
+        }
+
+      if (m_propagationDelay)
+        {
+          delay = m_propagationDelay->GetDelay (txMobility, receiverMobility);
+        }
+    }
 
-          if ((*rxPhyIterator) != txParams->txPhy)
+  if (m_fanOut)
+    {
+      PendingRx pending;
+      pending.m_params = rxParams;
+      pending.m_receiver = receiver;
+      pending.m_delay = delay;
+      m_pendingRx.push_back (pending);
+    }
+  else
+    {
+      ScheduleRx (rxParams, receiver, delay);
+    }
+}
+
+void
+MultiModelSpectrumChannel::ScheduleRx (Ptr<SpectrumSignalParameters> rxParams, Ptr<SpectrumPhy> receiver, Time delay)
+{
+  Ptr<NetDevice> netDev = receiver->GetDevice ();
+  if (netDev)
+    {
+      // the receiver has a NetDevice, so we expect that it is attached to a Node
+      uint32_t dstNode =  netDev->GetNode ()->GetId ();
+      Simulator::ScheduleWithContext (dstNode, delay, &MultiModelSpectrumChannel::StartRx, this,
+                                      rxParams, receiver);
+    }
+  else
+    {
+      // the receiver is not attached to a NetDevice, so we cannot assume that it is attached to a node
+      Simulator::Schedule (delay, &MultiModelSpectrumChannel::StartRx, this,
+                           rxParams, receiver);
+    }
+}
+
+void
+MultiModelSpectrumChannel::RunJobs (uint32_t first, uint32_t stride)
+{
+  for (uint32_t jobIndex = first; jobIndex < m_jobs.size (); jobIndex += stride)
+    {
+      m_jobs[jobIndex]->Run ();
+    }
+}
+
+void
+MultiModelSpectrumChannel::CompleteFanOut ()
+{
+  uint32_t numThreads = 1;
+#ifdef HAVE_PTHREAD_H
+  numThreads = m_fanOutThreads;
+  if (numThreads == 0)
+    {
+      numThreads = std::max (sysconf (_SC_NPROCESSORS_ONLN), 1L);
+    }
+#endif
+  NS_LOG_LOGIC (m_jobs.size () << " deferred jobs on " << numThreads << " threads");
+
+  if (numThreads > 1 && m_jobs.size () > 1)
+    {
+#ifdef HAVE_PTHREAD_H
+      if (m_fanOutWorkers.empty ())
+        {
+          m_fanOutStride = numThreads;
+          for (uint32_t index = 1; index < numThreads; index++)
             {
-              NS_LOG_LOGIC (" copying signal parameters " << txParams);
-              Ptr<SpectrumSignalParameters> rxParams = txParams->Copy ();
-              rxParams->psd = Copy<SpectrumValue> (convertedTxPowerSpectrum);
-              Time delay = MicroSeconds (0);
+              Callback<void, uint32_t> worker = MakeCallback (&MultiModelSpectrumChannel::FanOutWorker, this);
+              m_fanOutWorkers.push_back (Create<SystemThread> (worker.Bind (index)));
+              m_fanOutWorkers.back ()->Start ();
+            }
+        }
+      {
+        std::lock_guard<std::mutex> lock (m_fanOutMutex);
+        m_fanOutRound++;
+        m_fanOutBusy = m_fanOutWorkers.size ();
+      }
+      m_fanOutStart.notify_all ();
+      RunJobs (0, m_fanOutStride);
+      std::unique_lock<std::mutex> lock (m_fanOutMutex);
+      while (m_fanOutBusy > 0)
+        {
+          m_fanOutDone.wait (lock);
+        }
+#endif
+    }
+  else
+    {
+      RunJobs (0, 1);
+    }
+  m_jobs.clear ();
 
-              Ptr<MobilityModel> receiverMobility = (*rxPhyIterator)->GetMobility ();
+  for (std::vector<PendingRx>::const_iterator it = m_pendingRx.begin (); it != m_pendingRx.end (); ++it)
+    {
+      ScheduleRx (it->m_params, it->m_receiver, it->m_delay);
+    }
+  m_pendingRx.clear ();
+}
 
-              if (txMobility && receiverMobility)
-                {
-                  double pathLossDb = 0;
-                  if (rxParams->txAntenna != 0)
-                    {
-                      Angles txAngles (receiverMobility->GetPosition (), txMobility->GetPosition ());
-                      double txAntennaGain = rxParams->txAntenna->GetGainDb (txAngles);
-                      NS_LOG_LOGIC ("txAntennaGain = " << txAntennaGain << " dB");
-                      pathLossDb -= txAntennaGain;
-                    }
-                  Ptr<AntennaModel> rxAntenna = (*rxPhyIterator)->GetRxAntenna ();
-                  if (rxAntenna != 0)
-                    {
-                      Angles rxAngles (txMobility->GetPosition (), receiverMobility->GetPosition ());
-                      double rxAntennaGain = rxAntenna->GetGainDb (rxAngles);
-                      NS_LOG_LOGIC ("rxAntennaGain = " << rxAntennaGain << " dB");
-                      pathLossDb -= rxAntennaGain;
-                    }
-                  if (m_propagationLoss)
-                    {
-                      double propagationGainDb = m_propagationLoss->CalcRxPower (0, txMobility, receiverMobility);
-                      NS_LOG_LOGIC ("propagationGainDb = " << propagationGainDb << " dB");
-                      pathLossDb -= propagationGainDb;
-                    }                    
-                  NS_LOG_LOGIC ("total pathLoss = " << pathLossDb << " dB");    
-                  m_pathLossTrace (txParams->txPhy, *rxPhyIterator, pathLossDb);
-                  if ( pathLossDb > m_maxLossDb)
-                    {
-                      // beyond range
-                      continue;
-                    }
-                  double pathGainLinear = std::pow (10.0, (-pathLossDb) / 10.0);
-                  *(rxParams->psd) *= pathGainLinear;              
-
-                  if (m_spectrumPropagationLoss)
-                    {
-                      rxParams->psd = m_spectrumPropagationLoss->CalcRxPowerSpectralDensity (rxParams->psd, txMobility, receiverMobility);
-                    }
-
-                  if (m_propagationDelay)
-                    {
-                      delay = m_propagationDelay->GetDelay (txMobility, receiverMobility);
-                    }
-                }
+void
+MultiModelSpectrumChannel::FanOutWorker (uint32_t index)
+{
+#ifdef HAVE_PTHREAD_H
+  uint64_t round = 0;
+  while (true)
+    {
+      uint32_t stride;
+      {
+        // the round is checked under the mutex before waiting, so a round started
+        // before this worker waits is not missed
+        std::unique_lock<std::mutex> lock (m_fanOutMutex);
+        while (!m_fanOutStop && m_fanOutRound == round)
+          {
+            m_fanOutStart.wait (lock);
+          }
+        if (m_fanOutStop)
+          {
+            return;
+          }
+        round = m_fanOutRound;
+        stride = m_fanOutStride;
+      }
+      RunJobs (index, stride);
+      {
+        std::lock_guard<std::mutex> lock (m_fanOutMutex);
+        m_fanOutBusy--;
+      }
+      m_fanOutDone.notify_one ();
+    }
+#endif
+}
 
-              Ptr<NetDevice> netDev = (*rxPhyIterator)->GetDevice ();
-              if (netDev)
-                {
-                  // the receiver has a NetDevice, so we expect that it is attached to a Node
-                  uint32_t dstNode =  netDev->GetNode ()->GetId ();
-                  Simulator::ScheduleWithContext (dstNode, delay, &MultiModelSpectrumChannel::StartRx, this,
-                                                  rxParams, *rxPhyIterator);
-                }
-              else
+void
+MultiModelSpectrumChannel::StopFanOutWorkers ()
+{
+#ifdef HAVE_PTHREAD_H
+  if (m_fanOutWorkers.empty ())
+    {
+      return;
+    }
+  {
+    std::lock_guard<std::mutex> lock (m_fanOutMutex);
+    m_fanOutStop = true;
+  }
+  m_fanOutStart.notify_all ();
+  for (std::vector<Ptr<SystemThread> >::iterator it = m_fanOutWorkers.begin (); it != m_fanOutWorkers.end (); ++it)
+    {
+      (*it)->Join ();
+    }
+  m_fanOutWorkers.clear ();
+  // new workers start from round 0
+  m_fanOutRound = 0;
+  m_fanOutStop = false;
+#endif
+}
+
+bool
+MultiModelSpectrumChannel::RxIndexEntry::operator< (const RxIndexEntry &other) const
+{
+  if (m_spectrumModelUid != other.m_spectrumModelUid)
+    {
+      return m_spectrumModelUid < other.m_spectrumModelUid;
+    }
+  return m_phy < other.m_phy;
+}
+
+MultiModelSpectrumChannel::RxCell_t
+MultiModelSpectrumChannel::GetRxCell (const Vector &position) const
+{
+  return RxCell_t (static_cast<int64_t> (std::floor (position.x / m_maxRange)),
+                   static_cast<int64_t> (std::floor (position.y / m_maxRange)));
+}
+
+void
+MultiModelSpectrumChannel::BuildRxIndex ()
+{
+  NS_LOG_FUNCTION (this);
+  m_rxGrid.clear ();
+  m_rxUnindexed.clear ();
+  for (RxSpectrumModelInfoMap_t::const_iterator rxInfoIterator = m_rxSpectrumModelInfoMap.begin ();
+       rxInfoIterator != m_rxSpectrumModelInfoMap.end ();
+       ++rxInfoIterator)
+    {
+      for (std::set<Ptr<SpectrumPhy> >::const_iterator rxPhyIterator = rxInfoIterator->second.m_rxPhySet.begin ();
+           rxPhyIterator != rxInfoIterator->second.m_rxPhySet.end ();
+           ++rxPhyIterator)
+        {
+          RxIndexEntry entry;
+          entry.m_spectrumModelUid = rxInfoIterator->first;
+          entry.m_phy = *rxPhyIterator;
+          entry.m_mobility = (*rxPhyIterator)->GetMobility ();
+          if (entry.m_mobility == 0)
+            {
+              m_rxUnindexed.push_back (entry);
+              continue;
+            }
+          if (m_rxMobilities.insert (entry.m_mobility).second)
+            {
+              entry.m_mobility->TraceConnectWithoutContext ("CourseChange", MakeCallback (&MultiModelSpectrumChannel::RxCourseChanged, this));
+            }
+          Vector velocity = entry.m_mobility->GetVelocity ();
+          if (velocity.x != 0 || velocity.y != 0 || velocity.z != 0)
+            {
+              // the position changes without a CourseChange
+              m_rxUnindexed.push_back (entry);
+            }
+          else
+            {
+              m_rxGrid[GetRxCell (entry.m_mobility->GetPosition ())].push_back (entry);
+            }
+        }
+    }
+  m_rxIndexValid = true;
+}
+
+void
+MultiModelSpectrumChannel::FindRxInRange (const Vector &position)
+{
+  if (!m_rxIndexValid)
+    {
+      BuildRxIndex ();
+    }
+  m_rxInRange.clear ();
+  for (std::vector<RxIndexEntry>::const_iterator it = m_rxUnindexed.begin (); it != m_rxUnindexed.end (); ++it)
+    {
+      if (it->m_mobility == 0 || CalculateDistance (it->m_mobility->GetPosition (), position) <= m_maxRange)
+        {
+          m_rxInRange.push_back (*it);
+        }
+    }
+  RxCell_t cell = GetRxCell (position);
+  for (int64_t x = cell.first - 1; x <= cell.first + 1; x++)
+    {
+      for (int64_t y = cell.second - 1; y <= cell.second + 1; y++)
+        {
+          std::map<RxCell_t, std::vector<RxIndexEntry> >::const_iterator cellIt = m_rxGrid.find (RxCell_t (x, y));
+          if (cellIt == m_rxGrid.end ())
+            {
+              continue;
+            }
+          for (std::vector<RxIndexEntry>::const_iterator it = cellIt->second.begin (); it != cellIt->second.end (); ++it)
+            {
+              if (CalculateDistance (it->m_mobility->GetPosition (), position) <= m_maxRange)
                 {
-                  // the receiver is not attached to a NetDevice, so we cannot assume that it is attached to a node
-                  Simulator::Schedule (delay, &MultiModelSpectrumChannel::StartRx, this,
-                                       rxParams, *rxPhyIterator);
+                  m_rxInRange.push_back (*it);
                 }
             }
         }
-
     }
+  std::sort (m_rxInRange.begin (), m_rxInRange.end ());
+  NS_LOG_LOGIC (m_rxInRange.size () << " receivers within " << m_maxRange << " m of " << position);
+}
 
+void
+MultiModelSpectrumChannel::RxCourseChanged (Ptr<const MobilityModel> mobility)
+{
+  NS_LOG_FUNCTION (this << mobility);
+  m_rxIndexValid = false;
 }
 
 void
@@ -27,8 +27,17 @@
 #include <ns3/spectrum-channel.h>
 #include <ns3/spectrum-propagation-loss-model.h>
 #include <ns3/propagation-delay-model.h>
+#include <ns3/mobility-model.h>
+#include <ns3/core-config.h>
 #include <map>
 #include <set>
+#include <vector>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-thread.h>
+#include <mutex>
+#include <condition_variable>
+#endif
 
 namespace ns3 {
 
@@ -102,12 +111,30 @@ typedef std::map<SpectrumModelUid_t, RxSpectrumModelInfo> RxSpectrumModelInfoMap
  * for this to work is that, after the SpectrumPhy switched its
  * SpectrumModel,  MultiModelSpectrumChannel::AddRx () is
  * called again passing the pointer to that SpectrumPhy.
+ *
+ * With the MaxRange attribute, a transmission is passed only to the
+ * receivers within that distance of the transmitter. The receivers
+ * that do not move are indexed in a grid of MaxRange squares, so that
+ * only the receivers of the 9 squares around the transmitter are
+ * visited. The grid is rebuilt at the first transmission after a
+ * receiver is added or a CourseChange of one of the receivers.
+ *
+ * With more than one FanOutThreads, the received PSDs of a transmission
+ * are computed in two phases: the propagation models are called for each
+ * receiver on the main thread, and the parts of the computation that they
+ * defer (see SpectrumPropagationLossModel::CalcRxPowerSpectralDensity) are
+ * then run on the worker threads. The receptions are scheduled afterwards,
+ * in the order of the receivers, so the result does not depend on the
+ * number of threads. The worker threads are created at the first
+ * transmission with deferred jobs and wait for the next ones until the
+ * channel is disposed.
  */
 class MultiModelSpectrumChannel : public SpectrumChannel
 {
 
 public:
   MultiModelSpectrumChannel ();
+  virtual ~MultiModelSpectrumChannel ();
 
   /**
    * \brief Get the type ID.
@@ -158,6 +185,111 @@ private:
    */
   virtual void StartRx (Ptr<SpectrumSignalParameters> params, Ptr<SpectrumPhy> receiver);
 
+  /**
+   * Compute the signal received by a SpectrumPhy and schedule its reception.
+   *
+   * @param txParams The signal parameters of the transmitter.
+   * @param txPowerSpectrum The transmitted PSD in the SpectrumModel of the receiver.
+   * @param txMobility The mobility of the transmitter, can be 0.
+   * @param receiver The receiver SpectrumPhy.
+   */
+  void PropagateToRx (Ptr<SpectrumSignalParameters> txParams, Ptr<SpectrumValue> txPowerSpectrum,
+                      Ptr<MobilityModel> txMobility, Ptr<SpectrumPhy> receiver);
+
+  /**
+   * Schedule the reception of a signal.
+   *
+   * @param rxParams The received signal parameters.
+   * @param receiver The receiver SpectrumPhy.
+   * @param delay The propagation delay.
+   */
+  void ScheduleRx (Ptr<SpectrumSignalParameters> rxParams, Ptr<SpectrumPhy> receiver, Time delay);
+
+  /**
+   * Run the jobs first, first + stride, first + 2*stride, ... of m_jobs.
+   *
+   * @param first The index of the first job.
+   * @param stride The distance between two jobs of this worker.
+   */
+  void RunJobs (uint32_t first, uint32_t stride);
+
+  /**
+   * Run m_jobs on m_fanOutThreads threads, then schedule the
+   * receptions in m_pendingRx.
+   */
+  void CompleteFanOut ();
+
+  /**
+   * Body of a worker thread: wait for the jobs of a transmission, run
+   * its share of them and report it, until the workers are stopped.
+   *
+   * @param index The index of the worker, 0 being the main thread.
+   */
+  void FanOutWorker (uint32_t index);
+
+  /**
+   * Stop and join the worker threads.
+   */
+  void StopFanOutWorkers ();
+
+  /**
+   * Convert a transmitted PSD to the SpectrumModel of a receiver.
+   *
+   * @param txInfo The TX SpectrumModel information of the PSD.
+   * @param rxSpectrumModelUid The receiver SpectrumModel.
+   * @param txPowerSpectrum The transmitted PSD.
+   * @return the PSD itself if no conversion is needed, otherwise the converted PSD
+   */
+  Ptr<SpectrumValue> ConvertTxPowerSpectrum (const TxSpectrumModelInfo &txInfo,
+                                             SpectrumModelUid_t rxSpectrumModelUid,
+                                             Ptr<SpectrumValue> txPowerSpectrum) const;
+
+  /**
+   * A receiver in the spatial index
+   */
+  struct RxIndexEntry
+  {
+    SpectrumModelUid_t m_spectrumModelUid; //!< Rx SpectrumModel
+    Ptr<SpectrumPhy> m_phy;                //!< Rx SpectrumPhy
+    Ptr<MobilityModel> m_mobility;         //!< mobility of the receiver, can be 0
+
+    /**
+     * Order of m_rxSpectrumModelInfoMap and of its sets of SpectrumPhy.
+     * \param other The other entry.
+     * \return true if this entry is visited first
+     */
+    bool operator< (const RxIndexEntry &other) const;
+  };
+
+  /// Cell of the grid of the receivers
+  typedef std::pair<int64_t, int64_t> RxCell_t;
+
+  /**
+   * \param position A position.
+   * \return the cell of the grid containing the position
+   */
+  RxCell_t GetRxCell (const Vector &position) const;
+
+  /**
+   * Rebuild the grid of the receivers, and connect to the CourseChange
+   * of their mobility models.
+   */
+  void BuildRxIndex ();
+
+  /**
+   * Fill m_rxInRange with the receivers within MaxRange of a position.
+   *
+   * @param position The position of the transmitter.
+   */
+  void FindRxInRange (const Vector &position);
+
+  /**
+   * Invalidate the grid of the receivers when one of them moves.
+   *
+   * @param mobility The mobility model of the receiver.
+   */
+  void RxCourseChanged (Ptr<const MobilityModel> mobility);
+
   /**
    * Propagation delay model to be used with this channel.
    */
@@ -201,6 +333,42 @@ private:
    */
   double m_maxLossDb;
 
+  /**
+   * Maximum distance [m] between a transmitter and a receiver, 0 if unlimited.
+   */
+  double m_maxRange;
+
+  bool m_rxIndexValid; //!< false if the grid must be rebuilt
+  std::map<RxCell_t, std::vector<RxIndexEntry> > m_rxGrid; //!< receivers that do not move
+  std::vector<RxIndexEntry> m_rxUnindexed; //!< receivers that move or have no mobility
+  std::set<Ptr<MobilityModel> > m_rxMobilities; //!< mobility models whose CourseChange is connected
+  std::vector<RxIndexEntry> m_rxInRange; //!< result of FindRxInRange
+
+  /**
+   * A reception waiting for the deferred jobs of its transmission
+   */
+  struct PendingRx
+  {
+    Ptr<SpectrumSignalParameters> m_params; //!< received signal parameters
+    Ptr<SpectrumPhy> m_receiver;            //!< receiver
+    Time m_delay;                           //!< propagation delay
+  };
+
+  uint32_t m_fanOutThreads; //!< threads computing the received PSDs, 0 for one per core
+  bool m_fanOut; //!< true while StartTx defers the jobs and the receptions
+  SpectrumPropagationLossJobList m_jobs; //!< deferred jobs of the transmission
+  std::vector<PendingRx> m_pendingRx; //!< receptions of the transmission
+#ifdef HAVE_PTHREAD_H
+  std::vector<Ptr<SystemThread> > m_fanOutWorkers; //!< worker threads, the main thread is not included
+  std::mutex m_fanOutMutex; //!< protects the round, the stride, the busy count and the stop flag
+  std::condition_variable m_fanOutStart; //!< notified when a round starts or the workers stop
+  std::condition_variable m_fanOutDone; //!< notified when a worker finishes its jobs
+  uint64_t m_fanOutRound; //!< number of rounds of jobs started
+  uint32_t m_fanOutStride; //!< number of threads sharing the jobs of the round
+  uint32_t m_fanOutBusy; //!< workers still running jobs of the round
+  bool m_fanOutStop; //!< true when the workers must exit
+#endif
+
   /**
    * \deprecated The non-const \c Ptr<SpectrumPhy> argument
    * is deprecated and will be changed to \c Ptr<const SpectrumPhy>
@@ -28,6 +28,10 @@ NS_LOG_COMPONENT_DEFINE ("SpectrumPropagationLossModel");
 
 NS_OBJECT_ENSURE_REGISTERED (SpectrumPropagationLossModel);
 
+SpectrumPropagationLossJob::~SpectrumPropagationLossJob ()
+{
+}
+
 SpectrumPropagationLossModel::SpectrumPropagationLossModel ()
   : m_next (0)
 {
@@ -73,4 +77,34 @@ SpectrumPropagationLossModel::CalcRxPowerSpectralDensity (Ptr<const SpectrumValu
   return rxPsd;
 }
 
+Ptr<SpectrumValue>
+SpectrumPropagationLossModel::CalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                          Ptr<const MobilityModel> a,
+                                                          Ptr<const MobilityModel> b,
+                                                          SpectrumPropagationLossJobList &jobs) const
+{
+  size_t numJobs = jobs.size ();
+  Ptr<SpectrumValue> rxPsd = DoCalcRxPowerSpectralDensityDeferred (txPsd, a, b, jobs);
+  if (m_next != 0)
+    {
+      // the next model needs the values of the PSD
+      for (size_t i = numJobs; i < jobs.size (); i++)
+        {
+          jobs[i]->Run ();
+        }
+      jobs.resize (numJobs);
+      rxPsd = m_next->DoCalcRxPowerSpectralDensity (rxPsd, a, b);
+    }
+  return rxPsd;
+}
+
+Ptr<SpectrumValue>
+SpectrumPropagationLossModel::DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+                                                                    Ptr<const MobilityModel> a,
+                                                                    Ptr<const MobilityModel> b,
+                                                                    SpectrumPropagationLossJobList &jobs) const
+{
+  return DoCalcRxPowerSpectralDensity (txPsd, a, b);
+}
+
 } // namespace ns3
@@ -25,10 +25,35 @@
 #include <ns3/object.h>
 #include <ns3/mobility-model.h>
 #include <ns3/spectrum-value.h>
+#include <vector>
 
 namespace ns3 {
 
 
+/**
+ * \ingroup spectrum
+ *
+ * \brief Part of the computation of a received PSD that a
+ * SpectrumPropagationLossModel defers, so that the PSDs of the receivers
+ * of a transmission can be computed on several threads.
+ *
+ * A job only touches the objects it holds, and these are not used by the
+ * jobs of the other receivers of the same transmission. The jobs are
+ * created and destroyed on the main thread.
+ */
+class SpectrumPropagationLossJob : public SimpleRefCount<SpectrumPropagationLossJob>
+{
+public:
+  virtual ~SpectrumPropagationLossJob ();
+
+  /**
+   * Compute the values of the received PSD
+   */
+  virtual void Run () = 0;
+};
+
+/// Container of the deferred jobs of a transmission
+typedef std::vector<Ptr<SpectrumPropagationLossJob> > SpectrumPropagationLossJobList;
 
 
 /**
@@ -78,6 +103,24 @@ public:
                                                  Ptr<const MobilityModel> a,
                                                  Ptr<const MobilityModel> b) const;
 
+  /**
+   * Same as CalcRxPowerSpectralDensity, except that the computation of
+   * the values of the received PSD can be deferred to jobs appended to
+   * \p jobs. All the jobs must be run before the PSD is used. The jobs of
+   * different receivers can run in any order, on any thread.
+   *
+   * @param txPsd the power spectral density of the transmission
+   * @param a sender mobility
+   * @param b receiver mobility
+   * @param jobs the jobs of the transmission
+   *
+   * @return the received PSD, whose values are set once the jobs are run
+   */
+  Ptr<SpectrumValue> CalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                 Ptr<const MobilityModel> a,
+                                                 Ptr<const MobilityModel> b,
+                                                 SpectrumPropagationLossJobList &jobs) const;
+
 protected:
   virtual void DoDispose ();
 
@@ -97,6 +140,23 @@ private:
                                                            Ptr<const MobilityModel> a,
                                                            Ptr<const MobilityModel> b) const = 0;
 
+  /**
+   * Deferred version of DoCalcRxPowerSpectralDensity. The default
+   * implementation computes the received PSD immediately and appends no job.
+   *
+   * @param txPsd set of values Vs frequency representing the
+   * transmission power. See SpectrumChannel for details.
+   * @param a sender mobility
+   * @param b receiver mobility
+   * @param jobs the jobs of the transmission
+   *
+   * @return the received PSD, whose values are set once the jobs are run
+   */
+  virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+                                                                   Ptr<const MobilityModel> a,
+                                                                   Ptr<const MobilityModel> b,
+                                                                   SpectrumPropagationLossJobList &jobs) const;
+
   Ptr<SpectrumPropagationLossModel> m_next; //!< SpectrumPropagationLossModel chained to this one.
 };
 
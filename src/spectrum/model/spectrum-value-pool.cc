@@ -0,0 +1,265 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/spectrum-value-pool.h>
+#include <ns3/uinteger.h>
+#include <ns3/log.h>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("SpectrumValuePool");
+
+NS_OBJECT_ENSURE_REGISTERED (SpectrumValuePool);
+
+/// the pool returned by Get, 0 before it is created and after it is destroyed
+static SpectrumValuePool *g_spectrumValuePool = 0;
+
+static Ptr<SpectrumValuePool>
+CreateSpectrumValuePool ()
+{
+  Ptr<SpectrumValuePool> pool = CreateObject<SpectrumValuePool> ();
+  g_spectrumValuePool = PeekPointer (pool);
+  return pool;
+}
+
+SpectrumValuePool::SpectrumValuePool ()
+  : m_maxPerModel (0),
+    m_allocations (0),
+    m_reuses (0),
+    m_releases (0),
+    m_deletions (0),
+    m_shares (0)
+{
+#ifdef HAVE_PTHREAD_H
+  m_owner = SystemThread::Self ();
+#endif
+}
+
+SpectrumValuePool::~SpectrumValuePool ()
+{
+  if (g_spectrumValuePool == this)
+    {
+      g_spectrumValuePool = 0;
+    }
+  Clear ();
+}
+
+TypeId
+SpectrumValuePool::GetTypeId ()
+{
+  static TypeId tid = TypeId ("ns3::SpectrumValuePool")
+    .SetParent<Object> ()
+    .SetGroupName ("Spectrum")
+    .AddConstructor<SpectrumValuePool> ()
+    .AddAttribute ("MaxPerModel",
+                   "Maximum number of pooled values of each SpectrumModel, "
+                   "0 disables the pool and the values are deleted",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_maxPerModel),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("Allocations",
+                   "Number of values allocated on the heap by SpectrumValue::Copy "
+                   "and the SpectrumValuePool allocations",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_allocations),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Reuses",
+                   "Number of values taken from the pool instead of the heap",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_reuses),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Releases",
+                   "Number of values put back in the pool instead of being deleted",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_releases),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Deletions",
+                   "Number of values deleted because the pool of their SpectrumModel was full",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_deletions),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("Shares",
+                   "Number of PSDs passed on unmodified instead of being copied",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&SpectrumValuePool::m_shares),
+                   MakeUintegerChecker<uint64_t> ())
+  ;
+  return tid;
+}
+
+SpectrumValuePool *
+SpectrumValuePool::Get ()
+{
+  static Ptr<SpectrumValuePool> pool = CreateSpectrumValuePool ();
+  return PeekPointer (pool);
+}
+
+Ptr<SpectrumValue>
+SpectrumValuePool::Allocate (const Ptr<const SpectrumModel> &sm)
+{
+  Ptr<SpectrumValue> value = AllocateUninitialized (sm);
+  (*value) = 0.0;
+  return value;
+}
+
+Ptr<SpectrumValue>
+SpectrumValuePool::AllocateUninitialized (const Ptr<const SpectrumModel> &sm)
+{
+  SpectrumValue *value = Get ()->DoAllocate (sm->GetUid ());
+  if (value == 0)
+    {
+      return Create<SpectrumValue> (sm);
+    }
+  // the pooled values have no references left
+  return Ptr<SpectrumValue> (value);
+}
+
+void
+SpectrumValuePool::Release (SpectrumValue *value)
+{
+  if (g_spectrumValuePool == 0 || g_spectrumValuePool->m_maxPerModel == 0)
+    {
+      delete value;
+      return;
+    }
+  g_spectrumValuePool->DoRelease (value);
+}
+
+void
+SpectrumValuePool::NotifyShared ()
+{
+  SpectrumValuePool *pool = Get ();
+  if (pool->IsOwnerThread ())
+    {
+      pool->m_shares++;
+    }
+}
+
+bool
+SpectrumValuePool::IsOwnerThread () const
+{
+#ifdef HAVE_PTHREAD_H
+  return SystemThread::Equals (m_owner);
+#else
+  return true;
+#endif
+}
+
+SpectrumValue *
+SpectrumValuePool::DoAllocate (SpectrumModelUid_t uid)
+{
+  if (!IsOwnerThread ())
+    {
+      return 0;
+    }
+  std::map<SpectrumModelUid_t, std::vector<SpectrumValue *> >::iterator it = m_free.find (uid);
+  if (it == m_free.end () || it->second.empty ())
+    {
+      m_allocations++;
+      return 0;
+    }
+  SpectrumValue *value = it->second.back ();
+  it->second.pop_back ();
+  m_reuses++;
+  return value;
+}
+
+void
+SpectrumValuePool::DoRelease (SpectrumValue *value)
+{
+  if (IsOwnerThread ())
+    {
+      std::vector<SpectrumValue *> &values = m_free[value->GetSpectrumModelUid ()];
+      if (values.size () < m_maxPerModel)
+        {
+          values.push_back (value);
+          m_releases++;
+          return;
+        }
+      m_deletions++;
+    }
+  delete value;
+}
+
+uint64_t
+SpectrumValuePool::GetAllocations () const
+{
+  return m_allocations;
+}
+
+uint64_t
+SpectrumValuePool::GetReuses () const
+{
+  return m_reuses;
+}
+
+uint64_t
+SpectrumValuePool::GetShares () const
+{
+  return m_shares;
+}
+
+uint64_t
+SpectrumValuePool::GetReleases () const
+{
+  return m_releases;
+}
+
+uint64_t
+SpectrumValuePool::GetDeletions () const
+{
+  return m_deletions;
+}
+
+void
+SpectrumValuePool::PrintStatistics (std::ostream &os) const
+{
+  size_t pooled = 0;
+  for (std::map<SpectrumModelUid_t, std::vector<SpectrumValue *> >::const_iterator it = m_free.begin ();
+       it != m_free.end (); ++it)
+    {
+      pooled += it->second.size ();
+    }
+  os << "spectrum value pool: " << m_allocations << " heap allocations, " << m_reuses << " reuses, "
+     << m_shares << " shared PSDs, " << m_releases << " releases, " << m_deletions << " deletions, "
+     << pooled << " values of " << m_free.size () << " models pooled" << std::endl;
+}
+
+void
+SpectrumValuePool::Clear ()
+{
+  for (std::map<SpectrumModelUid_t, std::vector<SpectrumValue *> >::iterator it = m_free.begin ();
+       it != m_free.end (); ++it)
+    {
+      for (std::vector<SpectrumValue *>::iterator value = it->second.begin (); value != it->second.end (); ++value)
+        {
+          delete *value;
+        }
+    }
+  m_free.clear ();
+  m_allocations = 0;
+  m_reuses = 0;
+  m_releases = 0;
+  m_deletions = 0;
+  m_shares = 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,133 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SPECTRUM_VALUE_POOL_H
+#define SPECTRUM_VALUE_POOL_H
+
+#include <ns3/object.h>
+#include <ns3/spectrum-value.h>
+#include <ns3/core-config.h>
+#include <map>
+#include <vector>
+#include <ostream>
+
+#ifdef HAVE_PTHREAD_H
+#include <ns3/system-thread.h>
+#endif
+
+namespace ns3 {
+
+/**
+ * \ingroup spectrum
+ *
+ * \brief Process-wide pool of the SpectrumValue instances
+ *
+ * A SpectrumValue whose last reference is dropped is kept in a free list
+ * of its SpectrumModel instead of being deleted, and SpectrumValue::Copy
+ * reuses it, so that the per-signal PSD copies of the channels do not go
+ * through the heap once the pool has warmed up. A reused value already has
+ * the SpectrumModel and the number of values of its free list.
+ *
+ * The pool is disabled by default, the MaxPerModel attribute enables it.
+ * It must be set before the first SpectrumValue is copied, for instance
+ * with Config::SetDefault at the start of the simulation.
+ *
+ * The free lists and the counters belong to the thread that created the
+ * pool, normally the simulation thread. The values allocated or released
+ * by other threads go directly through the heap, so the pool takes no lock.
+ * The counters are exposed as read-only attributes.
+ */
+class SpectrumValuePool : public Object
+{
+public:
+  SpectrumValuePool ();
+  virtual ~SpectrumValuePool ();
+  static TypeId GetTypeId ();
+
+  /**
+   * \return the process-wide pool, created the first time. A raw pointer
+   * is returned so that the reference count is not touched by the worker threads
+   */
+  static SpectrumValuePool *Get ();
+
+  /**
+   * \brief Get a value of a SpectrumModel with all its values set to 0,
+   * like a new SpectrumValue
+   * \param sm the SpectrumModel
+   * \return a value from the free list of sm, or a new value if it is empty
+   */
+  static Ptr<SpectrumValue> Allocate (const Ptr<const SpectrumModel> &sm);
+
+  /**
+   * \brief Get a value of a SpectrumModel whose values are left unspecified,
+   * for the callers that overwrite all of them
+   * \param sm the SpectrumModel
+   * \return a value from the free list of sm, or a new value if it is empty
+   */
+  static Ptr<SpectrumValue> AllocateUninitialized (const Ptr<const SpectrumModel> &sm);
+
+  /**
+   * \brief Put a value without references back in the free list of its
+   * SpectrumModel, or delete it if the list is full. Called by SpectrumValueDeleter
+   * \param value the value
+   */
+  static void Release (SpectrumValue *value);
+
+  /**
+   * \brief Count a PSD passed on unmodified instead of being copied
+   */
+  static void NotifyShared ();
+
+  uint64_t GetAllocations () const;
+  uint64_t GetReuses () const;
+  uint64_t GetShares () const;
+  uint64_t GetReleases () const;
+  uint64_t GetDeletions () const;
+
+  /**
+   * \brief Print the counters and the number of pooled values
+   * \param os the output stream
+   */
+  void PrintStatistics (std::ostream &os) const;
+
+  /**
+   * \brief Delete the pooled values and reset the counters
+   */
+  void Clear ();
+
+private:
+  /**
+   * \return true if the free lists can be used by the calling thread
+   */
+  bool IsOwnerThread () const;
+  SpectrumValue *DoAllocate (SpectrumModelUid_t uid);
+  void DoRelease (SpectrumValue *value);
+
+  uint32_t m_maxPerModel; //!< maximum number of pooled values of each SpectrumModel, 0 disables the pool
+  std::map<SpectrumModelUid_t, std::vector<SpectrumValue *> > m_free; //!< free lists
+  uint64_t m_allocations; //!< values allocated on the heap
+  uint64_t m_reuses; //!< values taken from a free list
+  uint64_t m_releases; //!< values put back in a free list
+  uint64_t m_deletions; //!< values deleted because their free list was full
+  uint64_t m_shares; //!< PSDs shared instead of copied
+#ifdef HAVE_PTHREAD_H
+  SystemThread::ThreadId m_owner; //!< thread that created the pool
+#endif
+};
+
+} // namespace ns3
+
+#endif /* SPECTRUM_VALUE_POOL_H */
@@ -20,6 +20,7 @@
  */
 
 #include <ns3/spectrum-value.h>
+#include <ns3/spectrum-value-pool.h>
 #include <ns3/math.h>
 #include <ns3/log.h>
 
@@ -408,11 +409,17 @@ Integral (const SpectrumValue& arg)
 Ptr<SpectrumValue>
 SpectrumValue::Copy () const
 {
-  Ptr<SpectrumValue> p = Create<SpectrumValue> (m_spectrumModel);
-  *p = *this;
+  // a pooled value has the same spectrum model, only the values are copied
+  Ptr<SpectrumValue> p = SpectrumValuePool::AllocateUninitialized (m_spectrumModel);
+  p->m_values = m_values;
   return p;
+}
+
 
-  //  return Copy<SpectrumValue> (*this)
+void
+SpectrumValueDeleter::Delete (SpectrumValue *value)
+{
+  SpectrumValuePool::Release (value);
 }
 
 
@@ -33,6 +33,22 @@ namespace ns3 {
 /// Container for element values
 typedef std::vector<double> Values;
 
+class SpectrumValue;
+
+/**
+ * \ingroup spectrum
+ *
+ * \brief Deleter of the SpectrumValue instances, which gives them back to
+ * the SpectrumValuePool instead of deleting them
+ */
+struct SpectrumValueDeleter
+{
+  /**
+   * \param value the SpectrumValue without references left
+   */
+  static void Delete (SpectrumValue *value);
+};
+
 /**
  * \ingroup spectrum
  *
@@ -55,7 +71,7 @@ typedef std::vector<double> Values;
  * things, such as power spectral densities, frequency-dependent
  * propagation losses, spectral masks, etc.
  */
-class SpectrumValue : public SimpleRefCount<SpectrumValue>
+class SpectrumValue : public SimpleRefCount<SpectrumValue, empty, SpectrumValueDeleter>
 {
 public:
   /**
@@ -498,6 +514,8 @@ public:
   friend double Integral (const SpectrumValue&  arg);
 
   /**
+   * The copy is taken from the SpectrumValuePool when it holds a value of
+   * the same SpectrumModel
    *
    * @return a Ptr to a copy of this instance
    */
@@ -620,6 +638,27 @@ SpectrumValue Log2 (const SpectrumValue& arg);
 SpectrumValue Log (const SpectrumValue& arg);
 double Integral (const SpectrumValue& arg);
 
+/**
+ * \brief Copy of a SpectrumValue through SpectrumValue::Copy, so that the
+ * copies made with the generic Copy function use the SpectrumValuePool too
+ * \param object the SpectrumValue to copy
+ * \return the copy
+ */
+template <>
+inline Ptr<SpectrumValue> Copy<SpectrumValue> (Ptr<SpectrumValue> object)
+{
+  return object->Copy ();
+}
+
+/**
+ * \copydoc Copy<SpectrumValue>(Ptr<SpectrumValue>)
+ */
+template <>
+inline Ptr<SpectrumValue> Copy<SpectrumValue> (Ptr<const SpectrumValue> object)
+{
+  return object->Copy ();
+}
+
 
 } // namespace ns3
 
@@ -0,0 +1,570 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/multi-model-spectrum-channel.h>
+#include <ns3/spectrum-phy.h>
+#include <ns3/spectrum-value.h>
+#include <ns3/spectrum-signal-parameters.h>
+#include <ns3/spectrum-propagation-loss-model.h>
+#include <ns3/antenna-model.h>
+#include <ns3/net-device.h>
+#include <ns3/constant-position-mobility-model.h>
+#include <ns3/constant-velocity-mobility-model.h>
+#include <ns3/simulator.h>
+#include <ns3/double.h>
+#include <ns3/uinteger.h>
+#include <ns3/test.h>
+#include <vector>
+#include <cmath>
+
+using namespace ns3;
+
+/**
+ * \brief A reception recorded by MultiModelSpectrumChannelTestPhy
+ */
+struct MultiModelSpectrumChannelTestRx
+{
+  Ptr<const SpectrumPhy> m_txPhy; //!< transmitter of the signal
+  uint32_t m_rxId;                //!< identifier of the receiver
+  double m_distance;              //!< distance to the transmitter, -1 if the receiver has no mobility
+  Ptr<const SpectrumValue> m_psd; //!< received PSD
+};
+
+/**
+ * \brief SpectrumPhy recording the signals it receives in a log shared by
+ * all the receivers
+ */
+class MultiModelSpectrumChannelTestPhy : public SpectrumPhy
+{
+public:
+  /**
+   * \param id the identifier of the receiver in the log
+   * \param sm the SpectrumModel of the receiver
+   * \param log the log of the receptions
+   */
+  MultiModelSpectrumChannelTestPhy (uint32_t id, Ptr<const SpectrumModel> sm,
+                                    std::vector<MultiModelSpectrumChannelTestRx> *log);
+
+  virtual void SetDevice (Ptr<NetDevice> d);
+  virtual Ptr<NetDevice> GetDevice () const;
+  virtual void SetMobility (Ptr<MobilityModel> m);
+  virtual Ptr<MobilityModel> GetMobility ();
+  virtual void SetChannel (Ptr<SpectrumChannel> c);
+  virtual Ptr<const SpectrumModel> GetRxSpectrumModel () const;
+  virtual Ptr<AntennaModel> GetRxAntenna ();
+  virtual void StartRx (Ptr<SpectrumSignalParameters> params);
+
+private:
+  uint32_t m_id;
+  Ptr<const SpectrumModel> m_spectrumModel;
+  Ptr<MobilityModel> m_mobility;
+  std::vector<MultiModelSpectrumChannelTestRx> *m_log;
+};
+
+MultiModelSpectrumChannelTestPhy::MultiModelSpectrumChannelTestPhy (uint32_t id, Ptr<const SpectrumModel> sm,
+                                                                    std::vector<MultiModelSpectrumChannelTestRx> *log)
+  : m_id (id),
+    m_spectrumModel (sm),
+    m_log (log)
+{
+}
+
+void
+MultiModelSpectrumChannelTestPhy::SetDevice (Ptr<NetDevice> d)
+{
+}
+
+Ptr<NetDevice>
+MultiModelSpectrumChannelTestPhy::GetDevice () const
+{
+  return 0;
+}
+
+void
+MultiModelSpectrumChannelTestPhy::SetMobility (Ptr<MobilityModel> m)
+{
+  m_mobility = m;
+}
+
+Ptr<MobilityModel>
+MultiModelSpectrumChannelTestPhy::GetMobility ()
+{
+  return m_mobility;
+}
+
+void
+MultiModelSpectrumChannelTestPhy::SetChannel (Ptr<SpectrumChannel> c)
+{
+}
+
+Ptr<const SpectrumModel>
+MultiModelSpectrumChannelTestPhy::GetRxSpectrumModel () const
+{
+  return m_spectrumModel;
+}
+
+Ptr<AntennaModel>
+MultiModelSpectrumChannelTestPhy::GetRxAntenna ()
+{
+  return 0;
+}
+
+void
+MultiModelSpectrumChannelTestPhy::StartRx (Ptr<SpectrumSignalParameters> params)
+{
+  MultiModelSpectrumChannelTestRx rx;
+  rx.m_txPhy = params->txPhy;
+  rx.m_rxId = m_id;
+  rx.m_distance = -1;
+  if (m_mobility)
+    {
+      rx.m_distance = CalculateDistance (params->txPhy->GetMobility ()->GetPosition (), m_mobility->GetPosition ());
+    }
+  rx.m_psd = params->psd;
+  m_log->push_back (rx);
+}
+
+/**
+ * \brief Test that a MultiModelSpectrumChannel with a MaxRange passes a
+ * signal to the receivers within range of the transmitter, in the same
+ * order as the full scan of a channel without MaxRange
+ *
+ * The receivers use two SpectrumModels, some of them move, one has no
+ * mobility, and some change position or velocity between the
+ * transmissions, which must invalidate the grid of the receivers.
+ */
+class MultiModelSpectrumChannelMaxRangeTestCase : public TestCase
+{
+public:
+  MultiModelSpectrumChannelMaxRangeTestCase ();
+  virtual ~MultiModelSpectrumChannelMaxRangeTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Transmit the same signal on the full scan and on the MaxRange channel
+   */
+  void Transmit ();
+
+  /**
+   * \brief Compare the receptions of the last transmission
+   */
+  void Check ();
+
+  double m_maxRange;
+  Ptr<MultiModelSpectrumChannel> m_fullChannel;
+  Ptr<MultiModelSpectrumChannel> m_rangeChannel;
+  Ptr<MultiModelSpectrumChannelTestPhy> m_fullTx;
+  Ptr<MultiModelSpectrumChannelTestPhy> m_rangeTx;
+  Ptr<SpectrumValue> m_txPsd;
+  std::vector<MultiModelSpectrumChannelTestRx> m_log;
+  uint32_t m_numCulled; //!< receptions of the full scan out of range
+};
+
+MultiModelSpectrumChannelMaxRangeTestCase::MultiModelSpectrumChannelMaxRangeTestCase ()
+  : TestCase ("MultiModelSpectrumChannel MaxRange against the full scan"),
+    m_maxRange (150),
+    m_numCulled (0)
+{
+}
+
+MultiModelSpectrumChannelMaxRangeTestCase::~MultiModelSpectrumChannelMaxRangeTestCase ()
+{
+}
+
+void
+MultiModelSpectrumChannelMaxRangeTestCase::Transmit ()
+{
+  m_log.clear ();
+  Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters> ();
+  params->psd = m_txPsd;
+  params->duration = MicroSeconds (10);
+  params->txPhy = m_fullTx;
+  m_fullChannel->StartTx (params);
+
+  params = Create<SpectrumSignalParameters> ();
+  params->psd = m_txPsd;
+  params->duration = MicroSeconds (10);
+  params->txPhy = m_rangeTx;
+  m_rangeChannel->StartTx (params);
+
+  Simulator::ScheduleNow (&MultiModelSpectrumChannelMaxRangeTestCase::Check, this);
+}
+
+void
+MultiModelSpectrumChannelMaxRangeTestCase::Check ()
+{
+  std::vector<MultiModelSpectrumChannelTestRx> expected;
+  std::vector<MultiModelSpectrumChannelTestRx> actual;
+  for (std::vector<MultiModelSpectrumChannelTestRx>::const_iterator it = m_log.begin (); it != m_log.end (); ++it)
+    {
+      if (it->m_txPhy == m_rangeTx)
+        {
+          actual.push_back (*it);
+        }
+      else if (it->m_distance <= m_maxRange)
+        {
+          expected.push_back (*it);
+        }
+      else
+        {
+          m_numCulled++;
+        }
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (actual.size (), expected.size (), "wrong number of receivers in range at "
+                         << Simulator::Now ().GetSeconds () << " s");
+  for (uint32_t i = 0; i < actual.size () && i < expected.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (actual[i].m_rxId, expected[i].m_rxId, "different receiver at position " << i
+                             << " at " << Simulator::Now ().GetSeconds () << " s");
+    }
+}
+
+void
+MultiModelSpectrumChannelMaxRangeTestCase::DoRun (void)
+{
+  std::vector<double> freqs;
+  for (int i = 0; i < 4; i++)
+    {
+      freqs.push_back (28e9 + 1e6 * i);
+    }
+  Ptr<SpectrumModel> sm1 = Create<SpectrumModel> (freqs);
+  Ptr<SpectrumModel> sm2 = Create<SpectrumModel> (freqs);
+  m_txPsd = Create<SpectrumValue> (sm1);
+  (*m_txPsd) = 1e-9;
+
+  m_fullChannel = CreateObject<MultiModelSpectrumChannel> ();
+  m_rangeChannel = CreateObject<MultiModelSpectrumChannel> ();
+  m_rangeChannel->SetAttribute ("MaxRange", DoubleValue (m_maxRange));
+
+  Ptr<ConstantVelocityMobilityModel> txMobility = CreateObject<ConstantVelocityMobilityModel> ();
+  txMobility->SetPosition (Vector (0, 0, 10));
+  txMobility->SetVelocity (Vector (20, 5, 0));
+  m_fullTx = CreateObject<MultiModelSpectrumChannelTestPhy> (1000, sm1, &m_log);
+  m_fullTx->SetMobility (txMobility);
+  m_rangeTx = CreateObject<MultiModelSpectrumChannelTestPhy> (1000, sm1, &m_log);
+  m_rangeTx->SetMobility (txMobility);
+
+  // the same receivers are added to both channels
+  std::vector<Ptr<ConstantPositionMobilityModel> > fixed;
+  std::vector<Ptr<ConstantVelocityMobilityModel> > moving;
+  for (uint32_t id = 0; id < 40; id++)
+    {
+      Ptr<MultiModelSpectrumChannelTestPhy> phy =
+        CreateObject<MultiModelSpectrumChannelTestPhy> (id, id % 3 == 0 ? sm2 : sm1, &m_log);
+      Vector position ((id * 37) % 500 - 250.0 + 0.3, (id * 53) % 400 - 200.0 + 0.7, 1.5);
+      if (id % 5 == 4)
+        {
+          Ptr<ConstantVelocityMobilityModel> mobility = CreateObject<ConstantVelocityMobilityModel> ();
+          mobility->SetPosition (position);
+          mobility->SetVelocity (Vector (-10.0 + id, 3.0, 0));
+          phy->SetMobility (mobility);
+          moving.push_back (mobility);
+        }
+      else if (id != 17)
+        {
+          Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+          mobility->SetPosition (position);
+          phy->SetMobility (mobility);
+          fixed.push_back (mobility);
+        }
+      m_fullChannel->AddRx (phy);
+      m_rangeChannel->AddRx (phy);
+    }
+
+  for (uint32_t t = 0; t < 10; t++)
+    {
+      Simulator::Schedule (Seconds (t + 0.5), &MultiModelSpectrumChannelMaxRangeTestCase::Transmit, this);
+    }
+  // receivers jumping across the cells of the grid, stopping and starting to move
+  Simulator::Schedule (Seconds (2), &ConstantPositionMobilityModel::SetPosition, fixed[0], Vector (40, 20, 1.5));
+  Simulator::Schedule (Seconds (3), &ConstantPositionMobilityModel::SetPosition, fixed[3], Vector (-400, 300, 1.5));
+  Simulator::Schedule (Seconds (4), &ConstantPositionMobilityModel::SetPosition, fixed[7], Vector (110, 60, 1.5));
+  Simulator::Schedule (Seconds (5), &ConstantVelocityMobilityModel::SetVelocity, moving[1], Vector (0, 0, 0));
+  Simulator::Schedule (Seconds (6), &ConstantVelocityMobilityModel::SetVelocity, moving[1], Vector (15, 0, 0));
+  Simulator::Schedule (Seconds (7), &ConstantPositionMobilityModel::SetPosition, fixed[0], Vector (-40, -20, 1.5));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_GT (m_numCulled, 0, "no receiver out of range, the test does not check the culling");
+
+  m_fullChannel->Dispose ();
+  m_rangeChannel->Dispose ();
+}
+
+/**
+ * \brief SpectrumPropagationLossModel applying a frequency selective gain
+ * that depends on the distance, and deferring it to a job when asked to
+ */
+class MultiModelSpectrumChannelTestLossModel : public SpectrumPropagationLossModel
+{
+public:
+  /**
+   * \brief Compute the received PSD
+   * \param txPsd the transmitted PSD
+   * \param distance the distance between the transmitter and the receiver
+   * \param rxPsd the received PSD, overwritten
+   */
+  static void ApplyGain (const SpectrumValue &txPsd, double distance, SpectrumValue &rxPsd);
+
+private:
+  virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                           Ptr<const MobilityModel> a,
+                                                           Ptr<const MobilityModel> b) const;
+  virtual Ptr<SpectrumValue> DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+                                                                   Ptr<const MobilityModel> a,
+                                                                   Ptr<const MobilityModel> b,
+                                                                   SpectrumPropagationLossJobList &jobs) const;
+};
+
+/**
+ * \brief Deferred computation of MultiModelSpectrumChannelTestLossModel
+ */
+class MultiModelSpectrumChannelTestLossJob : public SpectrumPropagationLossJob
+{
+public:
+  /**
+   * \param txPsd the transmitted PSD
+   * \param distance the distance between the transmitter and the receiver
+   * \param rxPsd the received PSD
+   */
+  MultiModelSpectrumChannelTestLossJob (Ptr<const SpectrumValue> txPsd, double distance, Ptr<SpectrumValue> rxPsd)
+    : m_txPsd (txPsd),
+      m_distance (distance),
+      m_rxPsd (rxPsd)
+  {
+  }
+
+  virtual void Run ()
+  {
+    MultiModelSpectrumChannelTestLossModel::ApplyGain (*m_txPsd, m_distance, *m_rxPsd);
+  }
+
+private:
+  Ptr<const SpectrumValue> m_txPsd;
+  double m_distance;
+  Ptr<SpectrumValue> m_rxPsd;
+};
+
+void
+MultiModelSpectrumChannelTestLossModel::ApplyGain (const SpectrumValue &txPsd, double distance, SpectrumValue &rxPsd)
+{
+  for (uint32_t band = 0; band < txPsd.GetSpectrumModel ()->GetNumBands (); band++)
+    {
+      double gainRe = 0;
+      double gainIm = 0;
+      for (uint32_t k = 0; k < 200; k++)
+        {
+          gainRe += std::cos (distance * (band + 1) * k * 1e-3);
+          gainIm += std::sin (distance * (band + 1) * k * 1e-3);
+        }
+      rxPsd[band] = txPsd[band] * (gainRe * gainRe + gainIm * gainIm);
+    }
+}
+
+Ptr<SpectrumValue>
+MultiModelSpectrumChannelTestLossModel::DoCalcRxPowerSpectralDensity (Ptr<const SpectrumValue> txPsd,
+                                                                      Ptr<const MobilityModel> a,
+                                                                      Ptr<const MobilityModel> b) const
+{
+  Ptr<SpectrumValue> rxPsd = Create<SpectrumValue> (txPsd->GetSpectrumModel ());
+  ApplyGain (*txPsd, CalculateDistance (a->GetPosition (), b->GetPosition ()), *rxPsd);
+  return rxPsd;
+}
+
+Ptr<SpectrumValue>
+MultiModelSpectrumChannelTestLossModel::DoCalcRxPowerSpectralDensityDeferred (Ptr<const SpectrumValue> txPsd,
+                                                                              Ptr<const MobilityModel> a,
+                                                                              Ptr<const MobilityModel> b,
+                                                                              SpectrumPropagationLossJobList &jobs) const
+{
+  Ptr<SpectrumValue> rxPsd = Create<SpectrumValue> (txPsd->GetSpectrumModel ());
+  jobs.push_back (Create<MultiModelSpectrumChannelTestLossJob> (txPsd, CalculateDistance (a->GetPosition (), b->GetPosition ()), rxPsd));
+  return rxPsd;
+}
+
+/**
+ * \brief Test that the received PSDs of a MultiModelSpectrumChannel with
+ * several FanOutThreads are identical to the ones of the serial fan-out,
+ * and are delivered to the receivers in the same order
+ *
+ * Both channels share their receivers. Several transmissions are sent, so
+ * that the worker threads are reused.
+ */
+class MultiModelSpectrumChannelFanOutTestCase : public TestCase
+{
+public:
+  /**
+   * \param numThreads the FanOutThreads of the parallel channel
+   */
+  MultiModelSpectrumChannelFanOutTestCase (uint32_t numThreads);
+  virtual ~MultiModelSpectrumChannelFanOutTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Transmit the same signal on the serial and on the parallel channel
+   */
+  void Transmit ();
+
+  /**
+   * \brief Compare the receptions of the last transmission
+   */
+  void Check ();
+
+  uint32_t m_numThreads;
+  Ptr<MultiModelSpectrumChannel> m_serialChannel;
+  Ptr<MultiModelSpectrumChannel> m_parallelChannel;
+  Ptr<MultiModelSpectrumChannelTestPhy> m_serialTx;
+  Ptr<MultiModelSpectrumChannelTestPhy> m_parallelTx;
+  Ptr<SpectrumValue> m_txPsd;
+  std::vector<MultiModelSpectrumChannelTestRx> m_log;
+  uint32_t m_numChecked; //!< receptions compared
+};
+
+MultiModelSpectrumChannelFanOutTestCase::MultiModelSpectrumChannelFanOutTestCase (uint32_t numThreads)
+  : TestCase ("MultiModelSpectrumChannel fan-out on " + std::to_string (numThreads) + " threads against 1 thread"),
+    m_numThreads (numThreads),
+    m_numChecked (0)
+{
+}
+
+MultiModelSpectrumChannelFanOutTestCase::~MultiModelSpectrumChannelFanOutTestCase ()
+{
+}
+
+void
+MultiModelSpectrumChannelFanOutTestCase::Transmit ()
+{
+  m_log.clear ();
+  Ptr<SpectrumSignalParameters> params = Create<SpectrumSignalParameters> ();
+  params->psd = m_txPsd;
+  params->duration = MicroSeconds (10);
+  params->txPhy = m_serialTx;
+  m_serialChannel->StartTx (params);
+
+  params = Create<SpectrumSignalParameters> ();
+  params->psd = m_txPsd;
+  params->duration = MicroSeconds (10);
+  params->txPhy = m_parallelTx;
+  m_parallelChannel->StartTx (params);
+
+  Simulator::ScheduleNow (&MultiModelSpectrumChannelFanOutTestCase::Check, this);
+}
+
+void
+MultiModelSpectrumChannelFanOutTestCase::Check ()
+{
+  std::vector<MultiModelSpectrumChannelTestRx> expected;
+  std::vector<MultiModelSpectrumChannelTestRx> actual;
+  for (std::vector<MultiModelSpectrumChannelTestRx>::const_iterator it = m_log.begin (); it != m_log.end (); ++it)
+    {
+      if (it->m_txPhy == m_parallelTx)
+        {
+          actual.push_back (*it);
+        }
+      else
+        {
+          expected.push_back (*it);
+        }
+    }
+
+  NS_TEST_ASSERT_MSG_EQ (actual.size (), expected.size (), "wrong number of receptions");
+  for (uint32_t i = 0; i < actual.size () && i < expected.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (actual[i].m_rxId, expected[i].m_rxId, "different receiver at position " << i);
+      for (uint32_t band = 0; band < expected[i].m_psd->GetSpectrumModel ()->GetNumBands (); band++)
+        {
+          NS_TEST_ASSERT_MSG_EQ ((*actual[i].m_psd)[band], (*expected[i].m_psd)[band],
+                                 "different PSD of receiver " << actual[i].m_rxId << " in band " << band);
+        }
+      m_numChecked++;
+    }
+}
+
+void
+MultiModelSpectrumChannelFanOutTestCase::DoRun (void)
+{
+  std::vector<double> freqs;
+  for (int i = 0; i < 16; i++)
+    {
+      freqs.push_back (28e9 + 1e6 * i);
+    }
+  Ptr<SpectrumModel> sm = Create<SpectrumModel> (freqs);
+  m_txPsd = Create<SpectrumValue> (sm);
+  for (int i = 0; i < 16; i++)
+    {
+      (*m_txPsd)[i] = 1e-9 * (i + 1);
+    }
+
+  m_serialChannel = CreateObject<MultiModelSpectrumChannel> ();
+  m_serialChannel->AddSpectrumPropagationLossModel (CreateObject<MultiModelSpectrumChannelTestLossModel> ());
+  m_parallelChannel = CreateObject<MultiModelSpectrumChannel> ();
+  m_parallelChannel->SetAttribute ("FanOutThreads", UintegerValue (m_numThreads));
+  m_parallelChannel->AddSpectrumPropagationLossModel (CreateObject<MultiModelSpectrumChannelTestLossModel> ());
+
+  Ptr<ConstantVelocityMobilityModel> txMobility = CreateObject<ConstantVelocityMobilityModel> ();
+  txMobility->SetPosition (Vector (0, 0, 10));
+  txMobility->SetVelocity (Vector (20, 5, 0));
+  m_serialTx = CreateObject<MultiModelSpectrumChannelTestPhy> (1000, sm, &m_log);
+  m_serialTx->SetMobility (txMobility);
+  m_parallelTx = CreateObject<MultiModelSpectrumChannelTestPhy> (1000, sm, &m_log);
+  m_parallelTx->SetMobility (txMobility);
+
+  for (uint32_t id = 0; id < 25; id++)
+    {
+      Ptr<MultiModelSpectrumChannelTestPhy> phy = CreateObject<MultiModelSpectrumChannelTestPhy> (id, sm, &m_log);
+      Ptr<ConstantPositionMobilityModel> mobility = CreateObject<ConstantPositionMobilityModel> ();
+      mobility->SetPosition (Vector ((id * 37) % 500 - 250.0, (id * 53) % 400 - 200.0, 1.5));
+      phy->SetMobility (mobility);
+      m_serialChannel->AddRx (phy);
+      m_parallelChannel->AddRx (phy);
+    }
+
+  for (uint32_t t = 0; t < 20; t++)
+    {
+      Simulator::Schedule (Seconds (t * 0.1), &MultiModelSpectrumChannelFanOutTestCase::Transmit, this);
+    }
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_numChecked, 20 * 25, "wrong number of receptions compared");
+
+  m_serialChannel->Dispose ();
+  m_parallelChannel->Dispose ();
+}
+
+/**
+ * \brief MultiModelSpectrumChannel test suite
+ */
+class MultiModelSpectrumChannelTestSuite : public TestSuite
+{
+public:
+  MultiModelSpectrumChannelTestSuite ();
+};
+
+MultiModelSpectrumChannelTestSuite::MultiModelSpectrumChannelTestSuite ()
+  : TestSuite ("multi-model-spectrum-channel", UNIT)
+{
+  AddTestCase (new MultiModelSpectrumChannelMaxRangeTestCase, TestCase::QUICK);
+  AddTestCase (new MultiModelSpectrumChannelFanOutTestCase (2), TestCase::QUICK);
+  AddTestCase (new MultiModelSpectrumChannelFanOutTestCase (4), TestCase::QUICK);
+}
+
+static MultiModelSpectrumChannelTestSuite g_multiModelSpectrumChannelTestSuite;
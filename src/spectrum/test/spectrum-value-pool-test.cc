@@ -0,0 +1,160 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <ns3/spectrum-value.h>
+#include <ns3/spectrum-value-pool.h>
+#include <ns3/uinteger.h>
+#include <ns3/test.h>
+
+#include "spectrum-test.h"
+
+using namespace ns3;
+
+/**
+ * \brief Test the reuse of the SpectrumValue instances by the SpectrumValuePool
+ *
+ * The values released beyond the MaxPerModel limit are deleted, the pooled
+ * values are only reused for their own SpectrumModel, the copies have the
+ * values of the original and SpectrumValuePool::Allocate returns zeroed
+ * values. Once the pool is disabled the values are deleted.
+ */
+class SpectrumValuePoolTestCase : public TestCase
+{
+public:
+  SpectrumValuePoolTestCase ();
+  virtual ~SpectrumValuePoolTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Check the counters of the pool
+   * \param allocations the expected heap allocations
+   * \param reuses the expected reuses
+   * \param releases the expected releases
+   * \param deletions the expected deletions
+   * \param msg the message of the failures
+   */
+  void CheckCounters (uint64_t allocations, uint64_t reuses, uint64_t releases, uint64_t deletions,
+                      std::string msg);
+};
+
+SpectrumValuePoolTestCase::SpectrumValuePoolTestCase ()
+  : TestCase ("SpectrumValuePool reuse and release of the values")
+{
+}
+
+SpectrumValuePoolTestCase::~SpectrumValuePoolTestCase ()
+{
+}
+
+void
+SpectrumValuePoolTestCase::CheckCounters (uint64_t allocations, uint64_t reuses, uint64_t releases,
+                                          uint64_t deletions, std::string msg)
+{
+  SpectrumValuePool *pool = SpectrumValuePool::Get ();
+  NS_TEST_ASSERT_MSG_EQ (pool->GetAllocations (), allocations, msg << ": wrong number of allocations");
+  NS_TEST_ASSERT_MSG_EQ (pool->GetReuses (), reuses, msg << ": wrong number of reuses");
+  NS_TEST_ASSERT_MSG_EQ (pool->GetReleases (), releases, msg << ": wrong number of releases");
+  NS_TEST_ASSERT_MSG_EQ (pool->GetDeletions (), deletions, msg << ": wrong number of deletions");
+}
+
+void
+SpectrumValuePoolTestCase::DoRun (void)
+{
+  SpectrumValuePool *pool = SpectrumValuePool::Get ();
+  UintegerValue maxPerModel;
+  pool->GetAttribute ("MaxPerModel", maxPerModel);
+  pool->SetAttribute ("MaxPerModel", UintegerValue (2));
+  pool->Clear ();
+
+  std::vector<double> freqs;
+  for (int i = 0; i < 4; i++)
+    {
+      freqs.push_back (1e9 + 1e6 * i);
+    }
+  Ptr<SpectrumModel> sm = Create<SpectrumModel> (freqs);
+  Ptr<SpectrumModel> other = Create<SpectrumModel> (freqs);
+
+  Ptr<SpectrumValue> v = Create<SpectrumValue> (sm);
+  for (int i = 0; i < 4; i++)
+    {
+      (*v)[i] = i + 1.0;
+    }
+
+  Ptr<SpectrumValue> c1 = v->Copy ();
+  Ptr<SpectrumValue> c2 = Copy<SpectrumValue> (v);
+  Ptr<SpectrumValue> c3 = v->Copy ();
+  CheckCounters (3, 0, 0, 0, "first copies");
+  NS_TEST_ASSERT_MSG_SPECTRUM_VALUE_EQ_TOL (*c2, *v, 0.0, "wrong copy");
+
+  c1 = 0;
+  c2 = 0;
+  c3 = 0;
+  CheckCounters (3, 0, 2, 1, "release beyond MaxPerModel");
+
+  // a pooled value of sm is not given to another model
+  Ptr<SpectrumValue> o = Create<SpectrumValue> (other);
+  Ptr<SpectrumValue> oc = o->Copy ();
+  CheckCounters (4, 0, 2, 1, "copy of another model");
+  NS_TEST_ASSERT_MSG_EQ (oc->GetSpectrumModelUid (), other->GetUid (), "wrong model of the copy");
+
+  Ptr<SpectrumValue> c4 = v->Copy ();
+  CheckCounters (4, 1, 2, 1, "copy from the pool");
+  NS_TEST_ASSERT_MSG_EQ (c4->GetSpectrumModelUid (), sm->GetUid (), "wrong model of the pooled copy");
+  NS_TEST_ASSERT_MSG_SPECTRUM_VALUE_EQ_TOL (*c4, *v, 0.0, "wrong pooled copy");
+
+  // the last pooled value holds the values of v, it is zeroed
+  Ptr<SpectrumValue> a1 = SpectrumValuePool::Allocate (sm);
+  Ptr<SpectrumValue> a2 = SpectrumValuePool::Allocate (sm);
+  CheckCounters (5, 2, 2, 1, "allocations");
+  for (int i = 0; i < 4; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ ((*a1)[i], 0.0, "pooled allocation not zeroed");
+      NS_TEST_ASSERT_MSG_EQ ((*a2)[i], 0.0, "heap allocation not zeroed");
+    }
+
+  SpectrumValuePool::NotifyShared ();
+  NS_TEST_ASSERT_MSG_EQ (pool->GetShares (), 1, "wrong number of shares");
+
+  // once disabled, the pool neither keeps nor counts the released values
+  pool->SetAttribute ("MaxPerModel", UintegerValue (0));
+  c4 = 0;
+  a1 = 0;
+  a2 = 0;
+  oc = 0;
+  CheckCounters (5, 2, 2, 1, "disabled pool");
+
+  pool->SetAttribute ("MaxPerModel", maxPerModel);
+  pool->Clear ();
+}
+
+/**
+ * \brief SpectrumValuePool test suite
+ */
+class SpectrumValuePoolTestSuite : public TestSuite
+{
+public:
+  SpectrumValuePoolTestSuite ();
+};
+
+SpectrumValuePoolTestSuite::SpectrumValuePoolTestSuite ()
+  : TestSuite ("spectrum-value-pool", UNIT)
+{
+  AddTestCase (new SpectrumValuePoolTestCase, TestCase::QUICK);
+}
+
+static SpectrumValuePoolTestSuite g_spectrumValuePoolTestSuite;